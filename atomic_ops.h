@@ -26,11 +26,35 @@
 	#define ATTR_ALIGNED(X)
 #endif
 
+// Force alignment to boundary X, for types the hardware requires it on
+#if defined(SYSTEM_CC_GNUCC)
+	#define ATOMIC_OPS_ALIGNED(X) __attribute__((__aligned__(X)))
+#else
+	#define ATOMIC_OPS_ALIGNED(X) ATTR_ALIGNED(X)
+#endif
+
 // Compiler define: always inline functions
 #if !defined(ATTR_ALWAYSINLINE)
 	#define ATTR_ALWAYSINLINE
 #endif
 
+// Size of a cache line, to keep independently written data apart
+#if !defined(ATOMIC_OPS_CACHELINE_SIZE)
+	#define ATOMIC_OPS_CACHELINE_SIZE 64
+#endif
+
+// Distance that keeps independently written data from slowing each other down:
+// more than a cache line where the hardware prefetches lines in adjacent pairs
+#if !defined(ATOMIC_OPS_DESTRUCTIVE_SIZE)
+	#if defined(SYSTEM_CPU_X86) || defined(SYSTEM_CPU_X86_64) || defined(SYSTEM_CPU_PPC)
+		#define ATOMIC_OPS_DESTRUCTIVE_SIZE 128
+	#elif defined(__GCC_DESTRUCTIVE_SIZE)
+		#define ATOMIC_OPS_DESTRUCTIVE_SIZE __GCC_DESTRUCTIVE_SIZE
+	#else
+		#define ATOMIC_OPS_DESTRUCTIVE_SIZE ATOMIC_OPS_CACHELINE_SIZE
+	#endif
+#endif
+
 // Suppress unused argument warnings, if needed
 #define UNUSED_ARGUMENT(arg) (void)(arg)
 
@@ -47,7 +71,43 @@ typedef struct { void * volatile v; } atomic_ops_ptr ATTR_ALIGNED(sizeof(void *)
 #define ATOMIC_OPS_PTR_INIT(X) { ((void *)(X)) }
 
 typedef struct { atomic_ops_ptr p; } atomic_ops_flagptr ATTR_ALIGNED(sizeof(void *));
-#define ATOMIC_OPS_FLAGPTR_INIT(P, F) { (ATOMIC_OPS_PTR_INIT((void *)(((uintptr_t)(P)) | ((uintptr_t)(F))))) }
+#define ATOMIC_OPS_FLAGPTR_INIT(P, F) { ATOMIC_OPS_PTR_INIT((void *)(((uintptr_t)(P)) | ((uintptr_t)(F)))) }
+
+// Double-width: two words, compared and swapped together ('lo' is at the lower address)
+typedef struct { uintptr_t lo; uintptr_t hi; } atomic_ops_dptr_val;
+typedef struct { volatile uintptr_t lo; volatile uintptr_t hi; } atomic_ops_dptr ATOMIC_OPS_ALIGNED(2 * sizeof(uintptr_t));
+#define ATOMIC_OPS_DPTR_INIT(LO, HI) { ((uintptr_t)(LO)), ((uintptr_t)(HI)) }
+
+// Fixed-width: for compact arrays of small atomics (64 bit ones only where uintptr_t is 64 bit)
+typedef struct { volatile int8_t   v; } atomic_ops_i8  ATTR_ALIGNED(sizeof(int8_t));
+typedef struct { volatile uint8_t  v; } atomic_ops_u8  ATTR_ALIGNED(sizeof(uint8_t));
+typedef struct { volatile int16_t  v; } atomic_ops_i16 ATTR_ALIGNED(sizeof(int16_t));
+typedef struct { volatile uint16_t v; } atomic_ops_u16 ATTR_ALIGNED(sizeof(uint16_t));
+typedef struct { volatile int32_t  v; } atomic_ops_i32 ATTR_ALIGNED(sizeof(int32_t));
+typedef struct { volatile uint32_t v; } atomic_ops_u32 ATTR_ALIGNED(sizeof(uint32_t));
+#if UINTPTR_MAX == UINT64_MAX
+typedef struct { volatile int64_t  v; } atomic_ops_i64 ATTR_ALIGNED(sizeof(int64_t));
+typedef struct { volatile uint64_t v; } atomic_ops_u64 ATTR_ALIGNED(sizeof(uint64_t));
+#endif
+#define ATOMIC_OPS_I8_INIT(X)  { ((int8_t)(X)) }
+#define ATOMIC_OPS_U8_INIT(X)  { ((uint8_t)(X)) }
+#define ATOMIC_OPS_I16_INIT(X) { ((int16_t)(X)) }
+#define ATOMIC_OPS_U16_INIT(X) { ((uint16_t)(X)) }
+#define ATOMIC_OPS_I32_INIT(X) { ((int32_t)(X)) }
+#define ATOMIC_OPS_U32_INIT(X) { ((uint32_t)(X)) }
+#if UINTPTR_MAX == UINT64_MAX
+#define ATOMIC_OPS_I64_INIT(X) { ((int64_t)(X)) }
+#define ATOMIC_OPS_U64_INIT(X) { ((uint64_t)(X)) }
+#endif
+
+// Padded: alone in a block of ATOMIC_OPS_DESTRUCTIVE_SIZE bytes, never sharing a line with other data
+// (heap-allocated ones need aligned_alloc(ATOMIC_OPS_DESTRUCTIVE_SIZE, ...) for that)
+typedef struct { atomic_ops_int  a; char pad[ATOMIC_OPS_DESTRUCTIVE_SIZE - sizeof(atomic_ops_int)];  } atomic_ops_int_padded  ATOMIC_OPS_ALIGNED(ATOMIC_OPS_DESTRUCTIVE_SIZE);
+typedef struct { atomic_ops_uint a; char pad[ATOMIC_OPS_DESTRUCTIVE_SIZE - sizeof(atomic_ops_uint)]; } atomic_ops_uint_padded ATOMIC_OPS_ALIGNED(ATOMIC_OPS_DESTRUCTIVE_SIZE);
+typedef struct { atomic_ops_ptr  a; char pad[ATOMIC_OPS_DESTRUCTIVE_SIZE - sizeof(atomic_ops_ptr)];  } atomic_ops_ptr_padded  ATOMIC_OPS_ALIGNED(ATOMIC_OPS_DESTRUCTIVE_SIZE);
+#define ATOMIC_OPS_INT_PADDED_INIT(X)  { ATOMIC_OPS_INT_INIT(X),  { 0 } }
+#define ATOMIC_OPS_UINT_PADDED_INIT(X) { ATOMIC_OPS_UINT_INIT(X), { 0 } }
+#define ATOMIC_OPS_PTR_PADDED_INIT(X)  { ATOMIC_OPS_PTR_INIT(X),  { 0 } }
 
 typedef enum {
 	ATOMIC_OPS_FENCE_NONE    = (1 << 0), // Compiler barrier (don't let the compiler reorder)
@@ -74,9 +134,17 @@ static inline void atomic_ops_int_dec(atomic_ops_int *atomic, ATOMIC_OPS_FENCE f
 static inline intptr_t atomic_ops_int_fetch_and_add(atomic_ops_int *atomic, intptr_t val, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
 static inline intptr_t atomic_ops_int_fetch_and_inc(atomic_ops_int *atomic, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
 static inline intptr_t atomic_ops_int_fetch_and_dec(atomic_ops_int *atomic, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline intptr_t atomic_ops_int_fetch_and_and(atomic_ops_int *atomic, intptr_t val, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline intptr_t atomic_ops_int_fetch_and_or(atomic_ops_int *atomic, intptr_t val, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline intptr_t atomic_ops_int_fetch_and_xor(atomic_ops_int *atomic, intptr_t val, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline intptr_t atomic_ops_int_fetch_min(atomic_ops_int *atomic, intptr_t val, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline intptr_t atomic_ops_int_fetch_max(atomic_ops_int *atomic, intptr_t val, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
 static inline intptr_t atomic_ops_int_casr(atomic_ops_int *atomic, intptr_t oldval, intptr_t newval, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
 static inline bool atomic_ops_int_cas(atomic_ops_int *atomic, intptr_t oldval, intptr_t newval, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
 static inline intptr_t atomic_ops_int_swap(atomic_ops_int *atomic, intptr_t val, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline bool atomic_ops_int_test_and_set_bit(atomic_ops_int *atomic, unsigned int bit, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline bool atomic_ops_int_test_and_clear_bit(atomic_ops_int *atomic, unsigned int bit, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline bool atomic_ops_int_test_and_complement_bit(atomic_ops_int *atomic, unsigned int bit, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
 
 static inline uintptr_t atomic_ops_uint_load(const atomic_ops_uint *atomic, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
 static inline void atomic_ops_uint_store(atomic_ops_uint *atomic, uintptr_t val, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
@@ -90,9 +158,17 @@ static inline void atomic_ops_uint_dec(atomic_ops_uint *atomic, ATOMIC_OPS_FENCE
 static inline uintptr_t atomic_ops_uint_fetch_and_add(atomic_ops_uint *atomic, uintptr_t val, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
 static inline uintptr_t atomic_ops_uint_fetch_and_inc(atomic_ops_uint *atomic, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
 static inline uintptr_t atomic_ops_uint_fetch_and_dec(atomic_ops_uint *atomic, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline uintptr_t atomic_ops_uint_fetch_and_and(atomic_ops_uint *atomic, uintptr_t val, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline uintptr_t atomic_ops_uint_fetch_and_or(atomic_ops_uint *atomic, uintptr_t val, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline uintptr_t atomic_ops_uint_fetch_and_xor(atomic_ops_uint *atomic, uintptr_t val, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline uintptr_t atomic_ops_uint_fetch_min(atomic_ops_uint *atomic, uintptr_t val, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline uintptr_t atomic_ops_uint_fetch_max(atomic_ops_uint *atomic, uintptr_t val, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
 static inline uintptr_t atomic_ops_uint_casr(atomic_ops_uint *atomic, uintptr_t oldval, uintptr_t newval, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
 static inline bool atomic_ops_uint_cas(atomic_ops_uint *atomic, uintptr_t oldval, uintptr_t newval, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
 static inline uintptr_t atomic_ops_uint_swap(atomic_ops_uint *atomic, uintptr_t val, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline bool atomic_ops_uint_test_and_set_bit(atomic_ops_uint *atomic, unsigned int bit, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline bool atomic_ops_uint_test_and_clear_bit(atomic_ops_uint *atomic, unsigned int bit, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline bool atomic_ops_uint_test_and_complement_bit(atomic_ops_uint *atomic, unsigned int bit, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
 
 static inline void * atomic_ops_ptr_load(const atomic_ops_ptr *atomic, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
 static inline void atomic_ops_ptr_store(atomic_ops_ptr *atomic, void *val, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
@@ -115,6 +191,223 @@ static inline void * atomic_ops_flagptr_casr(atomic_ops_flagptr *atomic, bool *f
 static inline bool atomic_ops_flagptr_cas(atomic_ops_flagptr *atomic, void *oldptr, bool oldflag, void *newptr, bool newflag, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
 static inline void * atomic_ops_flagptr_swap(atomic_ops_flagptr *atomic, bool *flag, void *newptr, bool newflag, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
 
+/*
+ * Double-Width Functions
+ */
+
+static inline atomic_ops_dptr_val atomic_ops_dptr_load(const atomic_ops_dptr *atomic, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_dptr_store(atomic_ops_dptr *atomic, atomic_ops_dptr_val val, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline atomic_ops_dptr_val atomic_ops_dptr_casr(atomic_ops_dptr *atomic, atomic_ops_dptr_val oldval, atomic_ops_dptr_val newval, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline bool atomic_ops_dptr_cas(atomic_ops_dptr *atomic, atomic_ops_dptr_val oldval, atomic_ops_dptr_val newval, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+
+/*
+ * Fixed-Width Functions
+ */
+
+static inline int8_t atomic_ops_i8_load(const atomic_ops_i8 *atomic, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_i8_store(atomic_ops_i8 *atomic, int8_t val, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_i8_not(atomic_ops_i8 *atomic, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_i8_and(atomic_ops_i8 *atomic, int8_t val, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_i8_or(atomic_ops_i8 *atomic, int8_t val, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_i8_xor(atomic_ops_i8 *atomic, int8_t val, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_i8_add(atomic_ops_i8 *atomic, int8_t val, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_i8_inc(atomic_ops_i8 *atomic, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_i8_dec(atomic_ops_i8 *atomic, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline int8_t atomic_ops_i8_fetch_and_add(atomic_ops_i8 *atomic, int8_t val, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline int8_t atomic_ops_i8_fetch_and_inc(atomic_ops_i8 *atomic, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline int8_t atomic_ops_i8_fetch_and_dec(atomic_ops_i8 *atomic, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline int8_t atomic_ops_i8_casr(atomic_ops_i8 *atomic, int8_t oldval, int8_t newval, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline bool atomic_ops_i8_cas(atomic_ops_i8 *atomic, int8_t oldval, int8_t newval, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline int8_t atomic_ops_i8_swap(atomic_ops_i8 *atomic, int8_t val, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+
+static inline uint8_t atomic_ops_u8_load(const atomic_ops_u8 *atomic, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_u8_store(atomic_ops_u8 *atomic, uint8_t val, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_u8_not(atomic_ops_u8 *atomic, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_u8_and(atomic_ops_u8 *atomic, uint8_t val, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_u8_or(atomic_ops_u8 *atomic, uint8_t val, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_u8_xor(atomic_ops_u8 *atomic, uint8_t val, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_u8_add(atomic_ops_u8 *atomic, uint8_t val, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_u8_inc(atomic_ops_u8 *atomic, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_u8_dec(atomic_ops_u8 *atomic, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline uint8_t atomic_ops_u8_fetch_and_add(atomic_ops_u8 *atomic, uint8_t val, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline uint8_t atomic_ops_u8_fetch_and_inc(atomic_ops_u8 *atomic, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline uint8_t atomic_ops_u8_fetch_and_dec(atomic_ops_u8 *atomic, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline uint8_t atomic_ops_u8_casr(atomic_ops_u8 *atomic, uint8_t oldval, uint8_t newval, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline bool atomic_ops_u8_cas(atomic_ops_u8 *atomic, uint8_t oldval, uint8_t newval, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline uint8_t atomic_ops_u8_swap(atomic_ops_u8 *atomic, uint8_t val, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+
+static inline int16_t atomic_ops_i16_load(const atomic_ops_i16 *atomic, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_i16_store(atomic_ops_i16 *atomic, int16_t val, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_i16_not(atomic_ops_i16 *atomic, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_i16_and(atomic_ops_i16 *atomic, int16_t val, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_i16_or(atomic_ops_i16 *atomic, int16_t val, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_i16_xor(atomic_ops_i16 *atomic, int16_t val, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_i16_add(atomic_ops_i16 *atomic, int16_t val, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_i16_inc(atomic_ops_i16 *atomic, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_i16_dec(atomic_ops_i16 *atomic, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline int16_t atomic_ops_i16_fetch_and_add(atomic_ops_i16 *atomic, int16_t val, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline int16_t atomic_ops_i16_fetch_and_inc(atomic_ops_i16 *atomic, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline int16_t atomic_ops_i16_fetch_and_dec(atomic_ops_i16 *atomic, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline int16_t atomic_ops_i16_casr(atomic_ops_i16 *atomic, int16_t oldval, int16_t newval, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline bool atomic_ops_i16_cas(atomic_ops_i16 *atomic, int16_t oldval, int16_t newval, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline int16_t atomic_ops_i16_swap(atomic_ops_i16 *atomic, int16_t val, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+
+static inline uint16_t atomic_ops_u16_load(const atomic_ops_u16 *atomic, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_u16_store(atomic_ops_u16 *atomic, uint16_t val, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_u16_not(atomic_ops_u16 *atomic, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_u16_and(atomic_ops_u16 *atomic, uint16_t val, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_u16_or(atomic_ops_u16 *atomic, uint16_t val, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_u16_xor(atomic_ops_u16 *atomic, uint16_t val, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_u16_add(atomic_ops_u16 *atomic, uint16_t val, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_u16_inc(atomic_ops_u16 *atomic, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_u16_dec(atomic_ops_u16 *atomic, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline uint16_t atomic_ops_u16_fetch_and_add(atomic_ops_u16 *atomic, uint16_t val, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline uint16_t atomic_ops_u16_fetch_and_inc(atomic_ops_u16 *atomic, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline uint16_t atomic_ops_u16_fetch_and_dec(atomic_ops_u16 *atomic, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline uint16_t atomic_ops_u16_casr(atomic_ops_u16 *atomic, uint16_t oldval, uint16_t newval, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline bool atomic_ops_u16_cas(atomic_ops_u16 *atomic, uint16_t oldval, uint16_t newval, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline uint16_t atomic_ops_u16_swap(atomic_ops_u16 *atomic, uint16_t val, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+
+static inline int32_t atomic_ops_i32_load(const atomic_ops_i32 *atomic, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_i32_store(atomic_ops_i32 *atomic, int32_t val, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_i32_not(atomic_ops_i32 *atomic, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_i32_and(atomic_ops_i32 *atomic, int32_t val, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_i32_or(atomic_ops_i32 *atomic, int32_t val, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_i32_xor(atomic_ops_i32 *atomic, int32_t val, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_i32_add(atomic_ops_i32 *atomic, int32_t val, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_i32_inc(atomic_ops_i32 *atomic, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_i32_dec(atomic_ops_i32 *atomic, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline int32_t atomic_ops_i32_fetch_and_add(atomic_ops_i32 *atomic, int32_t val, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline int32_t atomic_ops_i32_fetch_and_inc(atomic_ops_i32 *atomic, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline int32_t atomic_ops_i32_fetch_and_dec(atomic_ops_i32 *atomic, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline int32_t atomic_ops_i32_casr(atomic_ops_i32 *atomic, int32_t oldval, int32_t newval, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline bool atomic_ops_i32_cas(atomic_ops_i32 *atomic, int32_t oldval, int32_t newval, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline int32_t atomic_ops_i32_swap(atomic_ops_i32 *atomic, int32_t val, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+
+static inline uint32_t atomic_ops_u32_load(const atomic_ops_u32 *atomic, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_u32_store(atomic_ops_u32 *atomic, uint32_t val, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_u32_not(atomic_ops_u32 *atomic, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_u32_and(atomic_ops_u32 *atomic, uint32_t val, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_u32_or(atomic_ops_u32 *atomic, uint32_t val, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_u32_xor(atomic_ops_u32 *atomic, uint32_t val, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_u32_add(atomic_ops_u32 *atomic, uint32_t val, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_u32_inc(atomic_ops_u32 *atomic, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_u32_dec(atomic_ops_u32 *atomic, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline uint32_t atomic_ops_u32_fetch_and_add(atomic_ops_u32 *atomic, uint32_t val, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline uint32_t atomic_ops_u32_fetch_and_inc(atomic_ops_u32 *atomic, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline uint32_t atomic_ops_u32_fetch_and_dec(atomic_ops_u32 *atomic, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline uint32_t atomic_ops_u32_casr(atomic_ops_u32 *atomic, uint32_t oldval, uint32_t newval, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline bool atomic_ops_u32_cas(atomic_ops_u32 *atomic, uint32_t oldval, uint32_t newval, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline uint32_t atomic_ops_u32_swap(atomic_ops_u32 *atomic, uint32_t val, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+
+#if UINTPTR_MAX == UINT64_MAX
+
+static inline int64_t atomic_ops_i64_load(const atomic_ops_i64 *atomic, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_i64_store(atomic_ops_i64 *atomic, int64_t val, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_i64_not(atomic_ops_i64 *atomic, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_i64_and(atomic_ops_i64 *atomic, int64_t val, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_i64_or(atomic_ops_i64 *atomic, int64_t val, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_i64_xor(atomic_ops_i64 *atomic, int64_t val, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_i64_add(atomic_ops_i64 *atomic, int64_t val, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_i64_inc(atomic_ops_i64 *atomic, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_i64_dec(atomic_ops_i64 *atomic, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline int64_t atomic_ops_i64_fetch_and_add(atomic_ops_i64 *atomic, int64_t val, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline int64_t atomic_ops_i64_fetch_and_inc(atomic_ops_i64 *atomic, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline int64_t atomic_ops_i64_fetch_and_dec(atomic_ops_i64 *atomic, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline int64_t atomic_ops_i64_casr(atomic_ops_i64 *atomic, int64_t oldval, int64_t newval, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline bool atomic_ops_i64_cas(atomic_ops_i64 *atomic, int64_t oldval, int64_t newval, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline int64_t atomic_ops_i64_swap(atomic_ops_i64 *atomic, int64_t val, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+
+static inline uint64_t atomic_ops_u64_load(const atomic_ops_u64 *atomic, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_u64_store(atomic_ops_u64 *atomic, uint64_t val, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_u64_not(atomic_ops_u64 *atomic, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_u64_and(atomic_ops_u64 *atomic, uint64_t val, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_u64_or(atomic_ops_u64 *atomic, uint64_t val, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_u64_xor(atomic_ops_u64 *atomic, uint64_t val, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_u64_add(atomic_ops_u64 *atomic, uint64_t val, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_u64_inc(atomic_ops_u64 *atomic, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_u64_dec(atomic_ops_u64 *atomic, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline uint64_t atomic_ops_u64_fetch_and_add(atomic_ops_u64 *atomic, uint64_t val, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline uint64_t atomic_ops_u64_fetch_and_inc(atomic_ops_u64 *atomic, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline uint64_t atomic_ops_u64_fetch_and_dec(atomic_ops_u64 *atomic, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline uint64_t atomic_ops_u64_casr(atomic_ops_u64 *atomic, uint64_t oldval, uint64_t newval, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline bool atomic_ops_u64_cas(atomic_ops_u64 *atomic, uint64_t oldval, uint64_t newval, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline uint64_t atomic_ops_u64_swap(atomic_ops_u64 *atomic, uint64_t val, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+
+#endif
+
+/*
+ * Padded Functions
+ */
+
+static inline intptr_t atomic_ops_int_padded_load(const atomic_ops_int_padded *atomic, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_int_padded_store(atomic_ops_int_padded *atomic, intptr_t val, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_int_padded_not(atomic_ops_int_padded *atomic, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_int_padded_and(atomic_ops_int_padded *atomic, intptr_t val, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_int_padded_or(atomic_ops_int_padded *atomic, intptr_t val, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_int_padded_xor(atomic_ops_int_padded *atomic, intptr_t val, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_int_padded_add(atomic_ops_int_padded *atomic, intptr_t val, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_int_padded_inc(atomic_ops_int_padded *atomic, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_int_padded_dec(atomic_ops_int_padded *atomic, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline intptr_t atomic_ops_int_padded_fetch_and_add(atomic_ops_int_padded *atomic, intptr_t val, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline intptr_t atomic_ops_int_padded_fetch_and_inc(atomic_ops_int_padded *atomic, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline intptr_t atomic_ops_int_padded_fetch_and_dec(atomic_ops_int_padded *atomic, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline intptr_t atomic_ops_int_padded_fetch_and_and(atomic_ops_int_padded *atomic, intptr_t val, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline intptr_t atomic_ops_int_padded_fetch_and_or(atomic_ops_int_padded *atomic, intptr_t val, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline intptr_t atomic_ops_int_padded_fetch_and_xor(atomic_ops_int_padded *atomic, intptr_t val, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline intptr_t atomic_ops_int_padded_fetch_min(atomic_ops_int_padded *atomic, intptr_t val, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline intptr_t atomic_ops_int_padded_fetch_max(atomic_ops_int_padded *atomic, intptr_t val, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline bool atomic_ops_int_padded_test_and_set_bit(atomic_ops_int_padded *atomic, unsigned int bit, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline bool atomic_ops_int_padded_test_and_clear_bit(atomic_ops_int_padded *atomic, unsigned int bit, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline bool atomic_ops_int_padded_test_and_complement_bit(atomic_ops_int_padded *atomic, unsigned int bit, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline intptr_t atomic_ops_int_padded_casr(atomic_ops_int_padded *atomic, intptr_t oldval, intptr_t newval, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline bool atomic_ops_int_padded_cas(atomic_ops_int_padded *atomic, intptr_t oldval, intptr_t newval, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline intptr_t atomic_ops_int_padded_swap(atomic_ops_int_padded *atomic, intptr_t val, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+
+static inline uintptr_t atomic_ops_uint_padded_load(const atomic_ops_uint_padded *atomic, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_uint_padded_store(atomic_ops_uint_padded *atomic, uintptr_t val, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_uint_padded_not(atomic_ops_uint_padded *atomic, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_uint_padded_and(atomic_ops_uint_padded *atomic, uintptr_t val, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_uint_padded_or(atomic_ops_uint_padded *atomic, uintptr_t val, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_uint_padded_xor(atomic_ops_uint_padded *atomic, uintptr_t val, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_uint_padded_add(atomic_ops_uint_padded *atomic, uintptr_t val, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_uint_padded_inc(atomic_ops_uint_padded *atomic, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_uint_padded_dec(atomic_ops_uint_padded *atomic, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline uintptr_t atomic_ops_uint_padded_fetch_and_add(atomic_ops_uint_padded *atomic, uintptr_t val, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline uintptr_t atomic_ops_uint_padded_fetch_and_inc(atomic_ops_uint_padded *atomic, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline uintptr_t atomic_ops_uint_padded_fetch_and_dec(atomic_ops_uint_padded *atomic, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline uintptr_t atomic_ops_uint_padded_fetch_and_and(atomic_ops_uint_padded *atomic, uintptr_t val, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline uintptr_t atomic_ops_uint_padded_fetch_and_or(atomic_ops_uint_padded *atomic, uintptr_t val, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline uintptr_t atomic_ops_uint_padded_fetch_and_xor(atomic_ops_uint_padded *atomic, uintptr_t val, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline uintptr_t atomic_ops_uint_padded_fetch_min(atomic_ops_uint_padded *atomic, uintptr_t val, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline uintptr_t atomic_ops_uint_padded_fetch_max(atomic_ops_uint_padded *atomic, uintptr_t val, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline bool atomic_ops_uint_padded_test_and_set_bit(atomic_ops_uint_padded *atomic, unsigned int bit, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline bool atomic_ops_uint_padded_test_and_clear_bit(atomic_ops_uint_padded *atomic, unsigned int bit, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline bool atomic_ops_uint_padded_test_and_complement_bit(atomic_ops_uint_padded *atomic, unsigned int bit, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline uintptr_t atomic_ops_uint_padded_casr(atomic_ops_uint_padded *atomic, uintptr_t oldval, uintptr_t newval, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline bool atomic_ops_uint_padded_cas(atomic_ops_uint_padded *atomic, uintptr_t oldval, uintptr_t newval, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline uintptr_t atomic_ops_uint_padded_swap(atomic_ops_uint_padded *atomic, uintptr_t val, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+
+static inline void * atomic_ops_ptr_padded_load(const atomic_ops_ptr_padded *atomic, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_ptr_padded_store(atomic_ops_ptr_padded *atomic, void *val, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline void * atomic_ops_ptr_padded_casr(atomic_ops_ptr_padded *atomic, void *oldval, void *newval, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline bool atomic_ops_ptr_padded_cas(atomic_ops_ptr_padded *atomic, void *oldval, void *newval, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+static inline void * atomic_ops_ptr_padded_swap(atomic_ops_ptr_padded *atomic, void *val, ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+
+/*
+ * Thread Functions
+ */
+
+static inline size_t atomic_ops_thread_slot(void) ATTR_ALWAYSINLINE;
+
+#if defined(ATOMIC_OPS_STATS)
+/*
+ * Statistics Functions (the rest in atomic_ops/stats.h)
+ */
+
+static inline void atomic_ops_stats_retry(void);
+#endif
+
 /*
  * Implementations
  */
@@ -126,12 +419,17 @@ static inline void * atomic_ops_flagptr_swap(atomic_ops_flagptr *atomic, bool *f
 		#include "atomic_ops/gcc/x86-64.h"
 	#elif defined(SYSTEM_CPU_SPARC)
 		#include "atomic_ops/gcc/sparcv9.h"
+	#elif defined(SYSTEM_CPU_AARCH64)
+		#include "atomic_ops/gcc/aarch64.h"
+	#elif defined(SYSTEM_CPU_ARM)
+		#include "atomic_ops/gcc/armv7.h"
+	#elif defined(__ATOMIC_RELAXED) && !defined(ATOMIC_OPS_SYNC_INTRINSICS)
+		// Everything else, POWER included: fence-aware __atomic builtins (GCC 4.7+, Clang)
+		#include "atomic_ops/gcc/atomic_intrinsics.h"
 	#elif defined(SYSTEM_CPU_IA64)
 		#include "atomic_ops/gcc/ia64.h"
 	#elif defined(SYSTEM_CPU_PPC)
 		#include "atomic_ops/gcc/ppc.h"
-	#elif defined(SYSTEM_CPU_ARM)
-		#include "atomic_ops/gcc/armv7.h"
 	#else
 		#include "atomic_ops/gcc/sync_intrinsics.h"
 	#endif
@@ -140,5 +438,12 @@ static inline void * atomic_ops_flagptr_swap(atomic_ops_flagptr *atomic, bool *f
 #endif
 
 #include "atomic_ops/flagptr.h"
+#include "atomic_ops/padded.h"
+#include "atomic_ops/thread.h"
+
+// Last: wraps all functions above in counting macros
+#if defined(ATOMIC_OPS_STATS)
+	#include "atomic_ops/stats.h"
+#endif
 
 #endif /* ATOMIC_OPS_H */
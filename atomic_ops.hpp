@@ -0,0 +1,326 @@
+/**
+ * This file is part of the atomic_ops project.
+ *
+ * For the full copyright and license information, please view the COPYING
+ * file that was distributed with this source code.
+ *
+ * @copyright  (c) the atomic_ops project
+ * @author     Luca Longinotti <chtekk@longitekk.com>
+ * @license    BSD 2-clause
+ * @version    $Id$
+ */
+
+#ifndef ATOMIC_OPS_HPP
+#define ATOMIC_OPS_HPP 1
+
+/*
+ * C++ front-end (C++11 and later).
+ * atomic_ops::atomic<T>, for integral and pointer T, and atomic_ops::flag_ptr<T>
+ * wrap the C types, with the fence of every operation as a template argument:
+ * a.load<ATOMIC_OPS_FENCE_ACQUIRE>(). The fence reaches the C function as a
+ * constant, whatever wrappers it goes through, so its if-chain on the fence
+ * always folds away: the generated code is the same as calling the C function
+ * with a literal fence. Operations default to FULL, like std::atomic does to
+ * seq_cst.
+ * Integral T maps to the C type of the same size and signedness: the word
+ * sized ones (int/uint) have every operation, the smaller fixed-width ones
+ * don't have fetch_and_and/or/xor, fetch_min/max and the bit operations.
+ */
+
+#include "atomic_ops.h"
+#include <type_traits>
+
+namespace atomic_ops {
+
+namespace detail {
+
+template <size_t Size, bool Signed> struct ops;
+
+#define ATOMIC_OPS_HPP_OPS(TYPE, MNEMONIC) \
+	typedef atomic_ops_##MNEMONIC atomic_type;																					\
+	typedef TYPE value_type;																									\
+																																\
+	ATTR_ALWAYSINLINE static inline TYPE load(const atomic_type *a, ATOMIC_OPS_FENCE f) {										\
+		return (atomic_ops_##MNEMONIC##_load(a, f));																			\
+	}																															\
+	ATTR_ALWAYSINLINE static inline void store(atomic_type *a, TYPE val, ATOMIC_OPS_FENCE f) {									\
+		atomic_ops_##MNEMONIC##_store(a, val, f);																				\
+	}																															\
+	ATTR_ALWAYSINLINE static inline void not_(atomic_type *a, ATOMIC_OPS_FENCE f) {											\
+		atomic_ops_##MNEMONIC##_not(a, f);																						\
+	}																															\
+	ATTR_ALWAYSINLINE static inline void and_(atomic_type *a, TYPE val, ATOMIC_OPS_FENCE f) {									\
+		atomic_ops_##MNEMONIC##_and(a, val, f);																					\
+	}																															\
+	ATTR_ALWAYSINLINE static inline void or_(atomic_type *a, TYPE val, ATOMIC_OPS_FENCE f) {									\
+		atomic_ops_##MNEMONIC##_or(a, val, f);																					\
+	}																															\
+	ATTR_ALWAYSINLINE static inline void xor_(atomic_type *a, TYPE val, ATOMIC_OPS_FENCE f) {									\
+		atomic_ops_##MNEMONIC##_xor(a, val, f);																					\
+	}																															\
+	ATTR_ALWAYSINLINE static inline void add(atomic_type *a, TYPE val, ATOMIC_OPS_FENCE f) {									\
+		atomic_ops_##MNEMONIC##_add(a, val, f);																					\
+	}																															\
+	ATTR_ALWAYSINLINE static inline void inc(atomic_type *a, ATOMIC_OPS_FENCE f) {												\
+		atomic_ops_##MNEMONIC##_inc(a, f);																						\
+	}																															\
+	ATTR_ALWAYSINLINE static inline void dec(atomic_type *a, ATOMIC_OPS_FENCE f) {												\
+		atomic_ops_##MNEMONIC##_dec(a, f);																						\
+	}																															\
+	ATTR_ALWAYSINLINE static inline TYPE fetch_and_add(atomic_type *a, TYPE val, ATOMIC_OPS_FENCE f) {							\
+		return (atomic_ops_##MNEMONIC##_fetch_and_add(a, val, f));																\
+	}																															\
+	ATTR_ALWAYSINLINE static inline TYPE fetch_and_inc(atomic_type *a, ATOMIC_OPS_FENCE f) {									\
+		return (atomic_ops_##MNEMONIC##_fetch_and_inc(a, f));																	\
+	}																															\
+	ATTR_ALWAYSINLINE static inline TYPE fetch_and_dec(atomic_type *a, ATOMIC_OPS_FENCE f) {									\
+		return (atomic_ops_##MNEMONIC##_fetch_and_dec(a, f));																	\
+	}																															\
+	ATTR_ALWAYSINLINE static inline TYPE casr(atomic_type *a, TYPE oldval, TYPE newval, ATOMIC_OPS_FENCE f) {					\
+		return (atomic_ops_##MNEMONIC##_casr(a, oldval, newval, f));															\
+	}																															\
+	ATTR_ALWAYSINLINE static inline bool cas(atomic_type *a, TYPE oldval, TYPE newval, ATOMIC_OPS_FENCE f) {					\
+		return (atomic_ops_##MNEMONIC##_cas(a, oldval, newval, f));																\
+	}																															\
+	ATTR_ALWAYSINLINE static inline TYPE swap(atomic_type *a, TYPE val, ATOMIC_OPS_FENCE f) {									\
+		return (atomic_ops_##MNEMONIC##_swap(a, val, f));																		\
+	}
+
+// Only int and uint have these
+#define ATOMIC_OPS_HPP_OPS_WORD(TYPE, MNEMONIC) \
+	ATTR_ALWAYSINLINE static inline TYPE fetch_and_and(atomic_type *a, TYPE val, ATOMIC_OPS_FENCE f) {							\
+		return (atomic_ops_##MNEMONIC##_fetch_and_and(a, val, f));																\
+	}																															\
+	ATTR_ALWAYSINLINE static inline TYPE fetch_and_or(atomic_type *a, TYPE val, ATOMIC_OPS_FENCE f) {							\
+		return (atomic_ops_##MNEMONIC##_fetch_and_or(a, val, f));																\
+	}																															\
+	ATTR_ALWAYSINLINE static inline TYPE fetch_and_xor(atomic_type *a, TYPE val, ATOMIC_OPS_FENCE f) {							\
+		return (atomic_ops_##MNEMONIC##_fetch_and_xor(a, val, f));																\
+	}																															\
+	ATTR_ALWAYSINLINE static inline TYPE fetch_min(atomic_type *a, TYPE val, ATOMIC_OPS_FENCE f) {								\
+		return (atomic_ops_##MNEMONIC##_fetch_min(a, val, f));																	\
+	}																															\
+	ATTR_ALWAYSINLINE static inline TYPE fetch_max(atomic_type *a, TYPE val, ATOMIC_OPS_FENCE f) {								\
+		return (atomic_ops_##MNEMONIC##_fetch_max(a, val, f));																	\
+	}																															\
+	ATTR_ALWAYSINLINE static inline bool test_and_set_bit(atomic_type *a, unsigned int bit, ATOMIC_OPS_FENCE f) {				\
+		return (atomic_ops_##MNEMONIC##_test_and_set_bit(a, bit, f));															\
+	}																															\
+	ATTR_ALWAYSINLINE static inline bool test_and_clear_bit(atomic_type *a, unsigned int bit, ATOMIC_OPS_FENCE f) {				\
+		return (atomic_ops_##MNEMONIC##_test_and_clear_bit(a, bit, f));															\
+	}																															\
+	ATTR_ALWAYSINLINE static inline bool test_and_complement_bit(atomic_type *a, unsigned int bit, ATOMIC_OPS_FENCE f) {		\
+		return (atomic_ops_##MNEMONIC##_test_and_complement_bit(a, bit, f));													\
+	}
+
+template <> struct ops<1, true>  { ATOMIC_OPS_HPP_OPS(int8_t,   i8) };
+template <> struct ops<1, false> { ATOMIC_OPS_HPP_OPS(uint8_t,  u8) };
+template <> struct ops<2, true>  { ATOMIC_OPS_HPP_OPS(int16_t,  i16) };
+template <> struct ops<2, false> { ATOMIC_OPS_HPP_OPS(uint16_t, u16) };
+#if UINTPTR_MAX == UINT64_MAX
+template <> struct ops<4, true>  { ATOMIC_OPS_HPP_OPS(int32_t,  i32) };
+template <> struct ops<4, false> { ATOMIC_OPS_HPP_OPS(uint32_t, u32) };
+#endif
+template <> struct ops<sizeof(intptr_t), true>  { ATOMIC_OPS_HPP_OPS(intptr_t,  int)  ATOMIC_OPS_HPP_OPS_WORD(intptr_t,  int) };
+template <> struct ops<sizeof(uintptr_t), false> { ATOMIC_OPS_HPP_OPS(uintptr_t, uint) ATOMIC_OPS_HPP_OPS_WORD(uintptr_t, uint) };
+
+#undef ATOMIC_OPS_HPP_OPS
+#undef ATOMIC_OPS_HPP_OPS_WORD
+
+} // namespace detail
+
+/*
+ * Type Definitions
+ */
+
+template <typename T>
+class atomic {
+	static_assert(std::is_integral<T>::value && !std::is_same<T, bool>::value, "atomic_ops::atomic<T> needs an integral or pointer T");
+
+	typedef detail::ops<sizeof(T), std::is_signed<T>::value> ops;
+	typedef typename ops::value_type value_type;
+
+	typename ops::atomic_type a;
+
+public:
+	constexpr atomic() : a{ 0 } { }
+	constexpr explicit atomic(T val) : a{ static_cast<value_type>(val) } { }
+	atomic(const atomic &) = delete;
+	atomic &operator=(const atomic &) = delete;
+
+	template <ATOMIC_OPS_FENCE F = ATOMIC_OPS_FENCE_FULL> T load() const {
+		return (static_cast<T>(ops::load(&a, F)));
+	}
+
+	template <ATOMIC_OPS_FENCE F = ATOMIC_OPS_FENCE_FULL> void store(T val) {
+		ops::store(&a, static_cast<value_type>(val), F);
+	}
+
+	template <ATOMIC_OPS_FENCE F = ATOMIC_OPS_FENCE_FULL> void not_() {
+		ops::not_(&a, F);
+	}
+
+	template <ATOMIC_OPS_FENCE F = ATOMIC_OPS_FENCE_FULL> void and_(T val) {
+		ops::and_(&a, static_cast<value_type>(val), F);
+	}
+
+	template <ATOMIC_OPS_FENCE F = ATOMIC_OPS_FENCE_FULL> void or_(T val) {
+		ops::or_(&a, static_cast<value_type>(val), F);
+	}
+
+	template <ATOMIC_OPS_FENCE F = ATOMIC_OPS_FENCE_FULL> void xor_(T val) {
+		ops::xor_(&a, static_cast<value_type>(val), F);
+	}
+
+	template <ATOMIC_OPS_FENCE F = ATOMIC_OPS_FENCE_FULL> void add(T val) {
+		ops::add(&a, static_cast<value_type>(val), F);
+	}
+
+	template <ATOMIC_OPS_FENCE F = ATOMIC_OPS_FENCE_FULL> void inc() {
+		ops::inc(&a, F);
+	}
+
+	template <ATOMIC_OPS_FENCE F = ATOMIC_OPS_FENCE_FULL> void dec() {
+		ops::dec(&a, F);
+	}
+
+	template <ATOMIC_OPS_FENCE F = ATOMIC_OPS_FENCE_FULL> T fetch_and_add(T val) {
+		return (static_cast<T>(ops::fetch_and_add(&a, static_cast<value_type>(val), F)));
+	}
+
+	template <ATOMIC_OPS_FENCE F = ATOMIC_OPS_FENCE_FULL> T fetch_and_inc() {
+		return (static_cast<T>(ops::fetch_and_inc(&a, F)));
+	}
+
+	template <ATOMIC_OPS_FENCE F = ATOMIC_OPS_FENCE_FULL> T fetch_and_dec() {
+		return (static_cast<T>(ops::fetch_and_dec(&a, F)));
+	}
+
+	// Word-sized T only
+	template <ATOMIC_OPS_FENCE F = ATOMIC_OPS_FENCE_FULL> T fetch_and_and(T val) {
+		return (static_cast<T>(ops::fetch_and_and(&a, static_cast<value_type>(val), F)));
+	}
+
+	template <ATOMIC_OPS_FENCE F = ATOMIC_OPS_FENCE_FULL> T fetch_and_or(T val) {
+		return (static_cast<T>(ops::fetch_and_or(&a, static_cast<value_type>(val), F)));
+	}
+
+	template <ATOMIC_OPS_FENCE F = ATOMIC_OPS_FENCE_FULL> T fetch_and_xor(T val) {
+		return (static_cast<T>(ops::fetch_and_xor(&a, static_cast<value_type>(val), F)));
+	}
+
+	template <ATOMIC_OPS_FENCE F = ATOMIC_OPS_FENCE_FULL> T fetch_min(T val) {
+		return (static_cast<T>(ops::fetch_min(&a, static_cast<value_type>(val), F)));
+	}
+
+	template <ATOMIC_OPS_FENCE F = ATOMIC_OPS_FENCE_FULL> T fetch_max(T val) {
+		return (static_cast<T>(ops::fetch_max(&a, static_cast<value_type>(val), F)));
+	}
+
+	template <ATOMIC_OPS_FENCE F = ATOMIC_OPS_FENCE_FULL> bool test_and_set_bit(unsigned int bit) {
+		return (ops::test_and_set_bit(&a, bit, F));
+	}
+
+	template <ATOMIC_OPS_FENCE F = ATOMIC_OPS_FENCE_FULL> bool test_and_clear_bit(unsigned int bit) {
+		return (ops::test_and_clear_bit(&a, bit, F));
+	}
+
+	template <ATOMIC_OPS_FENCE F = ATOMIC_OPS_FENCE_FULL> bool test_and_complement_bit(unsigned int bit) {
+		return (ops::test_and_complement_bit(&a, bit, F));
+	}
+
+	template <ATOMIC_OPS_FENCE F = ATOMIC_OPS_FENCE_FULL> T casr(T oldval, T newval) {
+		return (static_cast<T>(ops::casr(&a, static_cast<value_type>(oldval), static_cast<value_type>(newval), F)));
+	}
+
+	template <ATOMIC_OPS_FENCE F = ATOMIC_OPS_FENCE_FULL> bool cas(T oldval, T newval) {
+		return (ops::cas(&a, static_cast<value_type>(oldval), static_cast<value_type>(newval), F));
+	}
+
+	template <ATOMIC_OPS_FENCE F = ATOMIC_OPS_FENCE_FULL> T swap(T val) {
+		return (static_cast<T>(ops::swap(&a, static_cast<value_type>(val), F)));
+	}
+};
+
+template <typename T>
+class atomic<T *> {
+	atomic_ops_ptr a;
+
+public:
+	constexpr atomic() : a{ nullptr } { }
+	constexpr explicit atomic(T *ptr) : a{ ptr } { }
+	atomic(const atomic &) = delete;
+	atomic &operator=(const atomic &) = delete;
+
+	template <ATOMIC_OPS_FENCE F = ATOMIC_OPS_FENCE_FULL> T *load() const {
+		return (static_cast<T *>(atomic_ops_ptr_load(&a, F)));
+	}
+
+	template <ATOMIC_OPS_FENCE F = ATOMIC_OPS_FENCE_FULL> void store(T *ptr) {
+		atomic_ops_ptr_store(&a, ptr, F);
+	}
+
+	template <ATOMIC_OPS_FENCE F = ATOMIC_OPS_FENCE_FULL> T *casr(T *oldptr, T *newptr) {
+		return (static_cast<T *>(atomic_ops_ptr_casr(&a, oldptr, newptr, F)));
+	}
+
+	template <ATOMIC_OPS_FENCE F = ATOMIC_OPS_FENCE_FULL> bool cas(T *oldptr, T *newptr) {
+		return (atomic_ops_ptr_cas(&a, oldptr, newptr, F));
+	}
+
+	template <ATOMIC_OPS_FENCE F = ATOMIC_OPS_FENCE_FULL> T *swap(T *ptr) {
+		return (static_cast<T *>(atomic_ops_ptr_swap(&a, ptr, F)));
+	}
+};
+
+// Pointer plus a flag in its lowest bit: T must be at least 2 byte aligned
+template <typename T>
+class flag_ptr {
+	atomic_ops_flagptr a;
+
+	static T *ptr_of(void *ptr) {
+		return (static_cast<T *>(ptr));
+	}
+
+public:
+	explicit flag_ptr(T *ptr = nullptr, bool flag = false) : a ATOMIC_OPS_FLAGPTR_INIT(ptr, flag) { }
+	flag_ptr(const flag_ptr &) = delete;
+	flag_ptr &operator=(const flag_ptr &) = delete;
+
+	// If flag isn't NULL, the flag is returned in it
+	template <ATOMIC_OPS_FENCE F = ATOMIC_OPS_FENCE_FULL> T *load(bool *flag = nullptr) const {
+		return (ptr_of(atomic_ops_flagptr_load(&a, flag, F)));
+	}
+
+	template <ATOMIC_OPS_FENCE F = ATOMIC_OPS_FENCE_FULL> void store(T *ptr, bool flag) {
+		atomic_ops_flagptr_store(&a, ptr, flag, F);
+	}
+
+	template <ATOMIC_OPS_FENCE F = ATOMIC_OPS_FENCE_FULL> T *casr(T *oldptr, bool oldflag, T *newptr, bool newflag, bool *flag = nullptr) {
+		return (ptr_of(atomic_ops_flagptr_casr(&a, flag, oldptr, oldflag, newptr, newflag, F)));
+	}
+
+	template <ATOMIC_OPS_FENCE F = ATOMIC_OPS_FENCE_FULL> bool cas(T *oldptr, bool oldflag, T *newptr, bool newflag) {
+		return (atomic_ops_flagptr_cas(&a, oldptr, oldflag, newptr, newflag, F));
+	}
+
+	template <ATOMIC_OPS_FENCE F = ATOMIC_OPS_FENCE_FULL> T *swap(T *newptr, bool newflag, bool *flag = nullptr) {
+		return (ptr_of(atomic_ops_flagptr_swap(&a, flag, newptr, newflag, F)));
+	}
+};
+
+/*
+ * Functions
+ */
+
+template <ATOMIC_OPS_FENCE F = ATOMIC_OPS_FENCE_FULL> static inline void fence() {
+	atomic_ops_fence(F);
+}
+
+static inline void pause() {
+	atomic_ops_pause();
+}
+
+} // namespace atomic_ops
+
+#endif /* ATOMIC_OPS_HPP */
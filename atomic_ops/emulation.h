@@ -10,11 +10,91 @@
  * @version    $Id: emulation.h 1100 2012-07-31 03:04:43Z llongi $
  */
 
+/*
+ * Backoff between the failed attempts of the CAS and LL/SC retry loops below,
+ * chosen at compile time by defining ATOMIC_OPS_EMU_BACKOFF to one of:
+ * - ATOMIC_OPS_EMU_BACKOFF_NONE: retry right away (default).
+ * - ATOMIC_OPS_EMU_BACKOFF_EXP: pause, doubling the pauses with every failed
+ *   attempt, up to ATOMIC_OPS_EMU_BACKOFF_MAX.
+ * - ATOMIC_OPS_EMU_BACKOFF_RAND: pause a random number of times, up to a limit
+ *   doubling the same way, so threads that failed together don't all retry at
+ *   the same time again.
+ * The first attempt never waits, uncontended operations cost the same.
+ */
+#define ATOMIC_OPS_EMU_BACKOFF_NONE 0
+#define ATOMIC_OPS_EMU_BACKOFF_EXP 1
+#define ATOMIC_OPS_EMU_BACKOFF_RAND 2
+
+#if !defined(ATOMIC_OPS_EMU_BACKOFF)
+	#define ATOMIC_OPS_EMU_BACKOFF ATOMIC_OPS_EMU_BACKOFF_NONE
+#endif
+
+// Most pause instructions waited between two attempts
+#if !defined(ATOMIC_OPS_EMU_BACKOFF_MAX)
+	#define ATOMIC_OPS_EMU_BACKOFF_MAX 1024
+#endif
+
+#if ATOMIC_OPS_EMU_BACKOFF_MAX == 0 || ATOMIC_OPS_EMU_BACKOFF_MAX > UINT32_MAX / 2
+	#error ATOMIC_OPS_EMU_BACKOFF_MAX must be between 1 and UINT32_MAX / 2.
+#endif
+
+typedef struct {
+	uint32_t limit; // Pauses after the next failure, zero before the first one
+	uint32_t seed;
+} atomic_ops_emu_backoff;
+
+#define ATOMIC_OPS_EMU_BACKOFF_INIT { 0, 0 }
+
+// Called after a failed attempt, following the given policy
+static inline void atomic_ops_emu_backoff_policy(atomic_ops_emu_backoff *backoff, int policy) {
+	if (policy == ATOMIC_OPS_EMU_BACKOFF_NONE) {
+		return;
+	}
+
+	if (backoff->limit == 0) {
+		// Contending threads are on different stacks: seed from the address
+		uint64_t addr = (uint64_t)(uintptr_t)backoff;
+
+		backoff->limit = 1;
+		backoff->seed = (uint32_t)(addr ^ (addr >> 32)) * UINT32_C(0x9E3779B1);
+	}
+
+	uint32_t pauses = backoff->limit;
+
+	if (policy == ATOMIC_OPS_EMU_BACKOFF_RAND) {
+		backoff->seed = backoff->seed * UINT32_C(1664525) + UINT32_C(1013904223);
+		pauses = ((backoff->seed >> 16) % pauses) + 1;
+	}
+
+	for (uint32_t i = 0; i < pauses; i++) {
+		atomic_ops_pause();
+	}
+
+	// Clamped, the maximum needn't be a power of two
+	backoff->limit = (backoff->limit > (uint32_t)ATOMIC_OPS_EMU_BACKOFF_MAX / 2) ? ((uint32_t)ATOMIC_OPS_EMU_BACKOFF_MAX) : (backoff->limit * 2);
+}
+
+// Following the policy picked at compile time, free with ATOMIC_OPS_EMU_BACKOFF_NONE
+static inline void atomic_ops_emu_backoff_wait(atomic_ops_emu_backoff *backoff) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_emu_backoff_wait(atomic_ops_emu_backoff *backoff) {
+#if defined(ATOMIC_OPS_STATS)
+	atomic_ops_stats_retry();
+#endif
+
+#if ATOMIC_OPS_EMU_BACKOFF != ATOMIC_OPS_EMU_BACKOFF_NONE
+	atomic_ops_emu_backoff_policy(backoff, ATOMIC_OPS_EMU_BACKOFF);
+#else
+	UNUSED_ARGUMENT(backoff);
+#endif
+}
+
 // Alternative not implementations
 #define EMU_GEN_atomic_ops_not_by_cas(TYPE, MNEMONIC) \
 static inline void atomic_ops_##MNEMONIC##_not(atomic_ops_##MNEMONIC *atomic, ATOMIC_OPS_FENCE fence) {	\
 	atomic_ops_emu_entry_fence(fence);																	\
 																										\
+	atomic_ops_emu_backoff backoff = ATOMIC_OPS_EMU_BACKOFF_INIT;										\
+																										\
 	while (true) {																						\
 		TYPE oldval = atomic_ops_##MNEMONIC##_load(atomic, ATOMIC_OPS_FENCE_NONE);						\
 																										\
@@ -22,6 +102,8 @@ static inline void atomic_ops_##MNEMONIC##_not(atomic_ops_##MNEMONIC *atomic, AT
 			atomic_ops_emu_exit_fence(fence);															\
 			return;																						\
 		}																								\
+																										\
+		atomic_ops_emu_backoff_wait(&backoff);															\
 	}																									\
 }
 
@@ -29,6 +111,8 @@ static inline void atomic_ops_##MNEMONIC##_not(atomic_ops_##MNEMONIC *atomic, AT
 static inline void atomic_ops_##MNEMONIC##_not(atomic_ops_##MNEMONIC *atomic, ATOMIC_OPS_FENCE fence) {	\
 	atomic_ops_emu_entry_fence(fence);																	\
 																										\
+	atomic_ops_emu_backoff backoff = ATOMIC_OPS_EMU_BACKOFF_INIT;										\
+																										\
 	while (true) {																						\
 		TYPE oldval = atomic_ops_##MNEMONIC##_ll(atomic);												\
 																										\
@@ -36,6 +120,8 @@ static inline void atomic_ops_##MNEMONIC##_not(atomic_ops_##MNEMONIC *atomic, AT
 			atomic_ops_emu_exit_fence(fence);															\
 			return;																						\
 		}																								\
+																										\
+		atomic_ops_emu_backoff_wait(&backoff);															\
 	}																									\
 }
 
@@ -44,6 +130,8 @@ static inline void atomic_ops_##MNEMONIC##_not(atomic_ops_##MNEMONIC *atomic, AT
 static inline void atomic_ops_##MNEMONIC##_##FNAME(atomic_ops_##MNEMONIC *atomic, TYPE val, ATOMIC_OPS_FENCE fence) {	\
 	atomic_ops_emu_entry_fence(fence);																					\
 																														\
+	atomic_ops_emu_backoff backoff = ATOMIC_OPS_EMU_BACKOFF_INIT;														\
+																														\
 	while (true) {																										\
 		TYPE oldval = atomic_ops_##MNEMONIC##_load(atomic, ATOMIC_OPS_FENCE_NONE);										\
 																														\
@@ -51,6 +139,8 @@ static inline void atomic_ops_##MNEMONIC##_##FNAME(atomic_ops_##MNEMONIC *atomic
 			atomic_ops_emu_exit_fence(fence);																			\
 			return;																										\
 		}																												\
+																														\
+		atomic_ops_emu_backoff_wait(&backoff);																			\
 	}																													\
 }
 
@@ -58,6 +148,8 @@ static inline void atomic_ops_##MNEMONIC##_##FNAME(atomic_ops_##MNEMONIC *atomic
 static inline void atomic_ops_##MNEMONIC##_##FNAME(atomic_ops_##MNEMONIC *atomic, TYPE val, ATOMIC_OPS_FENCE fence) {	\
 	atomic_ops_emu_entry_fence(fence);																					\
 																														\
+	atomic_ops_emu_backoff backoff = ATOMIC_OPS_EMU_BACKOFF_INIT;														\
+																														\
 	while (true) {																										\
 		TYPE oldval = atomic_ops_##MNEMONIC##_ll(atomic);																\
 																														\
@@ -65,6 +157,8 @@ static inline void atomic_ops_##MNEMONIC##_##FNAME(atomic_ops_##MNEMONIC *atomic
 			atomic_ops_emu_exit_fence(fence);																			\
 			return;																										\
 		}																												\
+																														\
+		atomic_ops_emu_backoff_wait(&backoff);																			\
 	}																													\
 }
 
@@ -80,11 +174,57 @@ static inline void atomic_ops_##MNEMONIC##_##FNAME(atomic_ops_##MNEMONIC *atomic
 	atomic_ops_##MNEMONIC##_add(atomic, (TYPE) VALUE, fence);												\
 }
 
+// Alternative bit test-and-modify implementations: the bit's mask is combined into the old value with OP, after applying MASKOP to it
+// An unchanged value isn't written back, the entry/exit fences alone then order the load
+#define EMU_GEN_atomic_ops_test_and_bit_by_cas(FNAME, TYPE, MNEMONIC, OP, MASKOP) \
+static inline bool atomic_ops_##MNEMONIC##_test_and_##FNAME##_bit(atomic_ops_##MNEMONIC *atomic, unsigned int bit, ATOMIC_OPS_FENCE fence) {	\
+	TYPE mask = (TYPE)(((uintptr_t)1) << (bit % (sizeof(TYPE) * 8)));																\
+																																	\
+	atomic_ops_emu_entry_fence(fence);																								\
+																																	\
+	atomic_ops_emu_backoff backoff = ATOMIC_OPS_EMU_BACKOFF_INIT;																	\
+																																	\
+	while (true) {																													\
+		TYPE oldval = atomic_ops_##MNEMONIC##_load(atomic, ATOMIC_OPS_FENCE_NONE);													\
+		TYPE newval = (oldval OP (MASKOP mask));																					\
+																																	\
+		if (newval == oldval || atomic_ops_##MNEMONIC##_cas(atomic, oldval, newval, ATOMIC_OPS_FENCE_NONE)) {						\
+			atomic_ops_emu_exit_fence(fence);																						\
+			return ((oldval & mask) != 0);																							\
+		}																															\
+																																	\
+		atomic_ops_emu_backoff_wait(&backoff);																						\
+	}																																\
+}
+
+#define EMU_GEN_atomic_ops_test_and_bit_by_llsc(FNAME, TYPE, MNEMONIC, OP, MASKOP) \
+static inline bool atomic_ops_##MNEMONIC##_test_and_##FNAME##_bit(atomic_ops_##MNEMONIC *atomic, unsigned int bit, ATOMIC_OPS_FENCE fence) {	\
+	TYPE mask = (TYPE)(((uintptr_t)1) << (bit % (sizeof(TYPE) * 8)));																\
+																																	\
+	atomic_ops_emu_entry_fence(fence);																								\
+																																	\
+	atomic_ops_emu_backoff backoff = ATOMIC_OPS_EMU_BACKOFF_INIT;																	\
+																																	\
+	while (true) {																													\
+		TYPE oldval = atomic_ops_##MNEMONIC##_ll(atomic);																			\
+		TYPE newval = (oldval OP (MASKOP mask));																					\
+																																	\
+		if (newval == oldval || atomic_ops_##MNEMONIC##_sc(atomic, newval)) {														\
+			atomic_ops_emu_exit_fence(fence);																						\
+			return ((oldval & mask) != 0);																							\
+		}																															\
+																																	\
+		atomic_ops_emu_backoff_wait(&backoff);																						\
+	}																																\
+}
+
 // Alternative FAA implementations
 #define EMU_GEN_atomic_ops_fetch_and_add_by_cas(TYPE, MNEMONIC) \
 static inline TYPE atomic_ops_##MNEMONIC##_fetch_and_add(atomic_ops_##MNEMONIC *atomic, TYPE val, ATOMIC_OPS_FENCE fence) {	\
 	atomic_ops_emu_entry_fence(fence);																						\
 																															\
+	atomic_ops_emu_backoff backoff = ATOMIC_OPS_EMU_BACKOFF_INIT;															\
+																															\
 	while (true) {																											\
 		TYPE oldval = atomic_ops_##MNEMONIC##_load(atomic, ATOMIC_OPS_FENCE_NONE);											\
 																															\
@@ -92,6 +232,8 @@ static inline TYPE atomic_ops_##MNEMONIC##_fetch_and_add(atomic_ops_##MNEMONIC *
 			atomic_ops_emu_exit_fence(fence);																				\
 			return (oldval);																								\
 		}																													\
+																															\
+		atomic_ops_emu_backoff_wait(&backoff);																				\
 	}																														\
 }
 
@@ -99,6 +241,8 @@ static inline TYPE atomic_ops_##MNEMONIC##_fetch_and_add(atomic_ops_##MNEMONIC *
 static inline TYPE atomic_ops_##MNEMONIC##_fetch_and_add(atomic_ops_##MNEMONIC *atomic, TYPE val, ATOMIC_OPS_FENCE fence) {	\
 	atomic_ops_emu_entry_fence(fence);																						\
 																															\
+	atomic_ops_emu_backoff backoff = ATOMIC_OPS_EMU_BACKOFF_INIT;															\
+																															\
 	while (true) {																											\
 		TYPE oldval = atomic_ops_##MNEMONIC##_ll(atomic);																	\
 																															\
@@ -106,6 +250,101 @@ static inline TYPE atomic_ops_##MNEMONIC##_fetch_and_add(atomic_ops_##MNEMONIC *
 			atomic_ops_emu_exit_fence(fence);																				\
 			return (oldval);																								\
 		}																													\
+																															\
+		atomic_ops_emu_backoff_wait(&backoff);																				\
+	}																														\
+}
+
+// Alternative fetch_and_and/or/xor implementations
+#define EMU_GEN_atomic_ops_fetch_and_andorxor_by_cas(FNAME, TYPE, MNEMONIC, OP) \
+static inline TYPE atomic_ops_##MNEMONIC##_fetch_and_##FNAME(atomic_ops_##MNEMONIC *atomic, TYPE val, ATOMIC_OPS_FENCE fence) {	\
+	atomic_ops_emu_entry_fence(fence);																							\
+																																\
+	TYPE oldval = atomic_ops_##MNEMONIC##_load(atomic, ATOMIC_OPS_FENCE_NONE);													\
+																																\
+	atomic_ops_emu_backoff backoff = ATOMIC_OPS_EMU_BACKOFF_INIT;																\
+																																\
+	while (true) {																												\
+		TYPE prev = atomic_ops_##MNEMONIC##_casr(atomic, oldval, (oldval OP val), ATOMIC_OPS_FENCE_NONE);						\
+																																\
+		if (prev == oldval) {																									\
+			atomic_ops_emu_exit_fence(fence);																					\
+			return (oldval);																									\
+		}																														\
+																																\
+		oldval = prev; /* casr already loaded the new value, no need to load again */											\
+																																\
+		atomic_ops_emu_backoff_wait(&backoff);																					\
+	}																															\
+}
+
+#define EMU_GEN_atomic_ops_fetch_and_andorxor_by_llsc(FNAME, TYPE, MNEMONIC, OP) \
+static inline TYPE atomic_ops_##MNEMONIC##_fetch_and_##FNAME(atomic_ops_##MNEMONIC *atomic, TYPE val, ATOMIC_OPS_FENCE fence) {	\
+	atomic_ops_emu_entry_fence(fence);																							\
+																																\
+	atomic_ops_emu_backoff backoff = ATOMIC_OPS_EMU_BACKOFF_INIT;																\
+																																\
+	while (true) {																												\
+		TYPE oldval = atomic_ops_##MNEMONIC##_ll(atomic);																		\
+																																\
+		if (atomic_ops_##MNEMONIC##_sc(atomic, (oldval OP val))) {																\
+			atomic_ops_emu_exit_fence(fence);																					\
+			return (oldval);																									\
+		}																														\
+																																\
+		atomic_ops_emu_backoff_wait(&backoff);																					\
+	}																															\
+}
+
+// Alternative fetch_min/fetch_max implementations: CMP is < for min, > for max
+// If val wouldn't change the value, nothing is written: the operation is then just the first load, with the requested fence
+#define EMU_GEN_atomic_ops_fetch_minmax_by_cas(FNAME, TYPE, MNEMONIC, CMP) \
+static inline TYPE atomic_ops_##MNEMONIC##_fetch_##FNAME(atomic_ops_##MNEMONIC *atomic, TYPE val, ATOMIC_OPS_FENCE fence) {	\
+	TYPE oldval = atomic_ops_##MNEMONIC##_load(atomic, fence);																\
+																															\
+	if (!(val CMP oldval)) {																								\
+		return (oldval);																									\
+	}																														\
+																															\
+	atomic_ops_emu_entry_fence(fence);																						\
+																															\
+	atomic_ops_emu_backoff backoff = ATOMIC_OPS_EMU_BACKOFF_INIT;															\
+																															\
+	while (true) {																											\
+		TYPE prev = atomic_ops_##MNEMONIC##_casr(atomic, oldval, val, ATOMIC_OPS_FENCE_NONE);								\
+																															\
+		if (prev == oldval || !(val CMP prev)) {																			\
+			atomic_ops_emu_exit_fence(fence);																				\
+			return (prev);																									\
+		}																													\
+																															\
+		oldval = prev;																										\
+																															\
+		atomic_ops_emu_backoff_wait(&backoff);																				\
+	}																														\
+}
+
+#define EMU_GEN_atomic_ops_fetch_minmax_by_llsc(FNAME, TYPE, MNEMONIC, CMP) \
+static inline TYPE atomic_ops_##MNEMONIC##_fetch_##FNAME(atomic_ops_##MNEMONIC *atomic, TYPE val, ATOMIC_OPS_FENCE fence) {	\
+	TYPE oldval = atomic_ops_##MNEMONIC##_load(atomic, fence);																\
+																															\
+	if (!(val CMP oldval)) {																								\
+		return (oldval);																									\
+	}																														\
+																															\
+	atomic_ops_emu_entry_fence(fence);																						\
+																															\
+	atomic_ops_emu_backoff backoff = ATOMIC_OPS_EMU_BACKOFF_INIT;															\
+																															\
+	while (true) {																											\
+		oldval = atomic_ops_##MNEMONIC##_ll(atomic);																		\
+																															\
+		if (!(val CMP oldval) || atomic_ops_##MNEMONIC##_sc(atomic, val)) {													\
+			atomic_ops_emu_exit_fence(fence);																				\
+			return (oldval);																								\
+		}																													\
+																															\
+		atomic_ops_emu_backoff_wait(&backoff);																				\
 	}																														\
 }
 
@@ -120,6 +359,8 @@ static inline TYPE atomic_ops_##MNEMONIC##_fetch_and_##FNAME(atomic_ops_##MNEMON
 static inline TYPE atomic_ops_##MNEMONIC##_casr(atomic_ops_##MNEMONIC *atomic, TYPE oldval, TYPE newval, ATOMIC_OPS_FENCE fence) {	\
 	atomic_ops_emu_entry_fence(fence);																								\
 																																	\
+	atomic_ops_emu_backoff backoff = ATOMIC_OPS_EMU_BACKOFF_INIT;																	\
+																																	\
 	while (true) {																													\
 		TYPE prev = atomic_ops_##MNEMONIC##_ll(atomic);																				\
 																																	\
@@ -132,6 +373,55 @@ static inline TYPE atomic_ops_##MNEMONIC##_casr(atomic_ops_##MNEMONIC *atomic, T
 			atomic_ops_emu_exit_fence(fence);																						\
 			return (oldval);																										\
 		}																															\
+																																	\
+		atomic_ops_emu_backoff_wait(&backoff);																						\
+	}																																\
+}
+
+// Bit position of a sub-word value within the aligned 32 bit word containing it
+static inline unsigned int atomic_ops_emu_word_shift(const volatile void *addr, size_t size) {
+	uintptr_t offset = ((uintptr_t)addr) & (sizeof(uint32_t) - 1);
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+	return ((unsigned int)((sizeof(uint32_t) - size - offset) * 8));
+#else
+	UNUSED_ARGUMENT(size);
+	return ((unsigned int)(offset * 8));
+#endif
+}
+
+// For 8/16 bit types without a CAS of their own: CAS the containing word, retrying if only its other bytes changed
+#define EMU_GEN_atomic_ops_casr_by_word(TYPE, MNEMONIC) \
+static inline TYPE atomic_ops_##MNEMONIC##_casr(atomic_ops_##MNEMONIC *atomic, TYPE oldval, TYPE newval, ATOMIC_OPS_FENCE fence) {	\
+	atomic_ops_u32 *word = (atomic_ops_u32 *)(((uintptr_t)&atomic->v) & ~((uintptr_t)(sizeof(uint32_t) - 1)));						\
+	unsigned int shift = atomic_ops_emu_word_shift(&atomic->v, sizeof(TYPE));														\
+	uint32_t mask = (uint32_t)((UINT64_C(1) << (sizeof(TYPE) * 8)) - 1);															\
+																																	\
+	atomic_ops_emu_entry_fence(fence);																								\
+																																	\
+	uint32_t oldword = atomic_ops_u32_load(word, ATOMIC_OPS_FENCE_NONE);															\
+																																	\
+	atomic_ops_emu_backoff backoff = ATOMIC_OPS_EMU_BACKOFF_INIT;																	\
+																																	\
+	while (true) {																													\
+		TYPE prev = (TYPE)((oldword >> shift) & mask);																				\
+																																	\
+		if (prev != oldval) {																										\
+			atomic_ops_emu_exit_fence(fence);																						\
+			return (prev);																											\
+		}																															\
+																																	\
+		uint32_t newword = (oldword & ~(mask << shift)) | ((((uint32_t)newval) & mask) << shift);									\
+		uint32_t prevword = atomic_ops_u32_casr(word, oldword, newword, ATOMIC_OPS_FENCE_NONE);										\
+																																	\
+		if (prevword == oldword) {																									\
+			atomic_ops_emu_exit_fence(fence);																						\
+			return (oldval);																										\
+		}																															\
+																																	\
+		oldword = prevword;																											\
+																																	\
+		atomic_ops_emu_backoff_wait(&backoff);																						\
 	}																																\
 }
 
@@ -145,6 +435,8 @@ static inline bool atomic_ops_##MNEMONIC##_cas(atomic_ops_##MNEMONIC *atomic, TY
 static inline bool atomic_ops_##MNEMONIC##_cas(atomic_ops_##MNEMONIC *atomic, TYPE oldval, TYPE newval, ATOMIC_OPS_FENCE fence) {	\
 	atomic_ops_emu_entry_fence(fence);																								\
 																																	\
+	atomic_ops_emu_backoff backoff = ATOMIC_OPS_EMU_BACKOFF_INIT;																	\
+																																	\
 	while (true) {																													\
 		TYPE prev = atomic_ops_##MNEMONIC##_ll(atomic);																				\
 																																	\
@@ -157,6 +449,8 @@ static inline bool atomic_ops_##MNEMONIC##_cas(atomic_ops_##MNEMONIC *atomic, TY
 			atomic_ops_emu_exit_fence(fence);																						\
 			return (true);																											\
 		}																															\
+																																	\
+		atomic_ops_emu_backoff_wait(&backoff);																						\
 	}																																\
 }
 
@@ -165,6 +459,8 @@ static inline bool atomic_ops_##MNEMONIC##_cas(atomic_ops_##MNEMONIC *atomic, TY
 static inline TYPE atomic_ops_##MNEMONIC##_swap(atomic_ops_##MNEMONIC *atomic, TYPE val, ATOMIC_OPS_FENCE fence) {	\
 	atomic_ops_emu_entry_fence(fence);																				\
 																													\
+	atomic_ops_emu_backoff backoff = ATOMIC_OPS_EMU_BACKOFF_INIT;													\
+																													\
 	while (true) {																									\
 		TYPE oldval = atomic_ops_##MNEMONIC##_load(atomic, ATOMIC_OPS_FENCE_NONE);									\
 																													\
@@ -172,6 +468,8 @@ static inline TYPE atomic_ops_##MNEMONIC##_swap(atomic_ops_##MNEMONIC *atomic, T
 			atomic_ops_emu_exit_fence(fence);																		\
 			return (oldval);																						\
 		}																											\
+																													\
+		atomic_ops_emu_backoff_wait(&backoff);																		\
 	}																												\
 }
 
@@ -179,6 +477,8 @@ static inline TYPE atomic_ops_##MNEMONIC##_swap(atomic_ops_##MNEMONIC *atomic, T
 static inline TYPE atomic_ops_##MNEMONIC##_swap(atomic_ops_##MNEMONIC *atomic, TYPE val, ATOMIC_OPS_FENCE fence) {	\
 	atomic_ops_emu_entry_fence(fence);																				\
 																													\
+	atomic_ops_emu_backoff backoff = ATOMIC_OPS_EMU_BACKOFF_INIT;													\
+																													\
 	while (true) {																									\
 		TYPE oldval = atomic_ops_##MNEMONIC##_ll(atomic);															\
 																													\
@@ -186,5 +486,164 @@ static inline TYPE atomic_ops_##MNEMONIC##_swap(atomic_ops_##MNEMONIC *atomic, T
 			atomic_ops_emu_exit_fence(fence);																		\
 			return (oldval);																						\
 		}																											\
+																													\
+		atomic_ops_emu_backoff_wait(&backoff);																		\
+	}																												\
+}
+
+// Alternative double-width implementations
+#define ATOMIC_OPS_EMU_DPTR_EQ(A, B) (((A).lo == (B).lo) && ((A).hi == (B).hi))
+
+// A CAS that expects {0,0} and would write back {0,0} returns the current value without changing it
+#define EMU_GEN_atomic_ops_dptr_load_by_casr() \
+static inline atomic_ops_dptr_val atomic_ops_dptr_load(const atomic_ops_dptr *atomic, ATOMIC_OPS_FENCE fence) {	\
+	atomic_ops_dptr_val zero = { 0, 0 };																		\
+																												\
+	return (atomic_ops_dptr_casr((atomic_ops_dptr *)atomic, zero, zero, fence));								\
+}
+
+#define EMU_GEN_atomic_ops_dptr_store_by_casr() \
+static inline void atomic_ops_dptr_store(atomic_ops_dptr *atomic, atomic_ops_dptr_val val, ATOMIC_OPS_FENCE fence) {	\
+	atomic_ops_emu_entry_fence(fence);																				\
+																													\
+	/* Plain reads may tear, but are only used as the first guess */												\
+	atomic_ops_dptr_val oldval = { atomic->lo, atomic->hi };														\
+																													\
+	atomic_ops_emu_backoff backoff = ATOMIC_OPS_EMU_BACKOFF_INIT;													\
+																													\
+	while (true) {																									\
+		atomic_ops_dptr_val prev = atomic_ops_dptr_casr(atomic, oldval, val, ATOMIC_OPS_FENCE_NONE);				\
+																													\
+		if (ATOMIC_OPS_EMU_DPTR_EQ(prev, oldval)) {																	\
+			atomic_ops_emu_exit_fence(fence);																		\
+			return;																									\
+		}																											\
+																													\
+		oldval = prev;																								\
+																													\
+		atomic_ops_emu_backoff_wait(&backoff);																		\
+	}																												\
+}
+
+#define EMU_GEN_atomic_ops_dptr_cas_by_casr() \
+static inline bool atomic_ops_dptr_cas(atomic_ops_dptr *atomic, atomic_ops_dptr_val oldval, atomic_ops_dptr_val newval, ATOMIC_OPS_FENCE fence) {	\
+	atomic_ops_dptr_val prev = atomic_ops_dptr_casr(atomic, oldval, newval, fence);																\
+																																				\
+	return (ATOMIC_OPS_EMU_DPTR_EQ(prev, oldval));																								\
+}
+
+#define EMU_GEN_atomic_ops_dptr_load_by_ll() \
+static inline atomic_ops_dptr_val atomic_ops_dptr_load(const atomic_ops_dptr *atomic, ATOMIC_OPS_FENCE fence) {	\
+	atomic_ops_emu_entry_fence(fence);																			\
+																												\
+	atomic_ops_dptr_val val = atomic_ops_dptr_ll((atomic_ops_dptr *)atomic);									\
+																												\
+	atomic_ops_emu_exit_fence(fence);																			\
+	return (val);																								\
+}
+
+#define EMU_GEN_atomic_ops_dptr_store_by_llsc() \
+static inline void atomic_ops_dptr_store(atomic_ops_dptr *atomic, atomic_ops_dptr_val val, ATOMIC_OPS_FENCE fence) {	\
+	atomic_ops_emu_entry_fence(fence);																				\
+																													\
+	atomic_ops_emu_backoff backoff = ATOMIC_OPS_EMU_BACKOFF_INIT;													\
+																													\
+	while (true) {																									\
+		atomic_ops_dptr_ll(atomic);																					\
+																													\
+		if (atomic_ops_dptr_sc(atomic, val)) {																		\
+			atomic_ops_emu_exit_fence(fence);																		\
+			return;																									\
+		}																											\
+																													\
+		atomic_ops_emu_backoff_wait(&backoff);																		\
 	}																												\
 }
+
+#define EMU_GEN_atomic_ops_dptr_casr_by_llsc() \
+static inline atomic_ops_dptr_val atomic_ops_dptr_casr(atomic_ops_dptr *atomic, atomic_ops_dptr_val oldval, atomic_ops_dptr_val newval, ATOMIC_OPS_FENCE fence) {	\
+	atomic_ops_emu_entry_fence(fence);																															\
+																																								\
+	atomic_ops_emu_backoff backoff = ATOMIC_OPS_EMU_BACKOFF_INIT;																								\
+																																								\
+	while (true) {																																				\
+		atomic_ops_dptr_val prev = atomic_ops_dptr_ll(atomic);																									\
+																																								\
+		if (!ATOMIC_OPS_EMU_DPTR_EQ(prev, oldval)) {																											\
+			atomic_ops_emu_exit_fence(fence);																													\
+			return (prev);																																		\
+		}																																						\
+																																								\
+		if (atomic_ops_dptr_sc(atomic, newval)) {																												\
+			atomic_ops_emu_exit_fence(fence);																													\
+			return (oldval);																																	\
+		}																																						\
+																																								\
+		atomic_ops_emu_backoff_wait(&backoff);																													\
+	}																																							\
+}
+
+/*
+ * Last resort for double-width operations: a spinlock, picked by address from
+ * a table that is shared between all translation units (hence weak), taken by
+ * every operation, including loads. Only correct if all accesses to the type
+ * go through atomic_ops_dptr_* functions.
+ */
+#define ATOMIC_OPS_EMU_DPTR_LOCKS 64
+#define ATOMIC_OPS_EMU_DPTR_LOCK_STRIDE (ATOMIC_OPS_CACHELINE_SIZE / sizeof(atomic_ops_uint))
+
+#define EMU_GEN_atomic_ops_dptr_by_lock() \
+__attribute__((__weak__)) atomic_ops_uint atomic_ops_emu_dptr_locks[ATOMIC_OPS_EMU_DPTR_LOCKS * ATOMIC_OPS_EMU_DPTR_LOCK_STRIDE];		\
+																																	\
+static inline atomic_ops_uint *atomic_ops_emu_dptr_lock(const atomic_ops_dptr *atomic) {											\
+	atomic_ops_uint *lock = &atomic_ops_emu_dptr_locks[(((uintptr_t)atomic / sizeof(atomic_ops_dptr)) % ATOMIC_OPS_EMU_DPTR_LOCKS)	\
+		* ATOMIC_OPS_EMU_DPTR_LOCK_STRIDE];																							\
+																																	\
+	while (atomic_ops_uint_swap(lock, 1, ATOMIC_OPS_FENCE_ACQUIRE) != 0) {															\
+		while (atomic_ops_uint_load(lock, ATOMIC_OPS_FENCE_NONE) != 0) {															\
+			atomic_ops_pause();																										\
+		}																															\
+	}																																\
+																																	\
+	return (lock);																													\
+}																																	\
+																																	\
+static inline atomic_ops_dptr_val atomic_ops_dptr_load(const atomic_ops_dptr *atomic, ATOMIC_OPS_FENCE fence) {					\
+	atomic_ops_emu_entry_fence(fence);																								\
+	atomic_ops_uint *lock = atomic_ops_emu_dptr_lock(atomic);																		\
+																																	\
+	atomic_ops_dptr_val val = { atomic->lo, atomic->hi };																			\
+																																	\
+	atomic_ops_uint_store(lock, 0, ATOMIC_OPS_FENCE_RELEASE);																		\
+	atomic_ops_emu_exit_fence(fence);																								\
+	return (val);																													\
+}																																	\
+																																	\
+static inline void atomic_ops_dptr_store(atomic_ops_dptr *atomic, atomic_ops_dptr_val val, ATOMIC_OPS_FENCE fence) {				\
+	atomic_ops_emu_entry_fence(fence);																								\
+	atomic_ops_uint *lock = atomic_ops_emu_dptr_lock(atomic);																		\
+																																	\
+	atomic->lo = val.lo;																											\
+	atomic->hi = val.hi;																											\
+																																	\
+	atomic_ops_uint_store(lock, 0, ATOMIC_OPS_FENCE_RELEASE);																		\
+	atomic_ops_emu_exit_fence(fence);																								\
+}																																	\
+																																	\
+static inline atomic_ops_dptr_val atomic_ops_dptr_casr(atomic_ops_dptr *atomic, atomic_ops_dptr_val oldval, atomic_ops_dptr_val newval, ATOMIC_OPS_FENCE fence) {	\
+	atomic_ops_emu_entry_fence(fence);																								\
+	atomic_ops_uint *lock = atomic_ops_emu_dptr_lock(atomic);																		\
+																																	\
+	atomic_ops_dptr_val prev = { atomic->lo, atomic->hi };																			\
+																																	\
+	if (ATOMIC_OPS_EMU_DPTR_EQ(prev, oldval)) {																						\
+		atomic->lo = newval.lo;																										\
+		atomic->hi = newval.hi;																										\
+	}																																\
+																																	\
+	atomic_ops_uint_store(lock, 0, ATOMIC_OPS_FENCE_RELEASE);																		\
+	atomic_ops_emu_exit_fence(fence);																								\
+	return (prev);																													\
+}																																	\
+																																	\
+EMU_GEN_atomic_ops_dptr_cas_by_casr()
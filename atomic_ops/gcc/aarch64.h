@@ -0,0 +1,349 @@
+/**
+ * This file is part of the atomic_ops project.
+ *
+ * For the full copyright and license information, please view the COPYING
+ * file that was distributed with this source code.
+ *
+ * @copyright  (c) the atomic_ops project
+ * @author     Luca Longinotti <chtekk@longitekk.com>
+ * @license    BSD 2-clause
+ * @version    $Id$
+ */
+
+/*
+ * AArch64: loads and stores use ldar/stlr when they need acquire/release
+ * semantics, and the other fences with dmb. RMWs use the ARMv8.1 LSE
+ * instructions (ldadd, ldclr, ldset, ldeor, swp, cas, casp) if the compiler
+ * targets them (-march=armv8.1-a or later, __ARM_FEATURE_ATOMICS), with the
+ * a/l/al suffix picked by the fence: AL atomics are fully ordered. Otherwise
+ * they're ldxr/stxr loops, with ldaxr for acquire and stlxr for release; a
+ * full fence is then ldxr/stlxr followed by a dmb, as Linux does it.
+ */
+
+#if UINTPTR_MAX != UINT64_MAX
+	#error uintptr_t is not a 64 bit type. Only 64 bit systems are supported for AArch64.
+#endif
+
+static inline void atomic_ops_emu_entry_fence(ATOMIC_OPS_FENCE fence) {
+	if (fence == ATOMIC_OPS_FENCE_RELEASE || fence == ATOMIC_OPS_FENCE_FULL
+	 || fence == ATOMIC_OPS_FENCE_READ    || fence == ATOMIC_OPS_FENCE_WRITE) {
+		atomic_ops_fence(fence);
+	}
+}
+
+static inline void atomic_ops_emu_exit_fence(ATOMIC_OPS_FENCE fence) {
+	if (fence == ATOMIC_OPS_FENCE_ACQUIRE || fence == ATOMIC_OPS_FENCE_FULL
+	 || fence == ATOMIC_OPS_FENCE_READ    || fence == ATOMIC_OPS_FENCE_WRITE) {
+		atomic_ops_fence(fence);
+	}
+}
+
+// Expands ASM with the acquire/release suffixes for the fence (READ and WRITE are full)
+#define ATOMIC_OPS_AARCH64_ORDERED(FENCE, ASM, ...) \
+	if ((FENCE) == ATOMIC_OPS_FENCE_NONE) {							\
+		ASM("", "", __VA_ARGS__);									\
+	}																\
+	else if ((FENCE) == ATOMIC_OPS_FENCE_ACQUIRE) {					\
+		ASM("a", "", __VA_ARGS__);									\
+	}																\
+	else if ((FENCE) == ATOMIC_OPS_FENCE_RELEASE) {					\
+		ASM("", "l", __VA_ARGS__);									\
+	}																\
+	else {															\
+		ASM(ATOMIC_OPS_AARCH64_FULL_ACQ, "l", __VA_ARGS__);			\
+		ATOMIC_OPS_AARCH64_FULL_EXIT;								\
+	}
+
+#if defined(__ARM_FEATURE_ATOMICS)
+
+#define ATOMIC_OPS_AARCH64_FULL_ACQ "a"
+#define ATOMIC_OPS_AARCH64_FULL_EXIT
+
+// oldval = *atomic; *atomic = oldval OP arg
+#define ATOMIC_OPS_AARCH64_FETCH_OP(ACQ, REL, LSE_INSN, LSE_MASKOP, LLSC_INSN, OPS_SS, REG) \
+	__asm__ __volatile__ (LSE_INSN ACQ REL OPS_SS " %" REG "2, %" REG "0, [%1]"		\
+						: "=&r" (oldval)											\
+						: "r" (&atomic->v), "r" (LSE_MASKOP arg)					\
+						: "memory")
+
+#define ATOMIC_OPS_AARCH64_SWAP(ACQ, REL, OPS_SS, REG) \
+	__asm__ __volatile__ ("swp" ACQ REL OPS_SS " %" REG "2, %" REG "0, [%1]"		\
+						: "=&r" (oldval)											\
+						: "r" (&atomic->v), "r" (arg)								\
+						: "memory")
+
+// prev goes in as the expected value, comes out as the value found
+#define ATOMIC_OPS_AARCH64_CASR(ACQ, REL, OPS_SS, REG, CMP_EXT) \
+	__asm__ __volatile__ ("cas" ACQ REL OPS_SS " %" REG "0, %" REG "2, [%1]"		\
+						: "+r" (prev)												\
+						: "r" (&atomic->v), "r" (arg)								\
+						: "memory")
+
+// casp needs each pair in an even/odd register pair
+#define ATOMIC_OPS_AARCH64_DPTR_CASR(ACQ, REL, UNUSED) \
+	__asm__ __volatile__ ("casp" ACQ REL " %0, %1, %2, %3, [%4]"					\
+						: "+r" (x0), "+r" (x1)										\
+						: "r" (x2), "r" (x3), "r" (atomic)							\
+						: "memory")
+
+#else
+
+#define ATOMIC_OPS_AARCH64_FULL_ACQ ""
+#define ATOMIC_OPS_AARCH64_FULL_EXIT atomic_ops_fence(ATOMIC_OPS_FENCE_FULL)
+
+#define ATOMIC_OPS_AARCH64_FETCH_OP(ACQ, REL, LSE_INSN, LSE_MASKOP, LLSC_INSN, OPS_SS, REG) \
+	__asm__ __volatile__ ("1:	ld" ACQ "xr" OPS_SS " %" REG "0, [%3]\n"						\
+						  "	" LLSC_INSN " %" REG "1, %" REG "0, %" REG "4\n"				\
+						  "	st" REL "xr" OPS_SS " %w2, %" REG "1, [%3]\n"					\
+						  "	cbnz %w2, 1b"													\
+						: "=&r" (oldval), "=&r" (newval), "=&r" (failed)					\
+						: "r" (&atomic->v), "r" (arg)										\
+						: "memory")
+
+#define ATOMIC_OPS_AARCH64_SWAP(ACQ, REL, OPS_SS, REG) \
+	__asm__ __volatile__ ("1:	ld" ACQ "xr" OPS_SS " %" REG "0, [%2]\n"						\
+						  "	st" REL "xr" OPS_SS " %w1, %" REG "3, [%2]\n"					\
+						  "	cbnz %w1, 1b"													\
+						: "=&r" (oldval), "=&r" (failed)									\
+						: "r" (&atomic->v), "r" (arg)										\
+						: "memory")
+
+// Sub-word values are loaded zero-extended: compare against the zero-extended expected value
+#define ATOMIC_OPS_AARCH64_CASR(ACQ, REL, OPS_SS, REG, CMP_EXT) \
+	__asm__ __volatile__ ("1:	ld" ACQ "xr" OPS_SS " %" REG "0, [%2]\n"						\
+						  "	cmp %" REG "0, %" REG "3" CMP_EXT "\n"							\
+						  "	b.ne 2f\n"														\
+						  "	st" REL "xr" OPS_SS " %w1, %" REG "4, [%2]\n"					\
+						  "	cbnz %w1, 1b\n"													\
+						  "2:"																\
+						: "=&r" (prev), "=&r" (failed)										\
+						: "r" (&atomic->v), "r" (expected), "r" (arg)						\
+						: "cc", "memory")
+
+// ldxp alone isn't atomic: on a mismatch, write back what was read to make sure it was
+#define ATOMIC_OPS_AARCH64_DPTR_CASR(ACQ, REL, UNUSED) \
+	__asm__ __volatile__ ("1:	ld" ACQ "xp %0, %1, [%7]\n"										\
+						  "	cmp %0, %3\n"													\
+						  "	ccmp %1, %4, #0, eq\n"											\
+						  "	b.ne 2f\n"														\
+						  "	st" REL "xp %w2, %5, %6, [%7]\n"								\
+						  "	cbnz %w2, 1b\n"													\
+						  "	b 3f\n"															\
+						  "2:	st" REL "xp %w2, %0, %1, [%7]\n"								\
+						  "	cbnz %w2, 1b\n"													\
+						  "3:"																\
+						: "=&r" (x0), "=&r" (x1), "=&r" (failed)							\
+						: "r" (oldval.lo), "r" (oldval.hi), "r" (x2), "r" (x3), "r" (atomic)	\
+						: "cc", "memory")
+
+#endif
+
+#define GEN_atomic_ops_load(TYPE, MNEMONIC, OPS_SS, REG, WTYPE) \
+static inline TYPE atomic_ops_##MNEMONIC##_load(const atomic_ops_##MNEMONIC *atomic, ATOMIC_OPS_FENCE fence) {	\
+	if (fence == ATOMIC_OPS_FENCE_RELEASE || fence == ATOMIC_OPS_FENCE_FULL										\
+	 || fence == ATOMIC_OPS_FENCE_READ    || fence == ATOMIC_OPS_FENCE_WRITE) {									\
+		atomic_ops_fence(ATOMIC_OPS_FENCE_FULL);																\
+	}																											\
+																												\
+	WTYPE val;																									\
+																												\
+	if (fence == ATOMIC_OPS_FENCE_NONE || fence == ATOMIC_OPS_FENCE_RELEASE) {									\
+		__asm__ __volatile__ ("ldr" OPS_SS " %" REG "0, [%1]"													\
+							: "=r" (val)																		\
+							: "r" (&atomic->v)																	\
+							: "memory");																		\
+	}																											\
+	else {																										\
+		__asm__ __volatile__ ("ldar" OPS_SS " %" REG "0, [%1]"													\
+							: "=r" (val)																		\
+							: "r" (&atomic->v)																	\
+							: "memory");																		\
+	}																											\
+																												\
+	return ((TYPE)val);																							\
+}
+
+#define GEN_atomic_ops_store(TYPE, MNEMONIC, OPS_SS, REG, WTYPE) \
+static inline void atomic_ops_##MNEMONIC##_store(atomic_ops_##MNEMONIC *atomic, TYPE val, ATOMIC_OPS_FENCE fence) {	\
+	if (fence == ATOMIC_OPS_FENCE_NONE || fence == ATOMIC_OPS_FENCE_ACQUIRE) {										\
+		__asm__ __volatile__ ("str" OPS_SS " %" REG "0, [%1]"														\
+							: /* no output operands */																\
+							: "r" ((WTYPE)val), "r" (&atomic->v)													\
+							: "memory");																			\
+	}																												\
+	else {																											\
+		__asm__ __volatile__ ("stlr" OPS_SS " %" REG "0, [%1]"														\
+							: /* no output operands */																\
+							: "r" ((WTYPE)val), "r" (&atomic->v)													\
+							: "memory");																			\
+	}																												\
+																													\
+	if (fence == ATOMIC_OPS_FENCE_ACQUIRE || fence == ATOMIC_OPS_FENCE_FULL											\
+	 || fence == ATOMIC_OPS_FENCE_READ    || fence == ATOMIC_OPS_FENCE_WRITE) {										\
+		atomic_ops_fence(ATOMIC_OPS_FENCE_FULL);																	\
+	}																												\
+}
+
+// LSE has no plain 'and': ldclr clears the bits set in its operand
+#define GEN_atomic_ops_fetch_and_op(OPNAME, LSE_INSN, LSE_MASKOP, LLSC_INSN, TYPE, MNEMONIC, OPS_SS, REG, WTYPE) \
+static inline TYPE atomic_ops_##MNEMONIC##_fetch_and_##OPNAME(atomic_ops_##MNEMONIC *atomic, TYPE val, ATOMIC_OPS_FENCE fence) {	\
+	WTYPE arg = (WTYPE)val, oldval, newval;																							\
+	uint32_t failed;																												\
+																																	\
+	ATOMIC_OPS_AARCH64_ORDERED(fence, ATOMIC_OPS_AARCH64_FETCH_OP, LSE_INSN, LSE_MASKOP, LLSC_INSN, OPS_SS, REG)					\
+																																	\
+	UNUSED_ARGUMENT(newval);																										\
+	UNUSED_ARGUMENT(failed);																										\
+	return ((TYPE)oldval);																											\
+}
+
+#define GEN_atomic_ops_op(OPNAME, TYPE, MNEMONIC) \
+static inline void atomic_ops_##MNEMONIC##_##OPNAME(atomic_ops_##MNEMONIC *atomic, TYPE val, ATOMIC_OPS_FENCE fence) {	\
+	atomic_ops_##MNEMONIC##_fetch_and_##OPNAME(atomic, val, fence);													\
+}
+
+#define GEN_atomic_ops_not(TYPE, MNEMONIC) \
+static inline void atomic_ops_##MNEMONIC##_not(atomic_ops_##MNEMONIC *atomic, ATOMIC_OPS_FENCE fence) {	\
+	atomic_ops_##MNEMONIC##_fetch_and_xor(atomic, (TYPE)~((TYPE)0), fence);							\
+}
+
+#define GEN_atomic_ops_swap(TYPE, MNEMONIC, OPS_SS, REG, WTYPE) \
+static inline TYPE atomic_ops_##MNEMONIC##_swap(atomic_ops_##MNEMONIC *atomic, TYPE val, ATOMIC_OPS_FENCE fence) {	\
+	WTYPE arg = (WTYPE)val, oldval;																					\
+	uint32_t failed;																								\
+																													\
+	ATOMIC_OPS_AARCH64_ORDERED(fence, ATOMIC_OPS_AARCH64_SWAP, OPS_SS, REG)											\
+																													\
+	UNUSED_ARGUMENT(failed);																						\
+	return ((TYPE)oldval);																							\
+}
+
+// A failed CAS only loads: it has acquire semantics at most
+#define GEN_atomic_ops_casr(TYPE, MNEMONIC, OPS_SS, REG, WTYPE, CMP_EXT) \
+static inline TYPE atomic_ops_##MNEMONIC##_casr(atomic_ops_##MNEMONIC *atomic, TYPE oldval, TYPE newval, ATOMIC_OPS_FENCE fence) {	\
+	WTYPE expected = (WTYPE)oldval, prev = expected, arg = (WTYPE)newval;															\
+	uint32_t failed;																												\
+																																	\
+	ATOMIC_OPS_AARCH64_ORDERED(fence, ATOMIC_OPS_AARCH64_CASR, OPS_SS, REG, CMP_EXT)												\
+																																	\
+	UNUSED_ARGUMENT(failed);																										\
+	return ((TYPE)prev);																											\
+}
+
+#define GEN_atomic_ops_arith(TYPE, MNEMONIC, OPS_SS, REG, WTYPE) \
+GEN_atomic_ops_fetch_and_op(add, "ldadd", , "add", TYPE, MNEMONIC, OPS_SS, REG, WTYPE)	\
+GEN_atomic_ops_fetch_and_op(and, "ldclr", ~, "and", TYPE, MNEMONIC, OPS_SS, REG, WTYPE)	\
+GEN_atomic_ops_fetch_and_op(or,  "ldset", , "orr", TYPE, MNEMONIC, OPS_SS, REG, WTYPE)	\
+GEN_atomic_ops_fetch_and_op(xor, "ldeor", , "eor", TYPE, MNEMONIC, OPS_SS, REG, WTYPE)	\
+GEN_atomic_ops_not(TYPE, MNEMONIC)														\
+GEN_atomic_ops_op(and, TYPE, MNEMONIC)													\
+GEN_atomic_ops_op(or,  TYPE, MNEMONIC)													\
+GEN_atomic_ops_op(xor, TYPE, MNEMONIC)													\
+GEN_atomic_ops_op(add, TYPE, MNEMONIC)													\
+EMU_GEN_atomic_ops_incdec_by_add(inc, TYPE, MNEMONIC, 1)								\
+EMU_GEN_atomic_ops_incdec_by_add(dec, TYPE, MNEMONIC, -1)								\
+EMU_GEN_atomic_ops_fetch_and_incdec_by_faa(inc, TYPE, MNEMONIC, 1)						\
+EMU_GEN_atomic_ops_fetch_and_incdec_by_faa(dec, TYPE, MNEMONIC, -1)
+
+GEN_atomic_ops_load(intptr_t,  int,  "", "x", uint64_t)
+GEN_atomic_ops_load(uintptr_t, uint, "", "x", uint64_t)
+GEN_atomic_ops_load(void *,    ptr,  "", "x", uint64_t)
+
+GEN_atomic_ops_store(intptr_t,  int,  "", "x", uint64_t)
+GEN_atomic_ops_store(uintptr_t, uint, "", "x", uint64_t)
+GEN_atomic_ops_store(void *,    ptr,  "", "x", uint64_t)
+
+GEN_atomic_ops_arith(intptr_t,  int,  "", "x", uint64_t)
+GEN_atomic_ops_arith(uintptr_t, uint, "", "x", uint64_t)
+
+// EMULATED (ldsmax and co. always write, even when the value doesn't change)
+EMU_GEN_atomic_ops_fetch_minmax_by_cas(min, intptr_t,  int,  <)
+EMU_GEN_atomic_ops_fetch_minmax_by_cas(min, uintptr_t, uint, <)
+EMU_GEN_atomic_ops_fetch_minmax_by_cas(max, intptr_t,  int,  >)
+EMU_GEN_atomic_ops_fetch_minmax_by_cas(max, uintptr_t, uint, >)
+
+GEN_atomic_ops_casr(intptr_t,  int,  "", "x", uint64_t, "")
+GEN_atomic_ops_casr(uintptr_t, uint, "", "x", uint64_t, "")
+GEN_atomic_ops_casr(void *,    ptr,  "", "x", uint64_t, "")
+
+// EMULATED
+EMU_GEN_atomic_ops_cas_by_casr(intptr_t,  int)
+EMU_GEN_atomic_ops_cas_by_casr(uintptr_t, uint)
+EMU_GEN_atomic_ops_cas_by_casr(void *,    ptr)
+
+GEN_atomic_ops_swap(intptr_t,  int,  "", "x", uint64_t)
+GEN_atomic_ops_swap(uintptr_t, uint, "", "x", uint64_t)
+GEN_atomic_ops_swap(void *,    ptr,  "", "x", uint64_t)
+
+#define GEN_atomic_ops_test_and_bit(FNAME, OPNAME, TYPE, MNEMONIC, MASKOP) \
+static inline bool atomic_ops_##MNEMONIC##_test_and_##FNAME##_bit(atomic_ops_##MNEMONIC *atomic, unsigned int bit, ATOMIC_OPS_FENCE fence) {	\
+	TYPE mask = (TYPE)(((uintptr_t)1) << (bit % (sizeof(TYPE) * 8)));																			\
+																																				\
+	return ((atomic_ops_##MNEMONIC##_fetch_and_##OPNAME(atomic, (MASKOP mask), fence) & mask) != 0);											\
+}
+
+GEN_atomic_ops_test_and_bit(set,        or,  intptr_t,  int,  )
+GEN_atomic_ops_test_and_bit(set,        or,  uintptr_t, uint, )
+GEN_atomic_ops_test_and_bit(clear,      and, intptr_t,  int,  ~)
+GEN_atomic_ops_test_and_bit(clear,      and, uintptr_t, uint, ~)
+GEN_atomic_ops_test_and_bit(complement, xor, intptr_t,  int,  )
+GEN_atomic_ops_test_and_bit(complement, xor, uintptr_t, uint, )
+
+static inline atomic_ops_dptr_val atomic_ops_dptr_casr(atomic_ops_dptr *atomic, atomic_ops_dptr_val oldval, atomic_ops_dptr_val newval, ATOMIC_OPS_FENCE fence) {
+	register uint64_t x0 __asm__ ("x0") = oldval.lo;
+	register uint64_t x1 __asm__ ("x1") = oldval.hi;
+	register uint64_t x2 __asm__ ("x2") = newval.lo;
+	register uint64_t x3 __asm__ ("x3") = newval.hi;
+	uint32_t failed;
+
+	ATOMIC_OPS_AARCH64_ORDERED(fence, ATOMIC_OPS_AARCH64_DPTR_CASR, )
+
+	UNUSED_ARGUMENT(failed);
+
+	atomic_ops_dptr_val result = { (uintptr_t)x0, (uintptr_t)x1 };
+	return (result);
+}
+
+// EMULATED
+EMU_GEN_atomic_ops_dptr_cas_by_casr()
+EMU_GEN_atomic_ops_dptr_load_by_casr()
+EMU_GEN_atomic_ops_dptr_store_by_casr()
+
+// Fixed-width types: every instruction has byte and halfword forms, 32 bit ones use the w registers
+#define GEN_atomic_ops_fixed(TYPE, MNEMONIC, OPS_SS, REG, WTYPE, CMP_EXT) \
+GEN_atomic_ops_load(TYPE, MNEMONIC, OPS_SS, REG, WTYPE)			\
+GEN_atomic_ops_store(TYPE, MNEMONIC, OPS_SS, REG, WTYPE)		\
+GEN_atomic_ops_arith(TYPE, MNEMONIC, OPS_SS, REG, WTYPE)		\
+GEN_atomic_ops_casr(TYPE, MNEMONIC, OPS_SS, REG, WTYPE, CMP_EXT)	\
+EMU_GEN_atomic_ops_cas_by_casr(TYPE, MNEMONIC)					\
+GEN_atomic_ops_swap(TYPE, MNEMONIC, OPS_SS, REG, WTYPE)
+
+GEN_atomic_ops_fixed(int8_t,   i8,  "b", "w", uint32_t, ", uxtb")
+GEN_atomic_ops_fixed(uint8_t,  u8,  "b", "w", uint32_t, ", uxtb")
+GEN_atomic_ops_fixed(int16_t,  i16, "h", "w", uint32_t, ", uxth")
+GEN_atomic_ops_fixed(uint16_t, u16, "h", "w", uint32_t, ", uxth")
+GEN_atomic_ops_fixed(int32_t,  i32, "",  "w", uint32_t, "")
+GEN_atomic_ops_fixed(uint32_t, u32, "",  "w", uint32_t, "")
+GEN_atomic_ops_fixed(int64_t,  i64, "",  "x", uint64_t, "")
+GEN_atomic_ops_fixed(uint64_t, u64, "",  "x", uint64_t, "")
+
+// ishld orders earlier loads against everything after it: an acquire fence, and more than a read one
+static inline void atomic_ops_fence(ATOMIC_OPS_FENCE fence) {
+	__asm__ __volatile__ ("" ::: "memory");
+
+	if (fence == ATOMIC_OPS_FENCE_ACQUIRE || fence == ATOMIC_OPS_FENCE_READ) {
+		__asm__ __volatile__ ("dmb ishld" ::: "memory");
+	}
+
+	if (fence == ATOMIC_OPS_FENCE_RELEASE || fence == ATOMIC_OPS_FENCE_FULL) {
+		__asm__ __volatile__ ("dmb ish" ::: "memory");
+	}
+
+	if (fence == ATOMIC_OPS_FENCE_WRITE) {
+		__asm__ __volatile__ ("dmb ishst" ::: "memory");
+	}
+}
+
+static inline void atomic_ops_pause(void) {
+	__asm__ __volatile__ ("yield" ::: "memory");
+}
@@ -28,35 +28,57 @@ static inline void atomic_ops_emu_exit_fence(ATOMIC_OPS_FENCE fence) {
 	}
 }
 
-#define GEN_atomic_ops_ll(TYPE, MNEMONIC) \
+#define GEN_atomic_ops_ll(TYPE, MNEMONIC, OPS_SS) \
 static inline TYPE atomic_ops_##MNEMONIC##_ll(atomic_ops_##MNEMONIC *atomic) {	\
 	TYPE val;																	\
-	__asm__ __volatile__ ("ldrex %0, [%1]"										\
+	__asm__ __volatile__ ("ldrex" OPS_SS " %0, [%1]"							\
 						: "=&r" (val)											\
 						: "r" (&atomic->v)										\
 						: "memory");											\
 	return (val);																\
 }
 
-GEN_atomic_ops_ll(intptr_t,  int)
-GEN_atomic_ops_ll(uintptr_t, uint)
-GEN_atomic_ops_ll(void *,    ptr)
+GEN_atomic_ops_ll(intptr_t,  int,  "")
+GEN_atomic_ops_ll(uintptr_t, uint, "")
+GEN_atomic_ops_ll(void *,    ptr,  "")
 
-#define GEN_atomic_ops_sc(TYPE, MNEMONIC) \
+#define GEN_atomic_ops_sc(TYPE, MNEMONIC, OPS_SS) \
 static inline bool atomic_ops_##MNEMONIC##_sc(atomic_ops_##MNEMONIC *atomic, TYPE val) {	\
-	bool res;																				\
-	__asm__ __volatile__ ("strex %0, %1, [%2]"												\
-						: "=&r" (res) 														\
+	uint32_t failed;																		\
+	__asm__ __volatile__ ("strex" OPS_SS " %0, %1, [%2]"									\
+						: "=&r" (failed)													\
 						: "r" (val), "r" (&atomic->v)										\
 						: "memory");														\
-	return (res);																			\
+	return (failed == 0);																	\
 }
 
-GEN_atomic_ops_sc(intptr_t,  int)
-GEN_atomic_ops_sc(uintptr_t, uint)
-GEN_atomic_ops_sc(void *,    ptr)
+GEN_atomic_ops_sc(intptr_t,  int,  "")
+GEN_atomic_ops_sc(uintptr_t, uint, "")
+GEN_atomic_ops_sc(void *,    ptr,  "")
 
-#define GEN_atomic_ops_load(TYPE, MNEMONIC) \
+// ldrexd/strexd need an even/odd register pair, which GCC uses for 64 bit values
+static inline atomic_ops_dptr_val atomic_ops_dptr_ll(atomic_ops_dptr *atomic) {
+	uint64_t val;
+	__asm__ __volatile__ ("ldrexd %0, %H0, [%1]"
+						: "=&r" (val)
+						: "r" (&atomic->lo)
+						: "memory");
+
+	atomic_ops_dptr_val result = { (uintptr_t)val, (uintptr_t)(val >> 32) };
+	return (result);
+}
+
+static inline bool atomic_ops_dptr_sc(atomic_ops_dptr *atomic, atomic_ops_dptr_val val) {
+	uint64_t v = (((uint64_t)val.hi) << 32) | ((uint64_t)val.lo);
+	uint32_t failed;
+	__asm__ __volatile__ ("strexd %0, %1, %H1, [%2]"
+						: "=&r" (failed)
+						: "r" (v), "r" (&atomic->lo)
+						: "memory");
+	return (failed == 0);
+}
+
+#define GEN_atomic_ops_load(TYPE, MNEMONIC, OPS_SS) \
 static inline TYPE atomic_ops_##MNEMONIC##_load(const atomic_ops_##MNEMONIC *atomic, ATOMIC_OPS_FENCE fence) {	\
 	if (fence == ATOMIC_OPS_FENCE_RELEASE || fence == ATOMIC_OPS_FENCE_FULL										\
 	 || fence == ATOMIC_OPS_FENCE_READ    || fence == ATOMIC_OPS_FENCE_WRITE) {									\
@@ -64,7 +86,7 @@ static inline TYPE atomic_ops_##MNEMONIC##_load(const atomic_ops_##MNEMONIC *ato
 	}																											\
 																												\
 	TYPE val;																									\
-	__asm__ __volatile__ ("ldr %0, [%1]"																		\
+	__asm__ __volatile__ ("ldr" OPS_SS " %0, [%1]"																	\
 						: "=&r" (val)																			\
 						: "r" (&atomic->v)																		\
 						: "memory");																			\
@@ -77,18 +99,18 @@ static inline TYPE atomic_ops_##MNEMONIC##_load(const atomic_ops_##MNEMONIC *ato
 	return (val);																								\
 }
 
-GEN_atomic_ops_load(intptr_t,  int)
-GEN_atomic_ops_load(uintptr_t, uint)
-GEN_atomic_ops_load(void *,    ptr)
+GEN_atomic_ops_load(intptr_t,  int,  "")
+GEN_atomic_ops_load(uintptr_t, uint, "")
+GEN_atomic_ops_load(void *,    ptr,  "")
 
-#define GEN_atomic_ops_store(TYPE, MNEMONIC) \
+#define GEN_atomic_ops_store(TYPE, MNEMONIC, OPS_SS) \
 static inline void atomic_ops_##MNEMONIC##_store(atomic_ops_##MNEMONIC *atomic, TYPE val, ATOMIC_OPS_FENCE fence) {	\
 	if (fence == ATOMIC_OPS_FENCE_RELEASE || fence == ATOMIC_OPS_FENCE_FULL											\
 	 || fence == ATOMIC_OPS_FENCE_READ    || fence == ATOMIC_OPS_FENCE_WRITE) {										\
 		atomic_ops_fence(fence);																					\
 	}																												\
 																													\
-	__asm__ __volatile__ ("str %0, [%1]"																			\
+	__asm__ __volatile__ ("str" OPS_SS " %0, [%1]"																		\
 						: /* no output operands */																	\
 						: "r" (val), "r" (&atomic->v)																\
 						: "memory");																				\
@@ -99,9 +121,9 @@ static inline void atomic_ops_##MNEMONIC##_store(atomic_ops_##MNEMONIC *atomic,
 	}																												\
 }
 
-GEN_atomic_ops_store(intptr_t,  int)
-GEN_atomic_ops_store(uintptr_t, uint)
-GEN_atomic_ops_store(void *,    ptr)
+GEN_atomic_ops_store(intptr_t,  int,  "")
+GEN_atomic_ops_store(uintptr_t, uint, "")
+GEN_atomic_ops_store(void *,    ptr,  "")
 
 // EMULATED
 EMU_GEN_atomic_ops_not_by_llsc(intptr_t,  int)
@@ -124,6 +146,16 @@ EMU_GEN_atomic_ops_fetch_and_incdec_by_faa(inc, intptr_t,  int,  1)
 EMU_GEN_atomic_ops_fetch_and_incdec_by_faa(inc, uintptr_t, uint, 1)
 EMU_GEN_atomic_ops_fetch_and_incdec_by_faa(dec, intptr_t,  int,  -1)
 EMU_GEN_atomic_ops_fetch_and_incdec_by_faa(dec, uintptr_t, uint, -1)
+EMU_GEN_atomic_ops_fetch_and_andorxor_by_llsc(and, intptr_t,  int,  &)
+EMU_GEN_atomic_ops_fetch_and_andorxor_by_llsc(and, uintptr_t, uint, &)
+EMU_GEN_atomic_ops_fetch_and_andorxor_by_llsc(or,  intptr_t,  int,  |)
+EMU_GEN_atomic_ops_fetch_and_andorxor_by_llsc(or,  uintptr_t, uint, |)
+EMU_GEN_atomic_ops_fetch_and_andorxor_by_llsc(xor, intptr_t,  int,  ^)
+EMU_GEN_atomic_ops_fetch_and_andorxor_by_llsc(xor, uintptr_t, uint, ^)
+EMU_GEN_atomic_ops_fetch_minmax_by_llsc(min, intptr_t,  int,  <)
+EMU_GEN_atomic_ops_fetch_minmax_by_llsc(min, uintptr_t, uint, <)
+EMU_GEN_atomic_ops_fetch_minmax_by_llsc(max, intptr_t,  int,  >)
+EMU_GEN_atomic_ops_fetch_minmax_by_llsc(max, uintptr_t, uint, >)
 EMU_GEN_atomic_ops_casr_by_llsc(intptr_t,  int)
 EMU_GEN_atomic_ops_casr_by_llsc(uintptr_t, uint)
 EMU_GEN_atomic_ops_casr_by_llsc(void *,    ptr)
@@ -133,6 +165,43 @@ EMU_GEN_atomic_ops_cas_by_llsc(void *,    ptr)
 EMU_GEN_atomic_ops_swap_by_llsc(intptr_t,  int)
 EMU_GEN_atomic_ops_swap_by_llsc(uintptr_t, uint)
 EMU_GEN_atomic_ops_swap_by_llsc(void *,    ptr)
+EMU_GEN_atomic_ops_test_and_bit_by_llsc(set,        intptr_t,  int,  |, )
+EMU_GEN_atomic_ops_test_and_bit_by_llsc(set,        uintptr_t, uint, |, )
+EMU_GEN_atomic_ops_test_and_bit_by_llsc(clear,      intptr_t,  int,  &, ~)
+EMU_GEN_atomic_ops_test_and_bit_by_llsc(clear,      uintptr_t, uint, &, ~)
+EMU_GEN_atomic_ops_test_and_bit_by_llsc(complement, intptr_t,  int,  ^, )
+EMU_GEN_atomic_ops_test_and_bit_by_llsc(complement, uintptr_t, uint, ^, )
+EMU_GEN_atomic_ops_dptr_load_by_ll()
+EMU_GEN_atomic_ops_dptr_store_by_llsc()
+EMU_GEN_atomic_ops_dptr_casr_by_llsc()
+EMU_GEN_atomic_ops_dptr_cas_by_casr()
+
+// Fixed-width types: ldrex/strex and ldr/str have byte and halfword forms
+#define GEN_atomic_ops_fixed(TYPE, MNEMONIC, OPS_SS) \
+GEN_atomic_ops_ll(TYPE, MNEMONIC, OPS_SS)								\
+GEN_atomic_ops_sc(TYPE, MNEMONIC, OPS_SS)								\
+GEN_atomic_ops_load(TYPE, MNEMONIC, OPS_SS)								\
+GEN_atomic_ops_store(TYPE, MNEMONIC, OPS_SS)							\
+EMU_GEN_atomic_ops_not_by_llsc(TYPE, MNEMONIC)							\
+EMU_GEN_atomic_ops_andorxoradd_by_llsc(and, TYPE, MNEMONIC, &)			\
+EMU_GEN_atomic_ops_andorxoradd_by_llsc(or,  TYPE, MNEMONIC, |)			\
+EMU_GEN_atomic_ops_andorxoradd_by_llsc(xor, TYPE, MNEMONIC, ^)			\
+EMU_GEN_atomic_ops_andorxoradd_by_llsc(add, TYPE, MNEMONIC, +)			\
+EMU_GEN_atomic_ops_incdec_by_add(inc, TYPE, MNEMONIC, 1)				\
+EMU_GEN_atomic_ops_incdec_by_add(dec, TYPE, MNEMONIC, -1)				\
+EMU_GEN_atomic_ops_fetch_and_add_by_llsc(TYPE, MNEMONIC)				\
+EMU_GEN_atomic_ops_fetch_and_incdec_by_faa(inc, TYPE, MNEMONIC, 1)		\
+EMU_GEN_atomic_ops_fetch_and_incdec_by_faa(dec, TYPE, MNEMONIC, -1)		\
+EMU_GEN_atomic_ops_casr_by_llsc(TYPE, MNEMONIC)							\
+EMU_GEN_atomic_ops_cas_by_llsc(TYPE, MNEMONIC)							\
+EMU_GEN_atomic_ops_swap_by_llsc(TYPE, MNEMONIC)
+
+GEN_atomic_ops_fixed(int8_t,   i8,  "b")
+GEN_atomic_ops_fixed(uint8_t,  u8,  "b")
+GEN_atomic_ops_fixed(int16_t,  i16, "h")
+GEN_atomic_ops_fixed(uint16_t, u16, "h")
+GEN_atomic_ops_fixed(int32_t,  i32, "")
+GEN_atomic_ops_fixed(uint32_t, u32, "")
 
 static inline void atomic_ops_fence(ATOMIC_OPS_FENCE fence) {
 	__asm__ __volatile__ ("" ::: "memory");
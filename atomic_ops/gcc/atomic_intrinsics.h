@@ -0,0 +1,308 @@
+/**
+ * This file is part of the atomic_ops project.
+ *
+ * For the full copyright and license information, please view the COPYING
+ * file that was distributed with this source code.
+ *
+ * @copyright  (c) the atomic_ops project
+ * @author     Luca Longinotti <chtekk@longitekk.com>
+ * @license    BSD 2-clause
+ * @version    $Id$
+ */
+
+/*
+ * Generic implementation on the GCC/Clang __atomic builtins, which take a
+ * memory order: unlike the __sync ones, which are always full barriers, every
+ * operation only orders as much as its fence asks for.
+ * NONE is relaxed, ACQUIRE and RELEASE map to themselves, FULL (and READ and
+ * WRITE, which are full ones restricted to reads or writes) is sequentially
+ * consistent. A seq_cst RMW still doesn't keep later relaxed accesses from
+ * moving before its store, which FULL promises: so FULL RMWs keep using the
+ * __sync builtins, GCC's full barrier RMWs, and swap adds a trailing fence.
+ * Every operation is also a compiler barrier, like the asm implementations.
+ */
+
+static inline int atomic_ops_memorder(ATOMIC_OPS_FENCE fence) ATTR_ALWAYSINLINE;
+
+static inline int atomic_ops_memorder(ATOMIC_OPS_FENCE fence) {
+	if (fence == ATOMIC_OPS_FENCE_NONE) {
+		return (__ATOMIC_RELAXED);
+	}
+
+	if (fence == ATOMIC_OPS_FENCE_ACQUIRE) {
+		return (__ATOMIC_ACQUIRE);
+	}
+
+	if (fence == ATOMIC_OPS_FENCE_RELEASE) {
+		return (__ATOMIC_RELEASE);
+	}
+
+	return (__ATOMIC_SEQ_CST);
+}
+
+// For the emulated operations, whose loads and CASes are all relaxed
+static inline void atomic_ops_emu_entry_fence(ATOMIC_OPS_FENCE fence) {
+	if (fence == ATOMIC_OPS_FENCE_RELEASE || fence == ATOMIC_OPS_FENCE_FULL
+	 || fence == ATOMIC_OPS_FENCE_READ    || fence == ATOMIC_OPS_FENCE_WRITE) {
+		atomic_ops_fence(fence);
+	}
+}
+
+static inline void atomic_ops_emu_exit_fence(ATOMIC_OPS_FENCE fence) {
+	if (fence == ATOMIC_OPS_FENCE_ACQUIRE || fence == ATOMIC_OPS_FENCE_FULL
+	 || fence == ATOMIC_OPS_FENCE_READ    || fence == ATOMIC_OPS_FENCE_WRITE) {
+		atomic_ops_fence(fence);
+	}
+}
+
+// Only a full fence orders earlier stores before a load: RELEASE and FULL need one
+#define GEN_atomic_ops_load(TYPE, MNEMONIC) \
+static inline TYPE atomic_ops_##MNEMONIC##_load(const atomic_ops_##MNEMONIC *atomic, ATOMIC_OPS_FENCE fence) {	\
+	if (fence != ATOMIC_OPS_FENCE_NONE && fence != ATOMIC_OPS_FENCE_ACQUIRE) {									\
+		atomic_ops_fence(ATOMIC_OPS_FENCE_FULL);																\
+	}																											\
+																												\
+	atomic_ops_fence(ATOMIC_OPS_FENCE_NONE);																	\
+	TYPE val = __atomic_load_n(&atomic->v, (fence == ATOMIC_OPS_FENCE_NONE || fence == ATOMIC_OPS_FENCE_RELEASE)	\
+										   ? (__ATOMIC_RELAXED) : (__ATOMIC_ACQUIRE));							\
+	atomic_ops_fence(ATOMIC_OPS_FENCE_NONE);																	\
+																												\
+	return (val);																								\
+}
+
+GEN_atomic_ops_load(intptr_t,  int)
+GEN_atomic_ops_load(uintptr_t, uint)
+GEN_atomic_ops_load(void *,    ptr)
+
+// Only a full fence orders a store before later loads: ACQUIRE and FULL need one
+#define GEN_atomic_ops_store(TYPE, MNEMONIC) \
+static inline void atomic_ops_##MNEMONIC##_store(atomic_ops_##MNEMONIC *atomic, TYPE val, ATOMIC_OPS_FENCE fence) {	\
+	atomic_ops_fence(ATOMIC_OPS_FENCE_NONE);																		\
+	__atomic_store_n(&atomic->v, val, (fence == ATOMIC_OPS_FENCE_NONE || fence == ATOMIC_OPS_FENCE_ACQUIRE)			\
+									  ? (__ATOMIC_RELAXED) : (__ATOMIC_RELEASE));									\
+	atomic_ops_fence(ATOMIC_OPS_FENCE_NONE);																		\
+																													\
+	if (fence != ATOMIC_OPS_FENCE_NONE && fence != ATOMIC_OPS_FENCE_RELEASE) {										\
+		atomic_ops_fence(ATOMIC_OPS_FENCE_FULL);																	\
+	}																												\
+}
+
+GEN_atomic_ops_store(intptr_t,  int)
+GEN_atomic_ops_store(uintptr_t, uint)
+GEN_atomic_ops_store(void *,    ptr)
+
+#define GEN_atomic_ops_fetch_and_op(OPNAME, TYPE, MNEMONIC) \
+static inline TYPE atomic_ops_##MNEMONIC##_fetch_and_##OPNAME(atomic_ops_##MNEMONIC *atomic, TYPE val, ATOMIC_OPS_FENCE fence) {	\
+	if (atomic_ops_memorder(fence) == __ATOMIC_SEQ_CST) {																			\
+		return (__sync_fetch_and_##OPNAME(&atomic->v, val, /* protected variables: */ &atomic->v));									\
+	}																																\
+																																	\
+	atomic_ops_fence(ATOMIC_OPS_FENCE_NONE);																						\
+	TYPE oldval = __atomic_fetch_##OPNAME(&atomic->v, val, atomic_ops_memorder(fence));											\
+	atomic_ops_fence(ATOMIC_OPS_FENCE_NONE);																						\
+																																	\
+	return (oldval);																												\
+}
+
+// Value discarded: the compiler picks the store-only form where there's one (LSE's stadd, for example)
+#define GEN_atomic_ops_op(OPNAME, TYPE, MNEMONIC) \
+static inline void atomic_ops_##MNEMONIC##_##OPNAME(atomic_ops_##MNEMONIC *atomic, TYPE val, ATOMIC_OPS_FENCE fence) {	\
+	atomic_ops_##MNEMONIC##_fetch_and_##OPNAME(atomic, val, fence);													\
+}
+
+#define GEN_atomic_ops_not(TYPE, MNEMONIC) \
+static inline void atomic_ops_##MNEMONIC##_not(atomic_ops_##MNEMONIC *atomic, ATOMIC_OPS_FENCE fence) {	\
+	atomic_ops_##MNEMONIC##_fetch_and_xor(atomic, (TYPE)~((TYPE)0), fence);							\
+}
+
+GEN_atomic_ops_fetch_and_op(add, intptr_t,  int)
+GEN_atomic_ops_fetch_and_op(add, uintptr_t, uint)
+GEN_atomic_ops_fetch_and_op(and, intptr_t,  int)
+GEN_atomic_ops_fetch_and_op(and, uintptr_t, uint)
+GEN_atomic_ops_fetch_and_op(or,  intptr_t,  int)
+GEN_atomic_ops_fetch_and_op(or,  uintptr_t, uint)
+GEN_atomic_ops_fetch_and_op(xor, intptr_t,  int)
+GEN_atomic_ops_fetch_and_op(xor, uintptr_t, uint)
+
+GEN_atomic_ops_not(intptr_t,  int)
+GEN_atomic_ops_not(uintptr_t, uint)
+GEN_atomic_ops_op(and, intptr_t,  int)
+GEN_atomic_ops_op(and, uintptr_t, uint)
+GEN_atomic_ops_op(or,  intptr_t,  int)
+GEN_atomic_ops_op(or,  uintptr_t, uint)
+GEN_atomic_ops_op(xor, intptr_t,  int)
+GEN_atomic_ops_op(xor, uintptr_t, uint)
+GEN_atomic_ops_op(add, intptr_t,  int)
+GEN_atomic_ops_op(add, uintptr_t, uint)
+
+// EMULATED
+EMU_GEN_atomic_ops_incdec_by_add(inc, intptr_t,  int,  1)
+EMU_GEN_atomic_ops_incdec_by_add(inc, uintptr_t, uint, 1)
+EMU_GEN_atomic_ops_incdec_by_add(dec, intptr_t,  int,  -1)
+EMU_GEN_atomic_ops_incdec_by_add(dec, uintptr_t, uint, -1)
+EMU_GEN_atomic_ops_fetch_and_incdec_by_faa(inc, intptr_t,  int,  1)
+EMU_GEN_atomic_ops_fetch_and_incdec_by_faa(inc, uintptr_t, uint, 1)
+EMU_GEN_atomic_ops_fetch_and_incdec_by_faa(dec, intptr_t,  int,  -1)
+EMU_GEN_atomic_ops_fetch_and_incdec_by_faa(dec, uintptr_t, uint, -1)
+
+// EMULATED (there's no __atomic_fetch_min/max in GCC)
+EMU_GEN_atomic_ops_fetch_minmax_by_cas(min, intptr_t,  int,  <)
+EMU_GEN_atomic_ops_fetch_minmax_by_cas(min, uintptr_t, uint, <)
+EMU_GEN_atomic_ops_fetch_minmax_by_cas(max, intptr_t,  int,  >)
+EMU_GEN_atomic_ops_fetch_minmax_by_cas(max, uintptr_t, uint, >)
+
+// A failed CAS only loads: it can't have release semantics
+#define GEN_atomic_ops_casr(TYPE, MNEMONIC) \
+static inline TYPE atomic_ops_##MNEMONIC##_casr(atomic_ops_##MNEMONIC *atomic, TYPE oldval, TYPE newval, ATOMIC_OPS_FENCE fence) {	\
+	if (atomic_ops_memorder(fence) == __ATOMIC_SEQ_CST) {																			\
+		return (__sync_val_compare_and_swap(&atomic->v, oldval, newval, /* protected variables: */ &atomic->v));					\
+	}																																\
+																																	\
+	atomic_ops_fence(ATOMIC_OPS_FENCE_NONE);																						\
+	__atomic_compare_exchange_n(&atomic->v, &oldval, newval, false, atomic_ops_memorder(fence),									\
+								(fence == ATOMIC_OPS_FENCE_ACQUIRE) ? (__ATOMIC_ACQUIRE) : (__ATOMIC_RELAXED));						\
+	atomic_ops_fence(ATOMIC_OPS_FENCE_NONE);																						\
+																																	\
+	return (oldval);																												\
+}
+
+GEN_atomic_ops_casr(intptr_t,  int)
+GEN_atomic_ops_casr(uintptr_t, uint)
+GEN_atomic_ops_casr(void *,    ptr)
+
+#define GEN_atomic_ops_cas(TYPE, MNEMONIC) \
+static inline bool atomic_ops_##MNEMONIC##_cas(atomic_ops_##MNEMONIC *atomic, TYPE oldval, TYPE newval, ATOMIC_OPS_FENCE fence) {	\
+	if (atomic_ops_memorder(fence) == __ATOMIC_SEQ_CST) {																			\
+		return (__sync_bool_compare_and_swap(&atomic->v, oldval, newval, /* protected variables: */ &atomic->v));					\
+	}																																\
+																																	\
+	atomic_ops_fence(ATOMIC_OPS_FENCE_NONE);																						\
+	bool ret = __atomic_compare_exchange_n(&atomic->v, &oldval, newval, false, atomic_ops_memorder(fence),							\
+										   (fence == ATOMIC_OPS_FENCE_ACQUIRE) ? (__ATOMIC_ACQUIRE) : (__ATOMIC_RELAXED));			\
+	atomic_ops_fence(ATOMIC_OPS_FENCE_NONE);																						\
+																																	\
+	return (ret);																													\
+}
+
+GEN_atomic_ops_cas(intptr_t,  int)
+GEN_atomic_ops_cas(uintptr_t, uint)
+GEN_atomic_ops_cas(void *,    ptr)
+
+// There's no __sync exchange: FULL is seq_cst plus a full fence after it
+#define GEN_atomic_ops_swap(TYPE, MNEMONIC) \
+static inline TYPE atomic_ops_##MNEMONIC##_swap(atomic_ops_##MNEMONIC *atomic, TYPE val, ATOMIC_OPS_FENCE fence) {	\
+	atomic_ops_fence(ATOMIC_OPS_FENCE_NONE);																		\
+	TYPE oldval = __atomic_exchange_n(&atomic->v, val, atomic_ops_memorder(fence));									\
+	atomic_ops_fence(ATOMIC_OPS_FENCE_NONE);																		\
+																													\
+	if (atomic_ops_memorder(fence) == __ATOMIC_SEQ_CST) {															\
+		atomic_ops_fence(ATOMIC_OPS_FENCE_FULL);																	\
+	}																												\
+																													\
+	return (oldval);																								\
+}
+
+GEN_atomic_ops_swap(intptr_t,  int)
+GEN_atomic_ops_swap(uintptr_t, uint)
+GEN_atomic_ops_swap(void *,    ptr)
+
+#define GEN_atomic_ops_test_and_bit(FNAME, OPNAME, TYPE, MNEMONIC, MASKOP) \
+static inline bool atomic_ops_##MNEMONIC##_test_and_##FNAME##_bit(atomic_ops_##MNEMONIC *atomic, unsigned int bit, ATOMIC_OPS_FENCE fence) {	\
+	TYPE mask = (TYPE)(((uintptr_t)1) << (bit % (sizeof(TYPE) * 8)));																			\
+																																				\
+	return ((atomic_ops_##MNEMONIC##_fetch_and_##OPNAME(atomic, (MASKOP mask), fence) & mask) != 0);											\
+}
+
+GEN_atomic_ops_test_and_bit(set,        or,  intptr_t,  int,  )
+GEN_atomic_ops_test_and_bit(set,        or,  uintptr_t, uint, )
+GEN_atomic_ops_test_and_bit(clear,      and, intptr_t,  int,  ~)
+GEN_atomic_ops_test_and_bit(clear,      and, uintptr_t, uint, ~)
+GEN_atomic_ops_test_and_bit(complement, xor, intptr_t,  int,  )
+GEN_atomic_ops_test_and_bit(complement, xor, uintptr_t, uint, )
+
+// Fixed-width types: the builtins are sized by their operand already
+#define GEN_atomic_ops_fixed(TYPE, MNEMONIC) \
+GEN_atomic_ops_load(TYPE, MNEMONIC)										\
+GEN_atomic_ops_store(TYPE, MNEMONIC)									\
+GEN_atomic_ops_fetch_and_op(add, TYPE, MNEMONIC)						\
+GEN_atomic_ops_fetch_and_op(and, TYPE, MNEMONIC)						\
+GEN_atomic_ops_fetch_and_op(or,  TYPE, MNEMONIC)						\
+GEN_atomic_ops_fetch_and_op(xor, TYPE, MNEMONIC)						\
+GEN_atomic_ops_not(TYPE, MNEMONIC)										\
+GEN_atomic_ops_op(and, TYPE, MNEMONIC)									\
+GEN_atomic_ops_op(or,  TYPE, MNEMONIC)									\
+GEN_atomic_ops_op(xor, TYPE, MNEMONIC)									\
+GEN_atomic_ops_op(add, TYPE, MNEMONIC)									\
+EMU_GEN_atomic_ops_incdec_by_add(inc, TYPE, MNEMONIC, 1)				\
+EMU_GEN_atomic_ops_incdec_by_add(dec, TYPE, MNEMONIC, -1)				\
+EMU_GEN_atomic_ops_fetch_and_incdec_by_faa(inc, TYPE, MNEMONIC, 1)		\
+EMU_GEN_atomic_ops_fetch_and_incdec_by_faa(dec, TYPE, MNEMONIC, -1)		\
+GEN_atomic_ops_casr(TYPE, MNEMONIC)										\
+GEN_atomic_ops_cas(TYPE, MNEMONIC)										\
+GEN_atomic_ops_swap(TYPE, MNEMONIC)
+
+GEN_atomic_ops_fixed(int8_t,   i8)
+GEN_atomic_ops_fixed(uint8_t,  u8)
+GEN_atomic_ops_fixed(int16_t,  i16)
+GEN_atomic_ops_fixed(uint16_t, u16)
+GEN_atomic_ops_fixed(int32_t,  i32)
+GEN_atomic_ops_fixed(uint32_t, u32)
+#if UINTPTR_MAX == UINT64_MAX
+GEN_atomic_ops_fixed(int64_t,  i64)
+GEN_atomic_ops_fixed(uint64_t, u64)
+#endif
+
+// Double-width __atomic operations go through libatomic, which may use a lock: keep the __sync CAS
+#if (UINTPTR_MAX == UINT64_MAX && defined(__GCC_HAVE_SYNC_COMPARE_AND_SWAP_16)) \
+ || (UINTPTR_MAX == UINT32_MAX && defined(__GCC_HAVE_SYNC_COMPARE_AND_SWAP_8))
+
+#if UINTPTR_MAX == UINT64_MAX
+	typedef unsigned __int128 atomic_ops_dptr_word;
+#else
+	typedef uint64_t atomic_ops_dptr_word;
+#endif
+
+typedef union { atomic_ops_dptr_val val; atomic_ops_dptr_word word; } atomic_ops_dptr_union;
+
+static inline atomic_ops_dptr_val atomic_ops_dptr_casr(atomic_ops_dptr *atomic, atomic_ops_dptr_val oldval, atomic_ops_dptr_val newval, ATOMIC_OPS_FENCE fence) {
+	UNUSED_ARGUMENT(fence);
+
+	atomic_ops_dptr_union o = { oldval }, n = { newval }, r;
+	volatile atomic_ops_dptr_word *word = (volatile atomic_ops_dptr_word *)atomic;
+
+	r.word = __sync_val_compare_and_swap(word, o.word, n.word, /* protected variables: */ word);
+	return (r.val);
+}
+
+// EMULATED
+EMU_GEN_atomic_ops_dptr_cas_by_casr()
+EMU_GEN_atomic_ops_dptr_load_by_casr()
+EMU_GEN_atomic_ops_dptr_store_by_casr()
+
+#else
+
+// EMULATED (no double-width CAS available, needs -mcx16 on x86-64 for example)
+EMU_GEN_atomic_ops_dptr_by_lock()
+
+#endif
+
+// READ and WRITE only order reads, or writes: an acquire, or release, fence does that
+static inline void atomic_ops_fence(ATOMIC_OPS_FENCE fence) {
+	__atomic_signal_fence(__ATOMIC_SEQ_CST);
+
+	if (fence == ATOMIC_OPS_FENCE_ACQUIRE || fence == ATOMIC_OPS_FENCE_READ) {
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	}
+
+	if (fence == ATOMIC_OPS_FENCE_RELEASE || fence == ATOMIC_OPS_FENCE_WRITE) {
+		__atomic_thread_fence(__ATOMIC_RELEASE);
+	}
+
+	if (fence == ATOMIC_OPS_FENCE_FULL) {
+		__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	}
+}
+
+static inline void atomic_ops_pause(void) {
+	__asm__ __volatile__ ("" ::: "memory");
+}
@@ -15,10 +15,12 @@
 	#define ATOMIC_OPS_SS ""
 	#define ATOMIC_OPS_SS_SIGNED "sw"
 	#define ATOMIC_OPS_SS_UNSIGNED "uw"
+	#define ATOMIC_OPS_SS_STORE "w"
 #elif UINTPTR_MAX == UINT64_MAX
 	#define ATOMIC_OPS_SS "x"
 	#define ATOMIC_OPS_SS_SIGNED "x"
 	#define ATOMIC_OPS_SS_UNSIGNED "x"
+	#define ATOMIC_OPS_SS_STORE "x"
 #else
 	#error uintptr_t is not a 32 or 64 bit type. Only 32/64 bit systems are supported for SPARCv9.
 #endif
@@ -61,7 +63,7 @@ static inline TYPE atomic_ops_##MNEMONIC##_load(const atomic_ops_##MNEMONIC *ato
 	}																											\
 																												\
 	TYPE val;																									\
-	__asm__ __volatile__ ("ld"OPS_SS" [%1], %0"																	\
+	__asm__ __volatile__ ("ld" OPS_SS " [%1], %0"																\
 						: "=&r" (val)																			\
 						: "r" (&atomic->v)																		\
 						: "memory");																			\
@@ -95,7 +97,7 @@ static inline void atomic_ops_##MNEMONIC##_store(atomic_ops_##MNEMONIC *atomic,
 		__asm__ __volatile__ ("membar #StoreStore" ::: "memory");													\
 	}																												\
 																													\
-	__asm__ __volatile__ ("st"OPS_SS" %0, [%1]"																		\
+	__asm__ __volatile__ ("st" OPS_SS " %0, [%1]"																	\
 						: /* no output operands */																	\
 						: "r" (val), "r" (&atomic->v)																\
 						: "memory");																				\
@@ -111,9 +113,9 @@ static inline void atomic_ops_##MNEMONIC##_store(atomic_ops_##MNEMONIC *atomic,
 	}																												\
 }
 
-GEN_atomic_ops_store(intptr_t,  int,  ATOMIC_OPS_SS_SIGNED)
-GEN_atomic_ops_store(uintptr_t, uint, ATOMIC_OPS_SS_UNSIGNED)
-GEN_atomic_ops_store(void *,    ptr,  ATOMIC_OPS_SS_UNSIGNED)
+GEN_atomic_ops_store(intptr_t,  int,  ATOMIC_OPS_SS_STORE)
+GEN_atomic_ops_store(uintptr_t, uint, ATOMIC_OPS_SS_STORE)
+GEN_atomic_ops_store(void *,    ptr,  ATOMIC_OPS_SS_STORE)
 
 // EMULATED
 EMU_GEN_atomic_ops_not_by_cas(intptr_t,  int)
@@ -136,8 +138,18 @@ EMU_GEN_atomic_ops_fetch_and_incdec_by_faa(inc, intptr_t,  int,  1)
 EMU_GEN_atomic_ops_fetch_and_incdec_by_faa(inc, uintptr_t, uint, 1)
 EMU_GEN_atomic_ops_fetch_and_incdec_by_faa(dec, intptr_t,  int,  -1)
 EMU_GEN_atomic_ops_fetch_and_incdec_by_faa(dec, uintptr_t, uint, -1)
+EMU_GEN_atomic_ops_fetch_and_andorxor_by_cas(and, intptr_t,  int,  &)
+EMU_GEN_atomic_ops_fetch_and_andorxor_by_cas(and, uintptr_t, uint, &)
+EMU_GEN_atomic_ops_fetch_and_andorxor_by_cas(or,  intptr_t,  int,  |)
+EMU_GEN_atomic_ops_fetch_and_andorxor_by_cas(or,  uintptr_t, uint, |)
+EMU_GEN_atomic_ops_fetch_and_andorxor_by_cas(xor, intptr_t,  int,  ^)
+EMU_GEN_atomic_ops_fetch_and_andorxor_by_cas(xor, uintptr_t, uint, ^)
+EMU_GEN_atomic_ops_fetch_minmax_by_cas(min, intptr_t,  int,  <)
+EMU_GEN_atomic_ops_fetch_minmax_by_cas(min, uintptr_t, uint, <)
+EMU_GEN_atomic_ops_fetch_minmax_by_cas(max, intptr_t,  int,  >)
+EMU_GEN_atomic_ops_fetch_minmax_by_cas(max, uintptr_t, uint, >)
 
-#define GEN_atomic_ops_casr(TYPE, MNEMONIC) \
+#define GEN_atomic_ops_casr(TYPE, MNEMONIC, OPS_SS) \
 static inline TYPE atomic_ops_##MNEMONIC##_casr(atomic_ops_##MNEMONIC *atomic, TYPE oldval, TYPE newval, ATOMIC_OPS_FENCE fence) {	\
 	if (fence == ATOMIC_OPS_FENCE_RELEASE || fence == ATOMIC_OPS_FENCE_FULL) {														\
 		__asm__ __volatile__ ("membar #LoadStore | #StoreStore" ::: "memory");														\
@@ -150,8 +162,8 @@ static inline TYPE atomic_ops_##MNEMONIC##_casr(atomic_ops_##MNEMONIC *atomic, T
 	}																																\
 																																	\
 	TYPE result;																													\
-	__asm__ __volatile__ ("cas"ATOMIC_OPS_SS" [%3], %1, %0"																			\
-						: "=&r" (result), 																							\
+	__asm__ __volatile__ ("cas" OPS_SS " [%3], %1, %0"																					\
+						: "=&r" (result)																								\
 						: "r" (oldval), "0" (newval), "r" (&atomic->v)																\
 						: "memory");																								\
 																																	\
@@ -168,14 +180,20 @@ static inline TYPE atomic_ops_##MNEMONIC##_casr(atomic_ops_##MNEMONIC *atomic, T
 	return (result);																												\
 }
 
-GEN_atomic_ops_casr(intptr_t,  int)
-GEN_atomic_ops_casr(uintptr_t, uint)
-GEN_atomic_ops_casr(void *,    ptr)
+GEN_atomic_ops_casr(intptr_t,  int,  ATOMIC_OPS_SS)
+GEN_atomic_ops_casr(uintptr_t, uint, ATOMIC_OPS_SS)
+GEN_atomic_ops_casr(void *,    ptr,  ATOMIC_OPS_SS)
 
 // EMULATED
 EMU_GEN_atomic_ops_cas_by_casr(intptr_t,  int)
 EMU_GEN_atomic_ops_cas_by_casr(uintptr_t, uint)
 EMU_GEN_atomic_ops_cas_by_casr(void *,    ptr)
+EMU_GEN_atomic_ops_test_and_bit_by_cas(set,        intptr_t,  int,  |, )
+EMU_GEN_atomic_ops_test_and_bit_by_cas(set,        uintptr_t, uint, |, )
+EMU_GEN_atomic_ops_test_and_bit_by_cas(clear,      intptr_t,  int,  &, ~)
+EMU_GEN_atomic_ops_test_and_bit_by_cas(clear,      uintptr_t, uint, &, ~)
+EMU_GEN_atomic_ops_test_and_bit_by_cas(complement, intptr_t,  int,  ^, )
+EMU_GEN_atomic_ops_test_and_bit_by_cas(complement, uintptr_t, uint, ^, )
 
 #if UINTPTR_MAX == UINT64_MAX
 
@@ -200,7 +218,7 @@ static inline TYPE atomic_ops_##MNEMONIC##_swap(atomic_ops_##MNEMONIC *atomic, T
 																													\
 	TYPE result;																									\
 	__asm__ __volatile__ ("swap [%2], %0"																			\
-						: "=&r" (result), 																			\
+						: "=&r" (result)																				\
 						: "0" (val), "r" (&atomic->v)																\
 						: "memory");																				\
 																													\
@@ -223,6 +241,51 @@ GEN_atomic_ops_swap(void *,    ptr)
 
 #endif
 
+// Fixed-width types: sized loads and stores, everything else by CAS
+#define GEN_atomic_ops_fixed(TYPE, MNEMONIC, LOAD_SS, STORE_SS) \
+GEN_atomic_ops_load(TYPE, MNEMONIC, LOAD_SS)							\
+GEN_atomic_ops_store(TYPE, MNEMONIC, STORE_SS)							\
+EMU_GEN_atomic_ops_not_by_cas(TYPE, MNEMONIC)							\
+EMU_GEN_atomic_ops_andorxoradd_by_cas(and, TYPE, MNEMONIC, &)			\
+EMU_GEN_atomic_ops_andorxoradd_by_cas(or,  TYPE, MNEMONIC, |)			\
+EMU_GEN_atomic_ops_andorxoradd_by_cas(xor, TYPE, MNEMONIC, ^)			\
+EMU_GEN_atomic_ops_andorxoradd_by_cas(add, TYPE, MNEMONIC, +)			\
+EMU_GEN_atomic_ops_incdec_by_add(inc, TYPE, MNEMONIC, 1)				\
+EMU_GEN_atomic_ops_incdec_by_add(dec, TYPE, MNEMONIC, -1)				\
+EMU_GEN_atomic_ops_fetch_and_add_by_cas(TYPE, MNEMONIC)					\
+EMU_GEN_atomic_ops_fetch_and_incdec_by_faa(inc, TYPE, MNEMONIC, 1)		\
+EMU_GEN_atomic_ops_fetch_and_incdec_by_faa(dec, TYPE, MNEMONIC, -1)		\
+EMU_GEN_atomic_ops_cas_by_casr(TYPE, MNEMONIC)							\
+EMU_GEN_atomic_ops_swap_by_cas(TYPE, MNEMONIC)
+
+GEN_atomic_ops_fixed(int8_t,   i8,  "sb", "b")
+GEN_atomic_ops_fixed(uint8_t,  u8,  "ub", "b")
+GEN_atomic_ops_fixed(int16_t,  i16, "sh", "h")
+GEN_atomic_ops_fixed(uint16_t, u16, "uh", "h")
+GEN_atomic_ops_fixed(int32_t,  i32, "sw", "w")
+GEN_atomic_ops_fixed(uint32_t, u32, "uw", "w")
+#if UINTPTR_MAX == UINT64_MAX
+GEN_atomic_ops_fixed(int64_t,  i64, "x",  "x")
+GEN_atomic_ops_fixed(uint64_t, u64, "x",  "x")
+#endif
+
+// cas is 32 bit, casx 64 bit: smaller types are swapped in the word containing them
+GEN_atomic_ops_casr(int32_t,  i32, "")
+GEN_atomic_ops_casr(uint32_t, u32, "")
+#if UINTPTR_MAX == UINT64_MAX
+GEN_atomic_ops_casr(int64_t,  i64, "x")
+GEN_atomic_ops_casr(uint64_t, u64, "x")
+#endif
+
+// EMULATED
+EMU_GEN_atomic_ops_casr_by_word(int8_t,   i8)
+EMU_GEN_atomic_ops_casr_by_word(uint8_t,  u8)
+EMU_GEN_atomic_ops_casr_by_word(int16_t,  i16)
+EMU_GEN_atomic_ops_casr_by_word(uint16_t, u16)
+
+// EMULATED (casx is the widest CAS, and it's only as wide as a pointer on 64 bit)
+EMU_GEN_atomic_ops_dptr_by_lock()
+
 static inline void atomic_ops_fence(ATOMIC_OPS_FENCE fence) {
 	__asm__ __volatile__ ("" ::: "memory");
 
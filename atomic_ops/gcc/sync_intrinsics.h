@@ -105,6 +105,26 @@ EMU_GEN_atomic_ops_fetch_and_incdec_by_faa(inc, uintptr_t, uint, 1)
 EMU_GEN_atomic_ops_fetch_and_incdec_by_faa(dec, intptr_t,  int,  -1)
 EMU_GEN_atomic_ops_fetch_and_incdec_by_faa(dec, uintptr_t, uint, -1)
 
+#define GEN_atomic_ops_fetch_and_andorxor(FNAME, TYPE, MNEMONIC) \
+static inline TYPE atomic_ops_##MNEMONIC##_fetch_and_##FNAME(atomic_ops_##MNEMONIC *atomic, TYPE val, ATOMIC_OPS_FENCE fence) {	\
+	UNUSED_ARGUMENT(fence);																										\
+																																\
+	return (__sync_fetch_and_##FNAME(&atomic->v, val, /* protected variables: */ &atomic->v));									\
+}
+
+GEN_atomic_ops_fetch_and_andorxor(and, intptr_t,  int)
+GEN_atomic_ops_fetch_and_andorxor(and, uintptr_t, uint)
+GEN_atomic_ops_fetch_and_andorxor(or,  intptr_t,  int)
+GEN_atomic_ops_fetch_and_andorxor(or,  uintptr_t, uint)
+GEN_atomic_ops_fetch_and_andorxor(xor, intptr_t,  int)
+GEN_atomic_ops_fetch_and_andorxor(xor, uintptr_t, uint)
+
+// EMULATED
+EMU_GEN_atomic_ops_fetch_minmax_by_cas(min, intptr_t,  int,  <)
+EMU_GEN_atomic_ops_fetch_minmax_by_cas(min, uintptr_t, uint, <)
+EMU_GEN_atomic_ops_fetch_minmax_by_cas(max, intptr_t,  int,  >)
+EMU_GEN_atomic_ops_fetch_minmax_by_cas(max, uintptr_t, uint, >)
+
 #define GEN_atomic_ops_casr(TYPE, MNEMONIC) \
 static inline TYPE atomic_ops_##MNEMONIC##_casr(atomic_ops_##MNEMONIC *atomic, TYPE oldval, TYPE newval, ATOMIC_OPS_FENCE fence) {	\
 	UNUSED_ARGUMENT(fence);																											\
@@ -132,6 +152,84 @@ EMU_GEN_atomic_ops_swap_by_cas(intptr_t,  int)
 EMU_GEN_atomic_ops_swap_by_cas(uintptr_t, uint)
 EMU_GEN_atomic_ops_swap_by_cas(void *,    ptr)
 
+#define GEN_atomic_ops_test_and_bit(FNAME, BUILTIN, TYPE, MNEMONIC, MASKOP) \
+static inline bool atomic_ops_##MNEMONIC##_test_and_##FNAME##_bit(atomic_ops_##MNEMONIC *atomic, unsigned int bit, ATOMIC_OPS_FENCE fence) {	\
+	UNUSED_ARGUMENT(fence);																														\
+																																				\
+	TYPE mask = (TYPE)(((uintptr_t)1) << (bit % (sizeof(TYPE) * 8)));																			\
+																																				\
+	return ((BUILTIN(&atomic->v, (MASKOP mask), /* protected variables: */ &atomic->v) & mask) != 0);											\
+}
+
+GEN_atomic_ops_test_and_bit(set,        __sync_fetch_and_or,  intptr_t,  int,  )
+GEN_atomic_ops_test_and_bit(set,        __sync_fetch_and_or,  uintptr_t, uint, )
+GEN_atomic_ops_test_and_bit(clear,      __sync_fetch_and_and, intptr_t,  int,  ~)
+GEN_atomic_ops_test_and_bit(clear,      __sync_fetch_and_and, uintptr_t, uint, ~)
+GEN_atomic_ops_test_and_bit(complement, __sync_fetch_and_xor, intptr_t,  int,  )
+GEN_atomic_ops_test_and_bit(complement, __sync_fetch_and_xor, uintptr_t, uint, )
+
+// Fixed-width types: the builtins are sized by their operand already
+#define GEN_atomic_ops_fixed(TYPE, MNEMONIC) \
+GEN_atomic_ops_load(TYPE, MNEMONIC)										\
+GEN_atomic_ops_store(TYPE, MNEMONIC)									\
+EMU_GEN_atomic_ops_not_by_cas(TYPE, MNEMONIC)							\
+EMU_GEN_atomic_ops_andorxoradd_by_cas(and, TYPE, MNEMONIC, &)			\
+EMU_GEN_atomic_ops_andorxoradd_by_cas(or,  TYPE, MNEMONIC, |)			\
+EMU_GEN_atomic_ops_andorxoradd_by_cas(xor, TYPE, MNEMONIC, ^)			\
+EMU_GEN_atomic_ops_add_by_faa(TYPE, MNEMONIC)							\
+EMU_GEN_atomic_ops_incdec_by_add(inc, TYPE, MNEMONIC, 1)				\
+EMU_GEN_atomic_ops_incdec_by_add(dec, TYPE, MNEMONIC, -1)				\
+GEN_atomic_ops_fetch_and_add(TYPE, MNEMONIC)							\
+EMU_GEN_atomic_ops_fetch_and_incdec_by_faa(inc, TYPE, MNEMONIC, 1)		\
+EMU_GEN_atomic_ops_fetch_and_incdec_by_faa(dec, TYPE, MNEMONIC, -1)		\
+GEN_atomic_ops_casr(TYPE, MNEMONIC)										\
+GEN_atomic_ops_cas(TYPE, MNEMONIC)										\
+EMU_GEN_atomic_ops_swap_by_cas(TYPE, MNEMONIC)
+
+GEN_atomic_ops_fixed(int8_t,   i8)
+GEN_atomic_ops_fixed(uint8_t,  u8)
+GEN_atomic_ops_fixed(int16_t,  i16)
+GEN_atomic_ops_fixed(uint16_t, u16)
+GEN_atomic_ops_fixed(int32_t,  i32)
+GEN_atomic_ops_fixed(uint32_t, u32)
+#if UINTPTR_MAX == UINT64_MAX
+GEN_atomic_ops_fixed(int64_t,  i64)
+GEN_atomic_ops_fixed(uint64_t, u64)
+#endif
+
+#if (UINTPTR_MAX == UINT64_MAX && defined(__GCC_HAVE_SYNC_COMPARE_AND_SWAP_16)) \
+ || (UINTPTR_MAX == UINT32_MAX && defined(__GCC_HAVE_SYNC_COMPARE_AND_SWAP_8))
+
+#if UINTPTR_MAX == UINT64_MAX
+	typedef unsigned __int128 atomic_ops_dptr_word;
+#else
+	typedef uint64_t atomic_ops_dptr_word;
+#endif
+
+typedef union { atomic_ops_dptr_val val; atomic_ops_dptr_word word; } atomic_ops_dptr_union;
+
+static inline atomic_ops_dptr_val atomic_ops_dptr_casr(atomic_ops_dptr *atomic, atomic_ops_dptr_val oldval, atomic_ops_dptr_val newval, ATOMIC_OPS_FENCE fence) {
+	UNUSED_ARGUMENT(fence);
+
+	atomic_ops_dptr_union o = { oldval }, n = { newval }, r;
+	volatile atomic_ops_dptr_word *word = (volatile atomic_ops_dptr_word *)atomic;
+
+	r.word = __sync_val_compare_and_swap(word, o.word, n.word, /* protected variables: */ word);
+	return (r.val);
+}
+
+// EMULATED
+EMU_GEN_atomic_ops_dptr_cas_by_casr()
+EMU_GEN_atomic_ops_dptr_load_by_casr()
+EMU_GEN_atomic_ops_dptr_store_by_casr()
+
+#else
+
+// EMULATED (no double-width CAS available, needs -mcx16 on x86-64 for example)
+EMU_GEN_atomic_ops_dptr_by_lock()
+
+#endif
+
 static inline void atomic_ops_fence(ATOMIC_OPS_FENCE fence) {
 	__asm__ __volatile__ ("" ::: "memory");
 
@@ -17,7 +17,7 @@
  * If you need this to work on Pentium 3, use the following:
  *
  *		uintptr_t v = 0;
- *		__asm__ __volatile__ ("lock; or"ATOMIC_OPS_SS" $0, %0" : "+m" (v) :: "memory");
+ *		__asm__ __volatile__ ("lock; or" ATOMIC_OPS_SS " $0, %0" : "+m" (v) :: "memory");
  *
  *	as a full, as well as read, barrier.
  *	Even older systems also lack write barriers, so you'd have to use
@@ -25,37 +25,49 @@
  */
 
 // ATOMIC_OPS_SS (Size Suffix): appended to asm ops to specify operand length
+// ATOMIC_OPS_DSS (Double Size Suffix): appended to cmpxchg for double-width operands
 #if UINTPTR_MAX == UINT32_MAX
 	#define ATOMIC_OPS_SS "l"
+	#define ATOMIC_OPS_DSS "8b"
 #elif UINTPTR_MAX == UINT64_MAX
 	#define ATOMIC_OPS_SS "q"
+	#define ATOMIC_OPS_DSS "16b"
 #else
 	#error uintptr_t is not a 32 or 64 bit type. Only 32/64 bit systems are supported for x86-64.
 #endif
 
-#define GEN_atomic_ops_load(TYPE, MNEMONIC) \
+// Emulated operations are built on locked instructions, which are full barriers already
+static inline void atomic_ops_emu_entry_fence(ATOMIC_OPS_FENCE fence) {
+	UNUSED_ARGUMENT(fence);
+}
+
+static inline void atomic_ops_emu_exit_fence(ATOMIC_OPS_FENCE fence) {
+	UNUSED_ARGUMENT(fence);
+}
+
+#define GEN_atomic_ops_load(TYPE, MNEMONIC, OPS_SS, REG) \
 static inline TYPE atomic_ops_##MNEMONIC##_load(const atomic_ops_##MNEMONIC *atomic, ATOMIC_OPS_FENCE fence) {		\
 	if (fence == ATOMIC_OPS_FENCE_RELEASE || fence == ATOMIC_OPS_FENCE_FULL || fence == ATOMIC_OPS_FENCE_WRITE) {	\
 		atomic_ops_fence(ATOMIC_OPS_FENCE_FULL); /* Prevent #StoreLoad reordering */								\
 	}																												\
 																													\
 	TYPE val;																										\
-	__asm__ __volatile__ ("mov"ATOMIC_OPS_SS" %1, %0"																\
-						: "=r" (val)																				\
+	__asm__ __volatile__ ("mov" OPS_SS " %1, %0"																\
+						: "=" REG (val)																				\
 						: "m" (atomic->v)																			\
 						: "memory");																				\
 	return (val);																									\
 }
 
-GEN_atomic_ops_load(intptr_t,  int)
-GEN_atomic_ops_load(uintptr_t, uint)
-GEN_atomic_ops_load(void *,    ptr)
+GEN_atomic_ops_load(intptr_t,  int,  ATOMIC_OPS_SS, "r")
+GEN_atomic_ops_load(uintptr_t, uint, ATOMIC_OPS_SS, "r")
+GEN_atomic_ops_load(void *,    ptr,  ATOMIC_OPS_SS, "r")
 
-#define GEN_atomic_ops_store(TYPE, MNEMONIC) \
+#define GEN_atomic_ops_store(TYPE, MNEMONIC, OPS_SS, REG) \
 static inline void atomic_ops_##MNEMONIC##_store(atomic_ops_##MNEMONIC *atomic, TYPE val, ATOMIC_OPS_FENCE fence) {	\
-	__asm__ __volatile__ ("mov"ATOMIC_OPS_SS" %1, %0"																\
+	__asm__ __volatile__ ("mov" OPS_SS " %1, %0"																\
 						: "=m" (atomic->v)																			\
-						: "ir" (val)																				\
+						: "e" REG (val)																				\
 						: "memory");																				\
 																													\
 	if (fence == ATOMIC_OPS_FENCE_ACQUIRE || fence == ATOMIC_OPS_FENCE_FULL || fence == ATOMIC_OPS_FENCE_READ) {	\
@@ -63,60 +75,60 @@ static inline void atomic_ops_##MNEMONIC##_store(atomic_ops_##MNEMONIC *atomic,
 	}																												\
 }
 
-GEN_atomic_ops_store(intptr_t,  int)
-GEN_atomic_ops_store(uintptr_t, uint)
-GEN_atomic_ops_store(void *,    ptr)
+GEN_atomic_ops_store(intptr_t,  int,  ATOMIC_OPS_SS, "r")
+GEN_atomic_ops_store(uintptr_t, uint, ATOMIC_OPS_SS, "r")
+GEN_atomic_ops_store(void *,    ptr,  ATOMIC_OPS_SS, "r")
 
-#define GEN_atomic_ops_mem_val(OPNAME, TYPE, MNEMONIC) \
+#define GEN_atomic_ops_mem_val(OPNAME, TYPE, MNEMONIC, OPS_SS, REG) \
 static inline void atomic_ops_##MNEMONIC##_##OPNAME(atomic_ops_##MNEMONIC *atomic, TYPE val, ATOMIC_OPS_FENCE fence) {	\
 	UNUSED_ARGUMENT(fence);																								\
 																														\
-	__asm__ __volatile__ ("lock; "#OPNAME ATOMIC_OPS_SS" %1,%0"															\
+	__asm__ __volatile__ ("lock; "#OPNAME OPS_SS" %1,%0"																\
 						: "+m" (atomic->v)																				\
-						: "ir" (val)																					\
+						: "e" REG (val)																					\
 						: "memory");																					\
 }
 
-GEN_atomic_ops_mem_val(and, intptr_t,  int)
-GEN_atomic_ops_mem_val(and, uintptr_t, uint)
-GEN_atomic_ops_mem_val(or,  intptr_t,  int)
-GEN_atomic_ops_mem_val(or,  uintptr_t, uint)
-GEN_atomic_ops_mem_val(xor, intptr_t,  int)
-GEN_atomic_ops_mem_val(xor, uintptr_t, uint)
-GEN_atomic_ops_mem_val(add, intptr_t,  int)
-GEN_atomic_ops_mem_val(add, uintptr_t, uint)
+GEN_atomic_ops_mem_val(and, intptr_t,  int,  ATOMIC_OPS_SS, "r")
+GEN_atomic_ops_mem_val(and, uintptr_t, uint, ATOMIC_OPS_SS, "r")
+GEN_atomic_ops_mem_val(or,  intptr_t,  int,  ATOMIC_OPS_SS, "r")
+GEN_atomic_ops_mem_val(or,  uintptr_t, uint, ATOMIC_OPS_SS, "r")
+GEN_atomic_ops_mem_val(xor, intptr_t,  int,  ATOMIC_OPS_SS, "r")
+GEN_atomic_ops_mem_val(xor, uintptr_t, uint, ATOMIC_OPS_SS, "r")
+GEN_atomic_ops_mem_val(add, intptr_t,  int,  ATOMIC_OPS_SS, "r")
+GEN_atomic_ops_mem_val(add, uintptr_t, uint, ATOMIC_OPS_SS, "r")
 
-#define GEN_atomic_ops_mem(OPNAME, MNEMONIC) \
+#define GEN_atomic_ops_mem(OPNAME, MNEMONIC, OPS_SS) \
 static inline void atomic_ops_##MNEMONIC##_##OPNAME(atomic_ops_##MNEMONIC *atomic, ATOMIC_OPS_FENCE fence) {	\
 	UNUSED_ARGUMENT(fence);																						\
 																												\
-	__asm__ __volatile__ ("lock; "#OPNAME ATOMIC_OPS_SS" %0"													\
+	__asm__ __volatile__ ("lock; "#OPNAME OPS_SS" %0"														\
 						: "+m" (atomic->v)																		\
 						: /* no additional input operands */													\
 						: "memory");																			\
 }
 
-GEN_atomic_ops_mem(not, int)
-GEN_atomic_ops_mem(not, uint)
-GEN_atomic_ops_mem(inc, int)
-GEN_atomic_ops_mem(inc, uint)
-GEN_atomic_ops_mem(dec, int)
-GEN_atomic_ops_mem(dec, uint)
+GEN_atomic_ops_mem(not, int,  ATOMIC_OPS_SS)
+GEN_atomic_ops_mem(not, uint, ATOMIC_OPS_SS)
+GEN_atomic_ops_mem(inc, int,  ATOMIC_OPS_SS)
+GEN_atomic_ops_mem(inc, uint, ATOMIC_OPS_SS)
+GEN_atomic_ops_mem(dec, int,  ATOMIC_OPS_SS)
+GEN_atomic_ops_mem(dec, uint, ATOMIC_OPS_SS)
 
-#define GEN_atomic_ops_fetch_and_add(TYPE, MNEMONIC) \
+#define GEN_atomic_ops_fetch_and_add(TYPE, MNEMONIC, OPS_SS, REG) \
 static inline TYPE atomic_ops_##MNEMONIC##_fetch_and_add(atomic_ops_##MNEMONIC *atomic, TYPE val, ATOMIC_OPS_FENCE fence) {	\
 	UNUSED_ARGUMENT(fence);																									\
 																															\
 	TYPE result;																											\
-	__asm__ __volatile__ ("lock; xadd"ATOMIC_OPS_SS" %0,%1"																	\
-						: "=r" (result), "+m" (atomic->v)																	\
+	__asm__ __volatile__ ("lock; xadd" OPS_SS " %0,%1"																		\
+						: "=" REG (result), "+m" (atomic->v)																	\
 						: "0" (val)																							\
 						: "memory");																						\
 	return (result);																										\
 }
 
-GEN_atomic_ops_fetch_and_add(intptr_t,  int)
-GEN_atomic_ops_fetch_and_add(uintptr_t, uint)
+GEN_atomic_ops_fetch_and_add(intptr_t,  int,  ATOMIC_OPS_SS, "r")
+GEN_atomic_ops_fetch_and_add(uintptr_t, uint, ATOMIC_OPS_SS, "r")
 
 // EMULATED
 EMU_GEN_atomic_ops_fetch_and_incdec_by_faa(inc, intptr_t,  int,  1)
@@ -124,53 +136,142 @@ EMU_GEN_atomic_ops_fetch_and_incdec_by_faa(inc, uintptr_t, uint, 1)
 EMU_GEN_atomic_ops_fetch_and_incdec_by_faa(dec, intptr_t,  int,  -1)
 EMU_GEN_atomic_ops_fetch_and_incdec_by_faa(dec, uintptr_t, uint, -1)
 
-#define GEN_atomic_ops_casr(TYPE, MNEMONIC) \
+// EMULATED (lock and/or/xor don't return the old value, and there's no min/max)
+EMU_GEN_atomic_ops_fetch_and_andorxor_by_cas(and, intptr_t,  int,  &)
+EMU_GEN_atomic_ops_fetch_and_andorxor_by_cas(and, uintptr_t, uint, &)
+EMU_GEN_atomic_ops_fetch_and_andorxor_by_cas(or,  intptr_t,  int,  |)
+EMU_GEN_atomic_ops_fetch_and_andorxor_by_cas(or,  uintptr_t, uint, |)
+EMU_GEN_atomic_ops_fetch_and_andorxor_by_cas(xor, intptr_t,  int,  ^)
+EMU_GEN_atomic_ops_fetch_and_andorxor_by_cas(xor, uintptr_t, uint, ^)
+EMU_GEN_atomic_ops_fetch_minmax_by_cas(min, intptr_t,  int,  <)
+EMU_GEN_atomic_ops_fetch_minmax_by_cas(min, uintptr_t, uint, <)
+EMU_GEN_atomic_ops_fetch_minmax_by_cas(max, intptr_t,  int,  >)
+EMU_GEN_atomic_ops_fetch_minmax_by_cas(max, uintptr_t, uint, >)
+
+#define GEN_atomic_ops_casr(TYPE, MNEMONIC, OPS_SS) \
 static inline TYPE atomic_ops_##MNEMONIC##_casr(atomic_ops_##MNEMONIC *atomic, TYPE oldval, TYPE newval, ATOMIC_OPS_FENCE fence) {	\
 	UNUSED_ARGUMENT(fence);																											\
 																																	\
 	TYPE result;																													\
-	__asm__ __volatile__ ("lock; cmpxchg"ATOMIC_OPS_SS" %3,%1"																		\
+	__asm__ __volatile__ ("lock; cmpxchg" OPS_SS " %3,%1"																		\
 						: "=a" (result), "+m" (atomic->v)																			\
 						: "0" (oldval), "q" (newval)																				\
 						: "memory");																								\
 	return (result);																												\
 }
 
-GEN_atomic_ops_casr(intptr_t,  int)
-GEN_atomic_ops_casr(uintptr_t, uint)
-GEN_atomic_ops_casr(void *,    ptr)
+GEN_atomic_ops_casr(intptr_t,  int,  ATOMIC_OPS_SS)
+GEN_atomic_ops_casr(uintptr_t, uint, ATOMIC_OPS_SS)
+GEN_atomic_ops_casr(void *,    ptr,  ATOMIC_OPS_SS)
 
-#define GEN_atomic_ops_cas(TYPE, MNEMONIC) \
+#define GEN_atomic_ops_cas(TYPE, MNEMONIC, OPS_SS) \
 static inline bool atomic_ops_##MNEMONIC##_cas(atomic_ops_##MNEMONIC *atomic, TYPE oldval, TYPE newval, ATOMIC_OPS_FENCE fence) {	\
 	UNUSED_ARGUMENT(fence);																											\
 																																	\
 	bool result;																													\
-	__asm__ __volatile__ ("lock; cmpxchg"ATOMIC_OPS_SS" %3,%1; setz %0"																\
+	__asm__ __volatile__ ("lock; cmpxchg" OPS_SS " %3,%1; setz %0"																	\
 						: "=a" (result), "+m" (atomic->v)																			\
 						: "0" (oldval), "q" (newval)																				\
 						: "memory");																								\
 	return (result);																												\
 }
 
-GEN_atomic_ops_cas(intptr_t,  int)
-GEN_atomic_ops_cas(uintptr_t, uint)
-GEN_atomic_ops_cas(void *,    ptr)
+GEN_atomic_ops_cas(intptr_t,  int,  ATOMIC_OPS_SS)
+GEN_atomic_ops_cas(uintptr_t, uint, ATOMIC_OPS_SS)
+GEN_atomic_ops_cas(void *,    ptr,  ATOMIC_OPS_SS)
 
-#define GEN_atomic_ops_swap(TYPE, MNEMONIC) \
+#define GEN_atomic_ops_swap(TYPE, MNEMONIC, OPS_SS, REG) \
 static inline TYPE atomic_ops_##MNEMONIC##_swap(atomic_ops_##MNEMONIC *atomic, TYPE val, ATOMIC_OPS_FENCE fence) {	\
 	UNUSED_ARGUMENT(fence);																							\
 																													\
 	TYPE result;																									\
-	__asm__ __volatile__ ("lock; xchg"ATOMIC_OPS_SS" %0,%1"															\
-						: "=r" (result), "+m" (atomic->v)															\
+	__asm__ __volatile__ ("lock; xchg" OPS_SS " %0,%1"																\
+						: "=" REG (result), "+m" (atomic->v)															\
 						: "0" (val)																					\
 						: "memory");																				\
 	return (result);																								\
 }
 
-GEN_atomic_ops_swap(intptr_t,  int)
-GEN_atomic_ops_swap(uintptr_t, uint)
-GEN_atomic_ops_swap(void *,    ptr)
+GEN_atomic_ops_swap(intptr_t,  int,  ATOMIC_OPS_SS, "r")
+GEN_atomic_ops_swap(uintptr_t, uint, ATOMIC_OPS_SS, "r")
+GEN_atomic_ops_swap(void *,    ptr,  ATOMIC_OPS_SS, "r")
+
+// The carry flag gets the bit's old value
+#define GEN_atomic_ops_test_and_bit(FNAME, OPNAME, TYPE, MNEMONIC, OPS_SS) \
+static inline bool atomic_ops_##MNEMONIC##_test_and_##FNAME##_bit(atomic_ops_##MNEMONIC *atomic, unsigned int bit, ATOMIC_OPS_FENCE fence) {	\
+	UNUSED_ARGUMENT(fence);																														\
+																																				\
+	bool result;																																\
+	__asm__ __volatile__ ("lock; "#OPNAME OPS_SS" %2,%1; setc %0"																				\
+						: "=q" (result), "+m" (atomic->v)																						\
+						: "ir" ((TYPE)(bit % (sizeof(TYPE) * 8)))																				\
+						: "memory");																											\
+	return (result);																															\
+}
+
+GEN_atomic_ops_test_and_bit(set,        bts, intptr_t,  int,  ATOMIC_OPS_SS)
+GEN_atomic_ops_test_and_bit(set,        bts, uintptr_t, uint, ATOMIC_OPS_SS)
+GEN_atomic_ops_test_and_bit(clear,      btr, intptr_t,  int,  ATOMIC_OPS_SS)
+GEN_atomic_ops_test_and_bit(clear,      btr, uintptr_t, uint, ATOMIC_OPS_SS)
+GEN_atomic_ops_test_and_bit(complement, btc, intptr_t,  int,  ATOMIC_OPS_SS)
+GEN_atomic_ops_test_and_bit(complement, btc, uintptr_t, uint, ATOMIC_OPS_SS)
+
+// Fixed-width types: same instructions, with the operand size given by the suffix
+#define GEN_atomic_ops_fixed(TYPE, MNEMONIC, OPS_SS, REG) \
+GEN_atomic_ops_load(TYPE, MNEMONIC, OPS_SS, REG)								\
+GEN_atomic_ops_store(TYPE, MNEMONIC, OPS_SS, REG)								\
+GEN_atomic_ops_mem_val(and, TYPE, MNEMONIC, OPS_SS, REG)						\
+GEN_atomic_ops_mem_val(or,  TYPE, MNEMONIC, OPS_SS, REG)						\
+GEN_atomic_ops_mem_val(xor, TYPE, MNEMONIC, OPS_SS, REG)						\
+GEN_atomic_ops_mem_val(add, TYPE, MNEMONIC, OPS_SS, REG)						\
+GEN_atomic_ops_mem(not, MNEMONIC, OPS_SS)										\
+GEN_atomic_ops_mem(inc, MNEMONIC, OPS_SS)										\
+GEN_atomic_ops_mem(dec, MNEMONIC, OPS_SS)										\
+GEN_atomic_ops_fetch_and_add(TYPE, MNEMONIC, OPS_SS, REG)						\
+EMU_GEN_atomic_ops_fetch_and_incdec_by_faa(inc, TYPE, MNEMONIC, 1)				\
+EMU_GEN_atomic_ops_fetch_and_incdec_by_faa(dec, TYPE, MNEMONIC, -1)			\
+GEN_atomic_ops_casr(TYPE, MNEMONIC, OPS_SS)										\
+GEN_atomic_ops_cas(TYPE, MNEMONIC, OPS_SS)										\
+GEN_atomic_ops_swap(TYPE, MNEMONIC, OPS_SS, REG)
+
+// Byte operands need a register with a byte form ("q": a, b, c or d on 32 bit)
+GEN_atomic_ops_fixed(int8_t,   i8,  "b", "q")
+GEN_atomic_ops_fixed(uint8_t,  u8,  "b", "q")
+GEN_atomic_ops_fixed(int16_t,  i16, "w", "r")
+GEN_atomic_ops_fixed(uint16_t, u16, "w", "r")
+GEN_atomic_ops_fixed(int32_t,  i32, "l", "r")
+GEN_atomic_ops_fixed(uint32_t, u32, "l", "r")
+#if UINTPTR_MAX == UINT64_MAX
+GEN_atomic_ops_fixed(int64_t,  i64, "q", "r")
+GEN_atomic_ops_fixed(uint64_t, u64, "q", "r")
+#endif
+
+// The operand must be aligned to its full size, which atomic_ops_dptr guarantees
+static inline atomic_ops_dptr_val atomic_ops_dptr_casr(atomic_ops_dptr *atomic, atomic_ops_dptr_val oldval, atomic_ops_dptr_val newval, ATOMIC_OPS_FENCE fence) {
+	UNUSED_ARGUMENT(fence);
+
+	atomic_ops_dptr_val result;
+	__asm__ __volatile__ ("lock; cmpxchg" ATOMIC_OPS_DSS " %2"
+						: "=a" (result.lo), "=d" (result.hi), "+m" (*atomic)
+						: "0" (oldval.lo), "1" (oldval.hi), "b" (newval.lo), "c" (newval.hi)
+						: "memory");
+	return (result);
+}
+
+static inline bool atomic_ops_dptr_cas(atomic_ops_dptr *atomic, atomic_ops_dptr_val oldval, atomic_ops_dptr_val newval, ATOMIC_OPS_FENCE fence) {
+	UNUSED_ARGUMENT(fence);
+
+	bool result;
+	__asm__ __volatile__ ("lock; cmpxchg" ATOMIC_OPS_DSS " %1; setz %0"
+						: "=q" (result), "+m" (*atomic), "+a" (oldval.lo), "+d" (oldval.hi)
+						: "b" (newval.lo), "c" (newval.hi)
+						: "memory");
+	return (result);
+}
+
+// EMULATED (there are no plain double-width loads and stores that are guaranteed atomic)
+EMU_GEN_atomic_ops_dptr_load_by_casr()
+EMU_GEN_atomic_ops_dptr_store_by_casr()
 
 static inline void atomic_ops_fence(ATOMIC_OPS_FENCE fence) {
 	__asm__ __volatile__ ("" ::: "memory");
@@ -0,0 +1,95 @@
+/**
+ * This file is part of the atomic_ops project.
+ *
+ * For the full copyright and license information, please view the COPYING
+ * file that was distributed with this source code.
+ *
+ * @copyright  (c) the atomic_ops project
+ * @author     Luca Longinotti <chtekk@longitekk.com>
+ * @license    BSD 2-clause
+ * @version    $Id$
+ */
+
+/*
+ * Padded Implementation
+ */
+
+// Padded types only add space around the plain ones: forward every operation
+
+#define GEN_atomic_ops_padded_load(TYPE, MNEMONIC) \
+static inline TYPE atomic_ops_##MNEMONIC##_padded_load(const atomic_ops_##MNEMONIC##_padded *atomic, ATOMIC_OPS_FENCE fence) {	\
+	return (atomic_ops_##MNEMONIC##_load(&atomic->a, fence));																	\
+}
+
+#define GEN_atomic_ops_padded_void(OPNAME, MNEMONIC) \
+static inline void atomic_ops_##MNEMONIC##_padded_##OPNAME(atomic_ops_##MNEMONIC##_padded *atomic, ATOMIC_OPS_FENCE fence) {	\
+	atomic_ops_##MNEMONIC##_##OPNAME(&atomic->a, fence);																		\
+}
+
+#define GEN_atomic_ops_padded_void_val(OPNAME, TYPE, MNEMONIC) \
+static inline void atomic_ops_##MNEMONIC##_padded_##OPNAME(atomic_ops_##MNEMONIC##_padded *atomic, TYPE val, ATOMIC_OPS_FENCE fence) {	\
+	atomic_ops_##MNEMONIC##_##OPNAME(&atomic->a, val, fence);																			\
+}
+
+#define GEN_atomic_ops_padded_ret(OPNAME, TYPE, MNEMONIC) \
+static inline TYPE atomic_ops_##MNEMONIC##_padded_##OPNAME(atomic_ops_##MNEMONIC##_padded *atomic, ATOMIC_OPS_FENCE fence) {	\
+	return (atomic_ops_##MNEMONIC##_##OPNAME(&atomic->a, fence));																\
+}
+
+#define GEN_atomic_ops_padded_ret_val(OPNAME, TYPE, MNEMONIC) \
+static inline TYPE atomic_ops_##MNEMONIC##_padded_##OPNAME(atomic_ops_##MNEMONIC##_padded *atomic, TYPE val, ATOMIC_OPS_FENCE fence) {	\
+	return (atomic_ops_##MNEMONIC##_##OPNAME(&atomic->a, val, fence));																	\
+}
+
+#define GEN_atomic_ops_padded_bit(OPNAME, MNEMONIC) \
+static inline bool atomic_ops_##MNEMONIC##_padded_##OPNAME(atomic_ops_##MNEMONIC##_padded *atomic, unsigned int bit, ATOMIC_OPS_FENCE fence) {	\
+	return (atomic_ops_##MNEMONIC##_##OPNAME(&atomic->a, bit, fence));																		\
+}
+
+#define GEN_atomic_ops_padded_cas(TYPE, MNEMONIC) \
+static inline TYPE atomic_ops_##MNEMONIC##_padded_casr(atomic_ops_##MNEMONIC##_padded *atomic, TYPE oldval, TYPE newval, ATOMIC_OPS_FENCE fence) {	\
+	return (atomic_ops_##MNEMONIC##_casr(&atomic->a, oldval, newval, fence));																		\
+}																																					\
+																																					\
+static inline bool atomic_ops_##MNEMONIC##_padded_cas(atomic_ops_##MNEMONIC##_padded *atomic, TYPE oldval, TYPE newval, ATOMIC_OPS_FENCE fence) {	\
+	return (atomic_ops_##MNEMONIC##_cas(&atomic->a, oldval, newval, fence));																		\
+}
+
+#define GEN_atomic_ops_padded_arith(TYPE, MNEMONIC) \
+GEN_atomic_ops_padded_void(not, MNEMONIC)					\
+GEN_atomic_ops_padded_void_val(and, TYPE, MNEMONIC)			\
+GEN_atomic_ops_padded_void_val(or, TYPE, MNEMONIC)			\
+GEN_atomic_ops_padded_void_val(xor, TYPE, MNEMONIC)			\
+GEN_atomic_ops_padded_void_val(add, TYPE, MNEMONIC)			\
+GEN_atomic_ops_padded_void(inc, MNEMONIC)					\
+GEN_atomic_ops_padded_void(dec, MNEMONIC)					\
+GEN_atomic_ops_padded_ret_val(fetch_and_add, TYPE, MNEMONIC)	\
+GEN_atomic_ops_padded_ret(fetch_and_inc, TYPE, MNEMONIC)		\
+GEN_atomic_ops_padded_ret(fetch_and_dec, TYPE, MNEMONIC)		\
+GEN_atomic_ops_padded_ret_val(fetch_and_and, TYPE, MNEMONIC)	\
+GEN_atomic_ops_padded_ret_val(fetch_and_or, TYPE, MNEMONIC)		\
+GEN_atomic_ops_padded_ret_val(fetch_and_xor, TYPE, MNEMONIC)	\
+GEN_atomic_ops_padded_ret_val(fetch_min, TYPE, MNEMONIC)		\
+GEN_atomic_ops_padded_ret_val(fetch_max, TYPE, MNEMONIC)		\
+GEN_atomic_ops_padded_bit(test_and_set_bit, MNEMONIC)			\
+GEN_atomic_ops_padded_bit(test_and_clear_bit, MNEMONIC)			\
+GEN_atomic_ops_padded_bit(test_and_complement_bit, MNEMONIC)
+
+GEN_atomic_ops_padded_load(intptr_t,  int)
+GEN_atomic_ops_padded_load(uintptr_t, uint)
+GEN_atomic_ops_padded_load(void *,    ptr)
+
+GEN_atomic_ops_padded_void_val(store, intptr_t,  int)
+GEN_atomic_ops_padded_void_val(store, uintptr_t, uint)
+GEN_atomic_ops_padded_void_val(store, void *,    ptr)
+
+GEN_atomic_ops_padded_arith(intptr_t,  int)
+GEN_atomic_ops_padded_arith(uintptr_t, uint)
+
+GEN_atomic_ops_padded_cas(intptr_t,  int)
+GEN_atomic_ops_padded_cas(uintptr_t, uint)
+GEN_atomic_ops_padded_cas(void *,    ptr)
+
+GEN_atomic_ops_padded_ret_val(swap, intptr_t,  int)
+GEN_atomic_ops_padded_ret_val(swap, uintptr_t, uint)
+GEN_atomic_ops_padded_ret_val(swap, void *,    ptr)
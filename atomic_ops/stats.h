@@ -0,0 +1,778 @@
+/**
+ * This file is part of the atomic_ops project.
+ *
+ * For the full copyright and license information, please view the COPYING
+ * file that was distributed with this source code.
+ *
+ * @copyright  (c) the atomic_ops project
+ * @author     Luca Longinotti <chtekk@longitekk.com>
+ * @license    BSD 2-clause
+ * @version    $Id$
+ */
+
+/*
+ * Statistics Implementation
+ *
+ * Only included with ATOMIC_OPS_STATS defined. Every atomic_ops_* function is
+ * then wrapped by a macro of the same name, counting per operation: calls,
+ * calls by fence, CASes that failed, and failed attempts of the retry loops
+ * operations are emulated with (see emulation.h). Operations of all types
+ * count together: uint_cas and ptr_cas are both "cas".
+ * With ATOMIC_OPS_STATS_SITES defined too, the same counts are also kept per
+ * call site (__FILE__ and __LINE__ of the call, inside atomic_ops_*.h for the
+ * structures built on top), to find the few places most contention comes from.
+ * Counters are kept by each thread in its own buffer, never written by others,
+ * so counting adds no contention of its own. Buffers are allocated on a thread's
+ * first atomic operation and never freed, so the counts of threads that exited
+ * still show up: atomic_ops_stats_merge() sums all of them, and can run at any
+ * time, while atomic_ops_stats_dump() prints the sums as CSV, call sites with
+ * the most failures and retries first.
+ * Calls made by the implementations themselves aren't counted, so an emulated
+ * fetch_and_xor counts once, its inner CASes as retries. All translation units
+ * must agree on ATOMIC_OPS_STATS and ATOMIC_OPS_STATS_SITES.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+// Call sites tracked per thread, a power of two; calls from sites beyond three quarters of them only count per operation
+#if !defined(ATOMIC_OPS_STATS_SITE_SLOTS)
+	#define ATOMIC_OPS_STATS_SITE_SLOTS 1024
+#endif
+
+// One per ATOMIC_OPS_FENCE value, in order
+#define ATOMIC_OPS_STATS_FENCES 6
+
+/*
+ * Type Definitions
+ */
+
+typedef enum {
+	ATOMIC_OPS_STATS_OP_LOAD,
+	ATOMIC_OPS_STATS_OP_STORE,
+	ATOMIC_OPS_STATS_OP_NOT,
+	ATOMIC_OPS_STATS_OP_AND,
+	ATOMIC_OPS_STATS_OP_OR,
+	ATOMIC_OPS_STATS_OP_XOR,
+	ATOMIC_OPS_STATS_OP_ADD,
+	ATOMIC_OPS_STATS_OP_INC,
+	ATOMIC_OPS_STATS_OP_DEC,
+	ATOMIC_OPS_STATS_OP_FETCH_AND_ADD,
+	ATOMIC_OPS_STATS_OP_FETCH_AND_INC,
+	ATOMIC_OPS_STATS_OP_FETCH_AND_DEC,
+	ATOMIC_OPS_STATS_OP_FETCH_AND_AND,
+	ATOMIC_OPS_STATS_OP_FETCH_AND_OR,
+	ATOMIC_OPS_STATS_OP_FETCH_AND_XOR,
+	ATOMIC_OPS_STATS_OP_FETCH_MIN,
+	ATOMIC_OPS_STATS_OP_FETCH_MAX,
+	ATOMIC_OPS_STATS_OP_CASR,
+	ATOMIC_OPS_STATS_OP_CAS,
+	ATOMIC_OPS_STATS_OP_SWAP,
+	ATOMIC_OPS_STATS_OP_TEST_AND_SET_BIT,
+	ATOMIC_OPS_STATS_OP_TEST_AND_CLEAR_BIT,
+	ATOMIC_OPS_STATS_OP_TEST_AND_COMPLEMENT_BIT,
+	ATOMIC_OPS_STATS_OP_FENCE,
+	ATOMIC_OPS_STATS_OPS,
+} ATOMIC_OPS_STATS_OP;
+
+// Written by the owning thread only, read by any
+typedef struct {
+	atomic_ops_uint calls;
+	atomic_ops_uint failures; // CASes that didn't swap
+	atomic_ops_uint retries; // Failed attempts of emulation retry loops
+	atomic_ops_uint fences[ATOMIC_OPS_STATS_FENCES]; // Calls by fence
+} atomic_ops_stats_counters;
+
+typedef struct {
+	atomic_ops_ptr file; // NULL while the slot is free
+	unsigned int line;
+	ATOMIC_OPS_STATS_OP op;
+	atomic_ops_stats_counters counters;
+} atomic_ops_stats_site;
+
+typedef struct atomic_ops_stats_thread atomic_ops_stats_thread;
+
+struct atomic_ops_stats_thread {
+	atomic_ops_stats_thread *next; // Registry of all buffers
+	atomic_ops_stats_counters *current[2]; // Operation and site of the last call, for its retries and failure
+	atomic_ops_stats_counters ops[ATOMIC_OPS_STATS_OPS];
+#if defined(ATOMIC_OPS_STATS_SITES)
+	size_t sites_used;
+	atomic_ops_uint untracked; // Calls from sites that didn't fit
+	atomic_ops_stats_site sites[ATOMIC_OPS_STATS_SITE_SLOTS];
+#endif
+};
+
+// Sums, as returned by atomic_ops_stats_merge()
+typedef struct {
+	uintptr_t calls;
+	uintptr_t failures;
+	uintptr_t retries;
+	uintptr_t fences[ATOMIC_OPS_STATS_FENCES];
+} atomic_ops_stats_count;
+
+typedef struct {
+	const char *file;
+	unsigned int line;
+	ATOMIC_OPS_STATS_OP op;
+	atomic_ops_stats_count count;
+} atomic_ops_stats_site_count;
+
+/*
+ * Functions
+ */
+
+static inline void atomic_ops_stats_call(ATOMIC_OPS_STATS_OP op, ATOMIC_OPS_FENCE fence, const char *file, unsigned int line) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_stats_failure(void) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_stats_merge(atomic_ops_stats_count *out);
+#if defined(ATOMIC_OPS_STATS_SITES)
+static inline size_t atomic_ops_stats_merge_sites(atomic_ops_stats_site_count *out, size_t max, uintptr_t *untracked);
+#endif
+static inline void atomic_ops_stats_dump(FILE *file);
+
+/*
+ * Implementations
+ */
+
+// Shared between all translation units, hence weak
+__attribute__((__weak__)) atomic_ops_ptr atomic_ops_stats_registry;
+__attribute__((__weak__)) __thread atomic_ops_stats_thread *atomic_ops_stats_self;
+
+static inline void atomic_ops_stats_inc(atomic_ops_uint *counter) {
+	atomic_ops_uint_store(counter, atomic_ops_uint_load(counter, ATOMIC_OPS_FENCE_NONE) + 1, ATOMIC_OPS_FENCE_NONE);
+}
+
+static inline void atomic_ops_stats_count_add(atomic_ops_stats_count *count, const atomic_ops_stats_counters *counters) {
+	count->calls += atomic_ops_uint_load(&counters->calls, ATOMIC_OPS_FENCE_NONE);
+	count->failures += atomic_ops_uint_load(&counters->failures, ATOMIC_OPS_FENCE_NONE);
+	count->retries += atomic_ops_uint_load(&counters->retries, ATOMIC_OPS_FENCE_NONE);
+
+	for (size_t i = 0; i < ATOMIC_OPS_STATS_FENCES; i++) {
+		count->fences[i] += atomic_ops_uint_load(&counters->fences[i], ATOMIC_OPS_FENCE_NONE);
+	}
+}
+
+static inline void atomic_ops_stats_counters_inc(atomic_ops_stats_counters *counters, ATOMIC_OPS_FENCE fence) {
+	unsigned int kind = (unsigned int)__builtin_ctz((unsigned int)fence);
+
+	atomic_ops_stats_inc(&counters->calls);
+
+	if (kind < ATOMIC_OPS_STATS_FENCES) {
+		atomic_ops_stats_inc(&counters->fences[kind]);
+	}
+}
+
+// Buffer of the calling thread, allocated and registered on first use; NULL if out of memory
+static inline atomic_ops_stats_thread * atomic_ops_stats_thread_get(void) {
+	atomic_ops_stats_thread *self = atomic_ops_stats_self;
+
+	if (self == NULL) {
+		self = (atomic_ops_stats_thread *)calloc(1, sizeof(atomic_ops_stats_thread));
+
+		if (self == NULL) {
+			return (NULL);
+		}
+
+		do {
+			self->next = (atomic_ops_stats_thread *)atomic_ops_ptr_load(&atomic_ops_stats_registry, ATOMIC_OPS_FENCE_NONE);
+		} while (!atomic_ops_ptr_cas(&atomic_ops_stats_registry, self->next, self, ATOMIC_OPS_FENCE_RELEASE));
+
+		atomic_ops_stats_self = self;
+	}
+
+	return (self);
+}
+
+#if defined(ATOMIC_OPS_STATS_SITES)
+// Counters of the call site, NULL if the table is full
+static inline atomic_ops_stats_counters * atomic_ops_stats_site_get(atomic_ops_stats_thread *self, ATOMIC_OPS_STATS_OP op, const char *file, unsigned int line) {
+	uint32_t hash = ((uint32_t)(uintptr_t)file ^ (line * 32 + (uint32_t)op)) * UINT32_C(0x9E3779B1);
+
+	for (size_t i = (hash >> 16) & (ATOMIC_OPS_STATS_SITE_SLOTS - 1); ; i = (i + 1) & (ATOMIC_OPS_STATS_SITE_SLOTS - 1)) {
+		atomic_ops_stats_site *site = &self->sites[i];
+		const char *sitefile = (const char *)atomic_ops_ptr_load(&site->file, ATOMIC_OPS_FENCE_NONE);
+
+		if (sitefile == file && site->line == line && site->op == op) {
+			return (&site->counters);
+		}
+
+		if (sitefile == NULL) {
+			if (self->sites_used == (ATOMIC_OPS_STATS_SITE_SLOTS / 4) * 3) {
+				return (NULL);
+			}
+
+			site->line = line;
+			site->op = op;
+			atomic_ops_ptr_store(&site->file, (void *)file, ATOMIC_OPS_FENCE_RELEASE);
+			self->sites_used++;
+
+			return (&site->counters);
+		}
+	}
+}
+#endif
+
+// Called by the wrappers before each call
+static inline void atomic_ops_stats_call(ATOMIC_OPS_STATS_OP op, ATOMIC_OPS_FENCE fence, const char *file, unsigned int line) {
+	atomic_ops_stats_thread *self = atomic_ops_stats_thread_get();
+
+	if (self == NULL) {
+		return;
+	}
+
+	self->current[0] = &self->ops[op];
+	atomic_ops_stats_counters_inc(self->current[0], fence);
+
+#if defined(ATOMIC_OPS_STATS_SITES)
+	self->current[1] = atomic_ops_stats_site_get(self, op, file, line);
+
+	if (self->current[1] != NULL) {
+		atomic_ops_stats_counters_inc(self->current[1], fence);
+	}
+	else {
+		atomic_ops_stats_inc(&self->untracked);
+	}
+#else
+	UNUSED_ARGUMENT(file);
+	UNUSED_ARGUMENT(line);
+#endif
+}
+
+// Called by the wrappers after a CAS that failed
+static inline void atomic_ops_stats_failure(void) {
+	atomic_ops_stats_thread *self = atomic_ops_stats_self;
+
+	if (self != NULL) {
+		atomic_ops_stats_inc(&self->current[0]->failures);
+
+		if (self->current[1] != NULL) {
+			atomic_ops_stats_inc(&self->current[1]->failures);
+		}
+	}
+}
+
+// Called by the emulation retry loops after a failed attempt
+static inline void atomic_ops_stats_retry(void) {
+	atomic_ops_stats_thread *self = atomic_ops_stats_self;
+
+	// Calls made before any counted one belong to no operation
+	if (self != NULL && self->current[0] != NULL) {
+		atomic_ops_stats_inc(&self->current[0]->retries);
+
+		if (self->current[1] != NULL) {
+			atomic_ops_stats_inc(&self->current[1]->retries);
+		}
+	}
+}
+
+// Sums of all threads, into out[ATOMIC_OPS_STATS_OPS]; threads may keep counting meanwhile
+static inline void atomic_ops_stats_merge(atomic_ops_stats_count *out) {
+	memset(out, 0, ATOMIC_OPS_STATS_OPS * sizeof(atomic_ops_stats_count));
+
+	for (atomic_ops_stats_thread *thread = (atomic_ops_stats_thread *)atomic_ops_ptr_load(&atomic_ops_stats_registry, ATOMIC_OPS_FENCE_ACQUIRE); thread != NULL; thread = thread->next) {
+		for (size_t op = 0; op < ATOMIC_OPS_STATS_OPS; op++) {
+			atomic_ops_stats_count_add(&out[op], &thread->ops[op]);
+		}
+	}
+}
+
+#if defined(ATOMIC_OPS_STATS_SITES)
+// Sums of all threads per call site, up to max sites, returning how many; untracked gets the calls from sites that didn't fit
+static inline size_t atomic_ops_stats_merge_sites(atomic_ops_stats_site_count *out, size_t max, uintptr_t *untracked) {
+	size_t count = 0;
+
+	*untracked = 0;
+
+	for (atomic_ops_stats_thread *thread = (atomic_ops_stats_thread *)atomic_ops_ptr_load(&atomic_ops_stats_registry, ATOMIC_OPS_FENCE_ACQUIRE); thread != NULL; thread = thread->next) {
+		*untracked += atomic_ops_uint_load(&thread->untracked, ATOMIC_OPS_FENCE_NONE);
+
+		for (size_t i = 0; i < ATOMIC_OPS_STATS_SITE_SLOTS; i++) {
+			atomic_ops_stats_site *site = &thread->sites[i];
+			const char *file = (const char *)atomic_ops_ptr_load(&site->file, ATOMIC_OPS_FENCE_ACQUIRE);
+			size_t j = 0;
+
+			if (file == NULL) {
+				continue;
+			}
+
+			// The same header has a different __FILE__ pointer in each translation unit
+			while (j < count && (out[j].line != site->line || out[j].op != site->op || strcmp(out[j].file, file) != 0)) {
+				j++;
+			}
+
+			if (j == count) {
+				if (count == max) {
+					*untracked += atomic_ops_uint_load(&site->counters.calls, ATOMIC_OPS_FENCE_NONE);
+					continue;
+				}
+
+				memset(&out[j], 0, sizeof(atomic_ops_stats_site_count));
+				out[j].file = file;
+				out[j].line = site->line;
+				out[j].op = site->op;
+				count++;
+			}
+
+			atomic_ops_stats_count_add(&out[j].count, &site->counters);
+		}
+	}
+
+	return (count);
+}
+
+// Most failures and retries first, then most calls
+static inline int atomic_ops_stats_site_cmp(const void *a, const void *b) {
+	const atomic_ops_stats_count *ca = &((const atomic_ops_stats_site_count *)a)->count;
+	const atomic_ops_stats_count *cb = &((const atomic_ops_stats_site_count *)b)->count;
+	uintptr_t wa = ca->failures + ca->retries, wb = cb->failures + cb->retries;
+
+	if (wa != wb) {
+		return ((wa > wb) ? (-1) : (1));
+	}
+
+	return ((ca->calls > cb->calls) ? (-1) : ((ca->calls < cb->calls) ? (1) : (0)));
+}
+#endif
+
+// Line zero for totals
+static inline void atomic_ops_stats_dump_line(FILE *file, const char *site, unsigned int line, const char *op, const atomic_ops_stats_count *count) {
+	if (line != 0) {
+		fprintf(file, "%s:%u,", site, line);
+	}
+	else {
+		fprintf(file, "%s,", site);
+	}
+
+	fprintf(file, "%s,%llu,%llu,%llu", op, (unsigned long long)count->calls,
+		(unsigned long long)count->failures, (unsigned long long)count->retries);
+
+	for (size_t i = 0; i < ATOMIC_OPS_STATS_FENCES; i++) {
+		fprintf(file, ",%llu", (unsigned long long)count->fences[i]);
+	}
+
+	fprintf(file, "\n");
+}
+
+// CSV: one line per operation used (site "all"), then one per call site
+static inline void atomic_ops_stats_dump(FILE *file) {
+	static const char * const names[ATOMIC_OPS_STATS_OPS] = {
+		"load", "store", "not", "and", "or", "xor", "add", "inc", "dec",
+		"fetch_and_add", "fetch_and_inc", "fetch_and_dec", "fetch_and_and", "fetch_and_or", "fetch_and_xor",
+		"fetch_min", "fetch_max", "casr", "cas", "swap",
+		"test_and_set_bit", "test_and_clear_bit", "test_and_complement_bit", "fence",
+	};
+	atomic_ops_stats_count ops[ATOMIC_OPS_STATS_OPS];
+
+	fprintf(file, "site,op,calls,cas_failures,retries,fence_none,fence_acquire,fence_release,fence_full,fence_read,fence_write\n");
+
+	atomic_ops_stats_merge(ops);
+
+	for (size_t op = 0; op < ATOMIC_OPS_STATS_OPS; op++) {
+		if (ops[op].calls != 0) {
+			atomic_ops_stats_dump_line(file, "all", 0, names[op], &ops[op]);
+		}
+	}
+
+#if defined(ATOMIC_OPS_STATS_SITES)
+	size_t threads = 0, count;
+	uintptr_t untracked;
+
+	for (atomic_ops_stats_thread *thread = (atomic_ops_stats_thread *)atomic_ops_ptr_load(&atomic_ops_stats_registry, ATOMIC_OPS_FENCE_ACQUIRE); thread != NULL; thread = thread->next) {
+		threads++;
+	}
+
+	// Enough for all sites of the threads counted, later ones count as untracked
+	atomic_ops_stats_site_count *sites = (atomic_ops_stats_site_count *)malloc(threads * ATOMIC_OPS_STATS_SITE_SLOTS * sizeof(atomic_ops_stats_site_count));
+
+	if (sites == NULL) {
+		return;
+	}
+
+	count = atomic_ops_stats_merge_sites(sites, threads * ATOMIC_OPS_STATS_SITE_SLOTS, &untracked);
+
+	qsort(sites, count, sizeof(atomic_ops_stats_site_count), &atomic_ops_stats_site_cmp);
+
+	for (size_t i = 0; i < count; i++) {
+		atomic_ops_stats_dump_line(file, sites[i].file, sites[i].line, names[sites[i].op], &sites[i].count);
+	}
+
+	if (untracked != 0) {
+		fprintf(file, "untracked,all,%llu,0,0,0,0,0,0,0,0\n", (unsigned long long)untracked);
+	}
+
+	free(sites);
+#endif
+}
+
+/*
+ * Wrappers
+ *
+ * Defined last, so the implementations above them call the real functions.
+ * Macros aren't expanded again inside their own expansion: the name in the
+ * body is the function. All arguments are evaluated, once, before the call is
+ * counted: wrapped calls nested in them are counted first, and don't take the
+ * failures and retries of the outer call. Arguments keep their own type until
+ * the call, so pass NULL and not a plain 0 for pointers.
+ */
+
+#define ATOMIC_OPS_STATS_WRAP0(OP, FUNC, F) __extension__ ({									\
+	ATOMIC_OPS_FENCE atomic_ops_stats_f = (F);													\
+	atomic_ops_stats_call(ATOMIC_OPS_STATS_OP_##OP, atomic_ops_stats_f, __FILE__, __LINE__);	\
+	FUNC(atomic_ops_stats_f);																	\
+})
+
+#define ATOMIC_OPS_STATS_WRAP1(OP, FUNC, A, F) __extension__ ({									\
+	__typeof__(A) atomic_ops_stats_a = (A);														\
+	ATOMIC_OPS_FENCE atomic_ops_stats_f = (F);													\
+	atomic_ops_stats_call(ATOMIC_OPS_STATS_OP_##OP, atomic_ops_stats_f, __FILE__, __LINE__);	\
+	FUNC(atomic_ops_stats_a, atomic_ops_stats_f);												\
+})
+
+#define ATOMIC_OPS_STATS_WRAP2(OP, FUNC, A, B, F) __extension__ ({								\
+	__typeof__(A) atomic_ops_stats_a = (A);														\
+	__typeof__(B) atomic_ops_stats_b = (B);														\
+	ATOMIC_OPS_FENCE atomic_ops_stats_f = (F);													\
+	atomic_ops_stats_call(ATOMIC_OPS_STATS_OP_##OP, atomic_ops_stats_f, __FILE__, __LINE__);	\
+	FUNC(atomic_ops_stats_a, atomic_ops_stats_b, atomic_ops_stats_f);							\
+})
+
+#define ATOMIC_OPS_STATS_WRAP3(OP, FUNC, A, B, C, F) __extension__ ({							\
+	__typeof__(A) atomic_ops_stats_a = (A);														\
+	__typeof__(B) atomic_ops_stats_b = (B);														\
+	__typeof__(C) atomic_ops_stats_c = (C);														\
+	ATOMIC_OPS_FENCE atomic_ops_stats_f = (F);													\
+	atomic_ops_stats_call(ATOMIC_OPS_STATS_OP_##OP, atomic_ops_stats_f, __FILE__, __LINE__);	\
+	FUNC(atomic_ops_stats_a, atomic_ops_stats_b, atomic_ops_stats_c, atomic_ops_stats_f);		\
+})
+
+#define ATOMIC_OPS_STATS_WRAP4(OP, FUNC, A, B, C, D, F) __extension__ ({											\
+	__typeof__(A) atomic_ops_stats_a = (A);																		\
+	__typeof__(B) atomic_ops_stats_b = (B);																		\
+	__typeof__(C) atomic_ops_stats_c = (C);																		\
+	__typeof__(D) atomic_ops_stats_d = (D);																		\
+	ATOMIC_OPS_FENCE atomic_ops_stats_f = (F);																	\
+	atomic_ops_stats_call(ATOMIC_OPS_STATS_OP_##OP, atomic_ops_stats_f, __FILE__, __LINE__);						\
+	FUNC(atomic_ops_stats_a, atomic_ops_stats_b, atomic_ops_stats_c, atomic_ops_stats_d, atomic_ops_stats_f);	\
+})
+
+#define ATOMIC_OPS_STATS_WRAP_CAS3(FUNC, A, B, C, F) __extension__ ({													\
+	__typeof__(A) atomic_ops_stats_a = (A);																				\
+	__typeof__(B) atomic_ops_stats_b = (B);																				\
+	__typeof__(C) atomic_ops_stats_c = (C);																				\
+	ATOMIC_OPS_FENCE atomic_ops_stats_f = (F);																			\
+	atomic_ops_stats_call(ATOMIC_OPS_STATS_OP_CAS, atomic_ops_stats_f, __FILE__, __LINE__);								\
+	bool atomic_ops_stats_ok = FUNC(atomic_ops_stats_a, atomic_ops_stats_b, atomic_ops_stats_c, atomic_ops_stats_f);	\
+	if (!atomic_ops_stats_ok) {																							\
+		atomic_ops_stats_failure();																						\
+	}																													\
+	atomic_ops_stats_ok;																								\
+})
+
+#define ATOMIC_OPS_STATS_WRAP_CAS5(FUNC, A, B, C, D, E, F) __extension__ ({																						\
+	__typeof__(A) atomic_ops_stats_a = (A);																														\
+	__typeof__(B) atomic_ops_stats_b = (B);																														\
+	__typeof__(C) atomic_ops_stats_c = (C);																														\
+	__typeof__(D) atomic_ops_stats_d = (D);																														\
+	__typeof__(E) atomic_ops_stats_e = (E);																														\
+	ATOMIC_OPS_FENCE atomic_ops_stats_f = (F);																													\
+	atomic_ops_stats_call(ATOMIC_OPS_STATS_OP_CAS, atomic_ops_stats_f, __FILE__, __LINE__);																		\
+	bool atomic_ops_stats_ok = FUNC(atomic_ops_stats_a, atomic_ops_stats_b, atomic_ops_stats_c, atomic_ops_stats_d, atomic_ops_stats_e, atomic_ops_stats_f);	\
+	if (!atomic_ops_stats_ok) {																																	\
+		atomic_ops_stats_failure();																																\
+	}																																							\
+	atomic_ops_stats_ok;																																		\
+})
+
+#define ATOMIC_OPS_STATS_WRAP_CASR(FUNC, A, O, N, F) __extension__ ({																						\
+	__typeof__(A) atomic_ops_stats_a = (A);																												\
+	__typeof__(FUNC(A, O, N, F)) atomic_ops_stats_old = (O);																								\
+	__typeof__(N) atomic_ops_stats_new = (N);																												\
+	ATOMIC_OPS_FENCE atomic_ops_stats_f = (F);																											\
+	atomic_ops_stats_call(ATOMIC_OPS_STATS_OP_CASR, atomic_ops_stats_f, __FILE__, __LINE__);																\
+	__typeof__(atomic_ops_stats_old) atomic_ops_stats_prev = FUNC(atomic_ops_stats_a, atomic_ops_stats_old, atomic_ops_stats_new, atomic_ops_stats_f);	\
+	if (atomic_ops_stats_prev != atomic_ops_stats_old) {																									\
+		atomic_ops_stats_failure();																														\
+	}																																						\
+	atomic_ops_stats_prev;																																\
+})
+
+#define ATOMIC_OPS_STATS_WRAP_DPTR_CASR(A, O, N, F) __extension__ ({																							\
+	__typeof__(A) atomic_ops_stats_a = (A);																													\
+	atomic_ops_dptr_val atomic_ops_stats_old = (O), atomic_ops_stats_new = (N);																				\
+	ATOMIC_OPS_FENCE atomic_ops_stats_f = (F);																												\
+	atomic_ops_stats_call(ATOMIC_OPS_STATS_OP_CASR, atomic_ops_stats_f, __FILE__, __LINE__);																	\
+	atomic_ops_dptr_val atomic_ops_stats_prev = atomic_ops_dptr_casr(atomic_ops_stats_a, atomic_ops_stats_old, atomic_ops_stats_new, atomic_ops_stats_f);	\
+	if (atomic_ops_stats_prev.lo != atomic_ops_stats_old.lo || atomic_ops_stats_prev.hi != atomic_ops_stats_old.hi) {										\
+		atomic_ops_stats_failure();																															\
+	}																																						\
+	atomic_ops_stats_prev;																																	\
+})
+
+#define ATOMIC_OPS_STATS_WRAP_FLAGPTR_CASR(A, FL, OP, OF, NP, NF, F) __extension__ ({																																			\
+	__typeof__(A) atomic_ops_stats_a = (A);																																													\
+	bool *atomic_ops_stats_flagout = (FL), atomic_ops_stats_flag;																																								\
+	void *atomic_ops_stats_old = (OP);																																														\
+	bool atomic_ops_stats_oldflag = (OF);																																														\
+	void *atomic_ops_stats_new = (NP);																																														\
+	bool atomic_ops_stats_newflag = (NF);																																														\
+	ATOMIC_OPS_FENCE atomic_ops_stats_f = (F);																																												\
+	atomic_ops_stats_call(ATOMIC_OPS_STATS_OP_CASR, atomic_ops_stats_f, __FILE__, __LINE__);																																	\
+	void *atomic_ops_stats_prev = atomic_ops_flagptr_casr(atomic_ops_stats_a, &atomic_ops_stats_flag, atomic_ops_stats_old, atomic_ops_stats_oldflag, atomic_ops_stats_new, atomic_ops_stats_newflag, atomic_ops_stats_f);	\
+	if (atomic_ops_stats_prev != atomic_ops_stats_old || atomic_ops_stats_flag != atomic_ops_stats_oldflag) {																													\
+		atomic_ops_stats_failure();																																															\
+	}																																																							\
+	if (atomic_ops_stats_flagout != NULL) {																																													\
+		*atomic_ops_stats_flagout = atomic_ops_stats_flag;																																									\
+	}																																																							\
+	atomic_ops_stats_prev;																																																	\
+})
+
+#define atomic_ops_int_load(A, F) ATOMIC_OPS_STATS_WRAP1(LOAD, atomic_ops_int_load, A, F)
+#define atomic_ops_int_store(A, V, F) ATOMIC_OPS_STATS_WRAP2(STORE, atomic_ops_int_store, A, V, F)
+#define atomic_ops_int_not(A, F) ATOMIC_OPS_STATS_WRAP1(NOT, atomic_ops_int_not, A, F)
+#define atomic_ops_int_and(A, V, F) ATOMIC_OPS_STATS_WRAP2(AND, atomic_ops_int_and, A, V, F)
+#define atomic_ops_int_or(A, V, F) ATOMIC_OPS_STATS_WRAP2(OR, atomic_ops_int_or, A, V, F)
+#define atomic_ops_int_xor(A, V, F) ATOMIC_OPS_STATS_WRAP2(XOR, atomic_ops_int_xor, A, V, F)
+#define atomic_ops_int_add(A, V, F) ATOMIC_OPS_STATS_WRAP2(ADD, atomic_ops_int_add, A, V, F)
+#define atomic_ops_int_inc(A, F) ATOMIC_OPS_STATS_WRAP1(INC, atomic_ops_int_inc, A, F)
+#define atomic_ops_int_dec(A, F) ATOMIC_OPS_STATS_WRAP1(DEC, atomic_ops_int_dec, A, F)
+#define atomic_ops_int_fetch_and_add(A, V, F) ATOMIC_OPS_STATS_WRAP2(FETCH_AND_ADD, atomic_ops_int_fetch_and_add, A, V, F)
+#define atomic_ops_int_fetch_and_inc(A, F) ATOMIC_OPS_STATS_WRAP1(FETCH_AND_INC, atomic_ops_int_fetch_and_inc, A, F)
+#define atomic_ops_int_fetch_and_dec(A, F) ATOMIC_OPS_STATS_WRAP1(FETCH_AND_DEC, atomic_ops_int_fetch_and_dec, A, F)
+#define atomic_ops_int_fetch_and_and(A, V, F) ATOMIC_OPS_STATS_WRAP2(FETCH_AND_AND, atomic_ops_int_fetch_and_and, A, V, F)
+#define atomic_ops_int_fetch_and_or(A, V, F) ATOMIC_OPS_STATS_WRAP2(FETCH_AND_OR, atomic_ops_int_fetch_and_or, A, V, F)
+#define atomic_ops_int_fetch_and_xor(A, V, F) ATOMIC_OPS_STATS_WRAP2(FETCH_AND_XOR, atomic_ops_int_fetch_and_xor, A, V, F)
+#define atomic_ops_int_fetch_min(A, V, F) ATOMIC_OPS_STATS_WRAP2(FETCH_MIN, atomic_ops_int_fetch_min, A, V, F)
+#define atomic_ops_int_fetch_max(A, V, F) ATOMIC_OPS_STATS_WRAP2(FETCH_MAX, atomic_ops_int_fetch_max, A, V, F)
+#define atomic_ops_int_casr(A, O, N, F) ATOMIC_OPS_STATS_WRAP_CASR(atomic_ops_int_casr, A, O, N, F)
+#define atomic_ops_int_cas(A, O, N, F) ATOMIC_OPS_STATS_WRAP_CAS3(atomic_ops_int_cas, A, O, N, F)
+#define atomic_ops_int_swap(A, V, F) ATOMIC_OPS_STATS_WRAP2(SWAP, atomic_ops_int_swap, A, V, F)
+#define atomic_ops_int_test_and_set_bit(A, B, F) ATOMIC_OPS_STATS_WRAP2(TEST_AND_SET_BIT, atomic_ops_int_test_and_set_bit, A, B, F)
+#define atomic_ops_int_test_and_clear_bit(A, B, F) ATOMIC_OPS_STATS_WRAP2(TEST_AND_CLEAR_BIT, atomic_ops_int_test_and_clear_bit, A, B, F)
+#define atomic_ops_int_test_and_complement_bit(A, B, F) ATOMIC_OPS_STATS_WRAP2(TEST_AND_COMPLEMENT_BIT, atomic_ops_int_test_and_complement_bit, A, B, F)
+
+#define atomic_ops_uint_load(A, F) ATOMIC_OPS_STATS_WRAP1(LOAD, atomic_ops_uint_load, A, F)
+#define atomic_ops_uint_store(A, V, F) ATOMIC_OPS_STATS_WRAP2(STORE, atomic_ops_uint_store, A, V, F)
+#define atomic_ops_uint_not(A, F) ATOMIC_OPS_STATS_WRAP1(NOT, atomic_ops_uint_not, A, F)
+#define atomic_ops_uint_and(A, V, F) ATOMIC_OPS_STATS_WRAP2(AND, atomic_ops_uint_and, A, V, F)
+#define atomic_ops_uint_or(A, V, F) ATOMIC_OPS_STATS_WRAP2(OR, atomic_ops_uint_or, A, V, F)
+#define atomic_ops_uint_xor(A, V, F) ATOMIC_OPS_STATS_WRAP2(XOR, atomic_ops_uint_xor, A, V, F)
+#define atomic_ops_uint_add(A, V, F) ATOMIC_OPS_STATS_WRAP2(ADD, atomic_ops_uint_add, A, V, F)
+#define atomic_ops_uint_inc(A, F) ATOMIC_OPS_STATS_WRAP1(INC, atomic_ops_uint_inc, A, F)
+#define atomic_ops_uint_dec(A, F) ATOMIC_OPS_STATS_WRAP1(DEC, atomic_ops_uint_dec, A, F)
+#define atomic_ops_uint_fetch_and_add(A, V, F) ATOMIC_OPS_STATS_WRAP2(FETCH_AND_ADD, atomic_ops_uint_fetch_and_add, A, V, F)
+#define atomic_ops_uint_fetch_and_inc(A, F) ATOMIC_OPS_STATS_WRAP1(FETCH_AND_INC, atomic_ops_uint_fetch_and_inc, A, F)
+#define atomic_ops_uint_fetch_and_dec(A, F) ATOMIC_OPS_STATS_WRAP1(FETCH_AND_DEC, atomic_ops_uint_fetch_and_dec, A, F)
+#define atomic_ops_uint_fetch_and_and(A, V, F) ATOMIC_OPS_STATS_WRAP2(FETCH_AND_AND, atomic_ops_uint_fetch_and_and, A, V, F)
+#define atomic_ops_uint_fetch_and_or(A, V, F) ATOMIC_OPS_STATS_WRAP2(FETCH_AND_OR, atomic_ops_uint_fetch_and_or, A, V, F)
+#define atomic_ops_uint_fetch_and_xor(A, V, F) ATOMIC_OPS_STATS_WRAP2(FETCH_AND_XOR, atomic_ops_uint_fetch_and_xor, A, V, F)
+#define atomic_ops_uint_fetch_min(A, V, F) ATOMIC_OPS_STATS_WRAP2(FETCH_MIN, atomic_ops_uint_fetch_min, A, V, F)
+#define atomic_ops_uint_fetch_max(A, V, F) ATOMIC_OPS_STATS_WRAP2(FETCH_MAX, atomic_ops_uint_fetch_max, A, V, F)
+#define atomic_ops_uint_casr(A, O, N, F) ATOMIC_OPS_STATS_WRAP_CASR(atomic_ops_uint_casr, A, O, N, F)
+#define atomic_ops_uint_cas(A, O, N, F) ATOMIC_OPS_STATS_WRAP_CAS3(atomic_ops_uint_cas, A, O, N, F)
+#define atomic_ops_uint_swap(A, V, F) ATOMIC_OPS_STATS_WRAP2(SWAP, atomic_ops_uint_swap, A, V, F)
+#define atomic_ops_uint_test_and_set_bit(A, B, F) ATOMIC_OPS_STATS_WRAP2(TEST_AND_SET_BIT, atomic_ops_uint_test_and_set_bit, A, B, F)
+#define atomic_ops_uint_test_and_clear_bit(A, B, F) ATOMIC_OPS_STATS_WRAP2(TEST_AND_CLEAR_BIT, atomic_ops_uint_test_and_clear_bit, A, B, F)
+#define atomic_ops_uint_test_and_complement_bit(A, B, F) ATOMIC_OPS_STATS_WRAP2(TEST_AND_COMPLEMENT_BIT, atomic_ops_uint_test_and_complement_bit, A, B, F)
+
+#define atomic_ops_ptr_load(A, F) ATOMIC_OPS_STATS_WRAP1(LOAD, atomic_ops_ptr_load, A, F)
+#define atomic_ops_ptr_store(A, V, F) ATOMIC_OPS_STATS_WRAP2(STORE, atomic_ops_ptr_store, A, V, F)
+#define atomic_ops_ptr_casr(A, O, N, F) ATOMIC_OPS_STATS_WRAP_CASR(atomic_ops_ptr_casr, A, O, N, F)
+#define atomic_ops_ptr_cas(A, O, N, F) ATOMIC_OPS_STATS_WRAP_CAS3(atomic_ops_ptr_cas, A, O, N, F)
+#define atomic_ops_ptr_swap(A, V, F) ATOMIC_OPS_STATS_WRAP2(SWAP, atomic_ops_ptr_swap, A, V, F)
+
+#define atomic_ops_int_padded_load(A, F) ATOMIC_OPS_STATS_WRAP1(LOAD, atomic_ops_int_padded_load, A, F)
+#define atomic_ops_int_padded_store(A, V, F) ATOMIC_OPS_STATS_WRAP2(STORE, atomic_ops_int_padded_store, A, V, F)
+#define atomic_ops_int_padded_not(A, F) ATOMIC_OPS_STATS_WRAP1(NOT, atomic_ops_int_padded_not, A, F)
+#define atomic_ops_int_padded_and(A, V, F) ATOMIC_OPS_STATS_WRAP2(AND, atomic_ops_int_padded_and, A, V, F)
+#define atomic_ops_int_padded_or(A, V, F) ATOMIC_OPS_STATS_WRAP2(OR, atomic_ops_int_padded_or, A, V, F)
+#define atomic_ops_int_padded_xor(A, V, F) ATOMIC_OPS_STATS_WRAP2(XOR, atomic_ops_int_padded_xor, A, V, F)
+#define atomic_ops_int_padded_add(A, V, F) ATOMIC_OPS_STATS_WRAP2(ADD, atomic_ops_int_padded_add, A, V, F)
+#define atomic_ops_int_padded_inc(A, F) ATOMIC_OPS_STATS_WRAP1(INC, atomic_ops_int_padded_inc, A, F)
+#define atomic_ops_int_padded_dec(A, F) ATOMIC_OPS_STATS_WRAP1(DEC, atomic_ops_int_padded_dec, A, F)
+#define atomic_ops_int_padded_fetch_and_add(A, V, F) ATOMIC_OPS_STATS_WRAP2(FETCH_AND_ADD, atomic_ops_int_padded_fetch_and_add, A, V, F)
+#define atomic_ops_int_padded_fetch_and_inc(A, F) ATOMIC_OPS_STATS_WRAP1(FETCH_AND_INC, atomic_ops_int_padded_fetch_and_inc, A, F)
+#define atomic_ops_int_padded_fetch_and_dec(A, F) ATOMIC_OPS_STATS_WRAP1(FETCH_AND_DEC, atomic_ops_int_padded_fetch_and_dec, A, F)
+#define atomic_ops_int_padded_fetch_and_and(A, V, F) ATOMIC_OPS_STATS_WRAP2(FETCH_AND_AND, atomic_ops_int_padded_fetch_and_and, A, V, F)
+#define atomic_ops_int_padded_fetch_and_or(A, V, F) ATOMIC_OPS_STATS_WRAP2(FETCH_AND_OR, atomic_ops_int_padded_fetch_and_or, A, V, F)
+#define atomic_ops_int_padded_fetch_and_xor(A, V, F) ATOMIC_OPS_STATS_WRAP2(FETCH_AND_XOR, atomic_ops_int_padded_fetch_and_xor, A, V, F)
+#define atomic_ops_int_padded_fetch_min(A, V, F) ATOMIC_OPS_STATS_WRAP2(FETCH_MIN, atomic_ops_int_padded_fetch_min, A, V, F)
+#define atomic_ops_int_padded_fetch_max(A, V, F) ATOMIC_OPS_STATS_WRAP2(FETCH_MAX, atomic_ops_int_padded_fetch_max, A, V, F)
+#define atomic_ops_int_padded_test_and_set_bit(A, B, F) ATOMIC_OPS_STATS_WRAP2(TEST_AND_SET_BIT, atomic_ops_int_padded_test_and_set_bit, A, B, F)
+#define atomic_ops_int_padded_test_and_clear_bit(A, B, F) ATOMIC_OPS_STATS_WRAP2(TEST_AND_CLEAR_BIT, atomic_ops_int_padded_test_and_clear_bit, A, B, F)
+#define atomic_ops_int_padded_test_and_complement_bit(A, B, F) ATOMIC_OPS_STATS_WRAP2(TEST_AND_COMPLEMENT_BIT, atomic_ops_int_padded_test_and_complement_bit, A, B, F)
+#define atomic_ops_int_padded_casr(A, O, N, F) ATOMIC_OPS_STATS_WRAP_CASR(atomic_ops_int_padded_casr, A, O, N, F)
+#define atomic_ops_int_padded_cas(A, O, N, F) ATOMIC_OPS_STATS_WRAP_CAS3(atomic_ops_int_padded_cas, A, O, N, F)
+#define atomic_ops_int_padded_swap(A, V, F) ATOMIC_OPS_STATS_WRAP2(SWAP, atomic_ops_int_padded_swap, A, V, F)
+
+#define atomic_ops_uint_padded_load(A, F) ATOMIC_OPS_STATS_WRAP1(LOAD, atomic_ops_uint_padded_load, A, F)
+#define atomic_ops_uint_padded_store(A, V, F) ATOMIC_OPS_STATS_WRAP2(STORE, atomic_ops_uint_padded_store, A, V, F)
+#define atomic_ops_uint_padded_not(A, F) ATOMIC_OPS_STATS_WRAP1(NOT, atomic_ops_uint_padded_not, A, F)
+#define atomic_ops_uint_padded_and(A, V, F) ATOMIC_OPS_STATS_WRAP2(AND, atomic_ops_uint_padded_and, A, V, F)
+#define atomic_ops_uint_padded_or(A, V, F) ATOMIC_OPS_STATS_WRAP2(OR, atomic_ops_uint_padded_or, A, V, F)
+#define atomic_ops_uint_padded_xor(A, V, F) ATOMIC_OPS_STATS_WRAP2(XOR, atomic_ops_uint_padded_xor, A, V, F)
+#define atomic_ops_uint_padded_add(A, V, F) ATOMIC_OPS_STATS_WRAP2(ADD, atomic_ops_uint_padded_add, A, V, F)
+#define atomic_ops_uint_padded_inc(A, F) ATOMIC_OPS_STATS_WRAP1(INC, atomic_ops_uint_padded_inc, A, F)
+#define atomic_ops_uint_padded_dec(A, F) ATOMIC_OPS_STATS_WRAP1(DEC, atomic_ops_uint_padded_dec, A, F)
+#define atomic_ops_uint_padded_fetch_and_add(A, V, F) ATOMIC_OPS_STATS_WRAP2(FETCH_AND_ADD, atomic_ops_uint_padded_fetch_and_add, A, V, F)
+#define atomic_ops_uint_padded_fetch_and_inc(A, F) ATOMIC_OPS_STATS_WRAP1(FETCH_AND_INC, atomic_ops_uint_padded_fetch_and_inc, A, F)
+#define atomic_ops_uint_padded_fetch_and_dec(A, F) ATOMIC_OPS_STATS_WRAP1(FETCH_AND_DEC, atomic_ops_uint_padded_fetch_and_dec, A, F)
+#define atomic_ops_uint_padded_fetch_and_and(A, V, F) ATOMIC_OPS_STATS_WRAP2(FETCH_AND_AND, atomic_ops_uint_padded_fetch_and_and, A, V, F)
+#define atomic_ops_uint_padded_fetch_and_or(A, V, F) ATOMIC_OPS_STATS_WRAP2(FETCH_AND_OR, atomic_ops_uint_padded_fetch_and_or, A, V, F)
+#define atomic_ops_uint_padded_fetch_and_xor(A, V, F) ATOMIC_OPS_STATS_WRAP2(FETCH_AND_XOR, atomic_ops_uint_padded_fetch_and_xor, A, V, F)
+#define atomic_ops_uint_padded_fetch_min(A, V, F) ATOMIC_OPS_STATS_WRAP2(FETCH_MIN, atomic_ops_uint_padded_fetch_min, A, V, F)
+#define atomic_ops_uint_padded_fetch_max(A, V, F) ATOMIC_OPS_STATS_WRAP2(FETCH_MAX, atomic_ops_uint_padded_fetch_max, A, V, F)
+#define atomic_ops_uint_padded_test_and_set_bit(A, B, F) ATOMIC_OPS_STATS_WRAP2(TEST_AND_SET_BIT, atomic_ops_uint_padded_test_and_set_bit, A, B, F)
+#define atomic_ops_uint_padded_test_and_clear_bit(A, B, F) ATOMIC_OPS_STATS_WRAP2(TEST_AND_CLEAR_BIT, atomic_ops_uint_padded_test_and_clear_bit, A, B, F)
+#define atomic_ops_uint_padded_test_and_complement_bit(A, B, F) ATOMIC_OPS_STATS_WRAP2(TEST_AND_COMPLEMENT_BIT, atomic_ops_uint_padded_test_and_complement_bit, A, B, F)
+#define atomic_ops_uint_padded_casr(A, O, N, F) ATOMIC_OPS_STATS_WRAP_CASR(atomic_ops_uint_padded_casr, A, O, N, F)
+#define atomic_ops_uint_padded_cas(A, O, N, F) ATOMIC_OPS_STATS_WRAP_CAS3(atomic_ops_uint_padded_cas, A, O, N, F)
+#define atomic_ops_uint_padded_swap(A, V, F) ATOMIC_OPS_STATS_WRAP2(SWAP, atomic_ops_uint_padded_swap, A, V, F)
+
+#define atomic_ops_ptr_padded_load(A, F) ATOMIC_OPS_STATS_WRAP1(LOAD, atomic_ops_ptr_padded_load, A, F)
+#define atomic_ops_ptr_padded_store(A, V, F) ATOMIC_OPS_STATS_WRAP2(STORE, atomic_ops_ptr_padded_store, A, V, F)
+#define atomic_ops_ptr_padded_casr(A, O, N, F) ATOMIC_OPS_STATS_WRAP_CASR(atomic_ops_ptr_padded_casr, A, O, N, F)
+#define atomic_ops_ptr_padded_cas(A, O, N, F) ATOMIC_OPS_STATS_WRAP_CAS3(atomic_ops_ptr_padded_cas, A, O, N, F)
+#define atomic_ops_ptr_padded_swap(A, V, F) ATOMIC_OPS_STATS_WRAP2(SWAP, atomic_ops_ptr_padded_swap, A, V, F)
+
+#define atomic_ops_u8_load(A, F) ATOMIC_OPS_STATS_WRAP1(LOAD, atomic_ops_u8_load, A, F)
+#define atomic_ops_u8_store(A, V, F) ATOMIC_OPS_STATS_WRAP2(STORE, atomic_ops_u8_store, A, V, F)
+#define atomic_ops_u8_not(A, F) ATOMIC_OPS_STATS_WRAP1(NOT, atomic_ops_u8_not, A, F)
+#define atomic_ops_u8_and(A, V, F) ATOMIC_OPS_STATS_WRAP2(AND, atomic_ops_u8_and, A, V, F)
+#define atomic_ops_u8_or(A, V, F) ATOMIC_OPS_STATS_WRAP2(OR, atomic_ops_u8_or, A, V, F)
+#define atomic_ops_u8_xor(A, V, F) ATOMIC_OPS_STATS_WRAP2(XOR, atomic_ops_u8_xor, A, V, F)
+#define atomic_ops_u8_add(A, V, F) ATOMIC_OPS_STATS_WRAP2(ADD, atomic_ops_u8_add, A, V, F)
+#define atomic_ops_u8_inc(A, F) ATOMIC_OPS_STATS_WRAP1(INC, atomic_ops_u8_inc, A, F)
+#define atomic_ops_u8_dec(A, F) ATOMIC_OPS_STATS_WRAP1(DEC, atomic_ops_u8_dec, A, F)
+#define atomic_ops_u8_fetch_and_add(A, V, F) ATOMIC_OPS_STATS_WRAP2(FETCH_AND_ADD, atomic_ops_u8_fetch_and_add, A, V, F)
+#define atomic_ops_u8_fetch_and_inc(A, F) ATOMIC_OPS_STATS_WRAP1(FETCH_AND_INC, atomic_ops_u8_fetch_and_inc, A, F)
+#define atomic_ops_u8_fetch_and_dec(A, F) ATOMIC_OPS_STATS_WRAP1(FETCH_AND_DEC, atomic_ops_u8_fetch_and_dec, A, F)
+#define atomic_ops_u8_casr(A, O, N, F) ATOMIC_OPS_STATS_WRAP_CASR(atomic_ops_u8_casr, A, O, N, F)
+#define atomic_ops_u8_cas(A, O, N, F) ATOMIC_OPS_STATS_WRAP_CAS3(atomic_ops_u8_cas, A, O, N, F)
+#define atomic_ops_u8_swap(A, V, F) ATOMIC_OPS_STATS_WRAP2(SWAP, atomic_ops_u8_swap, A, V, F)
+
+#define atomic_ops_i8_load(A, F) ATOMIC_OPS_STATS_WRAP1(LOAD, atomic_ops_i8_load, A, F)
+#define atomic_ops_i8_store(A, V, F) ATOMIC_OPS_STATS_WRAP2(STORE, atomic_ops_i8_store, A, V, F)
+#define atomic_ops_i8_not(A, F) ATOMIC_OPS_STATS_WRAP1(NOT, atomic_ops_i8_not, A, F)
+#define atomic_ops_i8_and(A, V, F) ATOMIC_OPS_STATS_WRAP2(AND, atomic_ops_i8_and, A, V, F)
+#define atomic_ops_i8_or(A, V, F) ATOMIC_OPS_STATS_WRAP2(OR, atomic_ops_i8_or, A, V, F)
+#define atomic_ops_i8_xor(A, V, F) ATOMIC_OPS_STATS_WRAP2(XOR, atomic_ops_i8_xor, A, V, F)
+#define atomic_ops_i8_add(A, V, F) ATOMIC_OPS_STATS_WRAP2(ADD, atomic_ops_i8_add, A, V, F)
+#define atomic_ops_i8_inc(A, F) ATOMIC_OPS_STATS_WRAP1(INC, atomic_ops_i8_inc, A, F)
+#define atomic_ops_i8_dec(A, F) ATOMIC_OPS_STATS_WRAP1(DEC, atomic_ops_i8_dec, A, F)
+#define atomic_ops_i8_fetch_and_add(A, V, F) ATOMIC_OPS_STATS_WRAP2(FETCH_AND_ADD, atomic_ops_i8_fetch_and_add, A, V, F)
+#define atomic_ops_i8_fetch_and_inc(A, F) ATOMIC_OPS_STATS_WRAP1(FETCH_AND_INC, atomic_ops_i8_fetch_and_inc, A, F)
+#define atomic_ops_i8_fetch_and_dec(A, F) ATOMIC_OPS_STATS_WRAP1(FETCH_AND_DEC, atomic_ops_i8_fetch_and_dec, A, F)
+#define atomic_ops_i8_casr(A, O, N, F) ATOMIC_OPS_STATS_WRAP_CASR(atomic_ops_i8_casr, A, O, N, F)
+#define atomic_ops_i8_cas(A, O, N, F) ATOMIC_OPS_STATS_WRAP_CAS3(atomic_ops_i8_cas, A, O, N, F)
+#define atomic_ops_i8_swap(A, V, F) ATOMIC_OPS_STATS_WRAP2(SWAP, atomic_ops_i8_swap, A, V, F)
+
+#define atomic_ops_u16_load(A, F) ATOMIC_OPS_STATS_WRAP1(LOAD, atomic_ops_u16_load, A, F)
+#define atomic_ops_u16_store(A, V, F) ATOMIC_OPS_STATS_WRAP2(STORE, atomic_ops_u16_store, A, V, F)
+#define atomic_ops_u16_not(A, F) ATOMIC_OPS_STATS_WRAP1(NOT, atomic_ops_u16_not, A, F)
+#define atomic_ops_u16_and(A, V, F) ATOMIC_OPS_STATS_WRAP2(AND, atomic_ops_u16_and, A, V, F)
+#define atomic_ops_u16_or(A, V, F) ATOMIC_OPS_STATS_WRAP2(OR, atomic_ops_u16_or, A, V, F)
+#define atomic_ops_u16_xor(A, V, F) ATOMIC_OPS_STATS_WRAP2(XOR, atomic_ops_u16_xor, A, V, F)
+#define atomic_ops_u16_add(A, V, F) ATOMIC_OPS_STATS_WRAP2(ADD, atomic_ops_u16_add, A, V, F)
+#define atomic_ops_u16_inc(A, F) ATOMIC_OPS_STATS_WRAP1(INC, atomic_ops_u16_inc, A, F)
+#define atomic_ops_u16_dec(A, F) ATOMIC_OPS_STATS_WRAP1(DEC, atomic_ops_u16_dec, A, F)
+#define atomic_ops_u16_fetch_and_add(A, V, F) ATOMIC_OPS_STATS_WRAP2(FETCH_AND_ADD, atomic_ops_u16_fetch_and_add, A, V, F)
+#define atomic_ops_u16_fetch_and_inc(A, F) ATOMIC_OPS_STATS_WRAP1(FETCH_AND_INC, atomic_ops_u16_fetch_and_inc, A, F)
+#define atomic_ops_u16_fetch_and_dec(A, F) ATOMIC_OPS_STATS_WRAP1(FETCH_AND_DEC, atomic_ops_u16_fetch_and_dec, A, F)
+#define atomic_ops_u16_casr(A, O, N, F) ATOMIC_OPS_STATS_WRAP_CASR(atomic_ops_u16_casr, A, O, N, F)
+#define atomic_ops_u16_cas(A, O, N, F) ATOMIC_OPS_STATS_WRAP_CAS3(atomic_ops_u16_cas, A, O, N, F)
+#define atomic_ops_u16_swap(A, V, F) ATOMIC_OPS_STATS_WRAP2(SWAP, atomic_ops_u16_swap, A, V, F)
+
+#define atomic_ops_i16_load(A, F) ATOMIC_OPS_STATS_WRAP1(LOAD, atomic_ops_i16_load, A, F)
+#define atomic_ops_i16_store(A, V, F) ATOMIC_OPS_STATS_WRAP2(STORE, atomic_ops_i16_store, A, V, F)
+#define atomic_ops_i16_not(A, F) ATOMIC_OPS_STATS_WRAP1(NOT, atomic_ops_i16_not, A, F)
+#define atomic_ops_i16_and(A, V, F) ATOMIC_OPS_STATS_WRAP2(AND, atomic_ops_i16_and, A, V, F)
+#define atomic_ops_i16_or(A, V, F) ATOMIC_OPS_STATS_WRAP2(OR, atomic_ops_i16_or, A, V, F)
+#define atomic_ops_i16_xor(A, V, F) ATOMIC_OPS_STATS_WRAP2(XOR, atomic_ops_i16_xor, A, V, F)
+#define atomic_ops_i16_add(A, V, F) ATOMIC_OPS_STATS_WRAP2(ADD, atomic_ops_i16_add, A, V, F)
+#define atomic_ops_i16_inc(A, F) ATOMIC_OPS_STATS_WRAP1(INC, atomic_ops_i16_inc, A, F)
+#define atomic_ops_i16_dec(A, F) ATOMIC_OPS_STATS_WRAP1(DEC, atomic_ops_i16_dec, A, F)
+#define atomic_ops_i16_fetch_and_add(A, V, F) ATOMIC_OPS_STATS_WRAP2(FETCH_AND_ADD, atomic_ops_i16_fetch_and_add, A, V, F)
+#define atomic_ops_i16_fetch_and_inc(A, F) ATOMIC_OPS_STATS_WRAP1(FETCH_AND_INC, atomic_ops_i16_fetch_and_inc, A, F)
+#define atomic_ops_i16_fetch_and_dec(A, F) ATOMIC_OPS_STATS_WRAP1(FETCH_AND_DEC, atomic_ops_i16_fetch_and_dec, A, F)
+#define atomic_ops_i16_casr(A, O, N, F) ATOMIC_OPS_STATS_WRAP_CASR(atomic_ops_i16_casr, A, O, N, F)
+#define atomic_ops_i16_cas(A, O, N, F) ATOMIC_OPS_STATS_WRAP_CAS3(atomic_ops_i16_cas, A, O, N, F)
+#define atomic_ops_i16_swap(A, V, F) ATOMIC_OPS_STATS_WRAP2(SWAP, atomic_ops_i16_swap, A, V, F)
+
+#define atomic_ops_u32_load(A, F) ATOMIC_OPS_STATS_WRAP1(LOAD, atomic_ops_u32_load, A, F)
+#define atomic_ops_u32_store(A, V, F) ATOMIC_OPS_STATS_WRAP2(STORE, atomic_ops_u32_store, A, V, F)
+#define atomic_ops_u32_not(A, F) ATOMIC_OPS_STATS_WRAP1(NOT, atomic_ops_u32_not, A, F)
+#define atomic_ops_u32_and(A, V, F) ATOMIC_OPS_STATS_WRAP2(AND, atomic_ops_u32_and, A, V, F)
+#define atomic_ops_u32_or(A, V, F) ATOMIC_OPS_STATS_WRAP2(OR, atomic_ops_u32_or, A, V, F)
+#define atomic_ops_u32_xor(A, V, F) ATOMIC_OPS_STATS_WRAP2(XOR, atomic_ops_u32_xor, A, V, F)
+#define atomic_ops_u32_add(A, V, F) ATOMIC_OPS_STATS_WRAP2(ADD, atomic_ops_u32_add, A, V, F)
+#define atomic_ops_u32_inc(A, F) ATOMIC_OPS_STATS_WRAP1(INC, atomic_ops_u32_inc, A, F)
+#define atomic_ops_u32_dec(A, F) ATOMIC_OPS_STATS_WRAP1(DEC, atomic_ops_u32_dec, A, F)
+#define atomic_ops_u32_fetch_and_add(A, V, F) ATOMIC_OPS_STATS_WRAP2(FETCH_AND_ADD, atomic_ops_u32_fetch_and_add, A, V, F)
+#define atomic_ops_u32_fetch_and_inc(A, F) ATOMIC_OPS_STATS_WRAP1(FETCH_AND_INC, atomic_ops_u32_fetch_and_inc, A, F)
+#define atomic_ops_u32_fetch_and_dec(A, F) ATOMIC_OPS_STATS_WRAP1(FETCH_AND_DEC, atomic_ops_u32_fetch_and_dec, A, F)
+#define atomic_ops_u32_casr(A, O, N, F) ATOMIC_OPS_STATS_WRAP_CASR(atomic_ops_u32_casr, A, O, N, F)
+#define atomic_ops_u32_cas(A, O, N, F) ATOMIC_OPS_STATS_WRAP_CAS3(atomic_ops_u32_cas, A, O, N, F)
+#define atomic_ops_u32_swap(A, V, F) ATOMIC_OPS_STATS_WRAP2(SWAP, atomic_ops_u32_swap, A, V, F)
+
+#define atomic_ops_i32_load(A, F) ATOMIC_OPS_STATS_WRAP1(LOAD, atomic_ops_i32_load, A, F)
+#define atomic_ops_i32_store(A, V, F) ATOMIC_OPS_STATS_WRAP2(STORE, atomic_ops_i32_store, A, V, F)
+#define atomic_ops_i32_not(A, F) ATOMIC_OPS_STATS_WRAP1(NOT, atomic_ops_i32_not, A, F)
+#define atomic_ops_i32_and(A, V, F) ATOMIC_OPS_STATS_WRAP2(AND, atomic_ops_i32_and, A, V, F)
+#define atomic_ops_i32_or(A, V, F) ATOMIC_OPS_STATS_WRAP2(OR, atomic_ops_i32_or, A, V, F)
+#define atomic_ops_i32_xor(A, V, F) ATOMIC_OPS_STATS_WRAP2(XOR, atomic_ops_i32_xor, A, V, F)
+#define atomic_ops_i32_add(A, V, F) ATOMIC_OPS_STATS_WRAP2(ADD, atomic_ops_i32_add, A, V, F)
+#define atomic_ops_i32_inc(A, F) ATOMIC_OPS_STATS_WRAP1(INC, atomic_ops_i32_inc, A, F)
+#define atomic_ops_i32_dec(A, F) ATOMIC_OPS_STATS_WRAP1(DEC, atomic_ops_i32_dec, A, F)
+#define atomic_ops_i32_fetch_and_add(A, V, F) ATOMIC_OPS_STATS_WRAP2(FETCH_AND_ADD, atomic_ops_i32_fetch_and_add, A, V, F)
+#define atomic_ops_i32_fetch_and_inc(A, F) ATOMIC_OPS_STATS_WRAP1(FETCH_AND_INC, atomic_ops_i32_fetch_and_inc, A, F)
+#define atomic_ops_i32_fetch_and_dec(A, F) ATOMIC_OPS_STATS_WRAP1(FETCH_AND_DEC, atomic_ops_i32_fetch_and_dec, A, F)
+#define atomic_ops_i32_casr(A, O, N, F) ATOMIC_OPS_STATS_WRAP_CASR(atomic_ops_i32_casr, A, O, N, F)
+#define atomic_ops_i32_cas(A, O, N, F) ATOMIC_OPS_STATS_WRAP_CAS3(atomic_ops_i32_cas, A, O, N, F)
+#define atomic_ops_i32_swap(A, V, F) ATOMIC_OPS_STATS_WRAP2(SWAP, atomic_ops_i32_swap, A, V, F)
+
+#define atomic_ops_u64_load(A, F) ATOMIC_OPS_STATS_WRAP1(LOAD, atomic_ops_u64_load, A, F)
+#define atomic_ops_u64_store(A, V, F) ATOMIC_OPS_STATS_WRAP2(STORE, atomic_ops_u64_store, A, V, F)
+#define atomic_ops_u64_not(A, F) ATOMIC_OPS_STATS_WRAP1(NOT, atomic_ops_u64_not, A, F)
+#define atomic_ops_u64_and(A, V, F) ATOMIC_OPS_STATS_WRAP2(AND, atomic_ops_u64_and, A, V, F)
+#define atomic_ops_u64_or(A, V, F) ATOMIC_OPS_STATS_WRAP2(OR, atomic_ops_u64_or, A, V, F)
+#define atomic_ops_u64_xor(A, V, F) ATOMIC_OPS_STATS_WRAP2(XOR, atomic_ops_u64_xor, A, V, F)
+#define atomic_ops_u64_add(A, V, F) ATOMIC_OPS_STATS_WRAP2(ADD, atomic_ops_u64_add, A, V, F)
+#define atomic_ops_u64_inc(A, F) ATOMIC_OPS_STATS_WRAP1(INC, atomic_ops_u64_inc, A, F)
+#define atomic_ops_u64_dec(A, F) ATOMIC_OPS_STATS_WRAP1(DEC, atomic_ops_u64_dec, A, F)
+#define atomic_ops_u64_fetch_and_add(A, V, F) ATOMIC_OPS_STATS_WRAP2(FETCH_AND_ADD, atomic_ops_u64_fetch_and_add, A, V, F)
+#define atomic_ops_u64_fetch_and_inc(A, F) ATOMIC_OPS_STATS_WRAP1(FETCH_AND_INC, atomic_ops_u64_fetch_and_inc, A, F)
+#define atomic_ops_u64_fetch_and_dec(A, F) ATOMIC_OPS_STATS_WRAP1(FETCH_AND_DEC, atomic_ops_u64_fetch_and_dec, A, F)
+#define atomic_ops_u64_casr(A, O, N, F) ATOMIC_OPS_STATS_WRAP_CASR(atomic_ops_u64_casr, A, O, N, F)
+#define atomic_ops_u64_cas(A, O, N, F) ATOMIC_OPS_STATS_WRAP_CAS3(atomic_ops_u64_cas, A, O, N, F)
+#define atomic_ops_u64_swap(A, V, F) ATOMIC_OPS_STATS_WRAP2(SWAP, atomic_ops_u64_swap, A, V, F)
+
+#define atomic_ops_i64_load(A, F) ATOMIC_OPS_STATS_WRAP1(LOAD, atomic_ops_i64_load, A, F)
+#define atomic_ops_i64_store(A, V, F) ATOMIC_OPS_STATS_WRAP2(STORE, atomic_ops_i64_store, A, V, F)
+#define atomic_ops_i64_not(A, F) ATOMIC_OPS_STATS_WRAP1(NOT, atomic_ops_i64_not, A, F)
+#define atomic_ops_i64_and(A, V, F) ATOMIC_OPS_STATS_WRAP2(AND, atomic_ops_i64_and, A, V, F)
+#define atomic_ops_i64_or(A, V, F) ATOMIC_OPS_STATS_WRAP2(OR, atomic_ops_i64_or, A, V, F)
+#define atomic_ops_i64_xor(A, V, F) ATOMIC_OPS_STATS_WRAP2(XOR, atomic_ops_i64_xor, A, V, F)
+#define atomic_ops_i64_add(A, V, F) ATOMIC_OPS_STATS_WRAP2(ADD, atomic_ops_i64_add, A, V, F)
+#define atomic_ops_i64_inc(A, F) ATOMIC_OPS_STATS_WRAP1(INC, atomic_ops_i64_inc, A, F)
+#define atomic_ops_i64_dec(A, F) ATOMIC_OPS_STATS_WRAP1(DEC, atomic_ops_i64_dec, A, F)
+#define atomic_ops_i64_fetch_and_add(A, V, F) ATOMIC_OPS_STATS_WRAP2(FETCH_AND_ADD, atomic_ops_i64_fetch_and_add, A, V, F)
+#define atomic_ops_i64_fetch_and_inc(A, F) ATOMIC_OPS_STATS_WRAP1(FETCH_AND_INC, atomic_ops_i64_fetch_and_inc, A, F)
+#define atomic_ops_i64_fetch_and_dec(A, F) ATOMIC_OPS_STATS_WRAP1(FETCH_AND_DEC, atomic_ops_i64_fetch_and_dec, A, F)
+#define atomic_ops_i64_casr(A, O, N, F) ATOMIC_OPS_STATS_WRAP_CASR(atomic_ops_i64_casr, A, O, N, F)
+#define atomic_ops_i64_cas(A, O, N, F) ATOMIC_OPS_STATS_WRAP_CAS3(atomic_ops_i64_cas, A, O, N, F)
+#define atomic_ops_i64_swap(A, V, F) ATOMIC_OPS_STATS_WRAP2(SWAP, atomic_ops_i64_swap, A, V, F)
+
+#define atomic_ops_flagptr_load(A, FL, F) ATOMIC_OPS_STATS_WRAP2(LOAD, atomic_ops_flagptr_load, A, FL, F)
+#define atomic_ops_flagptr_load_full(A, FL, F) ATOMIC_OPS_STATS_WRAP2(LOAD, atomic_ops_flagptr_load_full, A, FL, F)
+#define atomic_ops_flagptr_store(A, NP, NF, F) ATOMIC_OPS_STATS_WRAP3(STORE, atomic_ops_flagptr_store, A, NP, NF, F)
+#define atomic_ops_flagptr_casr(A, FL, OP, OF, NP, NF, F) ATOMIC_OPS_STATS_WRAP_FLAGPTR_CASR(A, FL, OP, OF, NP, NF, F)
+#define atomic_ops_flagptr_cas(A, OP, OF, NP, NF, F) ATOMIC_OPS_STATS_WRAP_CAS5(atomic_ops_flagptr_cas, A, OP, OF, NP, NF, F)
+#define atomic_ops_flagptr_swap(A, FL, NP, NF, F) ATOMIC_OPS_STATS_WRAP4(SWAP, atomic_ops_flagptr_swap, A, FL, NP, NF, F)
+
+#define atomic_ops_dptr_load(A, F) ATOMIC_OPS_STATS_WRAP1(LOAD, atomic_ops_dptr_load, A, F)
+#define atomic_ops_dptr_store(A, V, F) ATOMIC_OPS_STATS_WRAP2(STORE, atomic_ops_dptr_store, A, V, F)
+#define atomic_ops_dptr_casr(A, O, N, F) ATOMIC_OPS_STATS_WRAP_DPTR_CASR(A, O, N, F)
+#define atomic_ops_dptr_cas(A, O, N, F) ATOMIC_OPS_STATS_WRAP_CAS3(atomic_ops_dptr_cas, A, O, N, F)
+
+#define atomic_ops_fence(F) ATOMIC_OPS_STATS_WRAP0(FENCE, atomic_ops_fence, F)
@@ -0,0 +1,28 @@
+/**
+ * This file is part of the atomic_ops project.
+ *
+ * For the full copyright and license information, please view the COPYING
+ * file that was distributed with this source code.
+ *
+ * @copyright  (c) the atomic_ops project
+ * @author     Luca Longinotti <chtekk@longitekk.com>
+ * @license    BSD 2-clause
+ * @version    $Id$
+ */
+
+/*
+ * Thread Implementation
+ */
+
+// Shared between all translation units, hence weak
+__attribute__((__weak__)) atomic_ops_uint atomic_ops_thread_next;
+__attribute__((__weak__)) __thread size_t atomic_ops_thread_self; // Slot offset by one, so zero means unassigned
+
+// Small number, distinct for each thread until they wrap around, to spread threads over per-slot data
+static inline size_t atomic_ops_thread_slot(void) {
+	if (atomic_ops_thread_self == 0) {
+		atomic_ops_thread_self = atomic_ops_uint_fetch_and_inc(&atomic_ops_thread_next, ATOMIC_OPS_FENCE_NONE) + 1;
+	}
+
+	return (atomic_ops_thread_self - 1);
+}
@@ -0,0 +1,2839 @@
+/**
+ * This file is part of the atomic_ops project.
+ *
+ * For the full copyright and license information, please view the COPYING
+ * file that was distributed with this source code.
+ *
+ * @copyright  (c) the atomic_ops project
+ * @author     Luca Longinotti <chtekk@longitekk.com>
+ * @license    BSD 2-clause
+ * @version    $Id$
+ */
+
+#include "atomic_ops.h"
+#include "atomic_ops_bitmap.h"
+#include "atomic_ops_combiner.h"
+#include "atomic_ops_counter.h"
+#include "atomic_ops_epoch.h"
+#include "atomic_ops_hashmap.h"
+#include "atomic_ops_hazard.h"
+#include "atomic_ops_histogram.h"
+#include "atomic_ops_list.h"
+#include "atomic_ops_lock.h"
+#include "atomic_ops_mpmc_queue.h"
+#include "atomic_ops_rwlock.h"
+#include "atomic_ops_seqlock.h"
+#include "atomic_ops_slab.h"
+#include "atomic_ops_spsc_ring.h"
+#include "atomic_ops_stack.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/*
+ * Output is one CSV line per measurement, preceded by a header line:
+ *
+ *		suite,impl,case,config,threads,ops,seconds,ops_per_sec,p50_ns,p99_ns,p999_ns
+ *
+ * 'config' holds suite-specific parameters as semicolon-separated key=value
+ * pairs. Latencies are per operation, taken from batches of operations timed
+ * together (see BENCH_SAMPLE_BATCH), with the clock overhead subtracted.
+ * Where threads compete for a fixed amount of work, 'config' also reports the
+ * fewest and most operations done by a single thread (ops_min, ops_max).
+ */
+
+#define BENCH_DEFAULT_ITERATIONS (1 << 18)
+#define BENCH_SAMPLE_BATCH 16 // Operations timed together to produce one latency sample
+#define BENCH_SLOT_SIZE 128 // Distance between per-thread atomics that must not share a line
+
+#define BENCH_STRINGIFY_(X) #X
+#define BENCH_STRINGIFY(X) BENCH_STRINGIFY_(X)
+
+// Implementation selected by atomic_ops.h, reported with every result
+#if defined(SYSTEM_CPU_X86) || defined(SYSTEM_CPU_X86_64)
+	#define BENCH_IMPL "x86-64"
+#elif defined(SYSTEM_CPU_SPARC)
+	#define BENCH_IMPL "sparcv9"
+#elif defined(SYSTEM_CPU_AARCH64) && defined(__ARM_FEATURE_ATOMICS)
+	#define BENCH_IMPL "aarch64-lse"
+#elif defined(SYSTEM_CPU_AARCH64)
+	#define BENCH_IMPL "aarch64"
+#elif defined(SYSTEM_CPU_ARM)
+	#define BENCH_IMPL "armv7"
+#elif defined(__ATOMIC_RELAXED) && !defined(ATOMIC_OPS_SYNC_INTRINSICS)
+	#define BENCH_IMPL "atomic_intrinsics"
+#elif defined(SYSTEM_CPU_IA64)
+	#define BENCH_IMPL "ia64"
+#elif defined(SYSTEM_CPU_PPC)
+	#define BENCH_IMPL "ppc"
+#else
+	#define BENCH_IMPL "sync_intrinsics"
+#endif
+
+typedef struct bench_config {
+	size_t max_threads;
+	size_t iterations;
+	const char *filter;
+} bench_config;
+
+typedef struct bench_thread bench_thread;
+typedef void (*bench_fn)(bench_thread *thread);
+
+struct bench_thread {
+	pthread_t thread;
+	pthread_barrier_t *barrier;
+	bench_fn fn;
+	void *ctx;
+	size_t id;
+	size_t threads;
+	size_t iterations;
+	uint64_t ops;
+	uint64_t start;
+	uint64_t end;
+	uint64_t *samples;
+	size_t samples_len;
+	size_t samples_size;
+	size_t samples_batch;
+};
+
+typedef struct bench_result {
+	uint64_t ops;
+	uint64_t ops_min; // Fewest operations done by one thread
+	uint64_t ops_max; // Most operations done by one thread
+	double seconds;
+	double p50;
+	double p99;
+	double p999;
+} bench_result;
+
+static double bench_clock_overhead = 0;
+static volatile uintptr_t bench_sink_value;
+
+static inline uint64_t bench_clock(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ((uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec);
+}
+
+static inline void bench_sink(uintptr_t val) {
+	bench_sink_value = val;
+}
+
+static inline void bench_sample(bench_thread *thread, uint64_t ns) {
+	if (thread->samples_len == thread->samples_size) {
+		thread->samples_size = (thread->samples_size == 0) ? (1024) : (thread->samples_size * 2);
+		thread->samples = realloc(thread->samples, thread->samples_size * sizeof(uint64_t));
+
+		if (thread->samples == NULL) {
+			fprintf(stderr, "Failed to allocate memory for latency samples.\n");
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	thread->samples[thread->samples_len++] = ns;
+}
+
+static int bench_compare_samples(const void *a, const void *b) {
+	uint64_t sa = *(const uint64_t *)a, sb = *(const uint64_t *)b;
+
+	return ((sa > sb) - (sa < sb));
+}
+
+static void bench_calibrate(void) {
+	uint64_t overhead[1024];
+
+	for (size_t i = 0; i < 1024; i++) {
+		uint64_t start = bench_clock();
+		overhead[i] = bench_clock() - start;
+	}
+
+	qsort(overhead, 1024, sizeof(uint64_t), &bench_compare_samples);
+
+	bench_clock_overhead = (double)overhead[512];
+}
+
+static double bench_percentile(const uint64_t *samples, size_t len, size_t batch, double p) {
+	if (len == 0) {
+		return (0);
+	}
+
+	size_t idx = (size_t)(p * (double)len);
+	if (idx >= len) {
+		idx = len - 1;
+	}
+
+	double ns = (double)samples[idx] - bench_clock_overhead;
+
+	return ((ns > 0) ? (ns / (double)batch) : (0));
+}
+
+static void *bench_thread_main(void *arg) {
+	bench_thread *thread = arg;
+
+	pthread_barrier_wait(thread->barrier);
+
+	thread->start = bench_clock();
+	thread->fn(thread);
+	thread->end = bench_clock();
+
+	return (NULL);
+}
+
+// Run fn on the given number of threads, all released at the same time
+static void bench_run(size_t threads, size_t iterations, size_t samples_batch, bench_fn fn, void *ctx, bench_result *result) {
+	bench_thread *ts = calloc(threads, sizeof(bench_thread));
+	pthread_barrier_t barrier;
+
+	if (ts == NULL) {
+		fprintf(stderr, "Failed to allocate memory for benchmark threads.\n");
+		exit(EXIT_FAILURE);
+	}
+
+	pthread_barrier_init(&barrier, NULL, (unsigned)threads + 1);
+
+	for (size_t i = 0; i < threads; i++) {
+		ts[i].barrier = &barrier;
+		ts[i].fn = fn;
+		ts[i].ctx = ctx;
+		ts[i].id = i;
+		ts[i].threads = threads;
+		ts[i].iterations = iterations;
+		ts[i].samples_batch = samples_batch;
+
+		if (pthread_create(&ts[i].thread, NULL, &bench_thread_main, &ts[i]) != 0) {
+			fprintf(stderr, "Failed to create benchmark thread %zu.\n", i);
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	pthread_barrier_wait(&barrier);
+
+	size_t samples_len = 0;
+
+	for (size_t i = 0; i < threads; i++) {
+		pthread_join(ts[i].thread, NULL);
+		samples_len += ts[i].samples_len;
+	}
+
+	// Wall time from the first thread starting to the last one finishing
+	uint64_t start = ts[0].start, end = ts[0].end;
+
+	for (size_t i = 1; i < threads; i++) {
+		start = (ts[i].start < start) ? (ts[i].start) : (start);
+		end = (ts[i].end > end) ? (ts[i].end) : (end);
+	}
+
+	uint64_t *samples = malloc((samples_len + 1) * sizeof(uint64_t));
+	if (samples == NULL) {
+		fprintf(stderr, "Failed to allocate memory for latency samples.\n");
+		exit(EXIT_FAILURE);
+	}
+
+	result->ops = 0;
+	result->ops_min = ts[0].ops;
+	result->ops_max = ts[0].ops;
+	samples_len = 0;
+
+	for (size_t i = 0; i < threads; i++) {
+		result->ops += ts[i].ops;
+		result->ops_min = (ts[i].ops < result->ops_min) ? (ts[i].ops) : (result->ops_min);
+		result->ops_max = (ts[i].ops > result->ops_max) ? (ts[i].ops) : (result->ops_max);
+		memcpy(samples + samples_len, ts[i].samples, ts[i].samples_len * sizeof(uint64_t));
+		samples_len += ts[i].samples_len;
+		free(ts[i].samples);
+	}
+
+	qsort(samples, samples_len, sizeof(uint64_t), &bench_compare_samples);
+
+	result->seconds = (double)(end - start) / 1e9;
+	result->p50 = bench_percentile(samples, samples_len, samples_batch, 0.50);
+	result->p99 = bench_percentile(samples, samples_len, samples_batch, 0.99);
+	result->p999 = bench_percentile(samples, samples_len, samples_batch, 0.999);
+
+	free(samples);
+	pthread_barrier_destroy(&barrier);
+	free(ts);
+}
+
+static void bench_report(const char *suite, const char *name, const char *config, size_t threads, const bench_result *result) {
+	printf("%s,%s,%s,%s,%zu,%llu,%.6f,%.0f,%.2f,%.2f,%.2f\n", suite, BENCH_IMPL, name, config, threads,
+		(unsigned long long)result->ops, result->seconds, (double)result->ops / result->seconds,
+		result->p50, result->p99, result->p999);
+	fflush(stdout);
+}
+
+static bool bench_selected(const bench_config *config, const char *name) {
+	return (config->filter == NULL || strstr(name, config->filter) != NULL);
+}
+
+// Thread counts: powers of two up to the maximum, plus the maximum itself
+static size_t bench_next_threads(const bench_config *config, size_t threads) {
+	if (threads >= config->max_threads) {
+		return (0);
+	}
+
+	return ((threads * 2 > config->max_threads) ? (config->max_threads) : (threads * 2));
+}
+
+/******************************************************************************/
+
+static const struct {
+	ATOMIC_OPS_FENCE fence;
+	const char *name;
+} bench_fences[] = {
+	{ ATOMIC_OPS_FENCE_NONE,    "NONE" },
+	{ ATOMIC_OPS_FENCE_ACQUIRE, "ACQUIRE" },
+	{ ATOMIC_OPS_FENCE_RELEASE, "RELEASE" },
+	{ ATOMIC_OPS_FENCE_FULL,    "FULL" },
+	{ ATOMIC_OPS_FENCE_READ,    "READ" },
+	{ ATOMIC_OPS_FENCE_WRITE,   "WRITE" },
+};
+
+typedef enum {
+	BENCH_SHARING_SHARED  = 0, // All threads on the same atomic
+	BENCH_SHARING_FALSE   = 1, // Each thread on its own atomic, adjacent in memory
+	BENCH_SHARING_PRIVATE = 2, // Each thread on its own atomic, on separate lines
+} BENCH_SHARING;
+
+static const char *bench_sharing_names[] = { "shared", "false-shared", "private" };
+
+typedef void (*bench_prim_fn)(void *atomic, bench_thread *thread, ATOMIC_OPS_FENCE fence);
+
+typedef struct bench_prim_ctx {
+	bench_prim_fn fn;
+	ATOMIC_OPS_FENCE fence;
+	BENCH_SHARING sharing;
+	char *buffer;
+} bench_prim_ctx;
+
+// Time BENCH_SAMPLE_BATCH executions of BODY per sample, with a constant fence 'f'
+#define BENCH_PRIM_LOOP(FENCE, BODY) \
+	for (size_t done = 0; done < thread->iterations; done += BENCH_SAMPLE_BATCH) {	\
+		const ATOMIC_OPS_FENCE f = (FENCE);											\
+		uint64_t start = bench_clock();												\
+																					\
+		for (size_t i = 0; i < BENCH_SAMPLE_BATCH; i++) {							\
+			BODY;																	\
+		}																			\
+																					\
+		bench_sample(thread, bench_clock() - start);								\
+		thread->ops += BENCH_SAMPLE_BATCH;											\
+	}
+
+#define BENCH_GEN_PRIM(TYPE, MNEMONIC, OPNAME, BODY) \
+static void bench_prim_##MNEMONIC##_##OPNAME(void *atomic, bench_thread *thread, ATOMIC_OPS_FENCE fence) {	\
+	atomic_ops_##MNEMONIC *a = atomic;																		\
+	TYPE v = atomic_ops_##MNEMONIC##_load(a, ATOMIC_OPS_FENCE_NONE);										\
+																											\
+	switch (fence) {																						\
+		case ATOMIC_OPS_FENCE_NONE:    BENCH_PRIM_LOOP(ATOMIC_OPS_FENCE_NONE,    BODY); break;				\
+		case ATOMIC_OPS_FENCE_ACQUIRE: BENCH_PRIM_LOOP(ATOMIC_OPS_FENCE_ACQUIRE, BODY); break;				\
+		case ATOMIC_OPS_FENCE_RELEASE: BENCH_PRIM_LOOP(ATOMIC_OPS_FENCE_RELEASE, BODY); break;				\
+		case ATOMIC_OPS_FENCE_FULL:    BENCH_PRIM_LOOP(ATOMIC_OPS_FENCE_FULL,    BODY); break;				\
+		case ATOMIC_OPS_FENCE_READ:    BENCH_PRIM_LOOP(ATOMIC_OPS_FENCE_READ,    BODY); break;				\
+		case ATOMIC_OPS_FENCE_WRITE:   BENCH_PRIM_LOOP(ATOMIC_OPS_FENCE_WRITE,   BODY); break;				\
+	}																										\
+																											\
+	bench_sink((uintptr_t)v);																				\
+}
+
+#define BENCH_GEN_PRIM_INTEGER(TYPE, MNEMONIC) \
+BENCH_GEN_PRIM(TYPE, MNEMONIC, load,          v = atomic_ops_##MNEMONIC##_load(a, f))								\
+BENCH_GEN_PRIM(TYPE, MNEMONIC, store,         atomic_ops_##MNEMONIC##_store(a, v, f))								\
+BENCH_GEN_PRIM(TYPE, MNEMONIC, not,           atomic_ops_##MNEMONIC##_not(a, f))									\
+BENCH_GEN_PRIM(TYPE, MNEMONIC, and,           atomic_ops_##MNEMONIC##_and(a, (TYPE) -2, f))							\
+BENCH_GEN_PRIM(TYPE, MNEMONIC, or,            atomic_ops_##MNEMONIC##_or(a, (TYPE) 1, f))							\
+BENCH_GEN_PRIM(TYPE, MNEMONIC, xor,           atomic_ops_##MNEMONIC##_xor(a, (TYPE) 1, f))							\
+BENCH_GEN_PRIM(TYPE, MNEMONIC, add,           atomic_ops_##MNEMONIC##_add(a, (TYPE) 1, f))							\
+BENCH_GEN_PRIM(TYPE, MNEMONIC, inc,           atomic_ops_##MNEMONIC##_inc(a, f))									\
+BENCH_GEN_PRIM(TYPE, MNEMONIC, dec,           atomic_ops_##MNEMONIC##_dec(a, f))									\
+BENCH_GEN_PRIM(TYPE, MNEMONIC, fetch_and_add, v = atomic_ops_##MNEMONIC##_fetch_and_add(a, (TYPE) 1, f))			\
+BENCH_GEN_PRIM(TYPE, MNEMONIC, fetch_and_inc, v = atomic_ops_##MNEMONIC##_fetch_and_inc(a, f))						\
+BENCH_GEN_PRIM(TYPE, MNEMONIC, fetch_and_dec, v = atomic_ops_##MNEMONIC##_fetch_and_dec(a, f))						\
+BENCH_GEN_PRIM(TYPE, MNEMONIC, casr,          TYPE prev = atomic_ops_##MNEMONIC##_casr(a, v, v + 1, f);			\
+                                              v = (prev == v) ? (v + 1) : (prev))									\
+BENCH_GEN_PRIM(TYPE, MNEMONIC, cas,           v = (atomic_ops_##MNEMONIC##_cas(a, v, v + 1, f))						\
+                                                ? (v + 1) : (atomic_ops_##MNEMONIC##_load(a, ATOMIC_OPS_FENCE_NONE)))	\
+BENCH_GEN_PRIM(TYPE, MNEMONIC, swap,          v = atomic_ops_##MNEMONIC##_swap(a, v + 1, f))
+
+BENCH_GEN_PRIM_INTEGER(intptr_t,  int)
+BENCH_GEN_PRIM_INTEGER(uintptr_t, uint)
+
+// Pointer values are stepped by two, keeping them usable as flag-pointers
+#define BENCH_PTR_NEXT(P) ((void *)((uintptr_t)(P) + 2))
+
+BENCH_GEN_PRIM(void *, ptr, load,  v = atomic_ops_ptr_load(a, f))
+BENCH_GEN_PRIM(void *, ptr, store, atomic_ops_ptr_store(a, v, f))
+BENCH_GEN_PRIM(void *, ptr, casr,  void *prev = atomic_ops_ptr_casr(a, v, BENCH_PTR_NEXT(v), f);
+                                   v = (prev == v) ? (BENCH_PTR_NEXT(v)) : (prev))
+BENCH_GEN_PRIM(void *, ptr, cas,   v = (atomic_ops_ptr_cas(a, v, BENCH_PTR_NEXT(v), f))
+                                     ? (BENCH_PTR_NEXT(v)) : (atomic_ops_ptr_load(a, ATOMIC_OPS_FENCE_NONE)))
+BENCH_GEN_PRIM(void *, ptr, swap,  v = atomic_ops_ptr_swap(a, BENCH_PTR_NEXT(v), f))
+
+static const struct {
+	const char *name;
+	bench_prim_fn fn;
+} bench_prims[] = {
+	{ "int_load",           &bench_prim_int_load },
+	{ "int_store",          &bench_prim_int_store },
+	{ "int_not",            &bench_prim_int_not },
+	{ "int_and",            &bench_prim_int_and },
+	{ "int_or",             &bench_prim_int_or },
+	{ "int_xor",            &bench_prim_int_xor },
+	{ "int_add",            &bench_prim_int_add },
+	{ "int_inc",            &bench_prim_int_inc },
+	{ "int_dec",            &bench_prim_int_dec },
+	{ "int_fetch_and_add",  &bench_prim_int_fetch_and_add },
+	{ "int_fetch_and_inc",  &bench_prim_int_fetch_and_inc },
+	{ "int_fetch_and_dec",  &bench_prim_int_fetch_and_dec },
+	{ "int_casr",           &bench_prim_int_casr },
+	{ "int_cas",            &bench_prim_int_cas },
+	{ "int_swap",           &bench_prim_int_swap },
+	{ "uint_load",          &bench_prim_uint_load },
+	{ "uint_store",         &bench_prim_uint_store },
+	{ "uint_not",           &bench_prim_uint_not },
+	{ "uint_and",           &bench_prim_uint_and },
+	{ "uint_or",            &bench_prim_uint_or },
+	{ "uint_xor",           &bench_prim_uint_xor },
+	{ "uint_add",           &bench_prim_uint_add },
+	{ "uint_inc",           &bench_prim_uint_inc },
+	{ "uint_dec",           &bench_prim_uint_dec },
+	{ "uint_fetch_and_add", &bench_prim_uint_fetch_and_add },
+	{ "uint_fetch_and_inc", &bench_prim_uint_fetch_and_inc },
+	{ "uint_fetch_and_dec", &bench_prim_uint_fetch_and_dec },
+	{ "uint_casr",          &bench_prim_uint_casr },
+	{ "uint_cas",           &bench_prim_uint_cas },
+	{ "uint_swap",          &bench_prim_uint_swap },
+	{ "ptr_load",           &bench_prim_ptr_load },
+	{ "ptr_store",          &bench_prim_ptr_store },
+	{ "ptr_casr",           &bench_prim_ptr_casr },
+	{ "ptr_cas",            &bench_prim_ptr_cas },
+	{ "ptr_swap",           &bench_prim_ptr_swap },
+};
+
+static void bench_primitives_thread(bench_thread *thread) {
+	bench_prim_ctx *ctx = thread->ctx;
+	size_t offset = 0;
+
+	if (ctx->sharing == BENCH_SHARING_FALSE) {
+		offset = thread->id * sizeof(uintptr_t);
+	}
+	else if (ctx->sharing == BENCH_SHARING_PRIVATE) {
+		offset = thread->id * BENCH_SLOT_SIZE;
+	}
+
+	ctx->fn(ctx->buffer + offset, thread, ctx->fence);
+}
+
+static void bench_primitives(const bench_config *config) {
+	bench_prim_ctx ctx;
+	bench_result result;
+	char params[64];
+
+	ctx.buffer = aligned_alloc(BENCH_SLOT_SIZE, config->max_threads * BENCH_SLOT_SIZE);
+	if (ctx.buffer == NULL) {
+		fprintf(stderr, "Failed to allocate memory for benchmark atomics.\n");
+		exit(EXIT_FAILURE);
+	}
+
+	for (size_t p = 0; p < (sizeof(bench_prims) / sizeof(bench_prims[0])); p++) {
+		if (!bench_selected(config, bench_prims[p].name)) {
+			continue;
+		}
+
+		for (size_t f = 0; f < (sizeof(bench_fences) / sizeof(bench_fences[0])); f++) {
+			for (size_t s = BENCH_SHARING_SHARED; s <= BENCH_SHARING_PRIVATE; s++) {
+				for (size_t threads = 1; threads != 0; threads = bench_next_threads(config, threads)) {
+					memset(ctx.buffer, 0, config->max_threads * BENCH_SLOT_SIZE);
+
+					ctx.fn = bench_prims[p].fn;
+					ctx.fence = bench_fences[f].fence;
+					ctx.sharing = (BENCH_SHARING)s;
+
+					bench_run(threads, config->iterations, BENCH_SAMPLE_BATCH, &bench_primitives_thread, &ctx, &result);
+
+					snprintf(params, sizeof(params), "fence=%s;sharing=%s", bench_fences[f].name, bench_sharing_names[s]);
+					bench_report("primitives", bench_prims[p].name, params, threads, &result);
+				}
+			}
+		}
+	}
+
+	free(ctx.buffer);
+}
+
+/******************************************************************************/
+
+#define BENCH_QUEUE_CAPACITY 1024
+
+// Baseline: the same bounded ring, protected by a mutex
+typedef struct bench_mutex_queue {
+	pthread_mutex_t lock;
+	void **items;
+	size_t mask;
+	size_t head;
+	size_t tail;
+} bench_mutex_queue;
+
+static bool bench_mutex_queue_try_enqueue(bench_mutex_queue *queue, void *data) {
+	bool res = false;
+
+	pthread_mutex_lock(&queue->lock);
+
+	if ((queue->head - queue->tail) <= queue->mask) {
+		queue->items[queue->head++ & queue->mask] = data;
+		res = true;
+	}
+
+	pthread_mutex_unlock(&queue->lock);
+
+	return (res);
+}
+
+static bool bench_mutex_queue_try_dequeue(bench_mutex_queue *queue, void **data) {
+	bool res = false;
+
+	pthread_mutex_lock(&queue->lock);
+
+	if (queue->head != queue->tail) {
+		*data = queue->items[queue->tail++ & queue->mask];
+		res = true;
+	}
+
+	pthread_mutex_unlock(&queue->lock);
+
+	return (res);
+}
+
+typedef enum {
+	BENCH_QUEUE_TRY      = 0, // try_enqueue/try_dequeue, retried until they succeed
+	BENCH_QUEUE_BLOCKING = 1, // enqueue/dequeue, waiting on the cell
+	BENCH_QUEUE_BATCH    = 2, // try_*_batch with up to BENCH_SAMPLE_BATCH elements
+	BENCH_QUEUE_MUTEX    = 3, // bench_mutex_queue
+} BENCH_QUEUE_KIND;
+
+static const char *bench_queue_names[] = { "mpmc_queue_try", "mpmc_queue_blocking", "mpmc_queue_batch", "mutex_queue" };
+
+typedef struct bench_queue_ctx {
+	BENCH_QUEUE_KIND kind;
+	atomic_ops_mpmc_queue queue;
+	bench_mutex_queue mutex_queue;
+	size_t producers;
+} bench_queue_ctx;
+
+static void bench_queue_thread(bench_thread *thread) {
+	bench_queue_ctx *ctx = thread->ctx;
+	bool producer = (thread->id < ctx->producers);
+	void *batch[BENCH_SAMPLE_BATCH];
+	size_t count = thread->iterations;
+
+	// Consumers split the producers' elements evenly among themselves
+	if (!producer) {
+		size_t consumers = thread->threads - ctx->producers, consumer = thread->id - ctx->producers;
+		size_t total = ctx->producers * thread->iterations;
+
+		count = (total / consumers) + ((consumer < (total % consumers)) ? (1) : (0));
+	}
+
+	for (size_t done = 0; done < count; ) {
+		size_t n = ((count - done) < BENCH_SAMPLE_BATCH) ? (count - done) : (BENCH_SAMPLE_BATCH);
+		uint64_t start = bench_clock();
+
+		for (size_t i = 0; i < n; i++) {
+			batch[i] = (void *)(done + i + 1);
+		}
+
+		switch (ctx->kind) {
+			case BENCH_QUEUE_TRY:
+				for (size_t i = 0; i < n; i++) {
+					while (!((producer) ? (atomic_ops_mpmc_queue_try_enqueue(&ctx->queue, batch[i]))
+						: (atomic_ops_mpmc_queue_try_dequeue(&ctx->queue, &batch[i])))) {
+						atomic_ops_pause();
+					}
+				}
+				break;
+
+			case BENCH_QUEUE_BLOCKING:
+				for (size_t i = 0; i < n; i++) {
+					if (producer) {
+						atomic_ops_mpmc_queue_enqueue(&ctx->queue, batch[i]);
+					}
+					else {
+						batch[i] = atomic_ops_mpmc_queue_dequeue(&ctx->queue);
+					}
+				}
+				break;
+
+			case BENCH_QUEUE_BATCH:
+				for (size_t i = 0; i < n; ) {
+					size_t res = (producer) ? (atomic_ops_mpmc_queue_try_enqueue_batch(&ctx->queue, batch + i, n - i))
+						: (atomic_ops_mpmc_queue_try_dequeue_batch(&ctx->queue, batch + i, n - i));
+
+					if (res == 0) {
+						atomic_ops_pause();
+					}
+
+					i += res;
+				}
+				break;
+
+			case BENCH_QUEUE_MUTEX:
+				for (size_t i = 0; i < n; i++) {
+					while (!((producer) ? (bench_mutex_queue_try_enqueue(&ctx->mutex_queue, batch[i]))
+						: (bench_mutex_queue_try_dequeue(&ctx->mutex_queue, &batch[i])))) {
+						atomic_ops_pause();
+					}
+				}
+				break;
+		}
+
+		bench_sample(thread, bench_clock() - start);
+		done += n;
+	}
+
+	// Throughput counts transferred elements, on the consumer side
+	if (!producer) {
+		thread->ops = count;
+	}
+}
+
+static void bench_queues(const bench_config *config) {
+	bench_queue_ctx ctx;
+	bench_result result;
+	char params[64];
+
+	if (!atomic_ops_mpmc_queue_init(&ctx.queue, BENCH_QUEUE_CAPACITY)) {
+		fprintf(stderr, "Failed to initialize MPMC queue.\n");
+		exit(EXIT_FAILURE);
+	}
+
+	ctx.mutex_queue.items = malloc(BENCH_QUEUE_CAPACITY * sizeof(void *));
+	if (ctx.mutex_queue.items == NULL) {
+		fprintf(stderr, "Failed to allocate memory for mutex queue.\n");
+		exit(EXIT_FAILURE);
+	}
+
+	pthread_mutex_init(&ctx.mutex_queue.lock, NULL);
+	ctx.mutex_queue.mask = BENCH_QUEUE_CAPACITY - 1;
+
+	for (size_t k = BENCH_QUEUE_TRY; k <= BENCH_QUEUE_MUTEX; k++) {
+		if (!bench_selected(config, bench_queue_names[k])) {
+			continue;
+		}
+
+		// Half producers, half consumers: needs at least two threads
+		for (size_t threads = 2; threads != 0 && threads <= config->max_threads; threads = bench_next_threads(config, threads)) {
+			ctx.kind = (BENCH_QUEUE_KIND)k;
+			ctx.producers = threads / 2;
+			ctx.mutex_queue.head = ctx.mutex_queue.tail = 0;
+
+			bench_run(threads, config->iterations, BENCH_SAMPLE_BATCH, &bench_queue_thread, &ctx, &result);
+
+			snprintf(params, sizeof(params), "producers=%zu;consumers=%zu;capacity=%d",
+				ctx.producers, threads - ctx.producers, BENCH_QUEUE_CAPACITY);
+			bench_report("mpmc_queue", bench_queue_names[k], params, threads, &result);
+		}
+	}
+
+	pthread_mutex_destroy(&ctx.mutex_queue.lock);
+	free(ctx.mutex_queue.items);
+	atomic_ops_mpmc_queue_destroy(&ctx.queue);
+}
+
+/******************************************************************************/
+
+typedef struct bench_ring_ctx {
+	atomic_ops_spsc_ring ring;
+	bool batch; // reserve/commit and peek/consume BENCH_SAMPLE_BATCH at a time
+} bench_ring_ctx;
+
+static void bench_ring_thread(bench_thread *thread) {
+	bench_ring_ctx *ctx = thread->ctx;
+	bool producer = (thread->id == 0);
+
+	for (size_t done = 0; done < thread->iterations; ) {
+		size_t n = ((thread->iterations - done) < BENCH_SAMPLE_BATCH) ? (thread->iterations - done) : (BENCH_SAMPLE_BATCH);
+		uint64_t start = bench_clock();
+
+		for (size_t i = 0; i < n; ) {
+			uintptr_t *elems, val = done + i;
+			size_t res = 1;
+
+			if (ctx->batch) {
+				elems = (producer) ? (atomic_ops_spsc_ring_reserve(&ctx->ring, n - i, &res))
+					: (atomic_ops_spsc_ring_peek(&ctx->ring, n - i, &res));
+
+				for (size_t j = 0; j < res; j++) {
+					if (producer) {
+						elems[j] = val + j;
+					}
+					else {
+						bench_sink(elems[j]);
+					}
+				}
+
+				if (producer) {
+					atomic_ops_spsc_ring_commit(&ctx->ring, res);
+				}
+				else {
+					atomic_ops_spsc_ring_consume(&ctx->ring, res);
+				}
+			}
+			else if (!((producer) ? (atomic_ops_spsc_ring_try_push(&ctx->ring, &val)) : (atomic_ops_spsc_ring_try_pop(&ctx->ring, &val)))) {
+				res = 0;
+			}
+
+			if (res == 0) {
+				atomic_ops_pause();
+			}
+
+			i += res;
+		}
+
+		bench_sample(thread, bench_clock() - start);
+		done += n;
+	}
+
+	if (!producer) {
+		thread->ops = thread->iterations;
+	}
+}
+
+static void bench_rings(const bench_config *config) {
+	static const char *names[] = { "spsc_ring_push_pop", "spsc_ring_batch" };
+	bench_ring_ctx ctx;
+	bench_result result;
+
+	if (config->max_threads < 2) {
+		return;
+	}
+
+	for (size_t b = 0; b < 2; b++) {
+		if (!bench_selected(config, names[b])) {
+			continue;
+		}
+
+		if (!atomic_ops_spsc_ring_init(&ctx.ring, BENCH_QUEUE_CAPACITY, sizeof(uintptr_t))) {
+			fprintf(stderr, "Failed to initialize SPSC ring.\n");
+			exit(EXIT_FAILURE);
+		}
+
+		ctx.batch = (b == 1);
+
+		bench_run(2, config->iterations, BENCH_SAMPLE_BATCH, &bench_ring_thread, &ctx, &result);
+		bench_report("spsc_ring", names[b], "producers=1;consumers=1;capacity=" BENCH_STRINGIFY(BENCH_QUEUE_CAPACITY), 2, &result);
+
+		atomic_ops_spsc_ring_destroy(&ctx.ring);
+	}
+}
+
+/******************************************************************************/
+
+typedef enum {
+	BENCH_HAZARD_UNPROTECTED = 0, // Plain loads of the shared pointer, the baseline
+	BENCH_HAZARD_PROTECT     = 1, // protect/clear around every read, nothing changes
+	BENCH_HAZARD_CHURN       = 2, // protect/clear, while thread 0 keeps replacing and retiring
+	BENCH_HAZARD_RECLAIM     = 3, // Latency from retire to free on thread 0, readers protecting
+} BENCH_HAZARD_KIND;
+
+static const char *bench_hazard_names[] = { "unprotected_load", "hazard_protect", "hazard_churn", "hazard_reclaim" };
+
+typedef struct bench_hazard_node {
+	uintptr_t value;
+	uint64_t retired;
+	bench_thread *thread; // Set if the reclamation latency is to be sampled
+} bench_hazard_node;
+
+typedef struct bench_hazard_ctx {
+	BENCH_HAZARD_KIND kind;
+	atomic_ops_hazard_domain domain;
+	atomic_ops_ptr shared;
+	atomic_ops_uint running; // Threads still measuring
+} bench_hazard_ctx;
+
+// Retired objects are freed by the thread that retired them, so sampling is safe here
+static void bench_hazard_free(void *ptr) {
+	bench_hazard_node *node = ptr;
+
+	if (node->thread != NULL) {
+		bench_sample(node->thread, bench_clock() - node->retired);
+		node->thread->ops++;
+	}
+
+	free(node);
+}
+
+static void bench_hazard_writer(bench_thread *thread, bench_hazard_ctx *ctx, atomic_ops_hazard_record *rec) {
+	bool measure = (ctx->kind == BENCH_HAZARD_RECLAIM);
+
+	for (size_t done = 0; (measure) ? (done < thread->iterations) : (atomic_ops_uint_load(&ctx->running, ATOMIC_OPS_FENCE_NONE) != 0); done++) {
+		bench_hazard_node *node = malloc(sizeof(bench_hazard_node));
+
+		if (node == NULL) {
+			fprintf(stderr, "Failed to allocate memory for hazard nodes.\n");
+			exit(EXIT_FAILURE);
+		}
+
+		node->value = done;
+		node->thread = NULL;
+
+		bench_hazard_node *old = atomic_ops_ptr_swap(&ctx->shared, node, ATOMIC_OPS_FENCE_FULL);
+
+		old->thread = (measure) ? (thread) : (NULL);
+		old->retired = bench_clock();
+
+		if (!atomic_ops_hazard_retire(&ctx->domain, rec, old, &bench_hazard_free)) {
+			fprintf(stderr, "Failed to retire hazard node.\n");
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	if (measure) {
+		atomic_ops_uint_dec(&ctx->running, ATOMIC_OPS_FENCE_NONE);
+	}
+
+	// Don't sample what's left over for the next run
+	for (size_t i = 0; i < rec->retired_len; i++) {
+		((bench_hazard_node *)rec->retired[i].ptr)->thread = NULL;
+	}
+}
+
+static void bench_hazard_reader(bench_thread *thread, bench_hazard_ctx *ctx, atomic_ops_hazard_record *rec) {
+	bool measure = (ctx->kind != BENCH_HAZARD_RECLAIM);
+	uintptr_t sum = 0;
+
+	for (size_t done = 0; (measure) ? (done < thread->iterations) : (atomic_ops_uint_load(&ctx->running, ATOMIC_OPS_FENCE_NONE) != 0); done += BENCH_SAMPLE_BATCH) {
+		uint64_t start = bench_clock();
+
+		for (size_t i = 0; i < BENCH_SAMPLE_BATCH; i++) {
+			if (ctx->kind == BENCH_HAZARD_UNPROTECTED) {
+				sum += ((bench_hazard_node *)atomic_ops_ptr_load(&ctx->shared, ATOMIC_OPS_FENCE_ACQUIRE))->value;
+			}
+			else {
+				sum += ((bench_hazard_node *)atomic_ops_hazard_protect(rec, 0, &ctx->shared))->value;
+				atomic_ops_hazard_clear(rec, 0);
+			}
+		}
+
+		if (measure) {
+			bench_sample(thread, bench_clock() - start);
+			thread->ops += BENCH_SAMPLE_BATCH;
+		}
+	}
+
+	if (measure) {
+		atomic_ops_uint_dec(&ctx->running, ATOMIC_OPS_FENCE_NONE);
+	}
+
+	bench_sink(sum);
+}
+
+static void bench_hazard_thread(bench_thread *thread) {
+	bench_hazard_ctx *ctx = thread->ctx;
+	atomic_ops_hazard_record *rec = atomic_ops_hazard_acquire(&ctx->domain);
+
+	if (rec == NULL) {
+		fprintf(stderr, "Failed to acquire hazard record.\n");
+		exit(EXIT_FAILURE);
+	}
+
+	if (thread->id == 0 && (ctx->kind == BENCH_HAZARD_CHURN || ctx->kind == BENCH_HAZARD_RECLAIM)) {
+		bench_hazard_writer(thread, ctx, rec);
+	}
+	else {
+		bench_hazard_reader(thread, ctx, rec);
+	}
+
+	atomic_ops_hazard_release(&ctx->domain, rec);
+}
+
+static void bench_hazard(const bench_config *config) {
+	bench_hazard_ctx ctx;
+	bench_result result;
+	char params[64];
+
+	for (size_t k = BENCH_HAZARD_UNPROTECTED; k <= BENCH_HAZARD_RECLAIM; k++) {
+		if (!bench_selected(config, bench_hazard_names[k])) {
+			continue;
+		}
+
+		bool churn = (k == BENCH_HAZARD_CHURN || k == BENCH_HAZARD_RECLAIM);
+
+		// With churn, thread 0 writes and the others read: needs at least two threads
+		for (size_t threads = (churn) ? (2) : (1); threads != 0 && threads <= config->max_threads; threads = bench_next_threads(config, threads)) {
+			bench_hazard_node *node = calloc(1, sizeof(bench_hazard_node));
+
+			if (node == NULL) {
+				fprintf(stderr, "Failed to allocate memory for hazard nodes.\n");
+				exit(EXIT_FAILURE);
+			}
+
+			ctx.kind = (BENCH_HAZARD_KIND)k;
+			atomic_ops_hazard_domain_init(&ctx.domain);
+			atomic_ops_ptr_store(&ctx.shared, node, ATOMIC_OPS_FENCE_NONE);
+			atomic_ops_uint_store(&ctx.running, (k == BENCH_HAZARD_RECLAIM) ? (1) : ((churn) ? (threads - 1) : (threads)), ATOMIC_OPS_FENCE_RELEASE);
+
+			// Reclamation latencies are sampled one object at a time
+			bench_run(threads, config->iterations, (k == BENCH_HAZARD_RECLAIM) ? (1) : (BENCH_SAMPLE_BATCH), &bench_hazard_thread, &ctx, &result);
+
+			snprintf(params, sizeof(params), "readers=%zu;writers=%d;slots=%d", (churn) ? (threads - 1) : (threads), (churn) ? (1) : (0), ATOMIC_OPS_HAZARD_SLOTS);
+			bench_report("hazard", bench_hazard_names[k], params, threads, &result);
+
+			atomic_ops_hazard_domain_destroy(&ctx.domain);
+			free(atomic_ops_ptr_load(&ctx.shared, ATOMIC_OPS_FENCE_NONE));
+		}
+	}
+}
+
+/******************************************************************************/
+
+typedef enum {
+	BENCH_EPOCH_READ      = 0, // enter/exit around every read, nothing changes
+	BENCH_EPOCH_QSBR_READ = 1, // Online, a quiescent state reported after every read
+	BENCH_EPOCH_CHURN     = 2, // enter/exit, while thread 0 keeps replacing and retiring
+	BENCH_EPOCH_RECLAIM   = 3, // Latency from retire to free on thread 0, readers in enter/exit
+} BENCH_EPOCH_KIND;
+
+static const char *bench_epoch_names[] = { "epoch_read", "qsbr_read", "epoch_churn", "epoch_reclaim" };
+
+// Uses the same nodes, sampled in the same free function, as the hazard suite
+typedef struct bench_epoch_ctx {
+	BENCH_EPOCH_KIND kind;
+	atomic_ops_epoch_domain domain;
+	atomic_ops_ptr shared;
+	atomic_ops_uint running; // Threads still measuring
+} bench_epoch_ctx;
+
+static void bench_epoch_writer(bench_thread *thread, bench_epoch_ctx *ctx, atomic_ops_epoch_record *rec) {
+	bool measure = (ctx->kind == BENCH_EPOCH_RECLAIM);
+
+	for (size_t done = 0; (measure) ? (done < thread->iterations) : (atomic_ops_uint_load(&ctx->running, ATOMIC_OPS_FENCE_NONE) != 0); done++) {
+		bench_hazard_node *node = malloc(sizeof(bench_hazard_node));
+
+		if (node == NULL) {
+			fprintf(stderr, "Failed to allocate memory for epoch nodes.\n");
+			exit(EXIT_FAILURE);
+		}
+
+		node->value = done;
+		node->thread = NULL;
+
+		bench_hazard_node *old = atomic_ops_ptr_swap(&ctx->shared, node, ATOMIC_OPS_FENCE_FULL);
+
+		old->thread = (measure) ? (thread) : (NULL);
+		old->retired = bench_clock();
+
+		if (!atomic_ops_epoch_retire(&ctx->domain, rec, old, &bench_hazard_free)) {
+			fprintf(stderr, "Failed to retire epoch node.\n");
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	if (measure) {
+		atomic_ops_uint_dec(&ctx->running, ATOMIC_OPS_FENCE_NONE);
+	}
+
+	// Don't sample what's left over for the next run
+	for (size_t i = 0; i < rec->deferred_len; i++) {
+		((bench_hazard_node *)rec->deferred[i].arg)->thread = NULL;
+	}
+}
+
+static void bench_epoch_reader(bench_thread *thread, bench_epoch_ctx *ctx, atomic_ops_epoch_record *rec) {
+	bool measure = (ctx->kind != BENCH_EPOCH_RECLAIM);
+	uintptr_t sum = 0;
+
+	if (ctx->kind == BENCH_EPOCH_QSBR_READ) {
+		atomic_ops_epoch_online(&ctx->domain, rec);
+	}
+
+	for (size_t done = 0; (measure) ? (done < thread->iterations) : (atomic_ops_uint_load(&ctx->running, ATOMIC_OPS_FENCE_NONE) != 0); done += BENCH_SAMPLE_BATCH) {
+		uint64_t start = bench_clock();
+
+		for (size_t i = 0; i < BENCH_SAMPLE_BATCH; i++) {
+			if (ctx->kind == BENCH_EPOCH_QSBR_READ) {
+				sum += ((bench_hazard_node *)atomic_ops_ptr_load(&ctx->shared, ATOMIC_OPS_FENCE_ACQUIRE))->value;
+				atomic_ops_epoch_quiescent(&ctx->domain, rec);
+			}
+			else {
+				atomic_ops_epoch_enter(&ctx->domain, rec);
+				sum += ((bench_hazard_node *)atomic_ops_ptr_load(&ctx->shared, ATOMIC_OPS_FENCE_ACQUIRE))->value;
+				atomic_ops_epoch_exit(&ctx->domain, rec);
+			}
+		}
+
+		if (measure) {
+			bench_sample(thread, bench_clock() - start);
+			thread->ops += BENCH_SAMPLE_BATCH;
+		}
+	}
+
+	if (ctx->kind == BENCH_EPOCH_QSBR_READ) {
+		atomic_ops_epoch_offline(&ctx->domain, rec);
+	}
+
+	if (measure) {
+		atomic_ops_uint_dec(&ctx->running, ATOMIC_OPS_FENCE_NONE);
+	}
+
+	bench_sink(sum);
+}
+
+static void bench_epoch_thread(bench_thread *thread) {
+	bench_epoch_ctx *ctx = thread->ctx;
+	atomic_ops_epoch_record *rec = atomic_ops_epoch_acquire(&ctx->domain);
+
+	if (rec == NULL) {
+		fprintf(stderr, "Failed to acquire epoch record.\n");
+		exit(EXIT_FAILURE);
+	}
+
+	if (thread->id == 0 && (ctx->kind == BENCH_EPOCH_CHURN || ctx->kind == BENCH_EPOCH_RECLAIM)) {
+		bench_epoch_writer(thread, ctx, rec);
+	}
+	else {
+		bench_epoch_reader(thread, ctx, rec);
+	}
+
+	atomic_ops_epoch_release(&ctx->domain, rec);
+}
+
+static void bench_epoch(const bench_config *config) {
+	bench_epoch_ctx ctx;
+	bench_result result;
+	char params[64];
+
+	for (size_t k = BENCH_EPOCH_READ; k <= BENCH_EPOCH_RECLAIM; k++) {
+		if (!bench_selected(config, bench_epoch_names[k])) {
+			continue;
+		}
+
+		bool churn = (k == BENCH_EPOCH_CHURN || k == BENCH_EPOCH_RECLAIM);
+
+		// With churn, thread 0 writes and the others read: needs at least two threads
+		for (size_t threads = (churn) ? (2) : (1); threads != 0 && threads <= config->max_threads; threads = bench_next_threads(config, threads)) {
+			bench_hazard_node *node = calloc(1, sizeof(bench_hazard_node));
+
+			if (node == NULL) {
+				fprintf(stderr, "Failed to allocate memory for epoch nodes.\n");
+				exit(EXIT_FAILURE);
+			}
+
+			ctx.kind = (BENCH_EPOCH_KIND)k;
+			atomic_ops_epoch_domain_init(&ctx.domain);
+			atomic_ops_ptr_store(&ctx.shared, node, ATOMIC_OPS_FENCE_NONE);
+			atomic_ops_uint_store(&ctx.running, (k == BENCH_EPOCH_RECLAIM) ? (1) : ((churn) ? (threads - 1) : (threads)), ATOMIC_OPS_FENCE_RELEASE);
+
+			// Reclamation latencies are sampled one object at a time
+			bench_run(threads, config->iterations, (k == BENCH_EPOCH_RECLAIM) ? (1) : (BENCH_SAMPLE_BATCH), &bench_epoch_thread, &ctx, &result);
+
+			snprintf(params, sizeof(params), "readers=%zu;writers=%d;membarrier=%s", (churn) ? (threads - 1) : (threads), (churn) ? (1) : (0),
+				(ctx.domain.asymmetric) ? ("yes") : ("no"));
+			bench_report("epoch", bench_epoch_names[k], params, threads, &result);
+
+			atomic_ops_epoch_domain_destroy(&ctx.domain);
+			free(atomic_ops_ptr_load(&ctx.shared, ATOMIC_OPS_FENCE_NONE));
+		}
+	}
+}
+
+/******************************************************************************/
+
+#define BENCH_LIST_KEYS 1024
+
+// Baseline: a plain sorted list, protected by a reader-writer lock
+typedef struct bench_rwlock_list_node {
+	struct bench_rwlock_list_node *next;
+	uintptr_t key;
+	void *value;
+} bench_rwlock_list_node;
+
+typedef struct bench_rwlock_list {
+	pthread_rwlock_t lock;
+	bench_rwlock_list_node *head;
+} bench_rwlock_list;
+
+static bool bench_rwlock_list_insert(bench_rwlock_list *list, uintptr_t key, void *value) {
+	bench_rwlock_list_node *node = malloc(sizeof(bench_rwlock_list_node)), **prev;
+	bool res = false;
+
+	if (node == NULL) {
+		fprintf(stderr, "Failed to allocate memory for list nodes.\n");
+		exit(EXIT_FAILURE);
+	}
+
+	pthread_rwlock_wrlock(&list->lock);
+
+	for (prev = &list->head; *prev != NULL && (*prev)->key < key; prev = &(*prev)->next) {
+		;
+	}
+
+	if (*prev == NULL || (*prev)->key != key) {
+		node->key = key;
+		node->value = value;
+		node->next = *prev;
+		*prev = node;
+		res = true;
+	}
+
+	pthread_rwlock_unlock(&list->lock);
+
+	if (!res) {
+		free(node);
+	}
+
+	return (res);
+}
+
+static bool bench_rwlock_list_remove(bench_rwlock_list *list, uintptr_t key) {
+	bench_rwlock_list_node *node = NULL, **prev;
+
+	pthread_rwlock_wrlock(&list->lock);
+
+	for (prev = &list->head; *prev != NULL && (*prev)->key < key; prev = &(*prev)->next) {
+		;
+	}
+
+	if (*prev != NULL && (*prev)->key == key) {
+		node = *prev;
+		*prev = node->next;
+	}
+
+	pthread_rwlock_unlock(&list->lock);
+
+	free(node);
+
+	return (node != NULL);
+}
+
+static bool bench_rwlock_list_contains(bench_rwlock_list *list, uintptr_t key) {
+	bench_rwlock_list_node *node;
+
+	pthread_rwlock_rdlock(&list->lock);
+
+	for (node = list->head; node != NULL && node->key < key; node = node->next) {
+		;
+	}
+
+	bool res = (node != NULL && node->key == key);
+
+	pthread_rwlock_unlock(&list->lock);
+
+	return (res);
+}
+
+static void bench_rwlock_list_destroy(bench_rwlock_list *list) {
+	while (list->head != NULL) {
+		bench_rwlock_list_node *next = list->head->next;
+
+		free(list->head);
+		list->head = next;
+	}
+}
+
+static const struct {
+	const char *name;
+	unsigned int updates; // Percentage of inserts plus removes, the rest are lookups
+} bench_list_mixes[] = {
+	{ "read-mostly", 10 },
+	{ "balanced",    50 },
+};
+
+typedef struct bench_list_ctx {
+	bool rwlock;
+	unsigned int updates;
+	atomic_ops_epoch_domain domain;
+	atomic_ops_list list;
+	bench_rwlock_list rwlock_list;
+} bench_list_ctx;
+
+static inline uintptr_t bench_random(uintptr_t *seed) {
+	*seed ^= *seed << 13;
+	*seed ^= *seed >> 7;
+	*seed ^= *seed << 17;
+
+	return (*seed);
+}
+
+static void bench_list_thread(bench_thread *thread) {
+	bench_list_ctx *ctx = thread->ctx;
+	atomic_ops_epoch_record *rec = atomic_ops_epoch_acquire(&ctx->domain);
+	uintptr_t seed = thread->id * 2654435761u + 1, found = 0;
+
+	if (rec == NULL) {
+		fprintf(stderr, "Failed to acquire epoch record.\n");
+		exit(EXIT_FAILURE);
+	}
+
+	for (size_t done = 0; done < thread->iterations; done += BENCH_SAMPLE_BATCH) {
+		uint64_t start = bench_clock();
+
+		for (size_t i = 0; i < BENCH_SAMPLE_BATCH; i++) {
+			uintptr_t r = bench_random(&seed), key = (r >> 8) % BENCH_LIST_KEYS;
+			unsigned int op = (unsigned int)(r % 100);
+
+			// Inserts and removes in equal parts keep the list half full
+			if (op < ctx->updates / 2) {
+				found += (ctx->rwlock) ? (bench_rwlock_list_insert(&ctx->rwlock_list, key, NULL))
+					: (atomic_ops_list_insert(&ctx->list, rec, key, NULL));
+			}
+			else if (op < ctx->updates) {
+				found += (ctx->rwlock) ? (bench_rwlock_list_remove(&ctx->rwlock_list, key))
+					: (atomic_ops_list_remove(&ctx->list, rec, key, NULL));
+			}
+			else {
+				found += (ctx->rwlock) ? (bench_rwlock_list_contains(&ctx->rwlock_list, key))
+					: (atomic_ops_list_contains(&ctx->list, rec, key, NULL));
+			}
+		}
+
+		bench_sample(thread, bench_clock() - start);
+		thread->ops += BENCH_SAMPLE_BATCH;
+	}
+
+	atomic_ops_epoch_release(&ctx->domain, rec);
+	bench_sink(found);
+}
+
+static void bench_lists(const bench_config *config) {
+	static const char *names[] = { "harris_list", "rwlock_list" };
+	bench_list_ctx ctx;
+	bench_result result;
+	char params[64];
+
+	for (size_t l = 0; l < 2; l++) {
+		if (!bench_selected(config, names[l])) {
+			continue;
+		}
+
+		for (size_t m = 0; m < (sizeof(bench_list_mixes) / sizeof(bench_list_mixes[0])); m++) {
+			for (size_t threads = 1; threads != 0; threads = bench_next_threads(config, threads)) {
+				ctx.rwlock = (l == 1);
+				ctx.updates = bench_list_mixes[m].updates;
+
+				atomic_ops_epoch_domain_init(&ctx.domain);
+				atomic_ops_list_init(&ctx.list, &ctx.domain);
+				pthread_rwlock_init(&ctx.rwlock_list.lock, NULL);
+				ctx.rwlock_list.head = NULL;
+
+				// Start half full, with every other key
+				atomic_ops_epoch_record *rec = atomic_ops_epoch_acquire(&ctx.domain);
+
+				for (uintptr_t key = 0; key < BENCH_LIST_KEYS; key += 2) {
+					if (ctx.rwlock) {
+						bench_rwlock_list_insert(&ctx.rwlock_list, key, NULL);
+					}
+					else {
+						atomic_ops_list_insert(&ctx.list, rec, key, NULL);
+					}
+				}
+
+				atomic_ops_epoch_release(&ctx.domain, rec);
+
+				bench_run(threads, config->iterations, BENCH_SAMPLE_BATCH, &bench_list_thread, &ctx, &result);
+
+				snprintf(params, sizeof(params), "mix=%s;updates=%u%%;keys=%d", bench_list_mixes[m].name, ctx.updates, BENCH_LIST_KEYS);
+				bench_report("list", names[l], params, threads, &result);
+
+				bench_rwlock_list_destroy(&ctx.rwlock_list);
+				pthread_rwlock_destroy(&ctx.rwlock_list.lock);
+				atomic_ops_list_destroy(&ctx.list);
+				atomic_ops_epoch_domain_destroy(&ctx.domain);
+			}
+		}
+	}
+}
+
+/******************************************************************************/
+
+#define BENCH_HASHMAP_KEYS (1 << 16)
+
+// Baseline: chained hash table behind a reader-writer lock, rehashed all at once when it grows
+typedef struct bench_rwlock_hashmap_node {
+	struct bench_rwlock_hashmap_node *next;
+	uintptr_t key;
+	void *value;
+} bench_rwlock_hashmap_node;
+
+typedef struct bench_rwlock_hashmap {
+	pthread_rwlock_t lock;
+	bench_rwlock_hashmap_node **buckets;
+	size_t mask;
+	size_t count;
+} bench_rwlock_hashmap;
+
+static bool bench_rwlock_hashmap_insert(bench_rwlock_hashmap *map, uintptr_t key, void *value) {
+	bench_rwlock_hashmap_node *node = malloc(sizeof(bench_rwlock_hashmap_node)), *cur;
+	uintptr_t hash = atomic_ops_hashmap_hash(key);
+
+	if (node == NULL) {
+		fprintf(stderr, "Failed to allocate memory for hash map nodes.\n");
+		exit(EXIT_FAILURE);
+	}
+
+	pthread_rwlock_wrlock(&map->lock);
+
+	for (cur = map->buckets[hash & map->mask]; cur != NULL && cur->key != key; cur = cur->next) {
+		;
+	}
+
+	if (cur != NULL) {
+		pthread_rwlock_unlock(&map->lock);
+		free(node);
+		return (false);
+	}
+
+	node->key = key;
+	node->value = value;
+	node->next = map->buckets[hash & map->mask];
+	map->buckets[hash & map->mask] = node;
+
+	if (++map->count / (map->mask + 1) > ATOMIC_OPS_HASHMAP_LOAD_FACTOR) {
+		size_t mask = (map->mask * 2) + 1;
+		bench_rwlock_hashmap_node **buckets = calloc(mask + 1, sizeof(bench_rwlock_hashmap_node *));
+
+		if (buckets == NULL) {
+			fprintf(stderr, "Failed to allocate memory for hash map buckets.\n");
+			exit(EXIT_FAILURE);
+		}
+
+		for (size_t i = 0; i <= map->mask; i++) {
+			while (map->buckets[i] != NULL) {
+				cur = map->buckets[i];
+				map->buckets[i] = cur->next;
+				cur->next = buckets[atomic_ops_hashmap_hash(cur->key) & mask];
+				buckets[atomic_ops_hashmap_hash(cur->key) & mask] = cur;
+			}
+		}
+
+		free(map->buckets);
+		map->buckets = buckets;
+		map->mask = mask;
+	}
+
+	pthread_rwlock_unlock(&map->lock);
+
+	return (true);
+}
+
+static bool bench_rwlock_hashmap_erase(bench_rwlock_hashmap *map, uintptr_t key) {
+	bench_rwlock_hashmap_node *node = NULL, **prev;
+
+	pthread_rwlock_wrlock(&map->lock);
+
+	for (prev = &map->buckets[atomic_ops_hashmap_hash(key) & map->mask]; *prev != NULL && (*prev)->key != key; prev = &(*prev)->next) {
+		;
+	}
+
+	if (*prev != NULL) {
+		node = *prev;
+		*prev = node->next;
+		map->count--;
+	}
+
+	pthread_rwlock_unlock(&map->lock);
+
+	free(node);
+
+	return (node != NULL);
+}
+
+static bool bench_rwlock_hashmap_lookup(bench_rwlock_hashmap *map, uintptr_t key) {
+	bench_rwlock_hashmap_node *node;
+
+	pthread_rwlock_rdlock(&map->lock);
+
+	for (node = map->buckets[atomic_ops_hashmap_hash(key) & map->mask]; node != NULL && node->key != key; node = node->next) {
+		;
+	}
+
+	pthread_rwlock_unlock(&map->lock);
+
+	return (node != NULL);
+}
+
+static void bench_rwlock_hashmap_init(bench_rwlock_hashmap *map) {
+	pthread_rwlock_init(&map->lock, NULL);
+	map->buckets = calloc(1, sizeof(bench_rwlock_hashmap_node *));
+	map->mask = 0;
+	map->count = 0;
+
+	if (map->buckets == NULL) {
+		fprintf(stderr, "Failed to allocate memory for hash map buckets.\n");
+		exit(EXIT_FAILURE);
+	}
+}
+
+static void bench_rwlock_hashmap_destroy(bench_rwlock_hashmap *map) {
+	for (size_t i = 0; i <= map->mask; i++) {
+		while (map->buckets[i] != NULL) {
+			bench_rwlock_hashmap_node *next = map->buckets[i]->next;
+
+			free(map->buckets[i]);
+			map->buckets[i] = next;
+		}
+	}
+
+	free(map->buckets);
+	pthread_rwlock_destroy(&map->lock);
+}
+
+typedef enum {
+	BENCH_HASHMAP_GROW  = 0, // Only inserts of new keys, starting from a single bucket
+	BENCH_HASHMAP_MIXED = 1, // Half full, the mixes of the list suite
+} BENCH_HASHMAP_KIND;
+
+typedef struct bench_hashmap_ctx {
+	bool rwlock;
+	BENCH_HASHMAP_KIND kind;
+	unsigned int updates;
+	atomic_ops_epoch_domain domain;
+	atomic_ops_hashmap map;
+	bench_rwlock_hashmap rwlock_map;
+} bench_hashmap_ctx;
+
+static void bench_hashmap_thread(bench_thread *thread) {
+	bench_hashmap_ctx *ctx = thread->ctx;
+	atomic_ops_epoch_record *rec = atomic_ops_epoch_acquire(&ctx->domain);
+	uintptr_t seed = thread->id * 2654435761u + 1, found = 0;
+
+	if (rec == NULL) {
+		fprintf(stderr, "Failed to acquire epoch record.\n");
+		exit(EXIT_FAILURE);
+	}
+
+	for (size_t done = 0; done < thread->iterations; done += BENCH_SAMPLE_BATCH) {
+		uint64_t start = bench_clock();
+
+		for (size_t i = 0; i < BENCH_SAMPLE_BATCH; i++) {
+			uintptr_t r = bench_random(&seed), key = (r >> 8) % BENCH_HASHMAP_KEYS;
+			unsigned int op = (unsigned int)(r % 100);
+
+			if (ctx->kind == BENCH_HASHMAP_GROW) {
+				key = ((done + i) * thread->threads) + thread->id; // Distinct keys for every thread
+				found += (ctx->rwlock) ? (bench_rwlock_hashmap_insert(&ctx->rwlock_map, key, NULL))
+					: (atomic_ops_hashmap_insert(&ctx->map, rec, key, NULL));
+			}
+			else if (op < ctx->updates / 2) {
+				found += (ctx->rwlock) ? (bench_rwlock_hashmap_insert(&ctx->rwlock_map, key, NULL))
+					: (atomic_ops_hashmap_insert(&ctx->map, rec, key, NULL));
+			}
+			else if (op < ctx->updates) {
+				found += (ctx->rwlock) ? (bench_rwlock_hashmap_erase(&ctx->rwlock_map, key))
+					: (atomic_ops_hashmap_erase(&ctx->map, rec, key, NULL));
+			}
+			else {
+				found += (ctx->rwlock) ? (bench_rwlock_hashmap_lookup(&ctx->rwlock_map, key))
+					: (atomic_ops_hashmap_lookup(&ctx->map, rec, key, NULL));
+			}
+		}
+
+		bench_sample(thread, bench_clock() - start);
+		thread->ops += BENCH_SAMPLE_BATCH;
+	}
+
+	atomic_ops_epoch_release(&ctx->domain, rec);
+	bench_sink(found);
+}
+
+static void bench_hashmaps(const bench_config *config) {
+	static const char *names[] = { "split_ordered_map", "rwlock_map" };
+	bench_hashmap_ctx ctx;
+	bench_result result;
+	char params[64];
+
+	for (size_t h = 0; h < 2; h++) {
+		if (!bench_selected(config, names[h])) {
+			continue;
+		}
+
+		// The grow case first, then every mix of the list suite
+		for (size_t m = 0; m <= (sizeof(bench_list_mixes) / sizeof(bench_list_mixes[0])); m++) {
+			for (size_t threads = 1; threads != 0; threads = bench_next_threads(config, threads)) {
+				ctx.rwlock = (h == 1);
+				ctx.kind = (m == 0) ? (BENCH_HASHMAP_GROW) : (BENCH_HASHMAP_MIXED);
+				ctx.updates = (m == 0) ? (100) : (bench_list_mixes[m - 1].updates);
+
+				atomic_ops_epoch_domain_init(&ctx.domain);
+				bench_rwlock_hashmap_init(&ctx.rwlock_map);
+
+				if (!atomic_ops_hashmap_init(&ctx.map, &ctx.domain, 1)) {
+					fprintf(stderr, "Failed to initialize hash map.\n");
+					exit(EXIT_FAILURE);
+				}
+
+				// Start half full, with every other key
+				if (ctx.kind == BENCH_HASHMAP_MIXED) {
+					atomic_ops_epoch_record *rec = atomic_ops_epoch_acquire(&ctx.domain);
+
+					for (uintptr_t key = 0; key < BENCH_HASHMAP_KEYS; key += 2) {
+						if (ctx.rwlock) {
+							bench_rwlock_hashmap_insert(&ctx.rwlock_map, key, NULL);
+						}
+						else {
+							atomic_ops_hashmap_insert(&ctx.map, rec, key, NULL);
+						}
+					}
+
+					atomic_ops_epoch_release(&ctx.domain, rec);
+				}
+
+				bench_run(threads, config->iterations, BENCH_SAMPLE_BATCH, &bench_hashmap_thread, &ctx, &result);
+
+				if (m == 0) {
+					snprintf(params, sizeof(params), "mix=grow;updates=100%%");
+				}
+				else {
+					snprintf(params, sizeof(params), "mix=%s;updates=%u%%;keys=%d", bench_list_mixes[m - 1].name, ctx.updates, BENCH_HASHMAP_KEYS);
+				}
+
+				bench_report("hashmap", names[h], params, threads, &result);
+
+				atomic_ops_hashmap_destroy(&ctx.map);
+				bench_rwlock_hashmap_destroy(&ctx.rwlock_map);
+				atomic_ops_epoch_domain_destroy(&ctx.domain);
+			}
+		}
+	}
+}
+
+/******************************************************************************/
+
+typedef enum {
+	BENCH_LOCK_TTAS   = 0,
+	BENCH_LOCK_TICKET = 1,
+	BENCH_LOCK_MCS    = 2,
+	BENCH_LOCK_CLH    = 3,
+	BENCH_LOCK_MUTEX  = 4, // pthread_mutex_t, as baseline
+} BENCH_LOCK_KIND;
+
+static const char *bench_lock_names[] = { "ttas", "ticket", "mcs", "clh", "pthread_mutex" };
+
+typedef struct bench_lock_ctx {
+	BENCH_LOCK_KIND kind;
+	atomic_ops_ttas ttas;
+	atomic_ops_ticket ticket;
+	atomic_ops_mcs mcs;
+	atomic_ops_clh clh;
+	pthread_mutex_t mutex;
+	char pad0[BENCH_SLOT_SIZE];
+	// Protected by the lock being measured
+	uint64_t total;
+	uint64_t released; // When the last holder released the lock
+	size_t holder; // Who that was
+} bench_lock_ctx;
+
+// Threads compete until threads * iterations critical sections ran in total;
+// how those were spread over the threads measures fairness. Latency is the
+// handoff time, from a release to the next acquisition by another thread.
+static void bench_lock_thread(bench_thread *thread) {
+	bench_lock_ctx *ctx = thread->ctx;
+	uint64_t goal = (uint64_t)thread->threads * thread->iterations;
+	atomic_ops_mcs_node mcs;
+	atomic_ops_clh_node *clh = atomic_ops_clh_node_create();
+	bool done = false;
+
+	if (clh == NULL) {
+		fprintf(stderr, "Failed to allocate memory for CLH node.\n");
+		exit(EXIT_FAILURE);
+	}
+
+	while (!done) {
+		switch (ctx->kind) {
+			case BENCH_LOCK_TTAS:
+				atomic_ops_ttas_lock(&ctx->ttas);
+				break;
+
+			case BENCH_LOCK_TICKET:
+				atomic_ops_ticket_lock(&ctx->ticket);
+				break;
+
+			case BENCH_LOCK_MCS:
+				atomic_ops_mcs_lock(&ctx->mcs, &mcs);
+				break;
+
+			case BENCH_LOCK_CLH:
+				atomic_ops_clh_lock(&ctx->clh, clh);
+				break;
+
+			default:
+				pthread_mutex_lock(&ctx->mutex);
+				break;
+		}
+
+		uint64_t now = bench_clock();
+
+		if (ctx->total >= goal) {
+			done = true;
+		}
+		else {
+			if (ctx->holder != thread->id && ctx->total != 0) {
+				bench_sample(thread, now - ctx->released);
+			}
+
+			ctx->total++;
+			thread->ops++;
+			ctx->holder = thread->id;
+			ctx->released = bench_clock();
+		}
+
+		switch (ctx->kind) {
+			case BENCH_LOCK_TTAS:
+				atomic_ops_ttas_unlock(&ctx->ttas);
+				break;
+
+			case BENCH_LOCK_TICKET:
+				atomic_ops_ticket_unlock(&ctx->ticket);
+				break;
+
+			case BENCH_LOCK_MCS:
+				atomic_ops_mcs_unlock(&ctx->mcs, &mcs);
+				break;
+
+			case BENCH_LOCK_CLH:
+				clh = atomic_ops_clh_unlock(&ctx->clh, clh);
+				break;
+
+			default:
+				pthread_mutex_unlock(&ctx->mutex);
+				break;
+		}
+	}
+
+	free(clh);
+}
+
+static void bench_locks(const bench_config *config) {
+	bench_lock_ctx ctx;
+	bench_result result;
+	char params[64];
+
+	for (size_t k = 0; k < (sizeof(bench_lock_names) / sizeof(bench_lock_names[0])); k++) {
+		if (!bench_selected(config, bench_lock_names[k])) {
+			continue;
+		}
+
+		for (size_t threads = 1; threads != 0; threads = bench_next_threads(config, threads)) {
+			ctx.kind = (BENCH_LOCK_KIND)k;
+			ctx.total = 0;
+			ctx.released = 0;
+			ctx.holder = 0;
+
+			atomic_ops_ttas_lock_init(&ctx.ttas, ATOMIC_OPS_LOCK_BACKOFF_MIN, ATOMIC_OPS_LOCK_BACKOFF_MAX);
+			atomic_ops_ticket_lock_init(&ctx.ticket);
+			atomic_ops_mcs_lock_init(&ctx.mcs);
+			pthread_mutex_init(&ctx.mutex, NULL);
+
+			if (!atomic_ops_clh_lock_init(&ctx.clh)) {
+				fprintf(stderr, "Failed to initialize CLH lock.\n");
+				exit(EXIT_FAILURE);
+			}
+
+			bench_run(threads, config->iterations, 1, &bench_lock_thread, &ctx, &result);
+
+			snprintf(params, sizeof(params), "ops_min=%llu;ops_max=%llu",
+				(unsigned long long)result.ops_min, (unsigned long long)result.ops_max);
+
+			bench_report("lock", bench_lock_names[k], params, threads, &result);
+
+			atomic_ops_clh_lock_destroy(&ctx.clh);
+			pthread_mutex_destroy(&ctx.mutex);
+		}
+	}
+}
+
+/******************************************************************************/
+
+typedef enum {
+	BENCH_RWLOCK_WRITER  = 0,
+	BENCH_RWLOCK_READER  = 1,
+	BENCH_RWLOCK_PTHREAD = 2, // pthread_rwlock_t, as baseline
+} BENCH_RWLOCK_KIND;
+
+static const char *bench_rwlock_names[] = { "rwlock_writer_pref", "rwlock_reader_pref", "pthread_rwlock" };
+
+// Percentage of operations taking the write side
+static const unsigned int bench_rwlock_writes[] = { 0, 1, 10, 50 };
+
+#define BENCH_RWLOCK_DATA 8 // Words read or written under the lock
+
+typedef struct bench_rwlock_ctx {
+	BENCH_RWLOCK_KIND kind;
+	unsigned int writes;
+	atomic_ops_rwlock lock;
+	pthread_rwlock_t rwlock;
+	char pad0[BENCH_SLOT_SIZE];
+	uintptr_t data[BENCH_RWLOCK_DATA];
+} bench_rwlock_ctx;
+
+static void bench_rwlock_thread(bench_thread *thread) {
+	bench_rwlock_ctx *ctx = thread->ctx;
+	uintptr_t seed = thread->id * 2654435761u + 1, sum = 0;
+
+	for (size_t done = 0; done < thread->iterations; done += BENCH_SAMPLE_BATCH) {
+		uint64_t start = bench_clock();
+
+		for (size_t i = 0; i < BENCH_SAMPLE_BATCH; i++) {
+			bool write = ((bench_random(&seed) >> 8) % 100 < ctx->writes);
+
+			if (write) {
+				if (ctx->kind == BENCH_RWLOCK_PTHREAD) {
+					pthread_rwlock_wrlock(&ctx->rwlock);
+				}
+				else {
+					atomic_ops_rwlock_write_lock(&ctx->lock);
+				}
+
+				for (size_t d = 0; d < BENCH_RWLOCK_DATA; d++) {
+					ctx->data[d]++;
+				}
+
+				if (ctx->kind == BENCH_RWLOCK_PTHREAD) {
+					pthread_rwlock_unlock(&ctx->rwlock);
+				}
+				else {
+					atomic_ops_rwlock_write_unlock(&ctx->lock);
+				}
+			}
+			else {
+				if (ctx->kind == BENCH_RWLOCK_PTHREAD) {
+					pthread_rwlock_rdlock(&ctx->rwlock);
+				}
+				else {
+					atomic_ops_rwlock_read_lock(&ctx->lock);
+				}
+
+				for (size_t d = 0; d < BENCH_RWLOCK_DATA; d++) {
+					sum += ctx->data[d];
+				}
+
+				if (ctx->kind == BENCH_RWLOCK_PTHREAD) {
+					pthread_rwlock_unlock(&ctx->rwlock);
+				}
+				else {
+					atomic_ops_rwlock_read_unlock(&ctx->lock);
+				}
+			}
+		}
+
+		bench_sample(thread, bench_clock() - start);
+		thread->ops += BENCH_SAMPLE_BATCH;
+	}
+
+	bench_sink(sum);
+}
+
+static void bench_rwlocks(const bench_config *config) {
+	bench_rwlock_ctx ctx;
+	bench_result result;
+	char params[64];
+
+	for (size_t k = 0; k < (sizeof(bench_rwlock_names) / sizeof(bench_rwlock_names[0])); k++) {
+		if (!bench_selected(config, bench_rwlock_names[k])) {
+			continue;
+		}
+
+		for (size_t w = 0; w < (sizeof(bench_rwlock_writes) / sizeof(bench_rwlock_writes[0])); w++) {
+			for (size_t threads = 1; threads != 0; threads = bench_next_threads(config, threads)) {
+				ctx.kind = (BENCH_RWLOCK_KIND)k;
+				ctx.writes = bench_rwlock_writes[w];
+				memset(ctx.data, 0, sizeof(ctx.data));
+				pthread_rwlock_init(&ctx.rwlock, NULL);
+
+				if (!atomic_ops_rwlock_init(&ctx.lock, (k == BENCH_RWLOCK_READER) ? (ATOMIC_OPS_RWLOCK_READER) : (ATOMIC_OPS_RWLOCK_WRITER))) {
+					fprintf(stderr, "Failed to initialize rwlock.\n");
+					exit(EXIT_FAILURE);
+				}
+
+				bench_run(threads, config->iterations, BENCH_SAMPLE_BATCH, &bench_rwlock_thread, &ctx, &result);
+
+				snprintf(params, sizeof(params), "reads=%u%%;writes=%u%%;slots=%d", 100 - ctx.writes, ctx.writes, ATOMIC_OPS_RWLOCK_SLOTS);
+
+				bench_report("rwlock", bench_rwlock_names[k], params, threads, &result);
+
+				atomic_ops_rwlock_destroy(&ctx.lock);
+				pthread_rwlock_destroy(&ctx.rwlock);
+			}
+		}
+	}
+}
+
+/******************************************************************************/
+
+// A multi-word record, as published through a seqlock
+typedef struct bench_seqlock_quote {
+	uintptr_t words[8];
+} bench_seqlock_quote;
+
+GEN_atomic_ops_seqlock(bench_seqlock_quote, bench_quote)
+
+static const char *bench_seqlock_names[] = { "seqlock", "rwlock_writer_pref" };
+
+typedef struct bench_seqlock_ctx {
+	bool rwlock;
+	unsigned int writes;
+	atomic_ops_seqlock_bench_quote quote;
+	char pad0[BENCH_SLOT_SIZE];
+	atomic_ops_rwlock lock;
+	bench_seqlock_quote data;
+} bench_seqlock_ctx;
+
+static void bench_seqlock_thread(bench_thread *thread) {
+	bench_seqlock_ctx *ctx = thread->ctx;
+	uintptr_t seed = thread->id * 2654435761u + 1, sum = 0;
+	bench_seqlock_quote q;
+
+	memset(&q, 0, sizeof(q));
+
+	for (size_t done = 0; done < thread->iterations; done += BENCH_SAMPLE_BATCH) {
+		uint64_t start = bench_clock();
+
+		for (size_t i = 0; i < BENCH_SAMPLE_BATCH; i++) {
+			bool write = ((bench_random(&seed) >> 8) % 100 < ctx->writes);
+
+			if (write) {
+				q.words[0]++;
+
+				if (ctx->rwlock) {
+					atomic_ops_rwlock_write_lock(&ctx->lock);
+					ctx->data = q;
+					atomic_ops_rwlock_write_unlock(&ctx->lock);
+				}
+				else {
+					atomic_ops_seqlock_bench_quote_write(&ctx->quote, &q);
+				}
+			}
+			else {
+				if (ctx->rwlock) {
+					atomic_ops_rwlock_read_lock(&ctx->lock);
+					q = ctx->data;
+					atomic_ops_rwlock_read_unlock(&ctx->lock);
+				}
+				else {
+					atomic_ops_seqlock_bench_quote_read(&ctx->quote, &q);
+				}
+
+				sum += q.words[0];
+			}
+		}
+
+		bench_sample(thread, bench_clock() - start);
+		thread->ops += BENCH_SAMPLE_BATCH;
+	}
+
+	bench_sink(sum);
+}
+
+static void bench_seqlocks(const bench_config *config) {
+	bench_seqlock_ctx ctx;
+	bench_result result;
+	char params[64];
+
+	for (size_t k = 0; k < (sizeof(bench_seqlock_names) / sizeof(bench_seqlock_names[0])); k++) {
+		if (!bench_selected(config, bench_seqlock_names[k])) {
+			continue;
+		}
+
+		for (size_t w = 0; w < (sizeof(bench_rwlock_writes) / sizeof(bench_rwlock_writes[0])); w++) {
+			for (size_t threads = 1; threads != 0; threads = bench_next_threads(config, threads)) {
+				ctx.rwlock = (k == 1);
+				ctx.writes = bench_rwlock_writes[w];
+				memset(&ctx.quote.data, 0, sizeof(ctx.quote.data));
+				memset(&ctx.data, 0, sizeof(ctx.data));
+				atomic_ops_seqlock_init(&ctx.quote.lock);
+
+				if (!atomic_ops_rwlock_init(&ctx.lock, ATOMIC_OPS_RWLOCK_WRITER)) {
+					fprintf(stderr, "Failed to initialize rwlock.\n");
+					exit(EXIT_FAILURE);
+				}
+
+				bench_run(threads, config->iterations, BENCH_SAMPLE_BATCH, &bench_seqlock_thread, &ctx, &result);
+
+				snprintf(params, sizeof(params), "reads=%u%%;writes=%u%%;bytes=%zu", 100 - ctx.writes, ctx.writes, sizeof(bench_seqlock_quote));
+
+				bench_report("seqlock", bench_seqlock_names[k], params, threads, &result);
+
+				atomic_ops_rwlock_destroy(&ctx.lock);
+			}
+		}
+	}
+}
+
+/******************************************************************************/
+
+typedef enum {
+	BENCH_COUNTER_SHARED  = 0, // One atomic_ops_uint, incremented by every thread
+	BENCH_COUNTER_STRIPED = 1,
+	BENCH_COUNTER_READ    = 2, // Striped, one thread summing it while the others increment
+} BENCH_COUNTER_KIND;
+
+static const char *bench_counter_names[] = { "shared_inc", "striped_inc", "striped_read" };
+
+typedef struct bench_counter_ctx {
+	BENCH_COUNTER_KIND kind;
+	atomic_ops_uint shared;
+	char pad0[BENCH_SLOT_SIZE];
+	atomic_ops_counter counter;
+} bench_counter_ctx;
+
+static void bench_counter_thread(bench_thread *thread) {
+	bench_counter_ctx *ctx = thread->ctx;
+	uintptr_t sum = 0;
+
+	for (size_t done = 0; done < thread->iterations; done += BENCH_SAMPLE_BATCH) {
+		uint64_t start = bench_clock();
+
+		for (size_t i = 0; i < BENCH_SAMPLE_BATCH; i++) {
+			if (ctx->kind == BENCH_COUNTER_SHARED) {
+				atomic_ops_uint_inc(&ctx->shared, ATOMIC_OPS_FENCE_NONE);
+			}
+			else if (ctx->kind == BENCH_COUNTER_READ && thread->id == 0) {
+				sum += atomic_ops_counter_read(&ctx->counter);
+			}
+			else {
+				atomic_ops_counter_inc(&ctx->counter);
+			}
+		}
+
+		bench_sample(thread, bench_clock() - start);
+		thread->ops += BENCH_SAMPLE_BATCH;
+	}
+
+	bench_sink(sum);
+}
+
+static void bench_counters(const bench_config *config) {
+	bench_counter_ctx ctx;
+	bench_result result;
+	char params[64];
+
+	for (size_t k = 0; k < (sizeof(bench_counter_names) / sizeof(bench_counter_names[0])); k++) {
+		if (!bench_selected(config, bench_counter_names[k])) {
+			continue;
+		}
+
+		for (size_t threads = 1; threads != 0; threads = bench_next_threads(config, threads)) {
+			ctx.kind = (BENCH_COUNTER_KIND)k;
+			atomic_ops_uint_store(&ctx.shared, 0, ATOMIC_OPS_FENCE_NONE);
+
+			if (!atomic_ops_counter_init(&ctx.counter)) {
+				fprintf(stderr, "Failed to initialize counter.\n");
+				exit(EXIT_FAILURE);
+			}
+
+			bench_run(threads, config->iterations, BENCH_SAMPLE_BATCH, &bench_counter_thread, &ctx, &result);
+
+			snprintf(params, sizeof(params), "cells=%d", (k == BENCH_COUNTER_SHARED) ? (1) : (ATOMIC_OPS_COUNTER_CELLS));
+
+			bench_report("counter", bench_counter_names[k], params, threads, &result);
+
+			atomic_ops_counter_destroy(&ctx.counter);
+		}
+	}
+}
+
+/******************************************************************************/
+
+// Every thread increments its own counter: any slowdown with more threads comes from false sharing
+static const char *bench_padded_names[] = { "packed_inc", "padded_inc" };
+
+typedef struct bench_padded_ctx {
+	bool padded;
+	atomic_ops_uint *packed; // Adjacent words, several per line
+	atomic_ops_uint_padded *padded_cells; // One per ATOMIC_OPS_DESTRUCTIVE_SIZE block
+} bench_padded_ctx;
+
+static void bench_padded_thread(bench_thread *thread) {
+	bench_padded_ctx *ctx = thread->ctx;
+
+	for (size_t done = 0; done < thread->iterations; done += BENCH_SAMPLE_BATCH) {
+		uint64_t start = bench_clock();
+
+		for (size_t i = 0; i < BENCH_SAMPLE_BATCH; i++) {
+			if (ctx->padded) {
+				atomic_ops_uint_padded_inc(&ctx->padded_cells[thread->id], ATOMIC_OPS_FENCE_NONE);
+			}
+			else {
+				atomic_ops_uint_inc(&ctx->packed[thread->id], ATOMIC_OPS_FENCE_NONE);
+			}
+		}
+
+		bench_sample(thread, bench_clock() - start);
+		thread->ops += BENCH_SAMPLE_BATCH;
+	}
+}
+
+static void bench_padded(const bench_config *config) {
+	bench_padded_ctx ctx;
+	bench_result result;
+	char params[64];
+
+	ctx.packed = aligned_alloc(ATOMIC_OPS_DESTRUCTIVE_SIZE, config->max_threads * ATOMIC_OPS_DESTRUCTIVE_SIZE);
+	ctx.padded_cells = aligned_alloc(ATOMIC_OPS_DESTRUCTIVE_SIZE, config->max_threads * sizeof(atomic_ops_uint_padded));
+
+	if (ctx.packed == NULL || ctx.padded_cells == NULL) {
+		fprintf(stderr, "Failed to allocate memory for counters.\n");
+		exit(EXIT_FAILURE);
+	}
+
+	for (size_t k = 0; k < 2; k++) {
+		if (!bench_selected(config, bench_padded_names[k])) {
+			continue;
+		}
+
+		for (size_t threads = 1; threads != 0; threads = bench_next_threads(config, threads)) {
+			ctx.padded = (k == 1);
+			memset(ctx.packed, 0, config->max_threads * ATOMIC_OPS_DESTRUCTIVE_SIZE);
+			memset(ctx.padded_cells, 0, config->max_threads * sizeof(atomic_ops_uint_padded));
+
+			bench_run(threads, config->iterations, BENCH_SAMPLE_BATCH, &bench_padded_thread, &ctx, &result);
+
+			snprintf(params, sizeof(params), "stride=%zu", (ctx.padded) ? (sizeof(atomic_ops_uint_padded)) : (sizeof(atomic_ops_uint)));
+
+			bench_report("padded", bench_padded_names[k], params, threads, &result);
+		}
+	}
+
+	free(ctx.packed);
+	free(ctx.padded_cells);
+}
+
+// Threads increment random counters in one big array: narrower counters fit more of it in cache
+#define BENCH_FIXED_SLOTS (1 << 20)
+
+static const char *bench_fixed_names[] = { "u8_inc", "u16_inc", "u32_inc", "uint_inc" };
+static const size_t bench_fixed_sizes[] = { sizeof(atomic_ops_u8), sizeof(atomic_ops_u16), sizeof(atomic_ops_u32), sizeof(atomic_ops_uint) };
+
+typedef struct bench_fixed_ctx {
+	size_t kind; // Index into bench_fixed_names
+	void *slots;
+} bench_fixed_ctx;
+
+static void bench_fixed_thread(bench_thread *thread) {
+	bench_fixed_ctx *ctx = thread->ctx;
+	uintptr_t seed = thread->id + 1;
+
+	for (size_t done = 0; done < thread->iterations; done += BENCH_SAMPLE_BATCH) {
+		uint64_t start = bench_clock();
+
+		for (size_t i = 0; i < BENCH_SAMPLE_BATCH; i++) {
+			size_t slot = (bench_random(&seed) >> 8) % BENCH_FIXED_SLOTS;
+
+			switch (ctx->kind) {
+				case 0:
+					atomic_ops_u8_inc(&((atomic_ops_u8 *)ctx->slots)[slot], ATOMIC_OPS_FENCE_NONE);
+					break;
+
+				case 1:
+					atomic_ops_u16_inc(&((atomic_ops_u16 *)ctx->slots)[slot], ATOMIC_OPS_FENCE_NONE);
+					break;
+
+				case 2:
+					atomic_ops_u32_inc(&((atomic_ops_u32 *)ctx->slots)[slot], ATOMIC_OPS_FENCE_NONE);
+					break;
+
+				default:
+					atomic_ops_uint_inc(&((atomic_ops_uint *)ctx->slots)[slot], ATOMIC_OPS_FENCE_NONE);
+					break;
+			}
+		}
+
+		bench_sample(thread, bench_clock() - start);
+		thread->ops += BENCH_SAMPLE_BATCH;
+	}
+}
+
+static void bench_fixed(const bench_config *config) {
+	bench_fixed_ctx ctx;
+	bench_result result;
+	char params[64];
+
+	ctx.slots = aligned_alloc(ATOMIC_OPS_CACHELINE_SIZE, BENCH_FIXED_SLOTS * sizeof(atomic_ops_uint));
+
+	if (ctx.slots == NULL) {
+		fprintf(stderr, "Failed to allocate memory for counters.\n");
+		exit(EXIT_FAILURE);
+	}
+
+	for (size_t k = 0; k < 4; k++) {
+		if (!bench_selected(config, bench_fixed_names[k])) {
+			continue;
+		}
+
+		for (size_t threads = 1; threads != 0; threads = bench_next_threads(config, threads)) {
+			ctx.kind = k;
+			memset(ctx.slots, 0, BENCH_FIXED_SLOTS * bench_fixed_sizes[k]);
+
+			bench_run(threads, config->iterations, BENCH_SAMPLE_BATCH, &bench_fixed_thread, &ctx, &result);
+
+			snprintf(params, sizeof(params), "slots=%d;bytes=%zu", BENCH_FIXED_SLOTS, BENCH_FIXED_SLOTS * bench_fixed_sizes[k]);
+
+			bench_report("fixed", bench_fixed_names[k], params, threads, &result);
+		}
+	}
+
+	free(ctx.slots);
+}
+
+// Alloc+free pairs on a bitmap filled to some level from the start: the summary skips over the full words
+#define BENCH_BITMAP_IDS (1 << 16)
+
+static const char *bench_bitmap_names[] = { "alloc", "alloc_near" };
+static const unsigned int bench_bitmap_fills[] = { 0, 90, 99 };
+
+typedef struct bench_bitmap_ctx {
+	bool near; // Each thread allocates near a random hint, instead of the lowest free ID
+	atomic_ops_bitmap bitmap;
+} bench_bitmap_ctx;
+
+static void bench_bitmap_thread(bench_thread *thread) {
+	bench_bitmap_ctx *ctx = thread->ctx;
+	uintptr_t seed = thread->id + 1;
+
+	for (size_t done = 0; done < thread->iterations; done += BENCH_SAMPLE_BATCH) {
+		uint64_t start = bench_clock();
+
+		for (size_t i = 0; i < BENCH_SAMPLE_BATCH; i++) {
+			size_t id;
+			bool ok;
+
+			if (ctx->near) {
+				ok = atomic_ops_bitmap_alloc_near(&ctx->bitmap, (bench_random(&seed) >> 8) % BENCH_BITMAP_IDS, &id);
+			}
+			else {
+				ok = atomic_ops_bitmap_alloc(&ctx->bitmap, &id);
+			}
+
+			if (ok) {
+				atomic_ops_bitmap_free(&ctx->bitmap, id);
+			}
+		}
+
+		bench_sample(thread, bench_clock() - start);
+		thread->ops += BENCH_SAMPLE_BATCH;
+	}
+}
+
+static void bench_bitmaps(const bench_config *config) {
+	bench_bitmap_ctx ctx;
+	bench_result result;
+	char params[64];
+
+	for (size_t k = 0; k < (sizeof(bench_bitmap_names) / sizeof(bench_bitmap_names[0])); k++) {
+		if (!bench_selected(config, bench_bitmap_names[k])) {
+			continue;
+		}
+
+		for (size_t f = 0; f < (sizeof(bench_bitmap_fills) / sizeof(bench_bitmap_fills[0])); f++) {
+			for (size_t threads = 1; threads != 0; threads = bench_next_threads(config, threads)) {
+				size_t id;
+
+				ctx.near = (k == 1);
+
+				if (!atomic_ops_bitmap_init(&ctx.bitmap, BENCH_BITMAP_IDS)) {
+					fprintf(stderr, "Failed to initialize bitmap.\n");
+					exit(EXIT_FAILURE);
+				}
+
+				for (size_t i = 0; i < ((size_t)BENCH_BITMAP_IDS * bench_bitmap_fills[f]) / 100; i++) {
+					atomic_ops_bitmap_alloc(&ctx.bitmap, &id);
+				}
+
+				bench_run(threads, config->iterations, BENCH_SAMPLE_BATCH, &bench_bitmap_thread, &ctx, &result);
+
+				snprintf(params, sizeof(params), "fill=%u%%;ids=%d", bench_bitmap_fills[f], BENCH_BITMAP_IDS);
+
+				bench_report("bitmap", bench_bitmap_names[k], params, threads, &result);
+
+				atomic_ops_bitmap_destroy(&ctx.bitmap);
+			}
+		}
+	}
+}
+
+/******************************************************************************/
+
+// High-water mark raised by every thread with rising values: most calls find it already higher
+static const char *bench_minmax_names[] = { "fetch_max", "cas_loop_max" };
+
+typedef struct bench_minmax_ctx {
+	bool cas_loop;
+	atomic_ops_uint high;
+} bench_minmax_ctx;
+
+// What fetch_max would be without its early exit: always CAS, even to write back the same value
+static inline uintptr_t bench_cas_loop_max(atomic_ops_uint *atomic, uintptr_t val) {
+	uintptr_t oldval = atomic_ops_uint_load(atomic, ATOMIC_OPS_FENCE_NONE);
+	uintptr_t prev;
+
+	while ((prev = atomic_ops_uint_casr(atomic, oldval, (val > oldval) ? (val) : (oldval), ATOMIC_OPS_FENCE_NONE)) != oldval) {
+		oldval = prev;
+	}
+
+	return (oldval);
+}
+
+static void bench_minmax_thread(bench_thread *thread) {
+	bench_minmax_ctx *ctx = thread->ctx;
+	uintptr_t sum = 0;
+
+	for (size_t done = 0; done < thread->iterations; done += BENCH_SAMPLE_BATCH) {
+		uint64_t start = bench_clock();
+
+		for (size_t i = 0; i < BENCH_SAMPLE_BATCH; i++) {
+			if (ctx->cas_loop) {
+				sum += bench_cas_loop_max(&ctx->high, done + i);
+			}
+			else {
+				sum += atomic_ops_uint_fetch_max(&ctx->high, done + i, ATOMIC_OPS_FENCE_NONE);
+			}
+		}
+
+		bench_sample(thread, bench_clock() - start);
+		thread->ops += BENCH_SAMPLE_BATCH;
+	}
+
+	bench_sink(sum);
+}
+
+static void bench_minmax(const bench_config *config) {
+	bench_minmax_ctx ctx;
+	bench_result result;
+
+	for (size_t k = 0; k < (sizeof(bench_minmax_names) / sizeof(bench_minmax_names[0])); k++) {
+		if (!bench_selected(config, bench_minmax_names[k])) {
+			continue;
+		}
+
+		for (size_t threads = 1; threads != 0; threads = bench_next_threads(config, threads)) {
+			ctx.cas_loop = (k == 1);
+			atomic_ops_uint_store(&ctx.high, 0, ATOMIC_OPS_FENCE_NONE);
+
+			bench_run(threads, config->iterations, BENCH_SAMPLE_BATCH, &bench_minmax_thread, &ctx, &result);
+
+			bench_report("minmax", bench_minmax_names[k], "values=rising", threads, &result);
+		}
+	}
+}
+
+/******************************************************************************/
+
+// Samples into a shared histogram: one atomic add each, or buffered per thread and flushed in batches
+static const char *bench_histogram_names[] = { "direct", "batched" };
+static const size_t bench_histogram_sizes[] = { ATOMIC_OPS_HISTOGRAM_DENSE, ATOMIC_OPS_HISTOGRAM_DENSE * 16 };
+static const char *bench_histogram_dists[] = { "uniform", "skewed" };
+
+#define BENCH_HISTOGRAM_HOT 32 // Skewed: buckets getting 90% of the samples
+
+typedef struct bench_histogram_ctx {
+	bool batched;
+	bool skewed;
+	atomic_ops_histogram hist;
+} bench_histogram_ctx;
+
+static void bench_histogram_thread(bench_thread *thread) {
+	bench_histogram_ctx *ctx = thread->ctx;
+	atomic_ops_histogram_local local;
+	uintptr_t seed = thread->id + 1;
+
+	if (ctx->batched && !atomic_ops_histogram_local_init(&local, &ctx->hist)) {
+		fprintf(stderr, "Failed to initialize local histogram.\n");
+		exit(EXIT_FAILURE);
+	}
+
+	for (size_t done = 0; done < thread->iterations; done += BENCH_SAMPLE_BATCH) {
+		uint64_t start = bench_clock();
+
+		for (size_t i = 0; i < BENCH_SAMPLE_BATCH; i++) {
+			uintptr_t r = bench_random(&seed) >> 8;
+			size_t bucket = r % ctx->hist.size;
+
+			if (ctx->skewed && (r % 10) != 0) {
+				bucket = (r / 10) % BENCH_HISTOGRAM_HOT;
+			}
+
+			if (ctx->batched) {
+				atomic_ops_histogram_inc(&local, bucket);
+			}
+			else {
+				atomic_ops_uint_inc(&ctx->hist.buckets[bucket], ATOMIC_OPS_FENCE_NONE);
+			}
+		}
+
+		bench_sample(thread, bench_clock() - start);
+		thread->ops += BENCH_SAMPLE_BATCH;
+	}
+
+	if (ctx->batched) {
+		atomic_ops_histogram_local_destroy(&local);
+	}
+}
+
+static void bench_histograms(const bench_config *config) {
+	bench_histogram_ctx ctx;
+	bench_result result;
+	char params[64];
+
+	for (size_t k = 0; k < (sizeof(bench_histogram_names) / sizeof(bench_histogram_names[0])); k++) {
+		if (!bench_selected(config, bench_histogram_names[k])) {
+			continue;
+		}
+
+		for (size_t b = 0; b < (sizeof(bench_histogram_sizes) / sizeof(bench_histogram_sizes[0])); b++) {
+			for (size_t d = 0; d < (sizeof(bench_histogram_dists) / sizeof(bench_histogram_dists[0])); d++) {
+				for (size_t threads = 1; threads != 0; threads = bench_next_threads(config, threads)) {
+					ctx.batched = (k == 1);
+					ctx.skewed = (d == 1);
+
+					if (!atomic_ops_histogram_init(&ctx.hist, bench_histogram_sizes[b])) {
+						fprintf(stderr, "Failed to initialize histogram.\n");
+						exit(EXIT_FAILURE);
+					}
+
+					bench_run(threads, config->iterations, BENCH_SAMPLE_BATCH, &bench_histogram_thread, &ctx, &result);
+
+					snprintf(params, sizeof(params), "buckets=%zu;dist=%s", bench_histogram_sizes[b], bench_histogram_dists[d]);
+
+					bench_report("histogram", bench_histogram_names[k], params, threads, &result);
+
+					atomic_ops_histogram_destroy(&ctx.hist);
+				}
+			}
+		}
+	}
+}
+
+/******************************************************************************/
+
+// Sequential structures shared by all threads: flat combining against a pthread mutex
+typedef enum {
+	BENCH_COMBINER_COUNTER_FC    = 0,
+	BENCH_COMBINER_COUNTER_MUTEX = 1,
+	BENCH_COMBINER_PQ_FC         = 2, // Push then pop of a random key
+	BENCH_COMBINER_PQ_MUTEX      = 3,
+} BENCH_COMBINER_KIND;
+
+static const char *bench_combiner_names[] = { "counter_combined", "counter_mutex", "pq_combined", "pq_mutex" };
+
+#define BENCH_COMBINER_PQ_PREFILL 1024
+
+typedef struct bench_combiner_ctx {
+	BENCH_COMBINER_KIND kind;
+	atomic_ops_combiner_counter counter;
+	atomic_ops_combiner_pq pq; // Its heap is used directly, under the mutex, by the mutex cases
+	pthread_mutex_t mutex;
+	char pad0[BENCH_SLOT_SIZE];
+	uintptr_t value; // Protected by the mutex
+} bench_combiner_ctx;
+
+static void bench_combiner_thread(bench_thread *thread) {
+	bench_combiner_ctx *ctx = thread->ctx;
+	atomic_ops_combiner_record *rec = NULL;
+	uintptr_t seed = thread->id + 1, sum = 0, key;
+	void *value;
+
+	if (ctx->kind == BENCH_COMBINER_COUNTER_FC) {
+		rec = atomic_ops_combiner_acquire(&ctx->counter.combiner);
+	}
+	else if (ctx->kind == BENCH_COMBINER_PQ_FC) {
+		rec = atomic_ops_combiner_acquire(&ctx->pq.combiner);
+	}
+
+	if ((ctx->kind == BENCH_COMBINER_COUNTER_FC || ctx->kind == BENCH_COMBINER_PQ_FC) && rec == NULL) {
+		fprintf(stderr, "Failed to allocate memory for combiner record.\n");
+		exit(EXIT_FAILURE);
+	}
+
+	for (size_t done = 0; done < thread->iterations; done += BENCH_SAMPLE_BATCH) {
+		uint64_t start = bench_clock();
+
+		for (size_t i = 0; i < BENCH_SAMPLE_BATCH; i++) {
+			switch (ctx->kind) {
+				case BENCH_COMBINER_COUNTER_FC:
+					sum += atomic_ops_combiner_counter_fetch_and_add(&ctx->counter, rec, 1);
+					break;
+
+				case BENCH_COMBINER_COUNTER_MUTEX:
+					pthread_mutex_lock(&ctx->mutex);
+					sum += ctx->value++;
+					pthread_mutex_unlock(&ctx->mutex);
+					break;
+
+				case BENCH_COMBINER_PQ_FC:
+					key = bench_random(&seed) >> 8;
+					atomic_ops_combiner_pq_push(&ctx->pq, rec, key, NULL);
+					atomic_ops_combiner_pq_pop(&ctx->pq, rec, &key, &value);
+					sum += key;
+					break;
+
+				default:
+					key = bench_random(&seed) >> 8;
+					pthread_mutex_lock(&ctx->mutex);
+					atomic_ops_combiner_pq_heap_push(&ctx->pq, key, NULL);
+					pthread_mutex_unlock(&ctx->mutex);
+					pthread_mutex_lock(&ctx->mutex);
+					atomic_ops_combiner_pq_heap_pop(&ctx->pq, &key, &value);
+					pthread_mutex_unlock(&ctx->mutex);
+					sum += key;
+					break;
+			}
+		}
+
+		bench_sample(thread, bench_clock() - start);
+		thread->ops += BENCH_SAMPLE_BATCH;
+	}
+
+	bench_sink(sum);
+}
+
+static void bench_combiners(const bench_config *config) {
+	bench_combiner_ctx ctx;
+	bench_result result;
+	char params[64];
+
+	for (size_t k = 0; k < (sizeof(bench_combiner_names) / sizeof(bench_combiner_names[0])); k++) {
+		if (!bench_selected(config, bench_combiner_names[k])) {
+			continue;
+		}
+
+		for (size_t threads = 1; threads != 0; threads = bench_next_threads(config, threads)) {
+			uintptr_t seed = 42;
+
+			ctx.kind = (BENCH_COMBINER_KIND)k;
+			ctx.value = 0;
+			pthread_mutex_init(&ctx.mutex, NULL);
+			atomic_ops_combiner_counter_init(&ctx.counter, 0);
+			atomic_ops_combiner_pq_init(&ctx.pq);
+
+			for (size_t i = 0; i < BENCH_COMBINER_PQ_PREFILL; i++) {
+				if (!atomic_ops_combiner_pq_heap_push(&ctx.pq, bench_random(&seed) >> 8, NULL)) {
+					fprintf(stderr, "Failed to allocate memory for priority queue.\n");
+					exit(EXIT_FAILURE);
+				}
+			}
+
+			bench_run(threads, config->iterations, BENCH_SAMPLE_BATCH, &bench_combiner_thread, &ctx, &result);
+
+			if (k == BENCH_COMBINER_PQ_FC || k == BENCH_COMBINER_PQ_MUTEX) {
+				snprintf(params, sizeof(params), "prefill=%d", BENCH_COMBINER_PQ_PREFILL);
+			}
+			else {
+				snprintf(params, sizeof(params), "batch=%d", (k == BENCH_COMBINER_COUNTER_FC) ? (ATOMIC_OPS_COMBINER_BATCH) : (1));
+			}
+
+			bench_report("combiner", bench_combiner_names[k], params, threads, &result);
+
+			atomic_ops_combiner_pq_destroy(&ctx.pq);
+			atomic_ops_combiner_counter_destroy(&ctx.counter);
+			pthread_mutex_destroy(&ctx.mutex);
+		}
+	}
+}
+
+/******************************************************************************/
+
+// Every thread pushes a node and pops one, as object pools do: plain Treiber stack against elimination
+static const char *bench_stack_names[] = { "treiber", "elimination" };
+
+#define BENCH_STACK_NODES 16 // Per thread
+
+typedef struct bench_stack_ctx {
+	bool eliminate;
+	atomic_ops_stack stack;
+	atomic_ops_stack_node *nodes;
+} bench_stack_ctx;
+
+// What the stack does without its elimination array: retry the CAS right away
+static inline void bench_treiber_push(atomic_ops_stack *stack, atomic_ops_stack_node *node) {
+	atomic_ops_dptr_val top = atomic_ops_dptr_load(&stack->top, ATOMIC_OPS_FENCE_NONE), newtop;
+
+	while (true) {
+		node->next = (atomic_ops_stack_node *)top.lo;
+		newtop.lo = (uintptr_t)node;
+		newtop.hi = top.hi + 1;
+
+		if (atomic_ops_dptr_cas(&stack->top, top, newtop, ATOMIC_OPS_FENCE_RELEASE)) {
+			return;
+		}
+
+		top = atomic_ops_dptr_load(&stack->top, ATOMIC_OPS_FENCE_NONE);
+	}
+}
+
+static inline atomic_ops_stack_node * bench_treiber_pop(atomic_ops_stack *stack) {
+	atomic_ops_dptr_val top = atomic_ops_dptr_load(&stack->top, ATOMIC_OPS_FENCE_ACQUIRE), newtop;
+
+	while (top.lo != 0) {
+		newtop.lo = (uintptr_t)((volatile atomic_ops_stack_node *)top.lo)->next;
+		newtop.hi = top.hi + 1;
+
+		if (atomic_ops_dptr_cas(&stack->top, top, newtop, ATOMIC_OPS_FENCE_ACQUIRE)) {
+			return ((atomic_ops_stack_node *)top.lo);
+		}
+
+		top = atomic_ops_dptr_load(&stack->top, ATOMIC_OPS_FENCE_ACQUIRE);
+	}
+
+	return (NULL);
+}
+
+static void bench_stack_thread(bench_thread *thread) {
+	bench_stack_ctx *ctx = thread->ctx;
+	atomic_ops_stack_node *held[BENCH_STACK_NODES * 2];
+	size_t count = 0;
+
+	for (size_t i = 0; i < BENCH_STACK_NODES; i++) {
+		held[count++] = &ctx->nodes[thread->id * BENCH_STACK_NODES + i];
+	}
+
+	for (size_t done = 0; done < thread->iterations; done += BENCH_SAMPLE_BATCH) {
+		uint64_t start = bench_clock();
+
+		for (size_t i = 0; i < BENCH_SAMPLE_BATCH; i++) {
+			atomic_ops_stack_node *node;
+
+			// Keep the pool of each thread about the same size, so that it never overflows held
+			if (count > 0) {
+				if (ctx->eliminate) {
+					atomic_ops_stack_push(&ctx->stack, held[--count]);
+				}
+				else {
+					bench_treiber_push(&ctx->stack, held[--count]);
+				}
+			}
+
+			if (count < BENCH_STACK_NODES * 2) {
+				node = (ctx->eliminate) ? (atomic_ops_stack_pop(&ctx->stack)) : (bench_treiber_pop(&ctx->stack));
+
+				if (node != NULL) {
+					held[count++] = node;
+				}
+			}
+		}
+
+		bench_sample(thread, bench_clock() - start);
+		thread->ops += BENCH_SAMPLE_BATCH;
+	}
+}
+
+static void bench_stacks(const bench_config *config) {
+	bench_stack_ctx ctx;
+	bench_result result;
+	char params[64];
+
+	ctx.nodes = malloc(config->max_threads * BENCH_STACK_NODES * sizeof(atomic_ops_stack_node));
+
+	if (ctx.nodes == NULL) {
+		fprintf(stderr, "Failed to allocate memory for stack nodes.\n");
+		exit(EXIT_FAILURE);
+	}
+
+	for (size_t k = 0; k < (sizeof(bench_stack_names) / sizeof(bench_stack_names[0])); k++) {
+		if (!bench_selected(config, bench_stack_names[k])) {
+			continue;
+		}
+
+		for (size_t threads = 1; threads != 0; threads = bench_next_threads(config, threads)) {
+			ctx.eliminate = (k == 1);
+			atomic_ops_stack_init(&ctx.stack);
+
+			bench_run(threads, config->iterations, BENCH_SAMPLE_BATCH, &bench_stack_thread, &ctx, &result);
+
+			snprintf(params, sizeof(params), "op=push_pop;slots=%d", (k == 1) ? (ATOMIC_OPS_STACK_SLOTS) : (0));
+
+			bench_report("stack", bench_stack_names[k], params, threads, &result);
+		}
+	}
+
+	free(ctx.nodes);
+}
+
+/******************************************************************************/
+
+// All threads updating one word through CAS loops: one case per backoff policy (in ATOMIC_OPS_EMU_BACKOFF_* order), then the library's own
+static const char *bench_backoff_names[] = { "cas_loop_none", "cas_loop_exp", "cas_loop_rand", "fetch_and_xor" };
+static const char *bench_backoff_policies[] = { "none", "exp", "rand" };
+
+typedef struct bench_backoff_ctx {
+	int policy;
+	bool emulated;
+	atomic_ops_uint word;
+} bench_backoff_ctx;
+
+// EMU_GEN_atomic_ops_fetch_and_add_by_cas, with the policy picked at run time
+static inline uintptr_t bench_backoff_fetch_and_add(atomic_ops_uint *atomic, uintptr_t val, int policy) {
+	atomic_ops_emu_backoff backoff = ATOMIC_OPS_EMU_BACKOFF_INIT;
+
+	while (true) {
+		uintptr_t oldval = atomic_ops_uint_load(atomic, ATOMIC_OPS_FENCE_NONE);
+
+		if (atomic_ops_uint_cas(atomic, oldval, oldval + val, ATOMIC_OPS_FENCE_NONE)) {
+			return (oldval);
+		}
+
+		atomic_ops_emu_backoff_policy(&backoff, policy);
+	}
+}
+
+static void bench_backoff_thread(bench_thread *thread) {
+	bench_backoff_ctx *ctx = thread->ctx;
+	uintptr_t sum = 0;
+
+	for (size_t done = 0; done < thread->iterations; done += BENCH_SAMPLE_BATCH) {
+		uint64_t start = bench_clock();
+
+		for (size_t i = 0; i < BENCH_SAMPLE_BATCH; i++) {
+			if (ctx->emulated) {
+				// Emulated by a CAS loop on most CPUs, backing off as compiled in
+				sum += atomic_ops_uint_fetch_and_xor(&ctx->word, done + i, ATOMIC_OPS_FENCE_NONE);
+			}
+			else {
+				sum += bench_backoff_fetch_and_add(&ctx->word, 1, ctx->policy);
+			}
+		}
+
+		bench_sample(thread, bench_clock() - start);
+		thread->ops += BENCH_SAMPLE_BATCH;
+	}
+
+	bench_sink(sum);
+}
+
+static void bench_backoffs(const bench_config *config) {
+	bench_backoff_ctx ctx;
+	bench_result result;
+	char params[64];
+
+	for (size_t k = 0; k < (sizeof(bench_backoff_names) / sizeof(bench_backoff_names[0])); k++) {
+		if (!bench_selected(config, bench_backoff_names[k])) {
+			continue;
+		}
+
+		for (size_t threads = 1; threads != 0; threads = bench_next_threads(config, threads)) {
+			ctx.emulated = (k == 3);
+			ctx.policy = (ctx.emulated) ? (ATOMIC_OPS_EMU_BACKOFF) : ((int)k);
+			atomic_ops_uint_store(&ctx.word, 0, ATOMIC_OPS_FENCE_NONE);
+
+			bench_run(threads, config->iterations, BENCH_SAMPLE_BATCH, &bench_backoff_thread, &ctx, &result);
+
+			snprintf(params, sizeof(params), "policy=%s;max=%d", bench_backoff_policies[ctx.policy], ATOMIC_OPS_EMU_BACKOFF_MAX);
+
+			bench_report("backoff", bench_backoff_names[k], params, threads, &result);
+		}
+	}
+}
+
+/******************************************************************************/
+
+// One thread allocates objects and hands them through an SPSC ring to another, which frees them
+static const char *bench_slab_names[] = { "malloc", "slab", "slab_bulk" };
+
+#define BENCH_SLAB_OBJECT 64
+
+typedef struct bench_slab_ctx {
+	size_t kind;
+	atomic_ops_spsc_ring ring;
+	atomic_ops_slab_pool pool;
+} bench_slab_ctx;
+
+static void bench_slab_thread(bench_thread *thread) {
+	bench_slab_ctx *ctx = thread->ctx;
+	bool producer = (thread->id == 0);
+	atomic_ops_slab_cache cache;
+
+	atomic_ops_slab_cache_init(&cache, &ctx->pool);
+
+	for (size_t done = 0; done < thread->iterations; ) {
+		size_t n = ((thread->iterations - done) < BENCH_SAMPLE_BATCH) ? (thread->iterations - done) : (BENCH_SAMPLE_BATCH);
+		uint64_t start = bench_clock();
+
+		for (size_t i = 0; i < n; ) {
+			void **objs;
+			size_t res;
+
+			if (producer) {
+				objs = atomic_ops_spsc_ring_reserve(&ctx->ring, n - i, &res);
+
+				if (ctx->kind == 2) {
+					atomic_ops_slab_alloc_bulk(&cache, objs, res);
+				}
+
+				for (size_t j = 0; j < res; j++) {
+					if (ctx->kind == 0) {
+						objs[j] = malloc(BENCH_SLAB_OBJECT);
+					}
+					else if (ctx->kind == 1) {
+						objs[j] = atomic_ops_slab_alloc(&cache);
+					}
+
+					// Touch the object, as a real producer fills it in
+					*(uintptr_t *)objs[j] = done + i + j;
+				}
+
+				atomic_ops_spsc_ring_commit(&ctx->ring, res);
+			}
+			else {
+				objs = atomic_ops_spsc_ring_peek(&ctx->ring, n - i, &res);
+
+				for (size_t j = 0; j < res; j++) {
+					bench_sink(*(uintptr_t *)objs[j]);
+
+					if (ctx->kind == 0) {
+						free(objs[j]);
+					}
+					else if (ctx->kind == 1) {
+						atomic_ops_slab_free(&cache, objs[j]);
+					}
+				}
+
+				if (ctx->kind == 2) {
+					atomic_ops_slab_free_bulk(&cache, objs, res);
+				}
+
+				atomic_ops_spsc_ring_consume(&ctx->ring, res);
+			}
+
+			if (res == 0) {
+				atomic_ops_pause();
+			}
+
+			i += res;
+		}
+
+		bench_sample(thread, bench_clock() - start);
+		done += n;
+	}
+
+	if (!producer) {
+		thread->ops = thread->iterations;
+	}
+
+	atomic_ops_slab_cache_destroy(&cache);
+}
+
+static void bench_slabs(const bench_config *config) {
+	bench_slab_ctx ctx;
+	bench_result result;
+
+	if (config->max_threads < 2) {
+		return;
+	}
+
+	for (size_t k = 0; k < (sizeof(bench_slab_names) / sizeof(bench_slab_names[0])); k++) {
+		if (!bench_selected(config, bench_slab_names[k])) {
+			continue;
+		}
+
+		if (!atomic_ops_spsc_ring_init(&ctx.ring, BENCH_QUEUE_CAPACITY, sizeof(void *))
+			|| !atomic_ops_slab_pool_init(&ctx.pool, BENCH_SLAB_OBJECT)) {
+			fprintf(stderr, "Failed to initialize slab benchmark.\n");
+			exit(EXIT_FAILURE);
+		}
+
+		ctx.kind = k;
+
+		bench_run(2, config->iterations, BENCH_SAMPLE_BATCH, &bench_slab_thread, &ctx, &result);
+		bench_report("slab", bench_slab_names[k], "producers=1;consumers=1;size=" BENCH_STRINGIFY(BENCH_SLAB_OBJECT) ";capacity=" BENCH_STRINGIFY(BENCH_QUEUE_CAPACITY), 2, &result);
+
+		atomic_ops_slab_pool_destroy(&ctx.pool);
+		atomic_ops_spsc_ring_destroy(&ctx.ring);
+	}
+}
+
+/******************************************************************************/
+
+static const struct {
+	const char *name;
+	void (*run)(const bench_config *config);
+} bench_suites[] = {
+	{ "primitives", &bench_primitives },
+	{ "mpmc_queue", &bench_queues },
+	{ "spsc_ring",  &bench_rings },
+	{ "hazard",     &bench_hazard },
+	{ "epoch",      &bench_epoch },
+	{ "list",       &bench_lists },
+	{ "hashmap",    &bench_hashmaps },
+	{ "lock",       &bench_locks },
+	{ "rwlock",     &bench_rwlocks },
+	{ "seqlock",    &bench_seqlocks },
+	{ "counter",    &bench_counters },
+	{ "padded",     &bench_padded },
+	{ "fixed",      &bench_fixed },
+	{ "bitmap",     &bench_bitmaps },
+	{ "minmax",     &bench_minmax },
+	{ "histogram",  &bench_histograms },
+	{ "combiner",   &bench_combiners },
+	{ "stack",      &bench_stacks },
+	{ "backoff",    &bench_backoffs },
+	{ "slab",       &bench_slabs },
+};
+
+static void bench_usage(const char *prog) {
+	fprintf(stderr, "Usage: %s [-t max_threads] [-i iterations] [-f case_filter] [suite ...]\n", prog);
+	fprintf(stderr, "Suites:");
+
+	for (size_t i = 0; i < (sizeof(bench_suites) / sizeof(bench_suites[0])); i++) {
+		fprintf(stderr, " %s", bench_suites[i].name);
+	}
+
+	fprintf(stderr, "\n");
+}
+
+int main(int argc, char *argv[]) {
+	bench_config config;
+	int opt;
+
+	long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+	config.max_threads = (cpus > 0) ? ((size_t)cpus) : (1);
+	config.iterations = BENCH_DEFAULT_ITERATIONS;
+	config.filter = NULL;
+
+	while ((opt = getopt(argc, argv, "t:i:f:h")) != -1) {
+		switch (opt) {
+			case 't':
+				config.max_threads = strtoul(optarg, NULL, 0);
+				break;
+
+			case 'i':
+				config.iterations = strtoul(optarg, NULL, 0);
+				break;
+
+			case 'f':
+				config.filter = optarg;
+				break;
+
+			default:
+				bench_usage(argv[0]);
+				return ((opt == 'h') ? (EXIT_SUCCESS) : (EXIT_FAILURE));
+		}
+	}
+
+	if (config.max_threads == 0 || config.iterations == 0) {
+		bench_usage(argv[0]);
+		return (EXIT_FAILURE);
+	}
+
+	bench_calibrate();
+
+	printf("suite,impl,case,config,threads,ops,seconds,ops_per_sec,p50_ns,p99_ns,p999_ns\n");
+
+	for (size_t i = 0; i < (sizeof(bench_suites) / sizeof(bench_suites[0])); i++) {
+		bool run = (optind == argc);
+
+		for (int a = optind; a < argc; a++) {
+			if (strcmp(argv[a], bench_suites[i].name) == 0) {
+				run = true;
+			}
+		}
+
+		if (run) {
+			bench_suites[i].run(&config);
+		}
+	}
+
+	return (EXIT_SUCCESS);
+}
@@ -0,0 +1,279 @@
+/**
+ * This file is part of the atomic_ops project.
+ *
+ * For the full copyright and license information, please view the COPYING
+ * file that was distributed with this source code.
+ *
+ * @copyright  (c) the atomic_ops project
+ * @author     Luca Longinotti <chtekk@longitekk.com>
+ * @license    BSD 2-clause
+ * @version    $Id$
+ */
+
+#include "atomic_ops.hpp"
+#include <algorithm>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+
+/*
+ * Parity benchmark for the C++ front-end: every operation is run, on a single
+ * thread, as a call to the C function with a literal fence (c_literal), as
+ * the same call through atomic_ops::atomic<T> (cpp_template), and as the C
+ * call with the fence only known at run-time (c_runtime_fence). The first two
+ * must match, the third shows what the template argument saves.
+ * Output uses the same CSV columns as atomic_ops_bench.c.
+ */
+
+#define BENCH_DEFAULT_ITERATIONS (1 << 22)
+#define BENCH_SAMPLE_BATCH 16 // Operations timed together to produce one latency sample
+
+#if defined(SYSTEM_CPU_X86_64)
+	#define BENCH_IMPL "x86-64"
+#elif defined(SYSTEM_CPU_SPARCV9)
+	#define BENCH_IMPL "sparcv9"
+#elif defined(SYSTEM_CPU_AARCH64) && defined(__ARM_FEATURE_ATOMICS)
+	#define BENCH_IMPL "aarch64-lse"
+#elif defined(SYSTEM_CPU_AARCH64)
+	#define BENCH_IMPL "aarch64"
+#elif defined(SYSTEM_CPU_ARM)
+	#define BENCH_IMPL "armv7"
+#elif defined(__ATOMIC_RELAXED) && !defined(ATOMIC_OPS_SYNC_INTRINSICS)
+	#define BENCH_IMPL "atomic_intrinsics"
+#elif defined(SYSTEM_CPU_IA64)
+	#define BENCH_IMPL "ia64"
+#elif defined(SYSTEM_CPU_PPC)
+	#define BENCH_IMPL "ppc"
+#else
+	#define BENCH_IMPL "sync_intrinsics"
+#endif
+
+static double bench_clock_overhead = 0;
+static volatile uintptr_t bench_sink_value;
+
+// Read once per case, so the compiler can't know the fence at the call site
+static volatile int bench_fence_none = ATOMIC_OPS_FENCE_NONE;
+static volatile int bench_fence_acquire = ATOMIC_OPS_FENCE_ACQUIRE;
+static volatile int bench_fence_release = ATOMIC_OPS_FENCE_RELEASE;
+static volatile int bench_fence_full = ATOMIC_OPS_FENCE_FULL;
+
+static inline uint64_t bench_clock(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ((uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec);
+}
+
+static void bench_calibrate(void) {
+	std::vector<uint64_t> overhead(1024);
+
+	for (size_t i = 0; i < overhead.size(); i++) {
+		uint64_t start = bench_clock();
+		overhead[i] = bench_clock() - start;
+	}
+
+	std::sort(overhead.begin(), overhead.end());
+
+	bench_clock_overhead = (double)overhead[512];
+}
+
+static double bench_percentile(const std::vector<uint64_t> &samples, double p) {
+	if (samples.empty()) {
+		return (0);
+	}
+
+	size_t idx = (size_t)(p * (double)samples.size());
+	if (idx >= samples.size()) {
+		idx = samples.size() - 1;
+	}
+
+	double ns = (double)samples[idx] - bench_clock_overhead;
+
+	return ((ns > 0) ? (ns / BENCH_SAMPLE_BATCH) : (0));
+}
+
+// Run fn(i) iterations times, timing it in batches, verify the result with check() and print one CSV line
+template <typename Fn, typename Check>
+static void bench_case(const char *filter, const char *op, const char *name, size_t iterations, Fn fn, Check check) {
+	if (filter != NULL && strstr(name, filter) == NULL) {
+		return;
+	}
+
+	std::vector<uint64_t> samples;
+	samples.reserve(iterations / BENCH_SAMPLE_BATCH + 1);
+
+	uintptr_t sink = 0;
+	uint64_t start = bench_clock();
+
+	for (size_t i = 0; i < iterations; i += BENCH_SAMPLE_BATCH) {
+		uint64_t batch_start = bench_clock();
+
+		for (size_t j = i; j < i + BENCH_SAMPLE_BATCH; j++) {
+			sink += (uintptr_t)fn(j);
+		}
+
+		samples.push_back(bench_clock() - batch_start);
+	}
+
+	uint64_t end = bench_clock();
+	bench_sink_value = sink;
+
+	if (!check()) {
+		fprintf(stderr, "Wrong final value for %s/%s.\n", op, name);
+		exit(EXIT_FAILURE);
+	}
+
+	std::sort(samples.begin(), samples.end());
+
+	size_t ops = (iterations + BENCH_SAMPLE_BATCH - 1) / BENCH_SAMPLE_BATCH * BENCH_SAMPLE_BATCH;
+	double seconds = (double)(end - start) / 1e9;
+
+	printf("cpp,%s,%s,op=%s,1,%zu,%.6f,%.0f,%.2f,%.2f,%.2f\n", BENCH_IMPL, name, op, ops, seconds,
+		(seconds > 0) ? ((double)ops / seconds) : (0), bench_percentile(samples, 0.50),
+		bench_percentile(samples, 0.99), bench_percentile(samples, 0.999));
+}
+
+static void bench_usage(const char *prog) {
+	fprintf(stderr, "Usage: %s [-i iterations] [-f case_filter]\n", prog);
+}
+
+int main(int argc, char *argv[]) {
+	size_t iterations = BENCH_DEFAULT_ITERATIONS;
+	const char *filter = NULL;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "i:f:h")) != -1) {
+		switch (opt) {
+			case 'i':
+				iterations = strtoul(optarg, NULL, 0);
+				break;
+
+			case 'f':
+				filter = optarg;
+				break;
+
+			default:
+				bench_usage(argv[0]);
+				return ((opt == 'h') ? (EXIT_SUCCESS) : (EXIT_FAILURE));
+		}
+	}
+
+	if (iterations == 0) {
+		bench_usage(argv[0]);
+		return (EXIT_FAILURE);
+	}
+
+	// Round up to whole batches, so the final values below are exact
+	iterations = (iterations + BENCH_SAMPLE_BATCH - 1) / BENCH_SAMPLE_BATCH * BENCH_SAMPLE_BATCH;
+
+	bench_calibrate();
+
+	printf("suite,impl,case,config,threads,ops,seconds,ops_per_sec,p50_ns,p99_ns,p999_ns\n");
+
+	static atomic_ops_uint c = ATOMIC_OPS_UINT_INIT(0);
+	static atomic_ops::atomic<uintptr_t> cc(0);
+	ATOMIC_OPS_FENCE fence;
+
+	// fetch_and_add NONE: the cheapest RMW, where a leftover branch shows most
+	atomic_ops_uint_store(&c, 0, ATOMIC_OPS_FENCE_NONE);
+	bench_case(filter, "fetch_and_add_none", "c_literal", iterations, [&](size_t i) {
+		(void)i;
+		return (atomic_ops_uint_fetch_and_add(&c, 1, ATOMIC_OPS_FENCE_NONE));
+	}, [&]() {
+		return (atomic_ops_uint_load(&c, ATOMIC_OPS_FENCE_NONE) == iterations);
+	});
+
+	cc.store<ATOMIC_OPS_FENCE_NONE>(0);
+	bench_case(filter, "fetch_and_add_none", "cpp_template", iterations, [&](size_t i) {
+		(void)i;
+		return (cc.fetch_and_add<ATOMIC_OPS_FENCE_NONE>(1));
+	}, [&]() {
+		return (cc.load<ATOMIC_OPS_FENCE_NONE>() == iterations);
+	});
+
+	atomic_ops_uint_store(&c, 0, ATOMIC_OPS_FENCE_NONE);
+	fence = (ATOMIC_OPS_FENCE)bench_fence_none;
+	bench_case(filter, "fetch_and_add_none", "c_runtime_fence", iterations, [&](size_t i) {
+		(void)i;
+		return (atomic_ops_uint_fetch_and_add(&c, 1, fence));
+	}, [&]() {
+		return (atomic_ops_uint_load(&c, ATOMIC_OPS_FENCE_NONE) == iterations);
+	});
+
+	// fetch_and_add FULL
+	atomic_ops_uint_store(&c, 0, ATOMIC_OPS_FENCE_NONE);
+	bench_case(filter, "fetch_and_add_full", "c_literal", iterations, [&](size_t i) {
+		(void)i;
+		return (atomic_ops_uint_fetch_and_add(&c, 1, ATOMIC_OPS_FENCE_FULL));
+	}, [&]() {
+		return (atomic_ops_uint_load(&c, ATOMIC_OPS_FENCE_NONE) == iterations);
+	});
+
+	cc.store<ATOMIC_OPS_FENCE_NONE>(0);
+	bench_case(filter, "fetch_and_add_full", "cpp_template", iterations, [&](size_t i) {
+		(void)i;
+		return (cc.fetch_and_add(1));
+	}, [&]() {
+		return (cc.load<ATOMIC_OPS_FENCE_NONE>() == iterations);
+	});
+
+	atomic_ops_uint_store(&c, 0, ATOMIC_OPS_FENCE_NONE);
+	fence = (ATOMIC_OPS_FENCE)bench_fence_full;
+	bench_case(filter, "fetch_and_add_full", "c_runtime_fence", iterations, [&](size_t i) {
+		(void)i;
+		return (atomic_ops_uint_fetch_and_add(&c, 1, fence));
+	}, [&]() {
+		return (atomic_ops_uint_load(&c, ATOMIC_OPS_FENCE_NONE) == iterations);
+	});
+
+	// store RELEASE + load ACQUIRE, the message passing pair
+	bench_case(filter, "store_release_load_acquire", "c_literal", iterations, [&](size_t i) {
+		atomic_ops_uint_store(&c, i, ATOMIC_OPS_FENCE_RELEASE);
+		return (atomic_ops_uint_load(&c, ATOMIC_OPS_FENCE_ACQUIRE));
+	}, [&]() {
+		return (atomic_ops_uint_load(&c, ATOMIC_OPS_FENCE_NONE) == iterations - 1);
+	});
+
+	bench_case(filter, "store_release_load_acquire", "cpp_template", iterations, [&](size_t i) {
+		cc.store<ATOMIC_OPS_FENCE_RELEASE>(i);
+		return (cc.load<ATOMIC_OPS_FENCE_ACQUIRE>());
+	}, [&]() {
+		return (cc.load<ATOMIC_OPS_FENCE_NONE>() == iterations - 1);
+	});
+
+	ATOMIC_OPS_FENCE fence_acquire = (ATOMIC_OPS_FENCE)bench_fence_acquire;
+	fence = (ATOMIC_OPS_FENCE)bench_fence_release;
+	bench_case(filter, "store_release_load_acquire", "c_runtime_fence", iterations, [&](size_t i) {
+		atomic_ops_uint_store(&c, i, fence);
+		return (atomic_ops_uint_load(&c, fence_acquire));
+	}, [&]() {
+		return (atomic_ops_uint_load(&c, ATOMIC_OPS_FENCE_NONE) == iterations - 1);
+	});
+
+	// cas ACQUIRE, always succeeding: the lock acquire path
+	atomic_ops_uint_store(&c, 0, ATOMIC_OPS_FENCE_NONE);
+	bench_case(filter, "cas_acquire", "c_literal", iterations, [&](size_t i) {
+		return (atomic_ops_uint_cas(&c, i, i + 1, ATOMIC_OPS_FENCE_ACQUIRE));
+	}, [&]() {
+		return (atomic_ops_uint_load(&c, ATOMIC_OPS_FENCE_NONE) == iterations);
+	});
+
+	cc.store<ATOMIC_OPS_FENCE_NONE>(0);
+	bench_case(filter, "cas_acquire", "cpp_template", iterations, [&](size_t i) {
+		return (cc.cas<ATOMIC_OPS_FENCE_ACQUIRE>(i, i + 1));
+	}, [&]() {
+		return (cc.load<ATOMIC_OPS_FENCE_NONE>() == iterations);
+	});
+
+	atomic_ops_uint_store(&c, 0, ATOMIC_OPS_FENCE_NONE);
+	fence = fence_acquire;
+	bench_case(filter, "cas_acquire", "c_runtime_fence", iterations, [&](size_t i) {
+		return (atomic_ops_uint_cas(&c, i, i + 1, fence));
+	}, [&]() {
+		return (atomic_ops_uint_load(&c, ATOMIC_OPS_FENCE_NONE) == iterations);
+	});
+
+	return (EXIT_SUCCESS);
+}
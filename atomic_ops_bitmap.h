@@ -0,0 +1,234 @@
+/**
+ * This file is part of the atomic_ops project.
+ *
+ * For the full copyright and license information, please view the COPYING
+ * file that was distributed with this source code.
+ *
+ * @copyright  (c) the atomic_ops project
+ * @author     Luca Longinotti <chtekk@longitekk.com>
+ * @license    BSD 2-clause
+ * @version    $Id$
+ */
+
+#ifndef ATOMIC_OPS_BITMAP_H
+#define ATOMIC_OPS_BITMAP_H 1
+
+/*
+ * Lock-free bitmap ID allocator.
+ * Each ID is a bit in the map, set while allocated: allocation finds a clear
+ * bit in a word, with find-first-zero, and takes it with test_and_set_bit,
+ * which tells whether we won it or some other thread was faster. Freeing is
+ * test_and_clear_bit. No two threads can ever get the same ID, and there is
+ * no lock anywhere.
+ * To avoid scanning full words, a summary level has one bit per map word, set
+ * when that word was found full: allocation scans the summary for words that
+ * may have free IDs, a map word's worth of them at a time, so finding a free
+ * ID costs O(words / 64) summary loads. The summary is only a hint: a word
+ * marked full is re-checked after marking it, and freeing an ID clears the
+ * word's summary bit after clearing the ID's, each side with a full fence in
+ * between, so a word with free IDs can't stay marked full. The opposite can
+ * happen, costing a wasted look at that word.
+ * Allocating acquires the ID, freeing releases it: whatever a thread did with
+ * an ID happens before its next owner gets it.
+ */
+
+#include "atomic_ops.h"
+
+#define ATOMIC_OPS_BITMAP_WORD_BITS (sizeof(uintptr_t) * 8)
+
+/*
+ * Type Definitions
+ */
+
+typedef struct {
+	size_t bits; // IDs go from 0 to bits - 1
+	size_t words;
+	atomic_ops_uint *map; // Bit set: ID allocated
+	atomic_ops_uint *full; // Bit set: that map word was seen full
+} atomic_ops_bitmap;
+
+/*
+ * Functions
+ */
+
+static inline bool atomic_ops_bitmap_init(atomic_ops_bitmap *bitmap, size_t bits);
+static inline void atomic_ops_bitmap_destroy(atomic_ops_bitmap *bitmap);
+static inline bool atomic_ops_bitmap_alloc(atomic_ops_bitmap *bitmap, size_t *id);
+static inline bool atomic_ops_bitmap_alloc_near(atomic_ops_bitmap *bitmap, size_t hint, size_t *id);
+static inline void atomic_ops_bitmap_free(atomic_ops_bitmap *bitmap, size_t id);
+static inline bool atomic_ops_bitmap_test(const atomic_ops_bitmap *bitmap, size_t id) ATTR_ALWAYSINLINE;
+
+/*
+ * Implementations
+ */
+
+// False if bits is zero or there's no memory for the map
+static inline bool atomic_ops_bitmap_init(atomic_ops_bitmap *bitmap, size_t bits) {
+	if (bits == 0) {
+		return (false);
+	}
+
+	size_t words = ((bits - 1) / ATOMIC_OPS_BITMAP_WORD_BITS) + 1;
+	size_t summaries = ((words - 1) / ATOMIC_OPS_BITMAP_WORD_BITS) + 1;
+
+	bitmap->map = malloc(words * sizeof(atomic_ops_uint));
+	bitmap->full = malloc(summaries * sizeof(atomic_ops_uint));
+
+	if (bitmap->map == NULL || bitmap->full == NULL) {
+		free(bitmap->map);
+		free(bitmap->full);
+		return (false);
+	}
+
+	bitmap->bits = bits;
+	bitmap->words = words;
+
+	for (size_t i = 0; i < words; i++) {
+		atomic_ops_uint_store(&bitmap->map[i], 0, ATOMIC_OPS_FENCE_NONE);
+	}
+
+	for (size_t i = 0; i < summaries; i++) {
+		atomic_ops_uint_store(&bitmap->full[i], 0, ATOMIC_OPS_FENCE_NONE);
+	}
+
+	// Bits past the end are permanently allocated, the map words past the end permanently full
+	if ((bits % ATOMIC_OPS_BITMAP_WORD_BITS) != 0) {
+		atomic_ops_uint_store(&bitmap->map[words - 1], ~((uintptr_t)0) << (bits % ATOMIC_OPS_BITMAP_WORD_BITS), ATOMIC_OPS_FENCE_NONE);
+	}
+
+	if ((words % ATOMIC_OPS_BITMAP_WORD_BITS) != 0) {
+		atomic_ops_uint_store(&bitmap->full[summaries - 1], ~((uintptr_t)0) << (words % ATOMIC_OPS_BITMAP_WORD_BITS), ATOMIC_OPS_FENCE_NONE);
+	}
+
+	atomic_ops_fence(ATOMIC_OPS_FENCE_RELEASE);
+
+	return (true);
+}
+
+// No thread may use the bitmap anymore
+static inline void atomic_ops_bitmap_destroy(atomic_ops_bitmap *bitmap) {
+	free(bitmap->map);
+	free(bitmap->full);
+	bitmap->map = NULL;
+	bitmap->full = NULL;
+}
+
+// Index of the lowest clear bit in val (val must have one)
+static inline unsigned int atomic_ops_bitmap_ffz(uintptr_t val) {
+	return ((unsigned int)__builtin_ctzl((unsigned long)~val));
+}
+
+static inline void atomic_ops_bitmap_mark_full(atomic_ops_bitmap *bitmap, size_t word) {
+	atomic_ops_uint *summary = &bitmap->full[word / ATOMIC_OPS_BITMAP_WORD_BITS];
+	unsigned int bit = (unsigned int)(word % ATOMIC_OPS_BITMAP_WORD_BITS);
+
+	// Full: the mark must be visible before the word is checked again
+	atomic_ops_uint_test_and_set_bit(summary, bit, ATOMIC_OPS_FENCE_FULL);
+
+	// A free that didn't see the mark yet won't clear it: do it ourselves
+	if (~atomic_ops_uint_load(&bitmap->map[word], ATOMIC_OPS_FENCE_NONE) != 0) {
+		atomic_ops_uint_test_and_clear_bit(summary, bit, ATOMIC_OPS_FENCE_NONE);
+	}
+}
+
+// Takes a clear bit of the map word, at or after bit from
+static inline bool atomic_ops_bitmap_take(atomic_ops_bitmap *bitmap, size_t word, unsigned int from, size_t *id) {
+	uintptr_t val = atomic_ops_uint_load(&bitmap->map[word], ATOMIC_OPS_FENCE_NONE);
+
+	while (true) {
+		uintptr_t candidates = val | ~(~((uintptr_t)0) << from);
+
+		if (~candidates == 0) {
+			// Filled up without getting marked, by racing with a free: mark it now
+			if (from == 0) {
+				atomic_ops_bitmap_mark_full(bitmap, word);
+			}
+
+			return (false);
+		}
+
+		unsigned int bit = atomic_ops_bitmap_ffz(candidates);
+
+		// Acquire: nothing done with the ID may happen before we own it
+		if (!atomic_ops_uint_test_and_set_bit(&bitmap->map[word], bit, ATOMIC_OPS_FENCE_ACQUIRE)) {
+			if (~atomic_ops_uint_load(&bitmap->map[word], ATOMIC_OPS_FENCE_NONE) == 0) {
+				atomic_ops_bitmap_mark_full(bitmap, word);
+			}
+
+			*id = (word * ATOMIC_OPS_BITMAP_WORD_BITS) + bit;
+			return (true);
+		}
+
+		// Someone else was faster
+		val = atomic_ops_uint_load(&bitmap->map[word], ATOMIC_OPS_FENCE_NONE);
+	}
+}
+
+// Takes a clear bit of a map word in [from, to), only looking at words not marked full
+static inline bool atomic_ops_bitmap_scan(atomic_ops_bitmap *bitmap, size_t from, size_t to, size_t *id) {
+	size_t word = from;
+
+	while (word < to) {
+		unsigned int bit = (unsigned int)(word % ATOMIC_OPS_BITMAP_WORD_BITS);
+
+		// The words before this one in its summary were handled already
+		uintptr_t summary = atomic_ops_uint_load(&bitmap->full[word / ATOMIC_OPS_BITMAP_WORD_BITS], ATOMIC_OPS_FENCE_NONE)
+						  | ~(~((uintptr_t)0) << bit);
+
+		if (~summary == 0) {
+			word += ATOMIC_OPS_BITMAP_WORD_BITS - bit;
+			continue;
+		}
+
+		word = (word - bit) + atomic_ops_bitmap_ffz(summary);
+
+		if (word < to && atomic_ops_bitmap_take(bitmap, word, 0, id)) {
+			return (true);
+		}
+
+		word++;
+	}
+
+	return (false);
+}
+
+// False if all IDs are allocated, else the lowest free ID is returned in id (with concurrent frees, about the lowest)
+static inline bool atomic_ops_bitmap_alloc(atomic_ops_bitmap *bitmap, size_t *id) {
+	return (atomic_ops_bitmap_scan(bitmap, 0, bitmap->words, id));
+}
+
+// Like alloc, but the first free ID at or after hint, wrapping around to the start: keeps related IDs close
+static inline bool atomic_ops_bitmap_alloc_near(atomic_ops_bitmap *bitmap, size_t hint, size_t *id) {
+	if (hint >= bitmap->bits) {
+		hint = 0;
+	}
+
+	size_t start = hint / ATOMIC_OPS_BITMAP_WORD_BITS;
+
+	return (atomic_ops_bitmap_take(bitmap, start, (unsigned int)(hint % ATOMIC_OPS_BITMAP_WORD_BITS), id)
+		 || atomic_ops_bitmap_scan(bitmap, start + 1, bitmap->words, id)
+		 || atomic_ops_bitmap_scan(bitmap, 0, start + 1, id));
+}
+
+// Freeing an ID that isn't allocated is a bug
+static inline void atomic_ops_bitmap_free(atomic_ops_bitmap *bitmap, size_t id) {
+	size_t word = id / ATOMIC_OPS_BITMAP_WORD_BITS;
+	atomic_ops_uint *summary = &bitmap->full[word / ATOMIC_OPS_BITMAP_WORD_BITS];
+	unsigned int bit = (unsigned int)(word % ATOMIC_OPS_BITMAP_WORD_BITS);
+
+	// Release for the ID's next owner, full so that the clear bit is visible before the mark is checked
+	atomic_ops_uint_test_and_clear_bit(&bitmap->map[word], (unsigned int)(id % ATOMIC_OPS_BITMAP_WORD_BITS), ATOMIC_OPS_FENCE_FULL);
+
+	if ((atomic_ops_uint_load(summary, ATOMIC_OPS_FENCE_NONE) & (((uintptr_t)1) << bit)) != 0) {
+		atomic_ops_uint_test_and_clear_bit(summary, bit, ATOMIC_OPS_FENCE_NONE);
+	}
+}
+
+// True if the ID is allocated right now
+static inline bool atomic_ops_bitmap_test(const atomic_ops_bitmap *bitmap, size_t id) {
+	uintptr_t val = atomic_ops_uint_load(&bitmap->map[id / ATOMIC_OPS_BITMAP_WORD_BITS], ATOMIC_OPS_FENCE_ACQUIRE);
+
+	return ((val & (((uintptr_t)1) << (id % ATOMIC_OPS_BITMAP_WORD_BITS))) != 0);
+}
+
+#endif /* ATOMIC_OPS_BITMAP_H */
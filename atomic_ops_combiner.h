@@ -0,0 +1,426 @@
+/**
+ * This file is part of the atomic_ops project.
+ *
+ * For the full copyright and license information, please view the COPYING
+ * file that was distributed with this source code.
+ *
+ * @copyright  (c) the atomic_ops project
+ * @author     Luca Longinotti <chtekk@longitekk.com>
+ * @license    BSD 2-clause
+ * @version    $Id$
+ */
+
+#ifndef ATOMIC_OPS_COMBINER_H
+#define ATOMIC_OPS_COMBINER_H 1
+
+/*
+ * Flat combining, for sequential data structures without a good lock-free
+ * form (heaps, LRU lists, ...).
+ * Each thread owns a publication record. To run an operation, it posts a
+ * request in its record, then tries to take the combiner lock: the thread
+ * that gets it becomes the combiner, and applies the pending requests of all
+ * records, its own included, in batches handed to the structure's callback,
+ * while the structure stays hot in its cache. Every request is then marked
+ * done, which publishes its results. The other threads spin on their own
+ * record until their request is done, or the lock is free again.
+ * Compared to a lock, the structure, and the lock, move between caches once
+ * per batch instead of once per operation.
+ * Two instances are built in: a priority queue (binary min-heap) and a
+ * counter, whose fetch_and_add is sequential like a locked one.
+ */
+
+#include "atomic_ops.h"
+#include <string.h>
+
+// Requests handed to the callback at most at once
+#if !defined(ATOMIC_OPS_COMBINER_BATCH)
+	#define ATOMIC_OPS_COMBINER_BATCH 64
+#endif
+
+// Scans of the records by a combiner, as long as each one still finds requests
+#if !defined(ATOMIC_OPS_COMBINER_PASSES)
+	#define ATOMIC_OPS_COMBINER_PASSES 4
+#endif
+
+/*
+ * Type Definitions
+ */
+
+// Applies count requests in order, writing their results into them
+typedef void (*atomic_ops_combiner_fn)(void *ctx, void **requests, size_t count);
+
+typedef struct atomic_ops_combiner_record atomic_ops_combiner_record;
+
+struct atomic_ops_combiner_record {
+	atomic_ops_ptr request; // Posted by the owner, reset to NULL by the combiner once applied
+	atomic_ops_uint active; // Owned by a thread or not
+	atomic_ops_combiner_record *next; // Set once, before the record is published
+};
+
+typedef struct {
+	atomic_ops_uint lock; // Held by the combining thread
+	char pad0[ATOMIC_OPS_CACHELINE_SIZE - sizeof(atomic_ops_uint)];
+	atomic_ops_ptr records; // List of all records, it only ever grows
+	atomic_ops_combiner_fn fn;
+	void *ctx;
+	// Only ever accessed by the combining thread
+	void *batch[ATOMIC_OPS_COMBINER_BATCH];
+	atomic_ops_combiner_record *batch_records[ATOMIC_OPS_COMBINER_BATCH];
+} atomic_ops_combiner;
+
+typedef struct {
+	uintptr_t key;
+	void *value;
+} atomic_ops_combiner_pq_entry;
+
+typedef enum {
+	ATOMIC_OPS_COMBINER_PQ_PUSH = 0,
+	ATOMIC_OPS_COMBINER_PQ_POP  = 1,
+} ATOMIC_OPS_COMBINER_PQ_OP;
+
+typedef struct {
+	ATOMIC_OPS_COMBINER_PQ_OP op;
+	uintptr_t key;
+	void *value;
+	bool ok;
+} atomic_ops_combiner_pq_request;
+
+typedef struct {
+	atomic_ops_combiner combiner;
+	// Only ever accessed by the combining thread
+	atomic_ops_combiner_pq_entry *heap;
+	size_t len;
+	size_t size;
+} atomic_ops_combiner_pq;
+
+typedef struct {
+	uintptr_t val;
+	uintptr_t result;
+} atomic_ops_combiner_counter_request;
+
+typedef struct {
+	atomic_ops_combiner combiner;
+	uintptr_t value; // Only ever accessed by the combining thread
+} atomic_ops_combiner_counter;
+
+/*
+ * Functions
+ */
+
+static inline void atomic_ops_combiner_init(atomic_ops_combiner *comb, atomic_ops_combiner_fn fn, void *ctx);
+static inline void atomic_ops_combiner_destroy(atomic_ops_combiner *comb);
+static inline atomic_ops_combiner_record * atomic_ops_combiner_acquire(atomic_ops_combiner *comb);
+static inline void atomic_ops_combiner_release(atomic_ops_combiner *comb, atomic_ops_combiner_record *rec);
+static inline void atomic_ops_combiner_execute(atomic_ops_combiner *comb, atomic_ops_combiner_record *rec, void *request);
+
+static inline void atomic_ops_combiner_pq_init(atomic_ops_combiner_pq *pq);
+static inline void atomic_ops_combiner_pq_destroy(atomic_ops_combiner_pq *pq);
+static inline bool atomic_ops_combiner_pq_push(atomic_ops_combiner_pq *pq, atomic_ops_combiner_record *rec, uintptr_t key, void *value);
+static inline bool atomic_ops_combiner_pq_pop(atomic_ops_combiner_pq *pq, atomic_ops_combiner_record *rec, uintptr_t *key, void **value);
+static inline bool atomic_ops_combiner_pq_heap_push(atomic_ops_combiner_pq *pq, uintptr_t key, void *value);
+static inline bool atomic_ops_combiner_pq_heap_pop(atomic_ops_combiner_pq *pq, uintptr_t *key, void **value);
+
+static inline void atomic_ops_combiner_counter_init(atomic_ops_combiner_counter *counter, uintptr_t val);
+static inline void atomic_ops_combiner_counter_destroy(atomic_ops_combiner_counter *counter);
+static inline uintptr_t atomic_ops_combiner_counter_fetch_and_add(atomic_ops_combiner_counter *counter, atomic_ops_combiner_record *rec, uintptr_t val);
+static inline uintptr_t atomic_ops_combiner_counter_read(atomic_ops_combiner_counter *counter, atomic_ops_combiner_record *rec);
+
+/*
+ * Implementations
+ */
+
+static inline void atomic_ops_combiner_init(atomic_ops_combiner *comb, atomic_ops_combiner_fn fn, void *ctx) {
+	comb->fn = fn;
+	comb->ctx = ctx;
+
+	atomic_ops_ptr_store(&comb->records, NULL, ATOMIC_OPS_FENCE_NONE);
+	atomic_ops_uint_store(&comb->lock, 0, ATOMIC_OPS_FENCE_RELEASE);
+}
+
+// No thread may use the combiner anymore
+static inline void atomic_ops_combiner_destroy(atomic_ops_combiner *comb) {
+	atomic_ops_combiner_record *rec = atomic_ops_ptr_load(&comb->records, ATOMIC_OPS_FENCE_ACQUIRE);
+
+	while (rec != NULL) {
+		atomic_ops_combiner_record *next = rec->next;
+
+		free(rec);
+
+		rec = next;
+	}
+
+	atomic_ops_ptr_store(&comb->records, NULL, ATOMIC_OPS_FENCE_RELEASE);
+}
+
+// Get a record for the calling thread, NULL if there's no memory for a new one
+static inline atomic_ops_combiner_record * atomic_ops_combiner_acquire(atomic_ops_combiner *comb) {
+	atomic_ops_combiner_record *rec;
+
+	// Reuse a record some other thread released first
+	for (rec = atomic_ops_ptr_load(&comb->records, ATOMIC_OPS_FENCE_ACQUIRE); rec != NULL; rec = rec->next) {
+		if (atomic_ops_uint_load(&rec->active, ATOMIC_OPS_FENCE_NONE) == 0
+			&& atomic_ops_uint_cas(&rec->active, 0, 1, ATOMIC_OPS_FENCE_ACQUIRE)) {
+			return (rec);
+		}
+	}
+
+	size_t size = ((sizeof(atomic_ops_combiner_record) + ATOMIC_OPS_CACHELINE_SIZE - 1) / ATOMIC_OPS_CACHELINE_SIZE) * ATOMIC_OPS_CACHELINE_SIZE;
+
+	// Whole lines: each thread spins on its own record only
+	rec = aligned_alloc(ATOMIC_OPS_CACHELINE_SIZE, size);
+	if (rec == NULL) {
+		return (NULL);
+	}
+
+	memset(rec, 0, size);
+
+	atomic_ops_ptr_store(&rec->request, NULL, ATOMIC_OPS_FENCE_NONE);
+	atomic_ops_uint_store(&rec->active, 1, ATOMIC_OPS_FENCE_NONE);
+
+	atomic_ops_combiner_record *head = atomic_ops_ptr_load(&comb->records, ATOMIC_OPS_FENCE_NONE), *prev;
+
+	while (true) {
+		rec->next = head;
+
+		prev = atomic_ops_ptr_casr(&comb->records, head, rec, ATOMIC_OPS_FENCE_RELEASE);
+		if (prev == head) {
+			return (rec);
+		}
+
+		head = prev;
+	}
+}
+
+// The record must have no request pending
+static inline void atomic_ops_combiner_release(atomic_ops_combiner *comb, atomic_ops_combiner_record *rec) {
+	UNUSED_ARGUMENT(comb);
+
+	atomic_ops_uint_store(&rec->active, 0, ATOMIC_OPS_FENCE_RELEASE);
+}
+
+static inline void atomic_ops_combiner_apply(atomic_ops_combiner *comb, size_t count) {
+	comb->fn(comb->ctx, comb->batch, count);
+
+	// Publishes the results written into the requests
+	for (size_t i = 0; i < count; i++) {
+		atomic_ops_ptr_store(&comb->batch_records[i]->request, NULL, ATOMIC_OPS_FENCE_RELEASE);
+	}
+}
+
+// Combiner lock held: apply whatever is pending, the caller's own request included
+static inline void atomic_ops_combiner_combine(atomic_ops_combiner *comb) {
+	for (size_t pass = 0; pass < ATOMIC_OPS_COMBINER_PASSES; pass++) {
+		size_t count = 0;
+		bool found = false;
+
+		for (atomic_ops_combiner_record *rec = atomic_ops_ptr_load(&comb->records, ATOMIC_OPS_FENCE_ACQUIRE); rec != NULL; rec = rec->next) {
+			void *request = atomic_ops_ptr_load(&rec->request, ATOMIC_OPS_FENCE_ACQUIRE);
+
+			if (request == NULL) {
+				continue;
+			}
+
+			comb->batch[count] = request;
+			comb->batch_records[count] = rec;
+			found = true;
+
+			if (++count == ATOMIC_OPS_COMBINER_BATCH) {
+				atomic_ops_combiner_apply(comb, count);
+				count = 0;
+			}
+		}
+
+		if (count > 0) {
+			atomic_ops_combiner_apply(comb, count);
+		}
+
+		if (!found) {
+			break;
+		}
+	}
+}
+
+// Returns once the request was applied, by this thread or by another combiner
+static inline void atomic_ops_combiner_execute(atomic_ops_combiner *comb, atomic_ops_combiner_record *rec, void *request) {
+	atomic_ops_ptr_store(&rec->request, request, ATOMIC_OPS_FENCE_RELEASE);
+
+	while (true) {
+		if (atomic_ops_uint_load(&comb->lock, ATOMIC_OPS_FENCE_NONE) == 0
+			&& atomic_ops_uint_cas(&comb->lock, 0, 1, ATOMIC_OPS_FENCE_ACQUIRE)) {
+			atomic_ops_combiner_combine(comb);
+			atomic_ops_uint_store(&comb->lock, 0, ATOMIC_OPS_FENCE_RELEASE);
+			return;
+		}
+
+		// Some other thread is combining: wait for it to serve this request, or to finish without it
+		while (atomic_ops_ptr_load(&rec->request, ATOMIC_OPS_FENCE_ACQUIRE) != NULL) {
+			if (atomic_ops_uint_load(&comb->lock, ATOMIC_OPS_FENCE_NONE) == 0) {
+				break;
+			}
+
+			atomic_ops_pause();
+		}
+
+		if (atomic_ops_ptr_load(&rec->request, ATOMIC_OPS_FENCE_ACQUIRE) == NULL) {
+			return;
+		}
+	}
+}
+
+// Sequential push, for the combiner or for callers that lock the queue themselves; false if there's no memory
+static inline bool atomic_ops_combiner_pq_heap_push(atomic_ops_combiner_pq *pq, uintptr_t key, void *value) {
+	if (pq->len == pq->size) {
+		size_t size = (pq->size == 0) ? (64) : (pq->size * 2);
+		atomic_ops_combiner_pq_entry *heap = realloc(pq->heap, size * sizeof(atomic_ops_combiner_pq_entry));
+
+		if (heap == NULL) {
+			return (false);
+		}
+
+		pq->heap = heap;
+		pq->size = size;
+	}
+
+	size_t i = pq->len++;
+
+	// Sift up
+	while (i > 0 && pq->heap[(i - 1) / 2].key > key) {
+		pq->heap[i] = pq->heap[(i - 1) / 2];
+		i = (i - 1) / 2;
+	}
+
+	pq->heap[i].key = key;
+	pq->heap[i].value = value;
+
+	return (true);
+}
+
+// Sequential pop of the lowest key; false if the queue is empty
+static inline bool atomic_ops_combiner_pq_heap_pop(atomic_ops_combiner_pq *pq, uintptr_t *key, void **value) {
+	if (pq->len == 0) {
+		return (false);
+	}
+
+	*key = pq->heap[0].key;
+	*value = pq->heap[0].value;
+
+	atomic_ops_combiner_pq_entry last = pq->heap[--pq->len];
+	size_t i = 0;
+
+	// Sift the last entry down from the root
+	while (true) {
+		size_t child = 2 * i + 1;
+
+		if (child >= pq->len) {
+			break;
+		}
+
+		if (child + 1 < pq->len && pq->heap[child + 1].key < pq->heap[child].key) {
+			child++;
+		}
+
+		if (pq->heap[child].key >= last.key) {
+			break;
+		}
+
+		pq->heap[i] = pq->heap[child];
+		i = child;
+	}
+
+	pq->heap[i] = last;
+
+	return (true);
+}
+
+static inline void atomic_ops_combiner_pq_apply(void *ctx, void **requests, size_t count) {
+	atomic_ops_combiner_pq *pq = ctx;
+
+	for (size_t i = 0; i < count; i++) {
+		atomic_ops_combiner_pq_request *req = requests[i];
+
+		if (req->op == ATOMIC_OPS_COMBINER_PQ_PUSH) {
+			req->ok = atomic_ops_combiner_pq_heap_push(pq, req->key, req->value);
+		}
+		else {
+			req->ok = atomic_ops_combiner_pq_heap_pop(pq, &req->key, &req->value);
+		}
+	}
+}
+
+static inline void atomic_ops_combiner_pq_init(atomic_ops_combiner_pq *pq) {
+	pq->heap = NULL;
+	pq->len = 0;
+	pq->size = 0;
+
+	atomic_ops_combiner_init(&pq->combiner, &atomic_ops_combiner_pq_apply, pq);
+}
+
+// No thread may use the queue anymore
+static inline void atomic_ops_combiner_pq_destroy(atomic_ops_combiner_pq *pq) {
+	atomic_ops_combiner_destroy(&pq->combiner);
+
+	free(pq->heap);
+	pq->heap = NULL;
+	pq->len = 0;
+	pq->size = 0;
+}
+
+// rec comes from atomic_ops_combiner_acquire(&pq->combiner); false if there's no memory
+static inline bool atomic_ops_combiner_pq_push(atomic_ops_combiner_pq *pq, atomic_ops_combiner_record *rec, uintptr_t key, void *value) {
+	atomic_ops_combiner_pq_request req = { ATOMIC_OPS_COMBINER_PQ_PUSH, key, value, false };
+
+	atomic_ops_combiner_execute(&pq->combiner, rec, &req);
+
+	return (req.ok);
+}
+
+// False if the queue is empty, else the entry with the lowest key is removed and returned
+static inline bool atomic_ops_combiner_pq_pop(atomic_ops_combiner_pq *pq, atomic_ops_combiner_record *rec, uintptr_t *key, void **value) {
+	atomic_ops_combiner_pq_request req = { ATOMIC_OPS_COMBINER_PQ_POP, 0, NULL, false };
+
+	atomic_ops_combiner_execute(&pq->combiner, rec, &req);
+
+	if (req.ok) {
+		*key = req.key;
+		*value = req.value;
+	}
+
+	return (req.ok);
+}
+
+static inline void atomic_ops_combiner_counter_apply(void *ctx, void **requests, size_t count) {
+	atomic_ops_combiner_counter *counter = ctx;
+
+	for (size_t i = 0; i < count; i++) {
+		atomic_ops_combiner_counter_request *req = requests[i];
+
+		req->result = counter->value;
+		counter->value += req->val;
+	}
+}
+
+static inline void atomic_ops_combiner_counter_init(atomic_ops_combiner_counter *counter, uintptr_t val) {
+	counter->value = val;
+
+	atomic_ops_combiner_init(&counter->combiner, &atomic_ops_combiner_counter_apply, counter);
+}
+
+// No thread may use the counter anymore
+static inline void atomic_ops_combiner_counter_destroy(atomic_ops_combiner_counter *counter) {
+	atomic_ops_combiner_destroy(&counter->combiner);
+}
+
+// rec comes from atomic_ops_combiner_acquire(&counter->combiner); returns the value before the add
+static inline uintptr_t atomic_ops_combiner_counter_fetch_and_add(atomic_ops_combiner_counter *counter, atomic_ops_combiner_record *rec, uintptr_t val) {
+	atomic_ops_combiner_counter_request req = { val, 0 };
+
+	atomic_ops_combiner_execute(&counter->combiner, rec, &req);
+
+	return (req.result);
+}
+
+static inline uintptr_t atomic_ops_combiner_counter_read(atomic_ops_combiner_counter *counter, atomic_ops_combiner_record *rec) {
+	return (atomic_ops_combiner_counter_fetch_and_add(counter, rec, 0));
+}
+
+#endif /* ATOMIC_OPS_COMBINER_H */
@@ -0,0 +1,115 @@
+/**
+ * This file is part of the atomic_ops project.
+ *
+ * For the full copyright and license information, please view the COPYING
+ * file that was distributed with this source code.
+ *
+ * @copyright  (c) the atomic_ops project
+ * @author     Luca Longinotti <chtekk@longitekk.com>
+ * @license    BSD 2-clause
+ * @version    $Id$
+ */
+
+#ifndef ATOMIC_OPS_COUNTER_H
+#define ATOMIC_OPS_COUNTER_H 1
+
+/*
+ * Striped counter, for statistics updated from many threads.
+ * The value is spread over padded cells, which never share a cache line, and
+ * a thread only ever adds to the cell of its thread slot: threads on different
+ * cells never contend, so updates scale with the number of threads. Reading has to
+ * sum all the cells instead, and is only approximate while updates go on:
+ * cells are read one after the other, not at the same instant. Reset swaps
+ * every cell with zero, so each update lands either in the returned total or
+ * in the counter afterwards, never in both nor lost.
+ * All operations are unordered: counters order nothing else.
+ */
+
+#include "atomic_ops.h"
+
+// Number of cells: up to that many threads update without sharing a line
+#if !defined(ATOMIC_OPS_COUNTER_CELLS)
+	#define ATOMIC_OPS_COUNTER_CELLS 64
+#endif
+
+/*
+ * Type Definitions
+ */
+
+typedef struct {
+	atomic_ops_uint_padded *cells;
+} atomic_ops_counter;
+
+/*
+ * Functions
+ */
+
+static inline bool atomic_ops_counter_init(atomic_ops_counter *counter);
+static inline void atomic_ops_counter_destroy(atomic_ops_counter *counter);
+static inline void atomic_ops_counter_add(atomic_ops_counter *counter, uintptr_t val) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_counter_inc(atomic_ops_counter *counter) ATTR_ALWAYSINLINE;
+static inline uintptr_t atomic_ops_counter_read(const atomic_ops_counter *counter);
+static inline uintptr_t atomic_ops_counter_reset(atomic_ops_counter *counter);
+
+/*
+ * Implementations
+ */
+
+// False if there's no memory for the cells
+static inline bool atomic_ops_counter_init(atomic_ops_counter *counter) {
+	counter->cells = aligned_alloc(ATOMIC_OPS_DESTRUCTIVE_SIZE, ATOMIC_OPS_COUNTER_CELLS * sizeof(atomic_ops_uint_padded));
+
+	if (counter->cells == NULL) {
+		return (false);
+	}
+
+	for (size_t i = 0; i < ATOMIC_OPS_COUNTER_CELLS; i++) {
+		atomic_ops_uint_padded_store(&counter->cells[i], 0, ATOMIC_OPS_FENCE_NONE);
+	}
+
+	atomic_ops_fence(ATOMIC_OPS_FENCE_RELEASE);
+
+	return (true);
+}
+
+// No thread may use the counter anymore
+static inline void atomic_ops_counter_destroy(atomic_ops_counter *counter) {
+	free(counter->cells);
+	counter->cells = NULL;
+}
+
+// Wraps around like uintptr_t: adding (uintptr_t)-N subtracts N
+static inline void atomic_ops_counter_add(atomic_ops_counter *counter, uintptr_t val) {
+	atomic_ops_uint_padded_add(&counter->cells[atomic_ops_thread_slot() % ATOMIC_OPS_COUNTER_CELLS], val, ATOMIC_OPS_FENCE_NONE);
+}
+
+static inline void atomic_ops_counter_inc(atomic_ops_counter *counter) {
+	atomic_ops_uint_padded_inc(&counter->cells[atomic_ops_thread_slot() % ATOMIC_OPS_COUNTER_CELLS], ATOMIC_OPS_FENCE_NONE);
+}
+
+// Approximate while there are concurrent updates, exact otherwise
+static inline uintptr_t atomic_ops_counter_read(const atomic_ops_counter *counter) {
+	uintptr_t sum = 0;
+
+	for (size_t i = 0; i < ATOMIC_OPS_COUNTER_CELLS; i++) {
+		sum += atomic_ops_uint_padded_load(&counter->cells[i], ATOMIC_OPS_FENCE_NONE);
+	}
+
+	return (sum);
+}
+
+// Returns the total and sets the counter to zero, without losing concurrent updates
+static inline uintptr_t atomic_ops_counter_reset(atomic_ops_counter *counter) {
+	uintptr_t sum = 0;
+
+	for (size_t i = 0; i < ATOMIC_OPS_COUNTER_CELLS; i++) {
+		// Most cells are untouched between resets: don't take their lines exclusively
+		if (atomic_ops_uint_padded_load(&counter->cells[i], ATOMIC_OPS_FENCE_NONE) != 0) {
+			sum += atomic_ops_uint_padded_swap(&counter->cells[i], 0, ATOMIC_OPS_FENCE_NONE);
+		}
+	}
+
+	return (sum);
+}
+
+#endif /* ATOMIC_OPS_COUNTER_H */
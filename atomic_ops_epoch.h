@@ -0,0 +1,347 @@
+/**
+ * This file is part of the atomic_ops project.
+ *
+ * For the full copyright and license information, please view the COPYING
+ * file that was distributed with this source code.
+ *
+ * @copyright  (c) the atomic_ops project
+ * @author     Luca Longinotti <chtekk@longitekk.com>
+ * @license    BSD 2-clause
+ * @version    $Id$
+ */
+
+#ifndef ATOMIC_OPS_EPOCH_H
+#define ATOMIC_OPS_EPOCH_H 1
+
+/*
+ * Epoch-based memory reclamation, for read-mostly data.
+ * Readers announce the global epoch in their record on enter, and clear it
+ * on exit. Writers advance the global epoch only once every active record
+ * has announced the current one. An object retired in epoch E can't be
+ * reached anymore by readers that enter after that, so it's freed once the
+ * epoch has advanced twice past E: by then, all readers that might still
+ * have held it have exited.
+ * Entering needs a #StoreLoad barrier between announcing the epoch and the
+ * reads that follow. On Linux, the writer issues it on the readers' behalf
+ * with membarrier(), before looking at their records, so enter and exit are
+ * a load and a plain store each, with compiler barriers only. Elsewhere, or
+ * if membarrier() isn't available, enter falls back to a full fence.
+ * Threads that never hold references across some known points can use the
+ * QSBR functions instead: they stay online, and only report quiescent states
+ * from time to time, which costs a load and a plain store and no fence at all.
+ * Callbacks deferred by a thread are queued in its record, and run by that
+ * thread once a grace period has passed: either in batches while deferring
+ * more, or on reclaim/release.
+ */
+
+#include "atomic_ops.h"
+#include <string.h>
+
+#if defined(__linux__) && !defined(ATOMIC_OPS_EPOCH_NO_MEMBARRIER)
+	#include <linux/membarrier.h>
+	#include <sys/syscall.h>
+	#include <unistd.h>
+
+	#if defined(__NR_membarrier)
+		#define ATOMIC_OPS_EPOCH_MEMBARRIER 1
+	#endif
+#endif
+
+// Deferred callbacks per record before reclaiming is attempted
+#if !defined(ATOMIC_OPS_EPOCH_RECLAIM_THRESHOLD)
+	#define ATOMIC_OPS_EPOCH_RECLAIM_THRESHOLD 64
+#endif
+
+/*
+ * Type Definitions
+ */
+
+typedef void (*atomic_ops_epoch_fn)(void *arg);
+
+typedef struct {
+	atomic_ops_epoch_fn fn;
+	void *arg;
+	uintptr_t epoch;
+} atomic_ops_epoch_deferred;
+
+typedef struct atomic_ops_epoch_record atomic_ops_epoch_record;
+
+struct atomic_ops_epoch_record {
+	atomic_ops_uint epoch; // Announced epoch with the low bit set while active, zero while not
+	atomic_ops_uint active; // Owned by a thread or not
+	atomic_ops_epoch_record *next; // Set once, before the record is published
+	// Only ever accessed by the owning thread
+	size_t nesting;
+	atomic_ops_epoch_deferred *deferred; // In order of epoch
+	size_t deferred_len;
+	size_t deferred_size;
+};
+
+typedef struct {
+	atomic_ops_uint epoch; // Global epoch, advances in steps of two
+	char pad0[ATOMIC_OPS_CACHELINE_SIZE - sizeof(atomic_ops_uint)];
+	atomic_ops_ptr records; // List of all records, it only ever grows
+	bool asymmetric; // Readers skip their fence, writers issue membarrier() instead
+} atomic_ops_epoch_domain;
+
+/*
+ * Functions
+ */
+
+static inline void atomic_ops_epoch_domain_init(atomic_ops_epoch_domain *domain);
+static inline void atomic_ops_epoch_domain_destroy(atomic_ops_epoch_domain *domain);
+static inline atomic_ops_epoch_record * atomic_ops_epoch_acquire(atomic_ops_epoch_domain *domain);
+static inline void atomic_ops_epoch_release(atomic_ops_epoch_domain *domain, atomic_ops_epoch_record *rec);
+static inline void atomic_ops_epoch_enter(atomic_ops_epoch_domain *domain, atomic_ops_epoch_record *rec) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_epoch_exit(atomic_ops_epoch_domain *domain, atomic_ops_epoch_record *rec) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_epoch_online(atomic_ops_epoch_domain *domain, atomic_ops_epoch_record *rec) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_epoch_offline(atomic_ops_epoch_domain *domain, atomic_ops_epoch_record *rec) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_epoch_quiescent(atomic_ops_epoch_domain *domain, atomic_ops_epoch_record *rec) ATTR_ALWAYSINLINE;
+static inline bool atomic_ops_epoch_reserve(atomic_ops_epoch_domain *domain, atomic_ops_epoch_record *rec);
+static inline bool atomic_ops_epoch_defer(atomic_ops_epoch_domain *domain, atomic_ops_epoch_record *rec, atomic_ops_epoch_fn fn, void *arg);
+static inline bool atomic_ops_epoch_retire(atomic_ops_epoch_domain *domain, atomic_ops_epoch_record *rec, void *ptr, atomic_ops_epoch_fn free_fn);
+static inline bool atomic_ops_epoch_advance(atomic_ops_epoch_domain *domain);
+static inline void atomic_ops_epoch_synchronize(atomic_ops_epoch_domain *domain);
+static inline size_t atomic_ops_epoch_reclaim(atomic_ops_epoch_domain *domain, atomic_ops_epoch_record *rec);
+
+/*
+ * Implementations
+ */
+
+static inline void atomic_ops_epoch_domain_init(atomic_ops_epoch_domain *domain) {
+	domain->asymmetric = false;
+
+#if defined(ATOMIC_OPS_EPOCH_MEMBARRIER)
+	domain->asymmetric = (syscall(__NR_membarrier, MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED, 0, 0) == 0);
+#endif
+
+	atomic_ops_uint_store(&domain->epoch, 0, ATOMIC_OPS_FENCE_NONE);
+	atomic_ops_ptr_store(&domain->records, NULL, ATOMIC_OPS_FENCE_RELEASE);
+}
+
+// No thread may use the domain anymore: all deferred callbacks are run
+static inline void atomic_ops_epoch_domain_destroy(atomic_ops_epoch_domain *domain) {
+	atomic_ops_epoch_record *rec = atomic_ops_ptr_load(&domain->records, ATOMIC_OPS_FENCE_ACQUIRE);
+
+	while (rec != NULL) {
+		atomic_ops_epoch_record *next = rec->next;
+
+		for (size_t i = 0; i < rec->deferred_len; i++) {
+			rec->deferred[i].fn(rec->deferred[i].arg);
+		}
+
+		free(rec->deferred);
+		free(rec);
+
+		rec = next;
+	}
+
+	atomic_ops_ptr_store(&domain->records, NULL, ATOMIC_OPS_FENCE_RELEASE);
+}
+
+// Get a record for the calling thread, NULL if there's no memory for a new one
+static inline atomic_ops_epoch_record * atomic_ops_epoch_acquire(atomic_ops_epoch_domain *domain) {
+	atomic_ops_epoch_record *rec;
+
+	// Reuse a record some other thread released first
+	for (rec = atomic_ops_ptr_load(&domain->records, ATOMIC_OPS_FENCE_ACQUIRE); rec != NULL; rec = rec->next) {
+		if (atomic_ops_uint_load(&rec->active, ATOMIC_OPS_FENCE_NONE) == 0
+			&& atomic_ops_uint_cas(&rec->active, 0, 1, ATOMIC_OPS_FENCE_ACQUIRE)) {
+			return (rec);
+		}
+	}
+
+	size_t size = ((sizeof(atomic_ops_epoch_record) + ATOMIC_OPS_CACHELINE_SIZE - 1) / ATOMIC_OPS_CACHELINE_SIZE) * ATOMIC_OPS_CACHELINE_SIZE;
+
+	// Whole lines, so that records of different threads never share one
+	rec = aligned_alloc(ATOMIC_OPS_CACHELINE_SIZE, size);
+	if (rec == NULL) {
+		return (NULL);
+	}
+
+	memset(rec, 0, size);
+
+	atomic_ops_uint_store(&rec->epoch, 0, ATOMIC_OPS_FENCE_NONE);
+	atomic_ops_uint_store(&rec->active, 1, ATOMIC_OPS_FENCE_NONE);
+
+	atomic_ops_epoch_record *head = atomic_ops_ptr_load(&domain->records, ATOMIC_OPS_FENCE_NONE), *prev;
+
+	while (true) {
+		rec->next = head;
+
+		prev = atomic_ops_ptr_casr(&domain->records, head, rec, ATOMIC_OPS_FENCE_RELEASE);
+		if (prev == head) {
+			return (rec);
+		}
+
+		head = prev;
+	}
+}
+
+// Callbacks that can't run yet stay queued, to be run by the next owner
+static inline void atomic_ops_epoch_release(atomic_ops_epoch_domain *domain, atomic_ops_epoch_record *rec) {
+	rec->nesting = 0;
+	atomic_ops_uint_store(&rec->epoch, 0, ATOMIC_OPS_FENCE_RELEASE);
+
+	atomic_ops_epoch_reclaim(domain, rec);
+
+	atomic_ops_uint_store(&rec->active, 0, ATOMIC_OPS_FENCE_RELEASE);
+}
+
+// Start a critical section: nothing reached from here on gets freed until exit, can be nested
+static inline void atomic_ops_epoch_enter(atomic_ops_epoch_domain *domain, atomic_ops_epoch_record *rec) {
+	if (rec->nesting++ != 0) {
+		return;
+	}
+
+	uintptr_t epoch = atomic_ops_uint_load(&domain->epoch, ATOMIC_OPS_FENCE_NONE);
+
+	atomic_ops_uint_store(&rec->epoch, epoch | 1, ATOMIC_OPS_FENCE_NONE);
+
+	if (!domain->asymmetric) {
+		// The announcement must be visible before anything is read (#StoreLoad)
+		atomic_ops_fence(ATOMIC_OPS_FENCE_FULL);
+	}
+}
+
+static inline void atomic_ops_epoch_exit(atomic_ops_epoch_domain *domain, atomic_ops_epoch_record *rec) {
+	UNUSED_ARGUMENT(domain);
+
+	if (--rec->nesting != 0) {
+		return;
+	}
+
+	// Release: all reads in the critical section must be done before it ends
+	atomic_ops_uint_store(&rec->epoch, 0, ATOMIC_OPS_FENCE_RELEASE);
+}
+
+// QSBR: from now on, the thread may hold references until it reports a quiescent state
+static inline void atomic_ops_epoch_online(atomic_ops_epoch_domain *domain, atomic_ops_epoch_record *rec) {
+	rec->nesting = 0;
+
+	atomic_ops_epoch_enter(domain, rec);
+}
+
+// QSBR: the thread holds no references, and won't report quiescent states until back online
+static inline void atomic_ops_epoch_offline(atomic_ops_epoch_domain *domain, atomic_ops_epoch_record *rec) {
+	rec->nesting = 1;
+
+	atomic_ops_epoch_exit(domain, rec);
+}
+
+// QSBR: the thread holds no references right now
+static inline void atomic_ops_epoch_quiescent(atomic_ops_epoch_domain *domain, atomic_ops_epoch_record *rec) {
+	uintptr_t epoch = atomic_ops_uint_load(&domain->epoch, ATOMIC_OPS_FENCE_NONE);
+
+	// While online the record always blocks advancing past its epoch, so moving it forward needs no #StoreLoad
+	atomic_ops_uint_store(&rec->epoch, epoch | 1, ATOMIC_OPS_FENCE_RELEASE);
+}
+
+// Make room to queue one more callback, so the next defer or retire can't fail, false if there's no memory for it
+static inline bool atomic_ops_epoch_reserve(atomic_ops_epoch_domain *domain, atomic_ops_epoch_record *rec) {
+	if (rec->deferred_len < rec->deferred_size) {
+		return (true);
+	}
+
+	size_t size = (rec->deferred_size == 0) ? (ATOMIC_OPS_EPOCH_RECLAIM_THRESHOLD) : (rec->deferred_size * 2);
+	atomic_ops_epoch_deferred *deferred = realloc(rec->deferred, size * sizeof(atomic_ops_epoch_deferred));
+
+	if (deferred != NULL) {
+		rec->deferred = deferred;
+		rec->deferred_size = size;
+
+		return (true);
+	}
+
+	// Can't grow: running the callbacks that are due may still free a slot
+	atomic_ops_epoch_reclaim(domain, rec);
+
+	return (rec->deferred_len < rec->deferred_size);
+}
+
+// Run fn(arg) once all threads have left the critical sections they're in now, false if there's no memory to queue it
+static inline bool atomic_ops_epoch_defer(atomic_ops_epoch_domain *domain, atomic_ops_epoch_record *rec, atomic_ops_epoch_fn fn, void *arg) {
+	if (!atomic_ops_epoch_reserve(domain, rec)) {
+		return (false);
+	}
+
+	// Reading an older epoch than the current one only delays the callback
+	rec->deferred[rec->deferred_len].fn = fn;
+	rec->deferred[rec->deferred_len].arg = arg;
+	rec->deferred[rec->deferred_len].epoch = atomic_ops_uint_load(&domain->epoch, ATOMIC_OPS_FENCE_NONE);
+	rec->deferred_len++;
+
+	if (rec->deferred_len >= ATOMIC_OPS_EPOCH_RECLAIM_THRESHOLD) {
+		atomic_ops_epoch_reclaim(domain, rec);
+	}
+
+	return (true);
+}
+
+// Free ptr with free_fn once no reader can hold it anymore, it must be unreachable already
+static inline bool atomic_ops_epoch_retire(atomic_ops_epoch_domain *domain, atomic_ops_epoch_record *rec, void *ptr, atomic_ops_epoch_fn free_fn) {
+	return (atomic_ops_epoch_defer(domain, rec, free_fn, ptr));
+}
+
+// Try to advance the global epoch, false if some thread is still active in an older one
+static inline bool atomic_ops_epoch_advance(atomic_ops_epoch_domain *domain) {
+	uintptr_t epoch = atomic_ops_uint_load(&domain->epoch, ATOMIC_OPS_FENCE_NONE);
+
+	// Make the readers' announcements visible, and ours (the unlinking of retired objects) to them
+#if defined(ATOMIC_OPS_EPOCH_MEMBARRIER)
+	if (!domain->asymmetric || syscall(__NR_membarrier, MEMBARRIER_CMD_PRIVATE_EXPEDITED, 0, 0) != 0) {
+		atomic_ops_fence(ATOMIC_OPS_FENCE_FULL);
+	}
+#else
+	atomic_ops_fence(ATOMIC_OPS_FENCE_FULL);
+#endif
+
+	for (atomic_ops_epoch_record *r = atomic_ops_ptr_load(&domain->records, ATOMIC_OPS_FENCE_ACQUIRE); r != NULL; r = r->next) {
+		uintptr_t announced = atomic_ops_uint_load(&r->epoch, ATOMIC_OPS_FENCE_NONE);
+
+		if (announced != 0 && announced != (epoch | 1)) {
+			return (false);
+		}
+	}
+
+	// Failing means someone else advanced it, just as good
+	atomic_ops_uint_cas(&domain->epoch, epoch, epoch + 2, ATOMIC_OPS_FENCE_FULL);
+
+	return (true);
+}
+
+// Wait until all threads have left the critical sections they're in now, the caller must not be in one
+static inline void atomic_ops_epoch_synchronize(atomic_ops_epoch_domain *domain) {
+	uintptr_t target = atomic_ops_uint_load(&domain->epoch, ATOMIC_OPS_FENCE_NONE) + 4;
+
+	while ((intptr_t)(atomic_ops_uint_load(&domain->epoch, ATOMIC_OPS_FENCE_ACQUIRE) - target) < 0) {
+		if (!atomic_ops_epoch_advance(domain)) {
+			atomic_ops_pause();
+		}
+	}
+}
+
+// Run the deferred callbacks whose grace period has passed, returns how many were run
+static inline size_t atomic_ops_epoch_reclaim(atomic_ops_epoch_domain *domain, atomic_ops_epoch_record *rec) {
+	if (rec->deferred_len == 0) {
+		return (0);
+	}
+
+	atomic_ops_epoch_advance(domain);
+
+	uintptr_t epoch = atomic_ops_uint_load(&domain->epoch, ATOMIC_OPS_FENCE_ACQUIRE);
+	size_t done = 0;
+
+	// Two advances since deferring: everyone active back then has exited
+	while (done < rec->deferred_len && (intptr_t)(epoch - rec->deferred[done].epoch) >= 4) {
+		rec->deferred[done].fn(rec->deferred[done].arg);
+		done++;
+	}
+
+	rec->deferred_len -= done;
+	memmove(rec->deferred, rec->deferred + done, rec->deferred_len * sizeof(atomic_ops_epoch_deferred));
+
+	return (done);
+}
+
+#endif /* ATOMIC_OPS_EPOCH_H */
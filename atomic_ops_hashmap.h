@@ -0,0 +1,470 @@
+/**
+ * This file is part of the atomic_ops project.
+ *
+ * For the full copyright and license information, please view the COPYING
+ * file that was distributed with this source code.
+ *
+ * @copyright  (c) the atomic_ops project
+ * @author     Luca Longinotti <chtekk@longitekk.com>
+ * @license    BSD 2-clause
+ * @version    $Id$
+ */
+
+#ifndef ATOMIC_OPS_HASHMAP_H
+#define ATOMIC_OPS_HASHMAP_H 1
+
+/*
+ * Lock-free resizable hash map (Shalev-Shavit split-ordered list).
+ * All elements live in a single lock-free sorted list (Harris-Michael, with
+ * the flagptr flag marking deleted nodes), ordered by the bit-reversed hash
+ * of their key. With that order, the elements of any bucket are contiguous
+ * for every power-of-two number of buckets, and doubling the buckets splits
+ * each one exactly in two, in place: nothing is ever moved.
+ * Each bucket points to a dummy node in the list, where its elements start.
+ * Buckets are set up lazily, the first time an insert or erase needs them,
+ * by inserting their dummy node starting from their parent bucket's one.
+ * Growing the map is then a single CAS on the bucket count, so there's no
+ * rehashing pause at all, the work is spread over the following operations.
+ * The bucket directory is a fixed array of segments, segment N holding
+ * buckets [2^(N-1), 2^N), allocated on first use and installed with a CAS.
+ * Lookups don't set up buckets: if theirs doesn't exist yet, they start from
+ * the closest parent bucket that does. So they never write anything shared,
+ * just walk the list. Nodes are freed through epoch-based reclamation, each
+ * operation runs in a critical section on the caller's epoch record.
+ */
+
+#include "atomic_ops.h"
+#include "atomic_ops_epoch.h"
+#include <string.h>
+
+// Elements per bucket, on average, above which the buckets are doubled
+#if !defined(ATOMIC_OPS_HASHMAP_LOAD_FACTOR)
+	#define ATOMIC_OPS_HASHMAP_LOAD_FACTOR 2
+#endif
+
+#define ATOMIC_OPS_HASHMAP_BITS (sizeof(uintptr_t) * 8)
+
+/*
+ * Type Definitions
+ */
+
+typedef struct atomic_ops_hashmap_node atomic_ops_hashmap_node;
+
+struct atomic_ops_hashmap_node {
+	atomic_ops_flagptr next; // Flag set: this node is logically deleted
+	uintptr_t so_key; // Bit-reversed hash, lowest bit set for elements, clear for bucket dummies
+	uintptr_t key;
+	void *value;
+};
+
+typedef struct {
+	atomic_ops_ptr segments[ATOMIC_OPS_HASHMAP_BITS]; // Arrays of atomic_ops_ptr to dummy nodes
+	atomic_ops_uint buckets; // Number of buckets, a power of two
+	char pad0[ATOMIC_OPS_CACHELINE_SIZE - sizeof(atomic_ops_uint)];
+	atomic_ops_uint count; // Number of elements
+	char pad1[ATOMIC_OPS_CACHELINE_SIZE - sizeof(atomic_ops_uint)];
+	atomic_ops_epoch_domain *domain;
+} atomic_ops_hashmap;
+
+/*
+ * Functions
+ */
+
+static inline bool atomic_ops_hashmap_init(atomic_ops_hashmap *map, atomic_ops_epoch_domain *domain, size_t buckets);
+static inline void atomic_ops_hashmap_destroy(atomic_ops_hashmap *map);
+static inline size_t atomic_ops_hashmap_size(const atomic_ops_hashmap *map) ATTR_ALWAYSINLINE;
+static inline size_t atomic_ops_hashmap_buckets(const atomic_ops_hashmap *map) ATTR_ALWAYSINLINE;
+static inline bool atomic_ops_hashmap_lookup(atomic_ops_hashmap *map, atomic_ops_epoch_record *rec, uintptr_t key, void **value);
+static inline bool atomic_ops_hashmap_insert(atomic_ops_hashmap *map, atomic_ops_epoch_record *rec, uintptr_t key, void *value);
+static inline bool atomic_ops_hashmap_erase(atomic_ops_hashmap *map, atomic_ops_epoch_record *rec, uintptr_t key, void **value);
+
+/*
+ * Implementations
+ */
+
+static inline uintptr_t atomic_ops_hashmap_hash(uintptr_t key) {
+#if UINTPTR_MAX == UINT64_MAX
+	key ^= key >> 33;
+	key *= UINT64_C(0xFF51AFD7ED558CCD);
+	key ^= key >> 33;
+	key *= UINT64_C(0xC4CEB9FE1A85EC53);
+	key ^= key >> 33;
+#else
+	key ^= key >> 16;
+	key *= UINT32_C(0x85EBCA6B);
+	key ^= key >> 13;
+	key *= UINT32_C(0xC2B2AE35);
+	key ^= key >> 16;
+#endif
+
+	return (key);
+}
+
+static inline uintptr_t atomic_ops_hashmap_reverse(uintptr_t x) {
+	x = ((x >> 1) & (UINTPTR_MAX / 3)) | ((x & (UINTPTR_MAX / 3)) << 1);
+	x = ((x >> 2) & (UINTPTR_MAX / 5)) | ((x & (UINTPTR_MAX / 5)) << 2);
+	x = ((x >> 4) & (UINTPTR_MAX / 17)) | ((x & (UINTPTR_MAX / 17)) << 4);
+	x = ((x >> 8) & (UINTPTR_MAX / 257)) | ((x & (UINTPTR_MAX / 257)) << 8);
+	x = ((x >> 16) & (UINTPTR_MAX / 65537)) | ((x & (UINTPTR_MAX / 65537)) << 16);
+#if UINTPTR_MAX == UINT64_MAX
+	x = (x >> 32) | (x << 32);
+#endif
+
+	return (x);
+}
+
+// Index of the highest bit set, x must not be zero
+static inline size_t atomic_ops_hashmap_log2(uintptr_t x) {
+	return ((sizeof(unsigned long long) * 8) - 1 - (size_t)__builtin_clzll((unsigned long long)x));
+}
+
+// The bucket a bucket splits from: the same, minus the highest bit
+static inline uintptr_t atomic_ops_hashmap_parent(uintptr_t bucket) {
+	return (bucket & ~((uintptr_t)1 << atomic_ops_hashmap_log2(bucket)));
+}
+
+// Buckets go up to 2^(bits-1), so the top bit of the hash is free to mark elements
+static inline uintptr_t atomic_ops_hashmap_so_key(uintptr_t hash) {
+	return (atomic_ops_hashmap_reverse(hash | ((uintptr_t)1 << (ATOMIC_OPS_HASHMAP_BITS - 1))));
+}
+
+// Bucket b is in segment floor(log2(b)) + 1, bucket 0 alone in segment 0
+static inline atomic_ops_ptr * atomic_ops_hashmap_bucket(atomic_ops_hashmap *map, uintptr_t bucket, bool create) {
+	size_t segment = 0, index = 0;
+
+	if (bucket != 0) {
+		segment = atomic_ops_hashmap_log2(bucket) + 1;
+		index = bucket - ((uintptr_t)1 << (segment - 1));
+	}
+
+	atomic_ops_ptr *buckets = atomic_ops_ptr_load(&map->segments[segment], ATOMIC_OPS_FENCE_ACQUIRE);
+
+	if (buckets == NULL && create) {
+		size_t size = (segment == 0) ? (1) : ((size_t)1 << (segment - 1));
+
+		buckets = calloc(size, sizeof(atomic_ops_ptr));
+		if (buckets == NULL) {
+			return (NULL);
+		}
+
+		atomic_ops_ptr *prev = atomic_ops_ptr_casr(&map->segments[segment], NULL, buckets, ATOMIC_OPS_FENCE_FULL);
+
+		if (prev != NULL) {
+			free(buckets); // Someone else was faster
+			buckets = prev;
+		}
+	}
+
+	return ((buckets == NULL) ? (NULL) : (&buckets[index]));
+}
+
+// Find the first node not ordered before (so_key, key), starting at a dummy node, unlinking marked nodes on the way;
+// prev_out is NULL if a marked node was found but there's no memory to retire it
+static inline bool atomic_ops_hashmap_find(atomic_ops_hashmap *map, atomic_ops_epoch_record *rec, atomic_ops_hashmap_node *start,
+	uintptr_t so_key, uintptr_t key, atomic_ops_flagptr **prev_out, atomic_ops_hashmap_node **cur_out) {
+retry:
+	{
+		atomic_ops_flagptr *prev = &start->next;
+		atomic_ops_hashmap_node *cur = atomic_ops_flagptr_load(prev, NULL, ATOMIC_OPS_FENCE_ACQUIRE);
+
+		while (cur != NULL) {
+			bool marked;
+			atomic_ops_hashmap_node *next = atomic_ops_flagptr_load(&cur->next, &marked, ATOMIC_OPS_FENCE_ACQUIRE);
+
+			if (marked) {
+				// Whoever unlinks it must retire it, so only try with room for that
+				if (!atomic_ops_epoch_reserve(map->domain, rec)) {
+					*prev_out = NULL;
+					*cur_out = NULL;
+
+					return (false);
+				}
+
+				if (!atomic_ops_flagptr_cas(prev, cur, false, next, false, ATOMIC_OPS_FENCE_FULL)) {
+					goto retry;
+				}
+
+				// Can't fail, there's room reserved
+				atomic_ops_epoch_retire(map->domain, rec, cur, &free);
+
+				cur = next;
+				continue;
+			}
+
+			if (cur->so_key > so_key || (cur->so_key == so_key && cur->key >= key)) {
+				*prev_out = prev;
+				*cur_out = cur;
+
+				return (cur->so_key == so_key && cur->key == key);
+			}
+
+			prev = &cur->next;
+			cur = next;
+		}
+
+		*prev_out = prev;
+		*cur_out = NULL;
+
+		return (false);
+	}
+}
+
+// Dummy node of a bucket, setting it (and its parents) up if needed, NULL if there's no memory
+static inline atomic_ops_hashmap_node * atomic_ops_hashmap_dummy(atomic_ops_hashmap *map, atomic_ops_epoch_record *rec, uintptr_t bucket) {
+	atomic_ops_ptr *slot = atomic_ops_hashmap_bucket(map, bucket, true);
+
+	if (slot == NULL) {
+		return (NULL);
+	}
+
+	atomic_ops_hashmap_node *dummy = atomic_ops_ptr_load(slot, ATOMIC_OPS_FENCE_ACQUIRE);
+
+	if (dummy != NULL) {
+		return (dummy);
+	}
+
+	atomic_ops_hashmap_node *parent = atomic_ops_hashmap_dummy(map, rec, atomic_ops_hashmap_parent(bucket));
+
+	if (parent == NULL) {
+		return (NULL);
+	}
+
+	dummy = malloc(sizeof(atomic_ops_hashmap_node));
+	if (dummy == NULL) {
+		return (NULL);
+	}
+
+	dummy->so_key = atomic_ops_hashmap_reverse(bucket);
+	dummy->key = 0;
+	dummy->value = NULL;
+
+	atomic_ops_flagptr *prev;
+	atomic_ops_hashmap_node *cur;
+
+	while (true) {
+		if (atomic_ops_hashmap_find(map, rec, parent, dummy->so_key, 0, &prev, &cur)) {
+			free(dummy); // Someone else inserted it already
+			dummy = cur;
+			break;
+		}
+
+		if (prev == NULL) {
+			free(dummy);
+			return (NULL);
+		}
+
+		atomic_ops_flagptr_store(&dummy->next, cur, false, ATOMIC_OPS_FENCE_NONE);
+
+		if (atomic_ops_flagptr_cas(prev, cur, false, dummy, false, ATOMIC_OPS_FENCE_FULL)) {
+			break;
+		}
+	}
+
+	// Whoever loses this found the same dummy node in the list
+	atomic_ops_ptr_cas(slot, NULL, dummy, ATOMIC_OPS_FENCE_FULL);
+
+	return (dummy);
+}
+
+// The number of buckets must be a power of two, it doubles as needed from there
+static inline bool atomic_ops_hashmap_init(atomic_ops_hashmap *map, atomic_ops_epoch_domain *domain, size_t buckets) {
+	if (buckets == 0 || (buckets & (buckets - 1)) != 0) {
+		return (false);
+	}
+
+	for (size_t i = 0; i < ATOMIC_OPS_HASHMAP_BITS; i++) {
+		atomic_ops_ptr_store(&map->segments[i], NULL, ATOMIC_OPS_FENCE_NONE);
+	}
+
+	map->domain = domain;
+
+	// Bucket 0 always exists: all others are set up from it
+	atomic_ops_hashmap_node *head = calloc(1, sizeof(atomic_ops_hashmap_node));
+	atomic_ops_ptr *slot = atomic_ops_hashmap_bucket(map, 0, true);
+
+	if (head == NULL || slot == NULL) {
+		free(head);
+		free(atomic_ops_ptr_load(&map->segments[0], ATOMIC_OPS_FENCE_NONE));
+		return (false);
+	}
+
+	atomic_ops_flagptr_store(&head->next, NULL, false, ATOMIC_OPS_FENCE_NONE);
+	atomic_ops_ptr_store(slot, head, ATOMIC_OPS_FENCE_NONE);
+
+	atomic_ops_uint_store(&map->count, 0, ATOMIC_OPS_FENCE_NONE);
+	atomic_ops_uint_store(&map->buckets, buckets, ATOMIC_OPS_FENCE_RELEASE);
+
+	return (true);
+}
+
+// No thread may use the map anymore
+static inline void atomic_ops_hashmap_destroy(atomic_ops_hashmap *map) {
+	atomic_ops_hashmap_node *node = atomic_ops_ptr_load(atomic_ops_hashmap_bucket(map, 0, false), ATOMIC_OPS_FENCE_ACQUIRE);
+
+	// Dummy nodes are in the list too
+	while (node != NULL) {
+		atomic_ops_hashmap_node *next = atomic_ops_flagptr_load(&node->next, NULL, ATOMIC_OPS_FENCE_NONE);
+
+		free(node);
+		node = next;
+	}
+
+	for (size_t i = 0; i < ATOMIC_OPS_HASHMAP_BITS; i++) {
+		free(atomic_ops_ptr_load(&map->segments[i], ATOMIC_OPS_FENCE_NONE));
+		atomic_ops_ptr_store(&map->segments[i], NULL, ATOMIC_OPS_FENCE_NONE);
+	}
+}
+
+// Only a snapshot: concurrent operations may change it right away
+static inline size_t atomic_ops_hashmap_size(const atomic_ops_hashmap *map) {
+	return (atomic_ops_uint_load(&map->count, ATOMIC_OPS_FENCE_NONE));
+}
+
+static inline size_t atomic_ops_hashmap_buckets(const atomic_ops_hashmap *map) {
+	return (atomic_ops_uint_load(&map->buckets, ATOMIC_OPS_FENCE_NONE));
+}
+
+// Only loads: walks the list from the closest bucket that's set up, ignoring deleted nodes
+static inline bool atomic_ops_hashmap_lookup(atomic_ops_hashmap *map, atomic_ops_epoch_record *rec, uintptr_t key, void **value) {
+	uintptr_t hash = atomic_ops_hashmap_hash(key), so_key = atomic_ops_hashmap_so_key(hash);
+	uintptr_t bucket = hash & (atomic_ops_uint_load(&map->buckets, ATOMIC_OPS_FENCE_NONE) - 1);
+	bool marked = true;
+
+	atomic_ops_epoch_enter(map->domain, rec);
+
+	atomic_ops_hashmap_node *cur = NULL;
+
+	while (true) {
+		atomic_ops_ptr *slot = atomic_ops_hashmap_bucket(map, bucket, false);
+
+		if (slot != NULL && (cur = atomic_ops_ptr_load(slot, ATOMIC_OPS_FENCE_ACQUIRE)) != NULL) {
+			break;
+		}
+
+		bucket = atomic_ops_hashmap_parent(bucket);
+	}
+
+	while (cur != NULL && (cur->so_key < so_key || (cur->so_key == so_key && cur->key < key))) {
+		cur = atomic_ops_flagptr_load(&cur->next, NULL, ATOMIC_OPS_FENCE_ACQUIRE);
+	}
+
+	if (cur != NULL && cur->so_key == so_key && cur->key == key) {
+		atomic_ops_flagptr_load(&cur->next, &marked, ATOMIC_OPS_FENCE_NONE);
+
+		if (!marked && value != NULL) {
+			*value = cur->value;
+		}
+	}
+
+	atomic_ops_epoch_exit(map->domain, rec);
+
+	return (!marked);
+}
+
+// False if the key is present already, or there's no memory for a new node or to retire deleted ones
+static inline bool atomic_ops_hashmap_insert(atomic_ops_hashmap *map, atomic_ops_epoch_record *rec, uintptr_t key, void *value) {
+	uintptr_t hash = atomic_ops_hashmap_hash(key);
+	uintptr_t buckets = atomic_ops_uint_load(&map->buckets, ATOMIC_OPS_FENCE_NONE);
+	atomic_ops_hashmap_node *node = malloc(sizeof(atomic_ops_hashmap_node));
+	atomic_ops_flagptr *prev;
+	atomic_ops_hashmap_node *cur;
+
+	if (node == NULL) {
+		return (false);
+	}
+
+	node->so_key = atomic_ops_hashmap_so_key(hash);
+	node->key = key;
+	node->value = value;
+
+	atomic_ops_epoch_enter(map->domain, rec);
+
+	atomic_ops_hashmap_node *dummy = atomic_ops_hashmap_dummy(map, rec, hash & (buckets - 1));
+
+	if (dummy == NULL) {
+		atomic_ops_epoch_exit(map->domain, rec);
+		free(node);
+
+		return (false);
+	}
+
+	while (true) {
+		if (atomic_ops_hashmap_find(map, rec, dummy, node->so_key, key, &prev, &cur) || prev == NULL) {
+			atomic_ops_epoch_exit(map->domain, rec);
+			free(node);
+
+			return (false);
+		}
+
+		atomic_ops_flagptr_store(&node->next, cur, false, ATOMIC_OPS_FENCE_NONE);
+
+		// Full: the node's contents must be visible before it is
+		if (atomic_ops_flagptr_cas(prev, cur, false, node, false, ATOMIC_OPS_FENCE_FULL)) {
+			break;
+		}
+	}
+
+	atomic_ops_epoch_exit(map->domain, rec);
+
+	// Growing is just doubling the count, buckets get split lazily as they're used
+	uintptr_t count = atomic_ops_uint_fetch_and_inc(&map->count, ATOMIC_OPS_FENCE_NONE) + 1;
+
+	if (count / buckets > ATOMIC_OPS_HASHMAP_LOAD_FACTOR && buckets < ((uintptr_t)1 << (ATOMIC_OPS_HASHMAP_BITS - 1))) {
+		atomic_ops_uint_cas(&map->buckets, buckets, buckets * 2, ATOMIC_OPS_FENCE_NONE);
+	}
+
+	return (true);
+}
+
+// False if the key isn't present, or there's no memory to retire its node, else its value is returned in value (if not NULL)
+static inline bool atomic_ops_hashmap_erase(atomic_ops_hashmap *map, atomic_ops_epoch_record *rec, uintptr_t key, void **value) {
+	uintptr_t hash = atomic_ops_hashmap_hash(key), so_key = atomic_ops_hashmap_so_key(hash);
+	atomic_ops_flagptr *prev;
+	atomic_ops_hashmap_node *cur;
+
+	atomic_ops_epoch_enter(map->domain, rec);
+
+	atomic_ops_hashmap_node *dummy = atomic_ops_hashmap_dummy(map, rec, hash & (atomic_ops_uint_load(&map->buckets, ATOMIC_OPS_FENCE_NONE) - 1));
+
+	// Without memory for its bucket, fall back to the first one: slower, but still correct
+	if (dummy == NULL) {
+		dummy = atomic_ops_ptr_load(atomic_ops_hashmap_bucket(map, 0, false), ATOMIC_OPS_FENCE_ACQUIRE);
+	}
+
+	while (true) {
+		if (!atomic_ops_hashmap_find(map, rec, dummy, so_key, key, &prev, &cur) || !atomic_ops_epoch_reserve(map->domain, rec)) {
+			atomic_ops_epoch_exit(map->domain, rec);
+
+			return (false);
+		}
+
+		bool marked;
+		atomic_ops_hashmap_node *next = atomic_ops_flagptr_load(&cur->next, &marked, ATOMIC_OPS_FENCE_ACQUIRE);
+
+		// Marking it is what removes it: whoever succeeds at that owns the removal
+		if (marked || !atomic_ops_flagptr_cas(&cur->next, next, false, next, true, ATOMIC_OPS_FENCE_FULL)) {
+			continue;
+		}
+
+		if (value != NULL) {
+			*value = cur->value;
+		}
+
+		// If unlinking fails, some search already did or will do it
+		if (atomic_ops_flagptr_cas(prev, cur, false, next, false, ATOMIC_OPS_FENCE_FULL)) {
+			// Can't fail, there's room reserved
+			atomic_ops_epoch_retire(map->domain, rec, cur, &free);
+		}
+		else {
+			atomic_ops_hashmap_find(map, rec, dummy, so_key, key, &prev, &cur);
+		}
+
+		atomic_ops_epoch_exit(map->domain, rec);
+
+		atomic_ops_uint_dec(&map->count, ATOMIC_OPS_FENCE_NONE);
+
+		return (true);
+	}
+}
+
+#endif /* ATOMIC_OPS_HASHMAP_H */
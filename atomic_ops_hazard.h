@@ -0,0 +1,326 @@
+/**
+ * This file is part of the atomic_ops project.
+ *
+ * For the full copyright and license information, please view the COPYING
+ * file that was distributed with this source code.
+ *
+ * @copyright  (c) the atomic_ops project
+ * @author     Luca Longinotti <chtekk@longitekk.com>
+ * @license    BSD 2-clause
+ * @version    $Id$
+ */
+
+#ifndef ATOMIC_OPS_HAZARD_H
+#define ATOMIC_OPS_HAZARD_H 1
+
+/*
+ * Hazard-pointer memory reclamation.
+ * Every thread using a domain owns a record with ATOMIC_OPS_HAZARD_SLOTS
+ * hazard slots. Before dereferencing a shared pointer, a thread publishes it
+ * in one of its slots and checks the pointer is still reachable from where it
+ * read it: from then on, nobody frees it until the slot is cleared. On x86
+ * this costs one store and an mfence per protected pointer.
+ * Removed objects are retired to the owning thread's record, and freed in
+ * batches: once enough have piled up, a scan collects all published hazards,
+ * sorts them, and frees every retired object not found among them. The scan
+ * threshold grows with the number of slots, so that each scan frees at least
+ * half of what was retired and the cost per retired object stays constant.
+ * Records are never freed before the domain itself, only reused by threads
+ * acquiring a record after others released theirs.
+ */
+
+#include "atomic_ops.h"
+#include <string.h>
+
+// Hazard slots per record, how many pointers a thread can hold at once
+#if !defined(ATOMIC_OPS_HAZARD_SLOTS)
+	#define ATOMIC_OPS_HAZARD_SLOTS 4
+#endif
+
+// Minimum number of retired objects per record before a scan is done
+#if !defined(ATOMIC_OPS_HAZARD_SCAN_THRESHOLD)
+	#define ATOMIC_OPS_HAZARD_SCAN_THRESHOLD 64
+#endif
+
+/*
+ * Type Definitions
+ */
+
+typedef void (*atomic_ops_hazard_free_fn)(void *ptr);
+
+typedef struct {
+	void *ptr;
+	atomic_ops_hazard_free_fn free_fn;
+} atomic_ops_hazard_retired;
+
+typedef struct atomic_ops_hazard_record atomic_ops_hazard_record;
+
+struct atomic_ops_hazard_record {
+	atomic_ops_ptr slots[ATOMIC_OPS_HAZARD_SLOTS]; // Read by all scanning threads
+	atomic_ops_uint active; // Owned by a thread or not
+	atomic_ops_hazard_record *next; // Set once, before the record is published
+	// Only ever accessed by the owning thread
+	atomic_ops_hazard_retired *retired;
+	size_t retired_len;
+	size_t retired_size;
+	void **hazards; // Scratch space for scans
+	size_t hazards_size;
+};
+
+typedef struct {
+	atomic_ops_ptr records; // List of all records, it only ever grows
+	atomic_ops_uint records_count;
+} atomic_ops_hazard_domain;
+
+#define ATOMIC_OPS_HAZARD_DOMAIN_INIT { ATOMIC_OPS_PTR_INIT(NULL), ATOMIC_OPS_UINT_INIT(0) }
+
+/*
+ * Functions
+ */
+
+static inline void atomic_ops_hazard_domain_init(atomic_ops_hazard_domain *domain);
+static inline void atomic_ops_hazard_domain_destroy(atomic_ops_hazard_domain *domain);
+static inline atomic_ops_hazard_record * atomic_ops_hazard_acquire(atomic_ops_hazard_domain *domain);
+static inline void atomic_ops_hazard_release(atomic_ops_hazard_domain *domain, atomic_ops_hazard_record *rec);
+static inline void * atomic_ops_hazard_protect(atomic_ops_hazard_record *rec, size_t slot, const atomic_ops_ptr *src) ATTR_ALWAYSINLINE;
+static inline void * atomic_ops_hazard_protect_flagptr(atomic_ops_hazard_record *rec, size_t slot, const atomic_ops_flagptr *src, bool *flag) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_hazard_set(atomic_ops_hazard_record *rec, size_t slot, void *ptr) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_hazard_clear(atomic_ops_hazard_record *rec, size_t slot) ATTR_ALWAYSINLINE;
+static inline bool atomic_ops_hazard_retire(atomic_ops_hazard_domain *domain, atomic_ops_hazard_record *rec, void *ptr, atomic_ops_hazard_free_fn free_fn);
+static inline size_t atomic_ops_hazard_scan(atomic_ops_hazard_domain *domain, atomic_ops_hazard_record *rec);
+
+/*
+ * Implementations
+ */
+
+static inline void atomic_ops_hazard_domain_init(atomic_ops_hazard_domain *domain) {
+	atomic_ops_uint_store(&domain->records_count, 0, ATOMIC_OPS_FENCE_NONE);
+	atomic_ops_ptr_store(&domain->records, NULL, ATOMIC_OPS_FENCE_RELEASE);
+}
+
+// No thread may use the domain anymore: everything still retired is freed
+static inline void atomic_ops_hazard_domain_destroy(atomic_ops_hazard_domain *domain) {
+	atomic_ops_hazard_record *rec = atomic_ops_ptr_load(&domain->records, ATOMIC_OPS_FENCE_ACQUIRE);
+
+	while (rec != NULL) {
+		atomic_ops_hazard_record *next = rec->next;
+
+		for (size_t i = 0; i < rec->retired_len; i++) {
+			rec->retired[i].free_fn(rec->retired[i].ptr);
+		}
+
+		free(rec->retired);
+		free(rec->hazards);
+		free(rec);
+
+		rec = next;
+	}
+
+	atomic_ops_uint_store(&domain->records_count, 0, ATOMIC_OPS_FENCE_NONE);
+	atomic_ops_ptr_store(&domain->records, NULL, ATOMIC_OPS_FENCE_RELEASE);
+}
+
+// Get a record for the calling thread, NULL if there's no memory for a new one
+static inline atomic_ops_hazard_record * atomic_ops_hazard_acquire(atomic_ops_hazard_domain *domain) {
+	atomic_ops_hazard_record *rec;
+
+	// Reuse a record some other thread released first
+	for (rec = atomic_ops_ptr_load(&domain->records, ATOMIC_OPS_FENCE_ACQUIRE); rec != NULL; rec = rec->next) {
+		if (atomic_ops_uint_load(&rec->active, ATOMIC_OPS_FENCE_NONE) == 0
+			&& atomic_ops_uint_cas(&rec->active, 0, 1, ATOMIC_OPS_FENCE_ACQUIRE)) {
+			return (rec);
+		}
+	}
+
+	size_t size = ((sizeof(atomic_ops_hazard_record) + ATOMIC_OPS_CACHELINE_SIZE - 1) / ATOMIC_OPS_CACHELINE_SIZE) * ATOMIC_OPS_CACHELINE_SIZE;
+
+	// Whole lines, so that records of different threads never share one
+	rec = aligned_alloc(ATOMIC_OPS_CACHELINE_SIZE, size);
+	if (rec == NULL) {
+		return (NULL);
+	}
+
+	memset(rec, 0, size);
+
+	for (size_t i = 0; i < ATOMIC_OPS_HAZARD_SLOTS; i++) {
+		atomic_ops_ptr_store(&rec->slots[i], NULL, ATOMIC_OPS_FENCE_NONE);
+	}
+
+	atomic_ops_uint_store(&rec->active, 1, ATOMIC_OPS_FENCE_NONE);
+
+	// Counted before being published: scans presize their snapshot on the count
+	atomic_ops_uint_inc(&domain->records_count, ATOMIC_OPS_FENCE_NONE);
+
+	atomic_ops_hazard_record *head = atomic_ops_ptr_load(&domain->records, ATOMIC_OPS_FENCE_NONE), *prev;
+
+	while (true) {
+		rec->next = head;
+
+		prev = atomic_ops_ptr_casr(&domain->records, head, rec, ATOMIC_OPS_FENCE_RELEASE);
+		if (prev == head) {
+			return (rec);
+		}
+
+		head = prev;
+	}
+}
+
+// Objects still protected elsewhere stay retired, to be freed by the next owner
+static inline void atomic_ops_hazard_release(atomic_ops_hazard_domain *domain, atomic_ops_hazard_record *rec) {
+	for (size_t i = 0; i < ATOMIC_OPS_HAZARD_SLOTS; i++) {
+		atomic_ops_hazard_clear(rec, i);
+	}
+
+	atomic_ops_hazard_scan(domain, rec);
+
+	atomic_ops_uint_store(&rec->active, 0, ATOMIC_OPS_FENCE_RELEASE);
+}
+
+// Read src and protect the result in slot, it can be dereferenced until the slot is cleared or reused
+static inline void * atomic_ops_hazard_protect(atomic_ops_hazard_record *rec, size_t slot, const atomic_ops_ptr *src) {
+	void *ptr = atomic_ops_ptr_load(src, ATOMIC_OPS_FENCE_NONE);
+
+	while (true) {
+		// Full: the hazard must be visible to scans before src is checked again (#StoreLoad)
+		atomic_ops_ptr_store(&rec->slots[slot], ptr, ATOMIC_OPS_FENCE_FULL);
+
+		void *check = atomic_ops_ptr_load(src, ATOMIC_OPS_FENCE_ACQUIRE);
+		if (check == ptr) {
+			return (ptr);
+		}
+
+		ptr = check;
+	}
+}
+
+// Like protect, but the flag is stripped from the hazard and returned separately
+static inline void * atomic_ops_hazard_protect_flagptr(atomic_ops_hazard_record *rec, size_t slot, const atomic_ops_flagptr *src, bool *flag) {
+	void *flagptr = atomic_ops_flagptr_load_full(src, NULL, ATOMIC_OPS_FENCE_NONE);
+
+	while (true) {
+		atomic_ops_ptr_store(&rec->slots[slot], ATOMIC_OPS_FLAGPTR_MASKPTR(flagptr), ATOMIC_OPS_FENCE_FULL);
+
+		void *check = atomic_ops_flagptr_load_full(src, NULL, ATOMIC_OPS_FENCE_ACQUIRE);
+		if (check == flagptr) {
+			if (flag != NULL) {
+				*flag = ATOMIC_OPS_FLAGPTR_MASKFLAG(flagptr);
+			}
+
+			return (ATOMIC_OPS_FLAGPTR_MASKPTR(flagptr));
+		}
+
+		flagptr = check;
+	}
+}
+
+// Protect a pointer known to be safe already, e.g. one held in another slot
+static inline void atomic_ops_hazard_set(atomic_ops_hazard_record *rec, size_t slot, void *ptr) {
+	atomic_ops_ptr_store(&rec->slots[slot], ptr, ATOMIC_OPS_FENCE_FULL);
+}
+
+static inline void atomic_ops_hazard_clear(atomic_ops_hazard_record *rec, size_t slot) {
+	// Release: all accesses through the pointer must be done before it can be freed
+	atomic_ops_ptr_store(&rec->slots[slot], NULL, ATOMIC_OPS_FENCE_RELEASE);
+}
+
+// Free ptr with free_fn once no hazard protects it anymore, false if there's no memory to track it
+static inline bool atomic_ops_hazard_retire(atomic_ops_hazard_domain *domain, atomic_ops_hazard_record *rec, void *ptr, atomic_ops_hazard_free_fn free_fn) {
+	if (rec->retired_len == rec->retired_size) {
+		size_t size = (rec->retired_size == 0) ? (ATOMIC_OPS_HAZARD_SCAN_THRESHOLD) : (rec->retired_size * 2);
+		atomic_ops_hazard_retired *retired = realloc(rec->retired, size * sizeof(atomic_ops_hazard_retired));
+
+		if (retired == NULL) {
+			return (false);
+		}
+
+		rec->retired = retired;
+		rec->retired_size = size;
+	}
+
+	rec->retired[rec->retired_len].ptr = ptr;
+	rec->retired[rec->retired_len].free_fn = free_fn;
+	rec->retired_len++;
+
+	// Twice the number of hazards: at least half of the retired objects get freed
+	size_t threshold = 2 * ATOMIC_OPS_HAZARD_SLOTS * atomic_ops_uint_load(&domain->records_count, ATOMIC_OPS_FENCE_NONE);
+
+	if (rec->retired_len >= threshold && rec->retired_len >= ATOMIC_OPS_HAZARD_SCAN_THRESHOLD) {
+		atomic_ops_hazard_scan(domain, rec);
+	}
+
+	return (true);
+}
+
+static inline int atomic_ops_hazard_compare(const void *a, const void *b) {
+	uintptr_t pa = (uintptr_t)*(void * const *)a, pb = (uintptr_t)*(void * const *)b;
+
+	return ((pa > pb) - (pa < pb));
+}
+
+// Free all retired objects no hazard protects, returns how many were freed
+static inline size_t atomic_ops_hazard_scan(atomic_ops_hazard_domain *domain, atomic_ops_hazard_record *rec) {
+	// Only a first guess: records keep being pushed while the list is walked
+	size_t size = ATOMIC_OPS_HAZARD_SLOTS * atomic_ops_uint_load(&domain->records_count, ATOMIC_OPS_FENCE_NONE);
+
+	if (rec->hazards_size < size) {
+		void **hazards = realloc(rec->hazards, size * sizeof(void *));
+
+		if (hazards == NULL) {
+			return (0); // Retry on the next scan
+		}
+
+		rec->hazards = hazards;
+		rec->hazards_size = size;
+	}
+
+	// Full: the unlinking of the retired objects must be visible before hazards are read (#StoreLoad)
+	atomic_ops_fence(ATOMIC_OPS_FENCE_FULL);
+
+	size_t len = 0;
+
+	// The whole list: new records go in at the head, the oldest ones are at the tail
+	for (atomic_ops_hazard_record *r = atomic_ops_ptr_load(&domain->records, ATOMIC_OPS_FENCE_ACQUIRE); r != NULL; r = r->next) {
+		if (rec->hazards_size - len < ATOMIC_OPS_HAZARD_SLOTS) {
+			size = (rec->hazards_size == 0) ? (ATOMIC_OPS_HAZARD_SLOTS) : (rec->hazards_size * 2);
+			void **hazards = realloc(rec->hazards, size * sizeof(void *));
+
+			if (hazards == NULL) {
+				return (0); // Not all hazards are known, nothing can be freed
+			}
+
+			rec->hazards = hazards;
+			rec->hazards_size = size;
+		}
+
+		for (size_t i = 0; i < ATOMIC_OPS_HAZARD_SLOTS; i++) {
+			void *hazard = atomic_ops_ptr_load(&r->slots[i], ATOMIC_OPS_FENCE_NONE);
+
+			if (hazard != NULL) {
+				rec->hazards[len++] = hazard;
+			}
+		}
+	}
+
+	// Acquire: accesses through the hazards must be done before freeing what they protected
+	atomic_ops_fence(ATOMIC_OPS_FENCE_ACQUIRE);
+
+	qsort(rec->hazards, len, sizeof(void *), &atomic_ops_hazard_compare);
+
+	size_t kept = 0, freed = 0;
+
+	for (size_t i = 0; i < rec->retired_len; i++) {
+		if (len != 0 && bsearch(&rec->retired[i].ptr, rec->hazards, len, sizeof(void *), &atomic_ops_hazard_compare) != NULL) {
+			rec->retired[kept++] = rec->retired[i];
+		}
+		else {
+			rec->retired[i].free_fn(rec->retired[i].ptr);
+			freed++;
+		}
+	}
+
+	rec->retired_len = kept;
+
+	return (freed);
+}
+
+#endif /* ATOMIC_OPS_HAZARD_H */
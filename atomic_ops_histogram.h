@@ -0,0 +1,309 @@
+/**
+ * This file is part of the atomic_ops project.
+ *
+ * For the full copyright and license information, please view the COPYING
+ * file that was distributed with this source code.
+ *
+ * @copyright  (c) the atomic_ops project
+ * @author     Luca Longinotti <chtekk@longitekk.com>
+ * @license    BSD 2-clause
+ * @version    $Id$
+ */
+
+#ifndef ATOMIC_OPS_HISTOGRAM_H
+#define ATOMIC_OPS_HISTOGRAM_H 1
+
+/*
+ * Histogram with many buckets, updated from many threads.
+ * Threads don't add to the shared buckets one sample at a time: each buffers
+ * its samples in a local table, and flushes them as one atomic add per bucket
+ * touched, once the table fills up, every ATOMIC_OPS_HISTOGRAM_FLUSH samples,
+ * or when asked to. Samples usually fall into few buckets (latencies, sizes),
+ * so a flush carries many samples per add, and the bucket lines are pulled
+ * exclusively that many times less.
+ * Histograms of up to ATOMIC_OPS_HISTOGRAM_DENSE buckets get a dense local
+ * table, one plain counter per bucket: adding is a plain increment, flushing
+ * scans the range of buckets touched, skipping blocks of counters that are
+ * all zero (a loop the compiler vectorizes). As a flush carries more samples
+ * than there are buckets, even uniformly spread samples need at most one add
+ * per ATOMIC_OPS_HISTOGRAM_FLUSH / buckets samples. Bigger histograms get a
+ * small hash table of ATOMIC_OPS_HISTOGRAM_BUFFER entries instead, which only
+ * pays off if most samples fall into fewer buckets than that.
+ * Flushes hold the read side of an rwlock, so they run in parallel, while
+ * snapshots hold the write side: a snapshot sees every flush either whole or
+ * not at all. Samples still buffered in local tables aren't seen.
+ */
+
+#include "atomic_ops.h"
+#include "atomic_ops_rwlock.h"
+#include <string.h>
+
+// Histograms with up to this many buckets get dense local tables
+#if !defined(ATOMIC_OPS_HISTOGRAM_DENSE)
+	#define ATOMIC_OPS_HISTOGRAM_DENSE 4096
+#endif
+
+// Entries in sparse local tables, a power of two; flushed once three quarters are used
+#if !defined(ATOMIC_OPS_HISTOGRAM_BUFFER)
+	#define ATOMIC_OPS_HISTOGRAM_BUFFER 256
+#endif
+
+// Samples buffered before a local table is flushed anyway, bounding how stale the buckets get
+#if !defined(ATOMIC_OPS_HISTOGRAM_FLUSH)
+	#define ATOMIC_OPS_HISTOGRAM_FLUSH 65536
+#endif
+
+// Dense counters checked together for zero when flushing
+#define ATOMIC_OPS_HISTOGRAM_SCAN 8
+
+/*
+ * Type Definitions
+ */
+
+typedef struct {
+	atomic_ops_uint *buckets;
+	size_t size;
+	atomic_ops_rwlock lock; // Read side for flushes, write side for snapshots
+} atomic_ops_histogram;
+
+// Owned by one thread
+typedef struct {
+	atomic_ops_histogram *hist;
+	uintptr_t *dense; // One counter per bucket, NULL for sparse tables
+	size_t lo; // Dense: buckets touched since the last flush are in [lo, hi)
+	size_t hi;
+	size_t used; // Sparse: entries used
+	size_t pending; // Samples since the last flush
+	uintptr_t keys[ATOMIC_OPS_HISTOGRAM_BUFFER]; // Sparse: bucket + 1, zero if the entry is free
+	uintptr_t counts[ATOMIC_OPS_HISTOGRAM_BUFFER];
+} atomic_ops_histogram_local;
+
+/*
+ * Functions
+ */
+
+static inline bool atomic_ops_histogram_init(atomic_ops_histogram *hist, size_t size);
+static inline void atomic_ops_histogram_destroy(atomic_ops_histogram *hist);
+static inline bool atomic_ops_histogram_local_init(atomic_ops_histogram_local *local, atomic_ops_histogram *hist);
+static inline void atomic_ops_histogram_local_destroy(atomic_ops_histogram_local *local);
+static inline void atomic_ops_histogram_add(atomic_ops_histogram_local *local, size_t bucket, uintptr_t val) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_histogram_inc(atomic_ops_histogram_local *local, size_t bucket) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_histogram_flush(atomic_ops_histogram_local *local);
+static inline uintptr_t atomic_ops_histogram_read(const atomic_ops_histogram *hist, size_t bucket) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_histogram_snapshot(atomic_ops_histogram *hist, uintptr_t *out);
+static inline void atomic_ops_histogram_reset(atomic_ops_histogram *hist, uintptr_t *out);
+
+/*
+ * Implementations
+ */
+
+// False if size is zero or there's no memory for the buckets
+static inline bool atomic_ops_histogram_init(atomic_ops_histogram *hist, size_t size) {
+	if (size == 0) {
+		return (false);
+	}
+
+	hist->buckets = malloc(size * sizeof(atomic_ops_uint));
+
+	if (hist->buckets == NULL) {
+		return (false);
+	}
+
+	if (!atomic_ops_rwlock_init(&hist->lock, ATOMIC_OPS_RWLOCK_WRITER)) {
+		free(hist->buckets);
+		return (false);
+	}
+
+	hist->size = size;
+
+	for (size_t i = 0; i < size; i++) {
+		atomic_ops_uint_store(&hist->buckets[i], 0, ATOMIC_OPS_FENCE_NONE);
+	}
+
+	atomic_ops_fence(ATOMIC_OPS_FENCE_RELEASE);
+
+	return (true);
+}
+
+// No thread may use the histogram anymore, local tables included
+static inline void atomic_ops_histogram_destroy(atomic_ops_histogram *hist) {
+	atomic_ops_rwlock_destroy(&hist->lock);
+	free(hist->buckets);
+	hist->buckets = NULL;
+}
+
+// False if there's no memory for a dense table
+static inline bool atomic_ops_histogram_local_init(atomic_ops_histogram_local *local, atomic_ops_histogram *hist) {
+	local->hist = hist;
+	local->dense = NULL;
+
+	if (hist->size <= ATOMIC_OPS_HISTOGRAM_DENSE) {
+		local->dense = calloc(hist->size, sizeof(uintptr_t));
+
+		if (local->dense == NULL) {
+			return (false);
+		}
+	}
+
+	local->lo = hist->size;
+	local->hi = 0;
+	local->used = 0;
+	local->pending = 0;
+
+	memset(local->keys, 0, sizeof(local->keys));
+
+	return (true);
+}
+
+// Flushes what's left
+static inline void atomic_ops_histogram_local_destroy(atomic_ops_histogram_local *local) {
+	atomic_ops_histogram_flush(local);
+
+	free(local->dense);
+	local->dense = NULL;
+}
+
+// Sparse table slot of a bucket, multiplicative hashing: neighbouring buckets spread out
+static inline size_t atomic_ops_histogram_slot(size_t bucket) {
+	return ((size_t)(((uint32_t)bucket * UINT32_C(0x9E3779B1)) >> 16) & (ATOMIC_OPS_HISTOGRAM_BUFFER - 1));
+}
+
+// Sparse tables only: false if the bucket isn't there and the table is full
+static inline bool atomic_ops_histogram_buffer(atomic_ops_histogram_local *local, size_t bucket, uintptr_t val) {
+	for (size_t i = atomic_ops_histogram_slot(bucket); ; i = (i + 1) & (ATOMIC_OPS_HISTOGRAM_BUFFER - 1)) {
+		if (local->keys[i] == bucket + 1) {
+			local->counts[i] += val;
+			return (true);
+		}
+
+		if (local->keys[i] == 0) {
+			if (local->used == (ATOMIC_OPS_HISTOGRAM_BUFFER / 4) * 3) {
+				return (false);
+			}
+
+			local->keys[i] = bucket + 1;
+			local->counts[i] = val;
+			local->used++;
+			return (true);
+		}
+	}
+}
+
+// bucket must be below the histogram's size; wraps around like uintptr_t
+static inline void atomic_ops_histogram_add(atomic_ops_histogram_local *local, size_t bucket, uintptr_t val) {
+	if (local->dense != NULL) {
+		local->dense[bucket] += val;
+
+		if (bucket < local->lo) {
+			local->lo = bucket;
+		}
+
+		if (bucket >= local->hi) {
+			local->hi = bucket + 1;
+		}
+	}
+	else if (!atomic_ops_histogram_buffer(local, bucket, val)) {
+		atomic_ops_histogram_flush(local);
+		atomic_ops_histogram_buffer(local, bucket, val);
+	}
+
+	if (++local->pending == ATOMIC_OPS_HISTOGRAM_FLUSH) {
+		atomic_ops_histogram_flush(local);
+	}
+}
+
+static inline void atomic_ops_histogram_inc(atomic_ops_histogram_local *local, size_t bucket) {
+	atomic_ops_histogram_add(local, bucket, 1);
+}
+
+// Adds the buffered samples to the shared buckets, all of them at once for snapshots
+static inline void atomic_ops_histogram_flush(atomic_ops_histogram_local *local) {
+	atomic_ops_histogram *hist = local->hist;
+
+	if (local->pending == 0) {
+		return;
+	}
+
+	atomic_ops_rwlock_read_lock(&hist->lock);
+
+	if (local->dense != NULL) {
+		uintptr_t *dense = local->dense;
+		size_t i = local->lo;
+
+		for (; i + ATOMIC_OPS_HISTOGRAM_SCAN <= local->hi; i += ATOMIC_OPS_HISTOGRAM_SCAN) {
+			uintptr_t any = 0;
+
+			for (size_t j = 0; j < ATOMIC_OPS_HISTOGRAM_SCAN; j++) {
+				any |= dense[i + j];
+			}
+
+			if (any == 0) {
+				continue;
+			}
+
+			for (size_t j = 0; j < ATOMIC_OPS_HISTOGRAM_SCAN; j++) {
+				if (dense[i + j] != 0) {
+					atomic_ops_uint_add(&hist->buckets[i + j], dense[i + j], ATOMIC_OPS_FENCE_NONE);
+					dense[i + j] = 0;
+				}
+			}
+		}
+
+		for (; i < local->hi; i++) {
+			if (dense[i] != 0) {
+				atomic_ops_uint_add(&hist->buckets[i], dense[i], ATOMIC_OPS_FENCE_NONE);
+				dense[i] = 0;
+			}
+		}
+
+		local->lo = hist->size;
+		local->hi = 0;
+	}
+	else {
+		for (size_t i = 0; i < ATOMIC_OPS_HISTOGRAM_BUFFER; i++) {
+			if (local->keys[i] != 0) {
+				atomic_ops_uint_add(&hist->buckets[local->keys[i] - 1], local->counts[i], ATOMIC_OPS_FENCE_NONE);
+				local->keys[i] = 0;
+			}
+		}
+
+		local->used = 0;
+	}
+
+	atomic_ops_rwlock_read_unlock(&hist->lock);
+
+	local->pending = 0;
+}
+
+// Single bucket, without waiting for flushes in progress
+static inline uintptr_t atomic_ops_histogram_read(const atomic_ops_histogram *hist, size_t bucket) {
+	return (atomic_ops_uint_load(&hist->buckets[bucket], ATOMIC_OPS_FENCE_NONE));
+}
+
+// Copies all buckets into out (hist->size values), between flushes
+static inline void atomic_ops_histogram_snapshot(atomic_ops_histogram *hist, uintptr_t *out) {
+	atomic_ops_rwlock_write_lock(&hist->lock);
+
+	for (size_t i = 0; i < hist->size; i++) {
+		out[i] = atomic_ops_uint_load(&hist->buckets[i], ATOMIC_OPS_FENCE_NONE);
+	}
+
+	atomic_ops_rwlock_write_unlock(&hist->lock);
+}
+
+// Like snapshot, then sets all buckets to zero; out may be NULL
+static inline void atomic_ops_histogram_reset(atomic_ops_histogram *hist, uintptr_t *out) {
+	atomic_ops_rwlock_write_lock(&hist->lock);
+
+	for (size_t i = 0; i < hist->size; i++) {
+		if (out != NULL) {
+			out[i] = atomic_ops_uint_load(&hist->buckets[i], ATOMIC_OPS_FENCE_NONE);
+		}
+
+		atomic_ops_uint_store(&hist->buckets[i], 0, ATOMIC_OPS_FENCE_NONE);
+	}
+
+	atomic_ops_rwlock_write_unlock(&hist->lock);
+}
+
+#endif /* ATOMIC_OPS_HISTOGRAM_H */
@@ -0,0 +1,256 @@
+/**
+ * This file is part of the atomic_ops project.
+ *
+ * For the full copyright and license information, please view the COPYING
+ * file that was distributed with this source code.
+ *
+ * @copyright  (c) the atomic_ops project
+ * @author     Luca Longinotti <chtekk@longitekk.com>
+ * @license    BSD 2-clause
+ * @version    $Id$
+ */
+
+#ifndef ATOMIC_OPS_LIST_H
+#define ATOMIC_OPS_LIST_H 1
+
+/*
+ * Lock-free sorted linked list (Harris-Michael), mapping unique keys to values.
+ * Removing a node happens in two steps: first the flag of its next pointer is
+ * set, marking it as logically deleted, so no node can be inserted after it
+ * anymore, then it's unlinked from its predecessor. Any thread finding a
+ * marked node while searching helps unlinking it.
+ * contains() never writes nor retries: it just walks the list, so it's
+ * wait-free. Nodes are freed through epoch-based reclamation: each operation
+ * runs in a critical section on the caller's epoch record, so readers never
+ * see a node being freed under them.
+ */
+
+#include "atomic_ops.h"
+#include "atomic_ops_epoch.h"
+
+/*
+ * Type Definitions
+ */
+
+typedef struct atomic_ops_list_node atomic_ops_list_node;
+
+struct atomic_ops_list_node {
+	atomic_ops_flagptr next; // Flag set: this node is logically deleted
+	uintptr_t key;
+	void *value;
+};
+
+typedef struct {
+	atomic_ops_flagptr head;
+	atomic_ops_epoch_domain *domain;
+} atomic_ops_list;
+
+// Called on each element by iterate, returning false stops it
+typedef bool (*atomic_ops_list_fn)(uintptr_t key, void *value, void *arg);
+
+/*
+ * Functions
+ */
+
+static inline void atomic_ops_list_init(atomic_ops_list *list, atomic_ops_epoch_domain *domain);
+static inline void atomic_ops_list_destroy(atomic_ops_list *list);
+static inline bool atomic_ops_list_insert(atomic_ops_list *list, atomic_ops_epoch_record *rec, uintptr_t key, void *value);
+static inline bool atomic_ops_list_remove(atomic_ops_list *list, atomic_ops_epoch_record *rec, uintptr_t key, void **value);
+static inline bool atomic_ops_list_contains(atomic_ops_list *list, atomic_ops_epoch_record *rec, uintptr_t key, void **value);
+static inline void atomic_ops_list_iterate(atomic_ops_list *list, atomic_ops_epoch_record *rec, atomic_ops_list_fn fn, void *arg);
+
+/*
+ * Implementations
+ */
+
+static inline void atomic_ops_list_init(atomic_ops_list *list, atomic_ops_epoch_domain *domain) {
+	list->domain = domain;
+	atomic_ops_flagptr_store(&list->head, NULL, false, ATOMIC_OPS_FENCE_RELEASE);
+}
+
+// No thread may use the list anymore
+static inline void atomic_ops_list_destroy(atomic_ops_list *list) {
+	atomic_ops_list_node *node = atomic_ops_flagptr_load(&list->head, NULL, ATOMIC_OPS_FENCE_ACQUIRE);
+
+	while (node != NULL) {
+		atomic_ops_list_node *next = atomic_ops_flagptr_load(&node->next, NULL, ATOMIC_OPS_FENCE_NONE);
+
+		free(node);
+		node = next;
+	}
+
+	atomic_ops_flagptr_store(&list->head, NULL, false, ATOMIC_OPS_FENCE_RELEASE);
+}
+
+// Find the first node with a key not less than key, and the link pointing to it, unlinking marked nodes on the way;
+// prev_out is NULL if a marked node was found but there's no memory to retire it
+static inline bool atomic_ops_list_find(atomic_ops_list *list, atomic_ops_epoch_record *rec, uintptr_t key, atomic_ops_flagptr **prev_out, atomic_ops_list_node **cur_out) {
+retry:
+	{
+		atomic_ops_flagptr *prev = &list->head;
+		atomic_ops_list_node *cur = atomic_ops_flagptr_load(prev, NULL, ATOMIC_OPS_FENCE_ACQUIRE);
+
+		while (cur != NULL) {
+			bool marked;
+			atomic_ops_list_node *next = atomic_ops_flagptr_load(&cur->next, &marked, ATOMIC_OPS_FENCE_ACQUIRE);
+
+			if (marked) {
+				// Whoever unlinks it must retire it, so only try with room for that
+				if (!atomic_ops_epoch_reserve(list->domain, rec)) {
+					*prev_out = NULL;
+					*cur_out = NULL;
+
+					return (false);
+				}
+
+				// Fails if prev got marked itself, or something was inserted before cur
+				if (!atomic_ops_flagptr_cas(prev, cur, false, next, false, ATOMIC_OPS_FENCE_FULL)) {
+					goto retry;
+				}
+
+				// Can't fail, there's room reserved
+				atomic_ops_epoch_retire(list->domain, rec, cur, &free);
+
+				cur = next;
+				continue;
+			}
+
+			if (cur->key >= key) {
+				*prev_out = prev;
+				*cur_out = cur;
+
+				return (cur->key == key);
+			}
+
+			prev = &cur->next;
+			cur = next;
+		}
+
+		*prev_out = prev;
+		*cur_out = NULL;
+
+		return (false);
+	}
+}
+
+// False if the key is present already, or there's no memory for a new node or to retire deleted ones
+static inline bool atomic_ops_list_insert(atomic_ops_list *list, atomic_ops_epoch_record *rec, uintptr_t key, void *value) {
+	atomic_ops_list_node *node = malloc(sizeof(atomic_ops_list_node));
+	atomic_ops_flagptr *prev;
+	atomic_ops_list_node *cur;
+
+	if (node == NULL) {
+		return (false);
+	}
+
+	node->key = key;
+	node->value = value;
+
+	atomic_ops_epoch_enter(list->domain, rec);
+
+	while (true) {
+		if (atomic_ops_list_find(list, rec, key, &prev, &cur) || prev == NULL) {
+			atomic_ops_epoch_exit(list->domain, rec);
+			free(node);
+
+			return (false);
+		}
+
+		atomic_ops_flagptr_store(&node->next, cur, false, ATOMIC_OPS_FENCE_NONE);
+
+		// Full: the node's contents must be visible before it is
+		if (atomic_ops_flagptr_cas(prev, cur, false, node, false, ATOMIC_OPS_FENCE_FULL)) {
+			atomic_ops_epoch_exit(list->domain, rec);
+
+			return (true);
+		}
+	}
+}
+
+// False if the key isn't present, or there's no memory to retire its node, else its value is returned in value (if not NULL)
+static inline bool atomic_ops_list_remove(atomic_ops_list *list, atomic_ops_epoch_record *rec, uintptr_t key, void **value) {
+	atomic_ops_flagptr *prev;
+	atomic_ops_list_node *cur;
+
+	atomic_ops_epoch_enter(list->domain, rec);
+
+	while (true) {
+		if (!atomic_ops_list_find(list, rec, key, &prev, &cur) || !atomic_ops_epoch_reserve(list->domain, rec)) {
+			atomic_ops_epoch_exit(list->domain, rec);
+
+			return (false);
+		}
+
+		bool marked;
+		atomic_ops_list_node *next = atomic_ops_flagptr_load(&cur->next, &marked, ATOMIC_OPS_FENCE_ACQUIRE);
+
+		// Marking it is what removes it: whoever succeeds at that owns the removal
+		if (marked || !atomic_ops_flagptr_cas(&cur->next, next, false, next, true, ATOMIC_OPS_FENCE_FULL)) {
+			continue;
+		}
+
+		if (value != NULL) {
+			*value = cur->value;
+		}
+
+		// If unlinking fails, some search already did or will do it
+		if (atomic_ops_flagptr_cas(prev, cur, false, next, false, ATOMIC_OPS_FENCE_FULL)) {
+			// Can't fail, there's room reserved
+			atomic_ops_epoch_retire(list->domain, rec, cur, &free);
+		}
+		else {
+			atomic_ops_list_find(list, rec, key, &prev, &cur);
+		}
+
+		atomic_ops_epoch_exit(list->domain, rec);
+
+		return (true);
+	}
+}
+
+// Wait-free: only follows pointers, never helps nor retries
+static inline bool atomic_ops_list_contains(atomic_ops_list *list, atomic_ops_epoch_record *rec, uintptr_t key, void **value) {
+	bool marked = true;
+
+	atomic_ops_epoch_enter(list->domain, rec);
+
+	atomic_ops_list_node *cur = atomic_ops_flagptr_load(&list->head, NULL, ATOMIC_OPS_FENCE_ACQUIRE);
+
+	while (cur != NULL && cur->key < key) {
+		cur = atomic_ops_flagptr_load(&cur->next, NULL, ATOMIC_OPS_FENCE_ACQUIRE);
+	}
+
+	if (cur != NULL && cur->key == key) {
+		atomic_ops_flagptr_load(&cur->next, &marked, ATOMIC_OPS_FENCE_NONE);
+
+		if (!marked && value != NULL) {
+			*value = cur->value;
+		}
+	}
+
+	atomic_ops_epoch_exit(list->domain, rec);
+
+	return (!marked);
+}
+
+// Visit elements in key order; concurrent changes may or may not be seen
+static inline void atomic_ops_list_iterate(atomic_ops_list *list, atomic_ops_epoch_record *rec, atomic_ops_list_fn fn, void *arg) {
+	atomic_ops_epoch_enter(list->domain, rec);
+
+	atomic_ops_list_node *cur = atomic_ops_flagptr_load(&list->head, NULL, ATOMIC_OPS_FENCE_ACQUIRE);
+
+	while (cur != NULL) {
+		bool marked;
+		atomic_ops_list_node *next = atomic_ops_flagptr_load(&cur->next, &marked, ATOMIC_OPS_FENCE_ACQUIRE);
+
+		if (!marked && !fn(cur->key, cur->value, arg)) {
+			break;
+		}
+
+		cur = next;
+	}
+
+	atomic_ops_epoch_exit(list->domain, rec);
+}
+
+#endif /* ATOMIC_OPS_LIST_H */
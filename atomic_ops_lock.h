@@ -0,0 +1,338 @@
+/**
+ * This file is part of the atomic_ops project.
+ *
+ * For the full copyright and license information, please view the COPYING
+ * file that was distributed with this source code.
+ *
+ * @copyright  (c) the atomic_ops project
+ * @author     Luca Longinotti <chtekk@longitekk.com>
+ * @license    BSD 2-clause
+ * @version    $Id$
+ */
+
+#ifndef ATOMIC_OPS_LOCK_H
+#define ATOMIC_OPS_LOCK_H 1
+
+/*
+ * Spinlocks.
+ * - TTAS: test-and-test-and-set, waiting with plain loads and backing off
+ *   exponentially after a failed swap. Cheapest uncontended, but unfair, and
+ *   every release makes all waiters race for the line.
+ * - Ticket: FIFO, a fetch_and_inc to take a ticket, then waiting for the
+ *   'owner' counter to reach it, with a pause proportional to the distance.
+ *   All waiters still spin on the same line.
+ * - MCS: FIFO queue of caller-provided nodes, each waiter spinning on its own
+ *   node, so a release only touches the line of the next waiter.
+ * - CLH: FIFO queue too, each waiter spinning on its predecessor's node.
+ *   Nodes move between threads: after unlock, the caller gets its
+ *   predecessor's node back, to use for the next lock. So the tail is a dptr,
+ *   the node and a version bumped by every enqueue: a trylock that saw a free
+ *   node at the tail fails its CAS if that node got recycled and locked again
+ *   meanwhile (ABA), instead of queueing behind it.
+ * Lock operations have acquire semantics and unlock has release semantics,
+ * nothing more: that is all a critical section needs.
+ */
+
+#include "atomic_ops.h"
+
+// TTAS backoff defaults, in pause instructions
+#if !defined(ATOMIC_OPS_LOCK_BACKOFF_MIN)
+	#define ATOMIC_OPS_LOCK_BACKOFF_MIN 4
+#endif
+
+#if !defined(ATOMIC_OPS_LOCK_BACKOFF_MAX)
+	#define ATOMIC_OPS_LOCK_BACKOFF_MAX 1024
+#endif
+
+/*
+ * Type Definitions
+ */
+
+typedef struct {
+	atomic_ops_uint locked;
+	uint32_t backoff_min;
+	uint32_t backoff_max;
+} atomic_ops_ttas;
+
+#define ATOMIC_OPS_TTAS_INIT { ATOMIC_OPS_UINT_INIT(0), ATOMIC_OPS_LOCK_BACKOFF_MIN, ATOMIC_OPS_LOCK_BACKOFF_MAX }
+
+typedef struct {
+	atomic_ops_uint next; // Next ticket to hand out
+	atomic_ops_uint owner; // Ticket currently holding the lock
+} atomic_ops_ticket;
+
+#define ATOMIC_OPS_TICKET_INIT { ATOMIC_OPS_UINT_INIT(0), ATOMIC_OPS_UINT_INIT(0) }
+
+// One per waiting thread, padded so that waiters never spin on each other's line
+typedef struct atomic_ops_mcs_node {
+	atomic_ops_ptr next;
+	atomic_ops_uint locked;
+	char pad0[ATOMIC_OPS_CACHELINE_SIZE - sizeof(atomic_ops_ptr) - sizeof(atomic_ops_uint)];
+} atomic_ops_mcs_node;
+
+typedef struct {
+	atomic_ops_ptr tail; // Last node in the queue, NULL if free
+} atomic_ops_mcs;
+
+#define ATOMIC_OPS_MCS_INIT { ATOMIC_OPS_PTR_INIT(NULL) }
+
+typedef struct atomic_ops_clh_node {
+	atomic_ops_uint locked; // Set while the owner holds or waits for the lock
+	struct atomic_ops_clh_node *pred; // Set by the owner, to take over on unlock
+	char pad0[ATOMIC_OPS_CACHELINE_SIZE - sizeof(atomic_ops_uint) - sizeof(struct atomic_ops_clh_node *)];
+} atomic_ops_clh_node;
+
+typedef struct {
+	atomic_ops_dptr tail; // lo: last node, never NULL, starts out as an unlocked dummy node; hi: version
+} atomic_ops_clh;
+
+/*
+ * Functions
+ */
+
+static inline void atomic_ops_ttas_lock_init(atomic_ops_ttas *lock, uint32_t backoff_min, uint32_t backoff_max);
+static inline void atomic_ops_ttas_lock(atomic_ops_ttas *lock) ATTR_ALWAYSINLINE;
+static inline bool atomic_ops_ttas_trylock(atomic_ops_ttas *lock) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_ttas_unlock(atomic_ops_ttas *lock) ATTR_ALWAYSINLINE;
+
+static inline void atomic_ops_ticket_lock_init(atomic_ops_ticket *lock);
+static inline void atomic_ops_ticket_lock(atomic_ops_ticket *lock) ATTR_ALWAYSINLINE;
+static inline bool atomic_ops_ticket_trylock(atomic_ops_ticket *lock) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_ticket_unlock(atomic_ops_ticket *lock) ATTR_ALWAYSINLINE;
+
+static inline void atomic_ops_mcs_lock_init(atomic_ops_mcs *lock);
+static inline void atomic_ops_mcs_lock(atomic_ops_mcs *lock, atomic_ops_mcs_node *node) ATTR_ALWAYSINLINE;
+static inline bool atomic_ops_mcs_trylock(atomic_ops_mcs *lock, atomic_ops_mcs_node *node) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_mcs_unlock(atomic_ops_mcs *lock, atomic_ops_mcs_node *node) ATTR_ALWAYSINLINE;
+
+static inline bool atomic_ops_clh_lock_init(atomic_ops_clh *lock);
+static inline void atomic_ops_clh_lock_destroy(atomic_ops_clh *lock);
+static inline atomic_ops_clh_node * atomic_ops_clh_node_create(void);
+static inline void atomic_ops_clh_lock(atomic_ops_clh *lock, atomic_ops_clh_node *node) ATTR_ALWAYSINLINE;
+static inline bool atomic_ops_clh_trylock(atomic_ops_clh *lock, atomic_ops_clh_node *node) ATTR_ALWAYSINLINE;
+static inline atomic_ops_clh_node * atomic_ops_clh_unlock(atomic_ops_clh *lock, atomic_ops_clh_node *node) ATTR_ALWAYSINLINE;
+
+/*
+ * Implementations
+ */
+
+static inline void atomic_ops_ttas_lock_init(atomic_ops_ttas *lock, uint32_t backoff_min, uint32_t backoff_max) {
+	lock->backoff_min = (backoff_min == 0) ? (1) : (backoff_min);
+	lock->backoff_max = (backoff_max < lock->backoff_min) ? (lock->backoff_min) : (backoff_max);
+
+	atomic_ops_uint_store(&lock->locked, 0, ATOMIC_OPS_FENCE_RELEASE);
+}
+
+static inline void atomic_ops_ttas_lock(atomic_ops_ttas *lock) {
+	uint32_t backoff = lock->backoff_min;
+
+	while (true) {
+		// Wait with plain loads: the line stays shared until the lock is released
+		while (atomic_ops_uint_load(&lock->locked, ATOMIC_OPS_FENCE_NONE) != 0) {
+			atomic_ops_pause();
+		}
+
+		if (atomic_ops_uint_swap(&lock->locked, 1, ATOMIC_OPS_FENCE_ACQUIRE) == 0) {
+			return;
+		}
+
+		// Lost the race: let the winner's line settle before trying again
+		for (uint32_t i = 0; i < backoff; i++) {
+			atomic_ops_pause();
+		}
+
+		backoff = (backoff >= lock->backoff_max / 2) ? (lock->backoff_max) : (backoff * 2);
+	}
+}
+
+static inline bool atomic_ops_ttas_trylock(atomic_ops_ttas *lock) {
+	return (atomic_ops_uint_load(&lock->locked, ATOMIC_OPS_FENCE_NONE) == 0
+		&& atomic_ops_uint_swap(&lock->locked, 1, ATOMIC_OPS_FENCE_ACQUIRE) == 0);
+}
+
+static inline void atomic_ops_ttas_unlock(atomic_ops_ttas *lock) {
+	atomic_ops_uint_store(&lock->locked, 0, ATOMIC_OPS_FENCE_RELEASE);
+}
+
+static inline void atomic_ops_ticket_lock_init(atomic_ops_ticket *lock) {
+	atomic_ops_uint_store(&lock->next, 0, ATOMIC_OPS_FENCE_NONE);
+	atomic_ops_uint_store(&lock->owner, 0, ATOMIC_OPS_FENCE_RELEASE);
+}
+
+static inline void atomic_ops_ticket_lock(atomic_ops_ticket *lock) {
+	uintptr_t ticket = atomic_ops_uint_fetch_and_inc(&lock->next, ATOMIC_OPS_FENCE_NONE);
+
+	while (true) {
+		uintptr_t owner = atomic_ops_uint_load(&lock->owner, ATOMIC_OPS_FENCE_ACQUIRE);
+
+		if (owner == ticket) {
+			return;
+		}
+
+		// Proportional backoff: every thread ahead needs its turn first
+		for (uintptr_t i = (ticket - owner) * ATOMIC_OPS_LOCK_BACKOFF_MIN; i != 0; i--) {
+			atomic_ops_pause();
+		}
+	}
+}
+
+static inline bool atomic_ops_ticket_trylock(atomic_ops_ticket *lock) {
+	uintptr_t owner = atomic_ops_uint_load(&lock->owner, ATOMIC_OPS_FENCE_NONE);
+
+	// Only free if no ticket past the owner's was handed out
+	return (atomic_ops_uint_cas(&lock->next, owner, owner + 1, ATOMIC_OPS_FENCE_ACQUIRE));
+}
+
+static inline void atomic_ops_ticket_unlock(atomic_ops_ticket *lock) {
+	// Only the owner ever writes 'owner', a plain increment is enough
+	uintptr_t owner = atomic_ops_uint_load(&lock->owner, ATOMIC_OPS_FENCE_NONE);
+
+	atomic_ops_uint_store(&lock->owner, owner + 1, ATOMIC_OPS_FENCE_RELEASE);
+}
+
+static inline void atomic_ops_mcs_lock_init(atomic_ops_mcs *lock) {
+	atomic_ops_ptr_store(&lock->tail, NULL, ATOMIC_OPS_FENCE_RELEASE);
+}
+
+// node must stay valid, and not be used for anything else, until unlock
+static inline void atomic_ops_mcs_lock(atomic_ops_mcs *lock, atomic_ops_mcs_node *node) {
+	atomic_ops_ptr_store(&node->next, NULL, ATOMIC_OPS_FENCE_NONE);
+	atomic_ops_uint_store(&node->locked, 1, ATOMIC_OPS_FENCE_NONE);
+
+	// Full: the node must be set up before it's visible, and the critical section must not start before
+	atomic_ops_mcs_node *pred = atomic_ops_ptr_swap(&lock->tail, node, ATOMIC_OPS_FENCE_FULL);
+
+	if (pred == NULL) {
+		return;
+	}
+
+	atomic_ops_ptr_store(&pred->next, node, ATOMIC_OPS_FENCE_RELEASE);
+
+	while (atomic_ops_uint_load(&node->locked, ATOMIC_OPS_FENCE_ACQUIRE) != 0) {
+		atomic_ops_pause();
+	}
+}
+
+static inline bool atomic_ops_mcs_trylock(atomic_ops_mcs *lock, atomic_ops_mcs_node *node) {
+	atomic_ops_ptr_store(&node->next, NULL, ATOMIC_OPS_FENCE_NONE);
+	atomic_ops_uint_store(&node->locked, 1, ATOMIC_OPS_FENCE_NONE);
+
+	return (atomic_ops_ptr_cas(&lock->tail, NULL, node, ATOMIC_OPS_FENCE_FULL));
+}
+
+static inline void atomic_ops_mcs_unlock(atomic_ops_mcs *lock, atomic_ops_mcs_node *node) {
+	atomic_ops_mcs_node *next = atomic_ops_ptr_load(&node->next, ATOMIC_OPS_FENCE_ACQUIRE);
+
+	if (next == NULL) {
+		// No one waiting: the lock becomes free, if no one started waiting meanwhile
+		if (atomic_ops_ptr_cas(&lock->tail, node, NULL, ATOMIC_OPS_FENCE_RELEASE)) {
+			return;
+		}
+
+		// Someone swapped the tail already, wait for it to link itself in
+		while ((next = atomic_ops_ptr_load(&node->next, ATOMIC_OPS_FENCE_ACQUIRE)) == NULL) {
+			atomic_ops_pause();
+		}
+	}
+
+	atomic_ops_uint_store(&next->locked, 0, ATOMIC_OPS_FENCE_RELEASE);
+}
+
+static inline atomic_ops_clh_node * atomic_ops_clh_node_create(void) {
+	atomic_ops_clh_node *node = aligned_alloc(ATOMIC_OPS_CACHELINE_SIZE, sizeof(atomic_ops_clh_node));
+
+	if (node != NULL) {
+		node->pred = NULL;
+		atomic_ops_uint_store(&node->locked, 0, ATOMIC_OPS_FENCE_NONE);
+	}
+
+	return (node);
+}
+
+// False if there's no memory for the dummy node
+static inline bool atomic_ops_clh_lock_init(atomic_ops_clh *lock) {
+	atomic_ops_clh_node *dummy = atomic_ops_clh_node_create();
+
+	if (dummy == NULL) {
+		return (false);
+	}
+
+	atomic_ops_dptr_val tail = { (uintptr_t)dummy, 0 };
+
+	atomic_ops_dptr_store(&lock->tail, tail, ATOMIC_OPS_FENCE_RELEASE);
+
+	return (true);
+}
+
+// The lock must be free: frees the node at the tail, that no thread owns anymore
+static inline void atomic_ops_clh_lock_destroy(atomic_ops_clh *lock) {
+	atomic_ops_dptr_val tail = atomic_ops_dptr_load(&lock->tail, ATOMIC_OPS_FENCE_ACQUIRE);
+
+	free((atomic_ops_clh_node *)tail.lo);
+
+	tail.lo = 0;
+	atomic_ops_dptr_store(&lock->tail, tail, ATOMIC_OPS_FENCE_NONE);
+}
+
+static inline void atomic_ops_clh_lock(atomic_ops_clh *lock, atomic_ops_clh_node *node) {
+	atomic_ops_uint_store(&node->locked, 1, ATOMIC_OPS_FENCE_NONE);
+
+	atomic_ops_dptr_val tail = atomic_ops_dptr_load(&lock->tail, ATOMIC_OPS_FENCE_NONE), newtail, prev;
+
+	while (true) {
+		newtail.lo = (uintptr_t)node;
+		newtail.hi = tail.hi + 1;
+
+		// Full: our node must be locked before it's visible, and the critical section must not start before
+		prev = atomic_ops_dptr_casr(&lock->tail, tail, newtail, ATOMIC_OPS_FENCE_FULL);
+		if (prev.lo == tail.lo && prev.hi == tail.hi) {
+			break;
+		}
+
+		tail = prev;
+	}
+
+	atomic_ops_clh_node *pred = (atomic_ops_clh_node *)tail.lo;
+
+	while (atomic_ops_uint_load(&pred->locked, ATOMIC_OPS_FENCE_ACQUIRE) != 0) {
+		atomic_ops_pause();
+	}
+
+	node->pred = pred;
+}
+
+static inline bool atomic_ops_clh_trylock(atomic_ops_clh *lock, atomic_ops_clh_node *node) {
+	atomic_ops_dptr_val tail = atomic_ops_dptr_load(&lock->tail, ATOMIC_OPS_FENCE_ACQUIRE);
+	atomic_ops_clh_node *pred = (atomic_ops_clh_node *)tail.lo;
+
+	if (atomic_ops_uint_load(&pred->locked, ATOMIC_OPS_FENCE_ACQUIRE) != 0) {
+		return (false);
+	}
+
+	atomic_ops_uint_store(&node->locked, 1, ATOMIC_OPS_FENCE_NONE);
+
+	atomic_ops_dptr_val newtail = { (uintptr_t)node, tail.hi + 1 };
+
+	// Fails on any enqueue since the load, so pred is still the free node seen above, never a recycled one
+	if (!atomic_ops_dptr_cas(&lock->tail, tail, newtail, ATOMIC_OPS_FENCE_FULL)) {
+		atomic_ops_uint_store(&node->locked, 0, ATOMIC_OPS_FENCE_NONE);
+		return (false);
+	}
+
+	node->pred = pred;
+
+	return (true);
+}
+
+// Returns the node to use for the next lock: ours now belongs to our successor
+static inline atomic_ops_clh_node * atomic_ops_clh_unlock(atomic_ops_clh *lock, atomic_ops_clh_node *node) {
+	UNUSED_ARGUMENT(lock);
+
+	atomic_ops_clh_node *pred = node->pred;
+
+	atomic_ops_uint_store(&node->locked, 0, ATOMIC_OPS_FENCE_RELEASE);
+
+	return (pred);
+}
+
+#endif /* ATOMIC_OPS_LOCK_H */
@@ -0,0 +1,281 @@
+/**
+ * This file is part of the atomic_ops project.
+ *
+ * For the full copyright and license information, please view the COPYING
+ * file that was distributed with this source code.
+ *
+ * @copyright  (c) the atomic_ops project
+ * @author     Luca Longinotti <chtekk@longitekk.com>
+ * @license    BSD 2-clause
+ * @version    $Id$
+ */
+
+#ifndef ATOMIC_OPS_MPMC_QUEUE_H
+#define ATOMIC_OPS_MPMC_QUEUE_H 1
+
+/*
+ * Bounded multi-producer/multi-consumer queue of pointers.
+ * Every cell carries a sequence number telling which lap of the ring it's
+ * ready for: a producer may fill the cell for position 'pos' once its sequence
+ * equals 'pos', a consumer may empty it once it equals 'pos + 1'. Producers
+ * and consumers only ever contend on their own index (head or tail), and on
+ * a cell when the queue is close to full or empty.
+ * The try_* functions claim positions with CAS and never wait, while the
+ * plain enqueue/dequeue claim them with fetch_and_add and then wait for the
+ * cell to become ready, which avoids CAS failures under heavy contention.
+ * All of them can be freely mixed on the same queue.
+ */
+
+#include "atomic_ops.h"
+
+/*
+ * Type Definitions
+ */
+
+typedef struct {
+	atomic_ops_uint seq;
+	void *data;
+} atomic_ops_mpmc_queue_cell;
+
+typedef struct {
+	atomic_ops_mpmc_queue_cell *cells;
+	uintptr_t mask;
+	char pad0[ATOMIC_OPS_CACHELINE_SIZE - sizeof(atomic_ops_mpmc_queue_cell *) - sizeof(uintptr_t)];
+	atomic_ops_uint head; // Next position to enqueue at
+	char pad1[ATOMIC_OPS_CACHELINE_SIZE - sizeof(atomic_ops_uint)];
+	atomic_ops_uint tail; // Next position to dequeue from
+	char pad2[ATOMIC_OPS_CACHELINE_SIZE - sizeof(atomic_ops_uint)];
+} atomic_ops_mpmc_queue;
+
+/*
+ * Functions
+ */
+
+static inline bool atomic_ops_mpmc_queue_init(atomic_ops_mpmc_queue *queue, size_t capacity);
+static inline void atomic_ops_mpmc_queue_destroy(atomic_ops_mpmc_queue *queue);
+static inline size_t atomic_ops_mpmc_queue_capacity(const atomic_ops_mpmc_queue *queue) ATTR_ALWAYSINLINE;
+static inline size_t atomic_ops_mpmc_queue_size(const atomic_ops_mpmc_queue *queue) ATTR_ALWAYSINLINE;
+static inline bool atomic_ops_mpmc_queue_try_enqueue(atomic_ops_mpmc_queue *queue, void *data) ATTR_ALWAYSINLINE;
+static inline bool atomic_ops_mpmc_queue_try_dequeue(atomic_ops_mpmc_queue *queue, void **data) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_mpmc_queue_enqueue(atomic_ops_mpmc_queue *queue, void *data) ATTR_ALWAYSINLINE;
+static inline void * atomic_ops_mpmc_queue_dequeue(atomic_ops_mpmc_queue *queue) ATTR_ALWAYSINLINE;
+static inline size_t atomic_ops_mpmc_queue_try_enqueue_batch(atomic_ops_mpmc_queue *queue, void * const *data, size_t count);
+static inline size_t atomic_ops_mpmc_queue_try_dequeue_batch(atomic_ops_mpmc_queue *queue, void **data, size_t count);
+
+/*
+ * Implementations
+ */
+
+// Capacity must be a power of two, and at least two
+static inline bool atomic_ops_mpmc_queue_init(atomic_ops_mpmc_queue *queue, size_t capacity) {
+	if (capacity < 2 || (capacity & (capacity - 1)) != 0) {
+		return (false);
+	}
+
+	queue->cells = malloc(capacity * sizeof(atomic_ops_mpmc_queue_cell));
+	if (queue->cells == NULL) {
+		return (false);
+	}
+
+	for (size_t i = 0; i < capacity; i++) {
+		atomic_ops_uint_store(&queue->cells[i].seq, i, ATOMIC_OPS_FENCE_NONE);
+		queue->cells[i].data = NULL;
+	}
+
+	queue->mask = capacity - 1;
+
+	atomic_ops_uint_store(&queue->head, 0, ATOMIC_OPS_FENCE_NONE);
+	atomic_ops_uint_store(&queue->tail, 0, ATOMIC_OPS_FENCE_RELEASE);
+
+	return (true);
+}
+
+static inline void atomic_ops_mpmc_queue_destroy(atomic_ops_mpmc_queue *queue) {
+	free(queue->cells);
+	queue->cells = NULL;
+}
+
+static inline size_t atomic_ops_mpmc_queue_capacity(const atomic_ops_mpmc_queue *queue) {
+	return (queue->mask + 1);
+}
+
+// Only a snapshot: concurrent operations may change it right away
+static inline size_t atomic_ops_mpmc_queue_size(const atomic_ops_mpmc_queue *queue) {
+	uintptr_t tail = atomic_ops_uint_load(&queue->tail, ATOMIC_OPS_FENCE_ACQUIRE);
+	uintptr_t head = atomic_ops_uint_load(&queue->head, ATOMIC_OPS_FENCE_NONE);
+
+	return (((intptr_t)(head - tail) > 0) ? (head - tail) : (0));
+}
+
+static inline bool atomic_ops_mpmc_queue_try_enqueue(atomic_ops_mpmc_queue *queue, void *data) {
+	uintptr_t pos = atomic_ops_uint_load(&queue->head, ATOMIC_OPS_FENCE_NONE);
+
+	while (true) {
+		atomic_ops_mpmc_queue_cell *cell = &queue->cells[pos & queue->mask];
+
+		// Acquire: the consumer of the previous lap must be done reading the cell
+		intptr_t dif = (intptr_t)(atomic_ops_uint_load(&cell->seq, ATOMIC_OPS_FENCE_ACQUIRE) - pos);
+
+		if (dif == 0) {
+			// The cell's sequence already orders everything, the CAS only claims the position
+			if (atomic_ops_uint_cas(&queue->head, pos, pos + 1, ATOMIC_OPS_FENCE_NONE)) {
+				cell->data = data;
+				atomic_ops_uint_store(&cell->seq, pos + 1, ATOMIC_OPS_FENCE_RELEASE);
+				return (true);
+			}
+
+			pos = atomic_ops_uint_load(&queue->head, ATOMIC_OPS_FENCE_NONE);
+		}
+		else if (dif < 0) {
+			return (false); // Full
+		}
+		else {
+			pos = atomic_ops_uint_load(&queue->head, ATOMIC_OPS_FENCE_NONE);
+		}
+	}
+}
+
+static inline bool atomic_ops_mpmc_queue_try_dequeue(atomic_ops_mpmc_queue *queue, void **data) {
+	uintptr_t pos = atomic_ops_uint_load(&queue->tail, ATOMIC_OPS_FENCE_NONE);
+
+	while (true) {
+		atomic_ops_mpmc_queue_cell *cell = &queue->cells[pos & queue->mask];
+
+		// Acquire: the producer's write of the data must be visible
+		intptr_t dif = (intptr_t)(atomic_ops_uint_load(&cell->seq, ATOMIC_OPS_FENCE_ACQUIRE) - (pos + 1));
+
+		if (dif == 0) {
+			if (atomic_ops_uint_cas(&queue->tail, pos, pos + 1, ATOMIC_OPS_FENCE_NONE)) {
+				*data = cell->data;
+				atomic_ops_uint_store(&cell->seq, pos + queue->mask + 1, ATOMIC_OPS_FENCE_RELEASE);
+				return (true);
+			}
+
+			pos = atomic_ops_uint_load(&queue->tail, ATOMIC_OPS_FENCE_NONE);
+		}
+		else if (dif < 0) {
+			return (false); // Empty
+		}
+		else {
+			pos = atomic_ops_uint_load(&queue->tail, ATOMIC_OPS_FENCE_NONE);
+		}
+	}
+}
+
+// Waits for a free cell if the queue is full
+static inline void atomic_ops_mpmc_queue_enqueue(atomic_ops_mpmc_queue *queue, void *data) {
+	uintptr_t pos = atomic_ops_uint_fetch_and_inc(&queue->head, ATOMIC_OPS_FENCE_NONE);
+	atomic_ops_mpmc_queue_cell *cell = &queue->cells[pos & queue->mask];
+
+	while (atomic_ops_uint_load(&cell->seq, ATOMIC_OPS_FENCE_ACQUIRE) != pos) {
+		atomic_ops_pause();
+	}
+
+	cell->data = data;
+	atomic_ops_uint_store(&cell->seq, pos + 1, ATOMIC_OPS_FENCE_RELEASE);
+}
+
+// Waits for an element if the queue is empty
+static inline void * atomic_ops_mpmc_queue_dequeue(atomic_ops_mpmc_queue *queue) {
+	uintptr_t pos = atomic_ops_uint_fetch_and_inc(&queue->tail, ATOMIC_OPS_FENCE_NONE);
+	atomic_ops_mpmc_queue_cell *cell = &queue->cells[pos & queue->mask];
+
+	while (atomic_ops_uint_load(&cell->seq, ATOMIC_OPS_FENCE_ACQUIRE) != (pos + 1)) {
+		atomic_ops_pause();
+	}
+
+	void *data = cell->data;
+	atomic_ops_uint_store(&cell->seq, pos + queue->mask + 1, ATOMIC_OPS_FENCE_RELEASE);
+
+	return (data);
+}
+
+// Enqueue up to count elements with a single CAS, returns how many were enqueued
+static inline size_t atomic_ops_mpmc_queue_try_enqueue_batch(atomic_ops_mpmc_queue *queue, void * const *data, size_t count) {
+	uintptr_t pos = atomic_ops_uint_load(&queue->head, ATOMIC_OPS_FENCE_NONE);
+
+	if (count > (queue->mask + 1)) {
+		count = queue->mask + 1;
+	}
+
+	while (count != 0) {
+		size_t n = 0;
+		intptr_t dif = 0;
+
+		// Count how many consecutive cells are free for this lap
+		while (n < count) {
+			dif = (intptr_t)(atomic_ops_uint_load(&queue->cells[(pos + n) & queue->mask].seq, ATOMIC_OPS_FENCE_ACQUIRE) - (pos + n));
+
+			if (dif != 0) {
+				break;
+			}
+
+			n++;
+		}
+
+		if (n == 0 && dif < 0) {
+			return (0); // Full
+		}
+
+		if (n != 0 && atomic_ops_uint_cas(&queue->head, pos, pos + n, ATOMIC_OPS_FENCE_NONE)) {
+			for (size_t i = 0; i < n; i++) {
+				atomic_ops_mpmc_queue_cell *cell = &queue->cells[(pos + i) & queue->mask];
+
+				cell->data = data[i];
+				atomic_ops_uint_store(&cell->seq, pos + i + 1, ATOMIC_OPS_FENCE_RELEASE);
+			}
+
+			return (n);
+		}
+
+		pos = atomic_ops_uint_load(&queue->head, ATOMIC_OPS_FENCE_NONE);
+	}
+
+	return (0);
+}
+
+// Dequeue up to count elements with a single CAS, returns how many were dequeued
+static inline size_t atomic_ops_mpmc_queue_try_dequeue_batch(atomic_ops_mpmc_queue *queue, void **data, size_t count) {
+	uintptr_t pos = atomic_ops_uint_load(&queue->tail, ATOMIC_OPS_FENCE_NONE);
+
+	if (count > (queue->mask + 1)) {
+		count = queue->mask + 1;
+	}
+
+	while (count != 0) {
+		size_t n = 0;
+		intptr_t dif = 0;
+
+		// Count how many consecutive cells are filled for this lap
+		while (n < count) {
+			dif = (intptr_t)(atomic_ops_uint_load(&queue->cells[(pos + n) & queue->mask].seq, ATOMIC_OPS_FENCE_ACQUIRE) - (pos + n + 1));
+
+			if (dif != 0) {
+				break;
+			}
+
+			n++;
+		}
+
+		if (n == 0 && dif < 0) {
+			return (0); // Empty
+		}
+
+		if (n != 0 && atomic_ops_uint_cas(&queue->tail, pos, pos + n, ATOMIC_OPS_FENCE_NONE)) {
+			for (size_t i = 0; i < n; i++) {
+				atomic_ops_mpmc_queue_cell *cell = &queue->cells[(pos + i) & queue->mask];
+
+				data[i] = cell->data;
+				atomic_ops_uint_store(&cell->seq, pos + i + queue->mask + 1, ATOMIC_OPS_FENCE_RELEASE);
+			}
+
+			return (n);
+		}
+
+		pos = atomic_ops_uint_load(&queue->tail, ATOMIC_OPS_FENCE_NONE);
+	}
+
+	return (0);
+}
+
+#endif /* ATOMIC_OPS_MPMC_QUEUE_H */
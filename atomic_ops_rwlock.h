@@ -0,0 +1,207 @@
+/**
+ * This file is part of the atomic_ops project.
+ *
+ * For the full copyright and license information, please view the COPYING
+ * file that was distributed with this source code.
+ *
+ * @copyright  (c) the atomic_ops project
+ * @author     Luca Longinotti <chtekk@longitekk.com>
+ * @license    BSD 2-clause
+ * @version    $Id$
+ */
+
+#ifndef ATOMIC_OPS_RWLOCK_H
+#define ATOMIC_OPS_RWLOCK_H 1
+
+/*
+ * Reader-writer spinlock with distributed reader indicators (big-reader lock).
+ * Instead of one shared reader count, which every read_lock has to pull into
+ * its cache exclusively, readers increment a counter in one of many slots,
+ * each on its own cache line, picked by the calling thread. Readers running
+ * on different slots never touch the same line, so read throughput scales
+ * with the number of threads; writers pay for that, having to check all slots.
+ * A writer sets the 'writer' flag, which stops new readers, then waits for all
+ * slots to drain. Readers increment their slot, then check the flag, backing
+ * off if it's set: the full fence in between guarantees that either the
+ * writer sees the reader's slot, or the reader sees the writer's flag.
+ * Policies:
+ * - WRITER: readers wait for a writer that's waiting, so writers can't starve.
+ * - READER: a writer that finds readers clears its flag again, letting new
+ *   readers in, and waits for the slot to drain before trying again. Readers
+ *   never wait behind a writer that doesn't hold the lock yet, but a steady
+ *   stream of readers can starve writers.
+ */
+
+#include "atomic_ops.h"
+
+// Number of reader slots: more slots mean less sharing between readers, but slower writers
+#if !defined(ATOMIC_OPS_RWLOCK_SLOTS)
+	#define ATOMIC_OPS_RWLOCK_SLOTS 64
+#endif
+
+/*
+ * Type Definitions
+ */
+
+typedef enum {
+	ATOMIC_OPS_RWLOCK_WRITER = 0, // Writer preference
+	ATOMIC_OPS_RWLOCK_READER = 1, // Reader preference
+} ATOMIC_OPS_RWLOCK_POLICY;
+
+typedef struct {
+	atomic_ops_uint_padded *slots; // Readers in each slot
+	ATOMIC_OPS_RWLOCK_POLICY policy;
+	char pad0[ATOMIC_OPS_CACHELINE_SIZE - sizeof(atomic_ops_uint_padded *) - sizeof(ATOMIC_OPS_RWLOCK_POLICY)];
+	atomic_ops_uint writer; // Set while a writer holds the lock, or (writer preference) waits for it
+} atomic_ops_rwlock;
+
+/*
+ * Functions
+ */
+
+static inline bool atomic_ops_rwlock_init(atomic_ops_rwlock *lock, ATOMIC_OPS_RWLOCK_POLICY policy);
+static inline void atomic_ops_rwlock_destroy(atomic_ops_rwlock *lock);
+static inline void atomic_ops_rwlock_read_lock(atomic_ops_rwlock *lock) ATTR_ALWAYSINLINE;
+static inline bool atomic_ops_rwlock_read_trylock(atomic_ops_rwlock *lock) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_rwlock_read_unlock(atomic_ops_rwlock *lock) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_rwlock_write_lock(atomic_ops_rwlock *lock);
+static inline bool atomic_ops_rwlock_write_trylock(atomic_ops_rwlock *lock);
+static inline void atomic_ops_rwlock_write_unlock(atomic_ops_rwlock *lock) ATTR_ALWAYSINLINE;
+
+/*
+ * Implementations
+ */
+
+// False if there's no memory for the reader slots
+static inline bool atomic_ops_rwlock_init(atomic_ops_rwlock *lock, ATOMIC_OPS_RWLOCK_POLICY policy) {
+	lock->slots = aligned_alloc(ATOMIC_OPS_DESTRUCTIVE_SIZE, ATOMIC_OPS_RWLOCK_SLOTS * sizeof(atomic_ops_uint_padded));
+
+	if (lock->slots == NULL) {
+		return (false);
+	}
+
+	for (size_t i = 0; i < ATOMIC_OPS_RWLOCK_SLOTS; i++) {
+		atomic_ops_uint_padded_store(&lock->slots[i], 0, ATOMIC_OPS_FENCE_NONE);
+	}
+
+	lock->policy = policy;
+	atomic_ops_uint_store(&lock->writer, 0, ATOMIC_OPS_FENCE_RELEASE);
+
+	return (true);
+}
+
+// No thread may use the lock anymore
+static inline void atomic_ops_rwlock_destroy(atomic_ops_rwlock *lock) {
+	free(lock->slots);
+	lock->slots = NULL;
+}
+
+static inline void atomic_ops_rwlock_read_lock(atomic_ops_rwlock *lock) {
+	atomic_ops_uint_padded *readers = &lock->slots[atomic_ops_thread_slot() % ATOMIC_OPS_RWLOCK_SLOTS];
+
+	while (true) {
+		while (atomic_ops_uint_load(&lock->writer, ATOMIC_OPS_FENCE_NONE) != 0) {
+			atomic_ops_pause();
+		}
+
+		// Full: the slot must be visible to writers before the flag is checked
+		atomic_ops_uint_padded_inc(readers, ATOMIC_OPS_FENCE_FULL);
+
+		if (atomic_ops_uint_load(&lock->writer, ATOMIC_OPS_FENCE_ACQUIRE) == 0) {
+			return;
+		}
+
+		atomic_ops_uint_padded_dec(readers, ATOMIC_OPS_FENCE_RELEASE);
+	}
+}
+
+static inline bool atomic_ops_rwlock_read_trylock(atomic_ops_rwlock *lock) {
+	atomic_ops_uint_padded *readers = &lock->slots[atomic_ops_thread_slot() % ATOMIC_OPS_RWLOCK_SLOTS];
+
+	if (atomic_ops_uint_load(&lock->writer, ATOMIC_OPS_FENCE_NONE) != 0) {
+		return (false);
+	}
+
+	atomic_ops_uint_padded_inc(readers, ATOMIC_OPS_FENCE_FULL);
+
+	if (atomic_ops_uint_load(&lock->writer, ATOMIC_OPS_FENCE_ACQUIRE) == 0) {
+		return (true);
+	}
+
+	atomic_ops_uint_padded_dec(readers, ATOMIC_OPS_FENCE_RELEASE);
+
+	return (false);
+}
+
+static inline void atomic_ops_rwlock_read_unlock(atomic_ops_rwlock *lock) {
+	atomic_ops_uint_padded_dec(&lock->slots[atomic_ops_thread_slot() % ATOMIC_OPS_RWLOCK_SLOTS], ATOMIC_OPS_FENCE_RELEASE);
+}
+
+// Index of a slot with readers in it, or ATOMIC_OPS_RWLOCK_SLOTS if there's none
+static inline size_t atomic_ops_rwlock_readers(atomic_ops_rwlock *lock) {
+	for (size_t i = 0; i < ATOMIC_OPS_RWLOCK_SLOTS; i++) {
+		if (atomic_ops_uint_padded_load(&lock->slots[i], ATOMIC_OPS_FENCE_ACQUIRE) != 0) {
+			return (i);
+		}
+	}
+
+	return (ATOMIC_OPS_RWLOCK_SLOTS);
+}
+
+static inline void atomic_ops_rwlock_write_lock(atomic_ops_rwlock *lock) {
+	while (true) {
+		while (atomic_ops_uint_load(&lock->writer, ATOMIC_OPS_FENCE_NONE) != 0) {
+			atomic_ops_pause();
+		}
+
+		// Full: the flag must be visible to readers before the slots are checked
+		if (!atomic_ops_uint_cas(&lock->writer, 0, 1, ATOMIC_OPS_FENCE_FULL)) {
+			continue;
+		}
+
+		size_t slot;
+
+		if (lock->policy == ATOMIC_OPS_RWLOCK_WRITER) {
+			// New readers wait for us, so the slots can only drain
+			while ((slot = atomic_ops_rwlock_readers(lock)) != ATOMIC_OPS_RWLOCK_SLOTS) {
+				while (atomic_ops_uint_padded_load(&lock->slots[slot], ATOMIC_OPS_FENCE_NONE) != 0) {
+					atomic_ops_pause();
+				}
+			}
+
+			return;
+		}
+
+		if ((slot = atomic_ops_rwlock_readers(lock)) == ATOMIC_OPS_RWLOCK_SLOTS) {
+			return;
+		}
+
+		// Readers go first: step back, and try again once the slot we found drained
+		atomic_ops_uint_store(&lock->writer, 0, ATOMIC_OPS_FENCE_RELEASE);
+
+		while (atomic_ops_uint_padded_load(&lock->slots[slot], ATOMIC_OPS_FENCE_NONE) != 0) {
+			atomic_ops_pause();
+		}
+	}
+}
+
+static inline bool atomic_ops_rwlock_write_trylock(atomic_ops_rwlock *lock) {
+	if (atomic_ops_uint_load(&lock->writer, ATOMIC_OPS_FENCE_NONE) != 0
+		|| !atomic_ops_uint_cas(&lock->writer, 0, 1, ATOMIC_OPS_FENCE_FULL)) {
+		return (false);
+	}
+
+	if (atomic_ops_rwlock_readers(lock) == ATOMIC_OPS_RWLOCK_SLOTS) {
+		return (true);
+	}
+
+	atomic_ops_uint_store(&lock->writer, 0, ATOMIC_OPS_FENCE_RELEASE);
+
+	return (false);
+}
+
+static inline void atomic_ops_rwlock_write_unlock(atomic_ops_rwlock *lock) {
+	atomic_ops_uint_store(&lock->writer, 0, ATOMIC_OPS_FENCE_RELEASE);
+}
+
+#endif /* ATOMIC_OPS_RWLOCK_H */
@@ -0,0 +1,151 @@
+/**
+ * This file is part of the atomic_ops project.
+ *
+ * For the full copyright and license information, please view the COPYING
+ * file that was distributed with this source code.
+ *
+ * @copyright  (c) the atomic_ops project
+ * @author     Luca Longinotti <chtekk@longitekk.com>
+ * @license    BSD 2-clause
+ * @version    $Id$
+ */
+
+#ifndef ATOMIC_OPS_SEQLOCK_H
+#define ATOMIC_OPS_SEQLOCK_H 1
+
+/*
+ * Sequence lock, for multi-word data that is read far more often than written.
+ * Writers make the sequence odd before changing the data, and even again
+ * after. Readers take the sequence, copy the data, then check the sequence
+ * again: if it was odd, or has changed, a writer interfered and the copy must
+ * be retried. Readers never write shared memory, so they don't slow each other
+ * or the writer down, but a steady stream of writers can starve them.
+ * Data read before read_retry() may be torn: it must only be copied, not
+ * followed as pointers nor otherwise acted upon, until read_retry() said so.
+ * On x86 the read side compiles to plain loads and compiler barriers.
+ * write_begin/write_end are for a single writer (or writers serialized some
+ * other way), write_lock/write_unlock let multiple writers exclude each other
+ * through the sequence itself.
+ */
+
+#include "atomic_ops.h"
+#include <string.h>
+
+/*
+ * Type Definitions
+ */
+
+typedef struct {
+	atomic_ops_uint seq; // Odd while a writer is changing the data
+} atomic_ops_seqlock;
+
+#define ATOMIC_OPS_SEQLOCK_INIT { ATOMIC_OPS_UINT_INIT(0) }
+
+/*
+ * Functions
+ */
+
+static inline void atomic_ops_seqlock_init(atomic_ops_seqlock *lock);
+static inline uintptr_t atomic_ops_seqlock_read_begin(const atomic_ops_seqlock *lock) ATTR_ALWAYSINLINE;
+static inline bool atomic_ops_seqlock_read_retry(const atomic_ops_seqlock *lock, uintptr_t seq) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_seqlock_write_begin(atomic_ops_seqlock *lock) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_seqlock_write_end(atomic_ops_seqlock *lock) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_seqlock_write_lock(atomic_ops_seqlock *lock) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_seqlock_write_unlock(atomic_ops_seqlock *lock) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_seqlock_read_copy(const atomic_ops_seqlock *lock, void *dst, const void *src, size_t size);
+static inline void atomic_ops_seqlock_write_copy(atomic_ops_seqlock *lock, void *dst, const void *src, size_t size);
+
+/*
+ * Implementations
+ */
+
+static inline void atomic_ops_seqlock_init(atomic_ops_seqlock *lock) {
+	atomic_ops_uint_store(&lock->seq, 0, ATOMIC_OPS_FENCE_RELEASE);
+}
+
+// Returns the sequence to pass to read_retry, once no writer is active
+static inline uintptr_t atomic_ops_seqlock_read_begin(const atomic_ops_seqlock *lock) {
+	uintptr_t seq;
+
+	// Acquire: the data must not be read before the sequence
+	while (((seq = atomic_ops_uint_load(&lock->seq, ATOMIC_OPS_FENCE_ACQUIRE)) & 1) != 0) {
+		atomic_ops_pause();
+	}
+
+	return (seq);
+}
+
+// True if a writer interfered since read_begin returned seq, and the data must be read again
+static inline bool atomic_ops_seqlock_read_retry(const atomic_ops_seqlock *lock, uintptr_t seq) {
+	// Read: the data must be read before the sequence is again
+	return (atomic_ops_uint_load(&lock->seq, ATOMIC_OPS_FENCE_READ) != seq);
+}
+
+static inline void atomic_ops_seqlock_write_begin(atomic_ops_seqlock *lock) {
+	uintptr_t seq = atomic_ops_uint_load(&lock->seq, ATOMIC_OPS_FENCE_NONE);
+
+	// Write: the odd sequence must be visible before any change to the data
+	atomic_ops_uint_store(&lock->seq, seq + 1, ATOMIC_OPS_FENCE_WRITE);
+}
+
+static inline void atomic_ops_seqlock_write_end(atomic_ops_seqlock *lock) {
+	uintptr_t seq = atomic_ops_uint_load(&lock->seq, ATOMIC_OPS_FENCE_NONE);
+
+	atomic_ops_uint_store(&lock->seq, seq + 1, ATOMIC_OPS_FENCE_RELEASE);
+}
+
+static inline void atomic_ops_seqlock_write_lock(atomic_ops_seqlock *lock) {
+	while (true) {
+		uintptr_t seq = atomic_ops_uint_load(&lock->seq, ATOMIC_OPS_FENCE_NONE);
+
+		// Write: same as write_begin, the cas making the sequence odd also excludes other writers
+		if ((seq & 1) == 0 && atomic_ops_uint_cas(&lock->seq, seq, seq + 1, ATOMIC_OPS_FENCE_WRITE)) {
+			return;
+		}
+
+		atomic_ops_pause();
+	}
+}
+
+static inline void atomic_ops_seqlock_write_unlock(atomic_ops_seqlock *lock) {
+	atomic_ops_seqlock_write_end(lock);
+}
+
+// Consistent copy of size bytes from src, which writers only change under lock
+static inline void atomic_ops_seqlock_read_copy(const atomic_ops_seqlock *lock, void *dst, const void *src, size_t size) {
+	uintptr_t seq;
+
+	do {
+		seq = atomic_ops_seqlock_read_begin(lock);
+		memcpy(dst, src, size);
+	} while (atomic_ops_seqlock_read_retry(lock, seq));
+}
+
+// Copy size bytes from src to dst, which readers read under lock; writers exclude each other
+static inline void atomic_ops_seqlock_write_copy(atomic_ops_seqlock *lock, void *dst, const void *src, size_t size) {
+	atomic_ops_seqlock_write_lock(lock);
+	memcpy(dst, src, size);
+	atomic_ops_seqlock_write_unlock(lock);
+}
+
+/*
+ * Typed seqlocks: GEN_atomic_ops_seqlock(struct quote, quote) defines the type
+ * atomic_ops_seqlock_quote, holding the data with its lock, and the functions
+ * atomic_ops_seqlock_quote_read(sl, &copy) and atomic_ops_seqlock_quote_write(sl, &new).
+ */
+
+#define GEN_atomic_ops_seqlock(TYPE, NAME) \
+typedef struct {																						\
+	atomic_ops_seqlock lock;																			\
+	TYPE data;																							\
+} atomic_ops_seqlock_##NAME;																			\
+																										\
+static inline void atomic_ops_seqlock_##NAME##_read(const atomic_ops_seqlock_##NAME *sl, TYPE *val) {	\
+	atomic_ops_seqlock_read_copy(&sl->lock, val, &sl->data, sizeof(TYPE));								\
+}																										\
+																										\
+static inline void atomic_ops_seqlock_##NAME##_write(atomic_ops_seqlock_##NAME *sl, const TYPE *val) {	\
+	atomic_ops_seqlock_write_copy(&sl->lock, &sl->data, val, sizeof(TYPE));								\
+}
+
+#endif /* ATOMIC_OPS_SEQLOCK_H */
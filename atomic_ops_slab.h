@@ -0,0 +1,312 @@
+/**
+ * This file is part of the atomic_ops project.
+ *
+ * For the full copyright and license information, please view the COPYING
+ * file that was distributed with this source code.
+ *
+ * @copyright  (c) the atomic_ops project
+ * @author     Luca Longinotti <chtekk@longitekk.com>
+ * @license    BSD 2-clause
+ * @version    $Id$
+ */
+
+#ifndef ATOMIC_OPS_SLAB_H
+#define ATOMIC_OPS_SLAB_H 1
+
+/*
+ * Allocator of fixed-size objects, for the nodes of lock-free structures.
+ * A pool hands out objects from slabs: blocks of ATOMIC_OPS_SLAB_BYTES bytes,
+ * aligned to their size, so an object finds its slab by masking its address.
+ * Each thread allocates and frees through its own cache, which owns some of
+ * the slabs and keeps a plain free list of their objects: allocating and
+ * freeing objects of its own slabs touches no shared memory at all.
+ * Objects freed by other threads go onto the remote list of their slab, a
+ * stack pushed with a CAS, never taking locks. The owner takes the whole list
+ * with a single swap, once its free list runs dry, so remote frees cost it
+ * one atomic operation per batch, not per object.
+ * A destroyed cache gives its free objects back to their slabs and leaves the
+ * slabs on the pool's orphan stack, for caches needing more objects to adopt.
+ * Memory is only returned to the system when the pool is destroyed.
+ */
+
+#include "atomic_ops.h"
+#include "atomic_ops_stack.h"
+
+// Bytes per slab, a power of two
+#if !defined(ATOMIC_OPS_SLAB_BYTES)
+	#define ATOMIC_OPS_SLAB_BYTES 65536
+#endif
+
+// Alignment of objects, as malloc's on 64 bit platforms
+#if !defined(ATOMIC_OPS_SLAB_ALIGN)
+	#define ATOMIC_OPS_SLAB_ALIGN 16
+#endif
+
+/*
+ * Type Definitions
+ */
+
+typedef struct atomic_ops_slab atomic_ops_slab;
+
+// Header at the start of each slab, the objects follow
+struct atomic_ops_slab {
+	atomic_ops_stack_node node; // On the pool's orphan stack
+	atomic_ops_slab *all; // Next of all the pool's slabs
+	atomic_ops_slab *next; // Next slab of the owning cache
+	atomic_ops_ptr owner; // Owning cache, NULL while orphaned
+	char pad0[ATOMIC_OPS_CACHELINE_SIZE - sizeof(atomic_ops_stack_node) - (2 * sizeof(atomic_ops_slab *)) - sizeof(atomic_ops_ptr)];
+	atomic_ops_ptr remote; // Objects freed by other threads, linked through their first word
+	char pad1[ATOMIC_OPS_CACHELINE_SIZE - sizeof(atomic_ops_ptr)];
+};
+
+typedef struct {
+	size_t size; // Object size, rounded up to ATOMIC_OPS_SLAB_ALIGN
+	size_t count; // Objects per slab
+	atomic_ops_ptr slabs; // All slabs, linked through 'all'
+	atomic_ops_stack orphans; // Slabs of destroyed caches
+} atomic_ops_slab_pool;
+
+// Owned by one thread
+typedef struct {
+	atomic_ops_slab_pool *pool;
+	void *free; // Objects of the owned slabs ready to allocate, linked through their first word
+	atomic_ops_slab *slabs; // Owned slabs
+} atomic_ops_slab_cache;
+
+/*
+ * Functions
+ */
+
+static inline bool atomic_ops_slab_pool_init(atomic_ops_slab_pool *pool, size_t size);
+static inline void atomic_ops_slab_pool_destroy(atomic_ops_slab_pool *pool);
+static inline void atomic_ops_slab_cache_init(atomic_ops_slab_cache *cache, atomic_ops_slab_pool *pool);
+static inline void atomic_ops_slab_cache_destroy(atomic_ops_slab_cache *cache);
+static inline void * atomic_ops_slab_alloc(atomic_ops_slab_cache *cache) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_slab_free(atomic_ops_slab_cache *cache, void *obj) ATTR_ALWAYSINLINE;
+static inline size_t atomic_ops_slab_alloc_bulk(atomic_ops_slab_cache *cache, void **objs, size_t count);
+static inline void atomic_ops_slab_free_bulk(atomic_ops_slab_cache *cache, void **objs, size_t count);
+
+/*
+ * Implementations
+ */
+
+// Offset of the first object in a slab
+#define ATOMIC_OPS_SLAB_OFFSET (((sizeof(atomic_ops_slab) + ATOMIC_OPS_SLAB_ALIGN - 1) / ATOMIC_OPS_SLAB_ALIGN) * ATOMIC_OPS_SLAB_ALIGN)
+
+#define ATOMIC_OPS_SLAB_NEXT(OBJ) (*(void **)(OBJ))
+
+// False if size is zero or objects that big don't fit in a slab
+static inline bool atomic_ops_slab_pool_init(atomic_ops_slab_pool *pool, size_t size) {
+	if (size == 0) {
+		return (false);
+	}
+
+	size = (size < sizeof(void *)) ? (sizeof(void *)) : (size);
+	size = ((size + ATOMIC_OPS_SLAB_ALIGN - 1) / ATOMIC_OPS_SLAB_ALIGN) * ATOMIC_OPS_SLAB_ALIGN;
+
+	if (size > ATOMIC_OPS_SLAB_BYTES - ATOMIC_OPS_SLAB_OFFSET) {
+		return (false);
+	}
+
+	pool->size = size;
+	pool->count = (ATOMIC_OPS_SLAB_BYTES - ATOMIC_OPS_SLAB_OFFSET) / size;
+
+	atomic_ops_stack_init(&pool->orphans);
+	atomic_ops_ptr_store(&pool->slabs, NULL, ATOMIC_OPS_FENCE_RELEASE);
+
+	return (true);
+}
+
+// No cache may use the pool anymore; all objects are freed with it
+static inline void atomic_ops_slab_pool_destroy(atomic_ops_slab_pool *pool) {
+	atomic_ops_slab *slab = atomic_ops_ptr_load(&pool->slabs, ATOMIC_OPS_FENCE_ACQUIRE);
+
+	while (slab != NULL) {
+		atomic_ops_slab *all = slab->all;
+
+		free(slab);
+		slab = all;
+	}
+
+	atomic_ops_ptr_store(&pool->slabs, NULL, ATOMIC_OPS_FENCE_NONE);
+}
+
+static inline void atomic_ops_slab_cache_init(atomic_ops_slab_cache *cache, atomic_ops_slab_pool *pool) {
+	cache->pool = pool;
+	cache->free = NULL;
+	cache->slabs = NULL;
+}
+
+static inline atomic_ops_slab * atomic_ops_slab_of(const void *obj) {
+	return ((atomic_ops_slab *)((uintptr_t)obj & ~((uintptr_t)ATOMIC_OPS_SLAB_BYTES - 1)));
+}
+
+// Pushes the chain of objects from first to last onto the slab's remote list
+static inline void atomic_ops_slab_push_remote(atomic_ops_slab *slab, void *first, void *last) {
+	void *head;
+
+	do {
+		head = atomic_ops_ptr_load(&slab->remote, ATOMIC_OPS_FENCE_NONE);
+		ATOMIC_OPS_SLAB_NEXT(last) = head;
+	} while (!atomic_ops_ptr_cas(&slab->remote, head, first, ATOMIC_OPS_FENCE_RELEASE));
+}
+
+// Gives the cache, whose free list is empty, all objects other threads freed into the slab; false if there are none
+static inline bool atomic_ops_slab_reclaim(atomic_ops_slab_cache *cache, atomic_ops_slab *slab) {
+	if (atomic_ops_ptr_load(&slab->remote, ATOMIC_OPS_FENCE_NONE) == NULL) {
+		return (false);
+	}
+
+	cache->free = atomic_ops_ptr_swap(&slab->remote, NULL, ATOMIC_OPS_FENCE_ACQUIRE);
+
+	return (true);
+}
+
+// Refills the empty free list: remote frees first, then orphaned slabs, then a new slab; false if out of memory
+static inline bool atomic_ops_slab_refill(atomic_ops_slab_cache *cache) {
+	atomic_ops_slab_pool *pool = cache->pool;
+	atomic_ops_stack_node *node;
+	atomic_ops_slab *slab;
+
+	for (slab = cache->slabs; slab != NULL; slab = slab->next) {
+		if (atomic_ops_slab_reclaim(cache, slab)) {
+			return (true);
+		}
+	}
+
+	while ((node = atomic_ops_stack_pop(&pool->orphans)) != NULL) {
+		slab = (atomic_ops_slab *)node;
+
+		atomic_ops_ptr_store(&slab->owner, cache, ATOMIC_OPS_FENCE_NONE);
+		slab->next = cache->slabs;
+		cache->slabs = slab;
+
+		if (atomic_ops_slab_reclaim(cache, slab)) {
+			return (true);
+		}
+	}
+
+	slab = aligned_alloc(ATOMIC_OPS_SLAB_BYTES, ATOMIC_OPS_SLAB_BYTES);
+
+	if (slab == NULL) {
+		return (false);
+	}
+
+	atomic_ops_ptr_store(&slab->owner, cache, ATOMIC_OPS_FENCE_NONE);
+	atomic_ops_ptr_store(&slab->remote, NULL, ATOMIC_OPS_FENCE_NONE);
+	slab->next = cache->slabs;
+	cache->slabs = slab;
+
+	do {
+		slab->all = atomic_ops_ptr_load(&pool->slabs, ATOMIC_OPS_FENCE_NONE);
+	} while (!atomic_ops_ptr_cas(&pool->slabs, slab->all, slab, ATOMIC_OPS_FENCE_RELEASE));
+
+	char *objs = (char *)slab + ATOMIC_OPS_SLAB_OFFSET;
+
+	for (size_t i = 0; i < pool->count - 1; i++) {
+		ATOMIC_OPS_SLAB_NEXT(objs + (i * pool->size)) = objs + ((i + 1) * pool->size);
+	}
+
+	ATOMIC_OPS_SLAB_NEXT(objs + ((pool->count - 1) * pool->size)) = NULL;
+	cache->free = objs;
+
+	return (true);
+}
+
+// Objects still allocated stay valid, and may be freed through any other cache
+static inline void atomic_ops_slab_cache_destroy(atomic_ops_slab_cache *cache) {
+	void *obj = cache->free;
+
+	// Free objects go back to their slabs as remote frees, consecutive ones of the same slab together
+	while (obj != NULL) {
+		atomic_ops_slab *slab = atomic_ops_slab_of(obj);
+		void *first = obj, *last = obj;
+
+		obj = ATOMIC_OPS_SLAB_NEXT(obj);
+
+		while (obj != NULL && atomic_ops_slab_of(obj) == slab) {
+			last = obj;
+			obj = ATOMIC_OPS_SLAB_NEXT(obj);
+		}
+
+		atomic_ops_slab_push_remote(slab, first, last);
+	}
+
+	while (cache->slabs != NULL) {
+		atomic_ops_slab *slab = cache->slabs;
+
+		cache->slabs = slab->next;
+
+		atomic_ops_ptr_store(&slab->owner, NULL, ATOMIC_OPS_FENCE_NONE);
+		atomic_ops_stack_push(&cache->pool->orphans, &slab->node);
+	}
+
+	cache->free = NULL;
+}
+
+// NULL if out of memory
+static inline void * atomic_ops_slab_alloc(atomic_ops_slab_cache *cache) {
+	void *obj = cache->free;
+
+	if (obj == NULL) {
+		if (!atomic_ops_slab_refill(cache)) {
+			return (NULL);
+		}
+
+		obj = cache->free;
+	}
+
+	cache->free = ATOMIC_OPS_SLAB_NEXT(obj);
+
+	return (obj);
+}
+
+// obj may come from any cache of the same pool
+static inline void atomic_ops_slab_free(atomic_ops_slab_cache *cache, void *obj) {
+	atomic_ops_slab *slab = atomic_ops_slab_of(obj);
+
+	if (atomic_ops_ptr_load(&slab->owner, ATOMIC_OPS_FENCE_NONE) == cache) {
+		ATOMIC_OPS_SLAB_NEXT(obj) = cache->free;
+		cache->free = obj;
+	}
+	else {
+		atomic_ops_slab_push_remote(slab, obj, obj);
+	}
+}
+
+// Allocates up to count objects into objs, returning how many (fewer only if out of memory)
+static inline size_t atomic_ops_slab_alloc_bulk(atomic_ops_slab_cache *cache, void **objs, size_t count) {
+	for (size_t i = 0; i < count; i++) {
+		if (cache->free == NULL && !atomic_ops_slab_refill(cache)) {
+			return (i);
+		}
+
+		objs[i] = cache->free;
+		cache->free = ATOMIC_OPS_SLAB_NEXT(objs[i]);
+	}
+
+	return (count);
+}
+
+// Runs of objects of the same slab are freed together, remote ones with a single CAS
+static inline void atomic_ops_slab_free_bulk(atomic_ops_slab_cache *cache, void **objs, size_t count) {
+	for (size_t i = 0; i < count; ) {
+		atomic_ops_slab *slab = atomic_ops_slab_of(objs[i]);
+		void *first = objs[i], *last = objs[i];
+
+		for (i++; i < count && atomic_ops_slab_of(objs[i]) == slab; i++) {
+			ATOMIC_OPS_SLAB_NEXT(last) = objs[i];
+			last = objs[i];
+		}
+
+		if (atomic_ops_ptr_load(&slab->owner, ATOMIC_OPS_FENCE_NONE) == cache) {
+			ATOMIC_OPS_SLAB_NEXT(last) = cache->free;
+			cache->free = first;
+		}
+		else {
+			atomic_ops_slab_push_remote(slab, first, last);
+		}
+	}
+}
+
+#endif /* ATOMIC_OPS_SLAB_H */
@@ -0,0 +1,182 @@
+/**
+ * This file is part of the atomic_ops project.
+ *
+ * For the full copyright and license information, please view the COPYING
+ * file that was distributed with this source code.
+ *
+ * @copyright  (c) the atomic_ops project
+ * @author     Luca Longinotti <chtekk@longitekk.com>
+ * @license    BSD 2-clause
+ * @version    $Id$
+ */
+
+#ifndef ATOMIC_OPS_SPSC_RING_H
+#define ATOMIC_OPS_SPSC_RING_H 1
+
+/*
+ * Wait-free single-producer/single-consumer ring of fixed-size elements.
+ * The producer publishes with a release store of head, the consumer with a
+ * release store of tail, and each side reads the other's index with an
+ * acquire load: on x86 all of this is plain movs, no locked instructions.
+ * Each side also keeps a cached copy of the other side's index, and only
+ * reloads it when the cached value says the ring is full (or empty), so in
+ * steady state the shared lines are touched once per batch, not per element.
+ * Elements are written and read in place: reserve/commit on the producer
+ * side and peek/consume on the consumer side hand out pointers into the
+ * ring itself, for up to 'count' contiguous elements at a time.
+ */
+
+#include "atomic_ops.h"
+#include <string.h>
+
+/*
+ * Type Definitions
+ */
+
+typedef struct {
+	char *buffer;
+	size_t elem_size;
+	uintptr_t mask;
+	char pad0[ATOMIC_OPS_CACHELINE_SIZE - sizeof(char *) - sizeof(size_t) - sizeof(uintptr_t)];
+	atomic_ops_uint head; // Written by the producer only
+	uintptr_t tail_cache; // Producer's copy of tail
+	char pad1[ATOMIC_OPS_CACHELINE_SIZE - sizeof(atomic_ops_uint) - sizeof(uintptr_t)];
+	atomic_ops_uint tail; // Written by the consumer only
+	uintptr_t head_cache; // Consumer's copy of head
+	char pad2[ATOMIC_OPS_CACHELINE_SIZE - sizeof(atomic_ops_uint) - sizeof(uintptr_t)];
+} atomic_ops_spsc_ring;
+
+/*
+ * Functions
+ */
+
+static inline bool atomic_ops_spsc_ring_init(atomic_ops_spsc_ring *ring, size_t capacity, size_t elem_size);
+static inline void atomic_ops_spsc_ring_destroy(atomic_ops_spsc_ring *ring);
+static inline size_t atomic_ops_spsc_ring_capacity(const atomic_ops_spsc_ring *ring) ATTR_ALWAYSINLINE;
+static inline void * atomic_ops_spsc_ring_reserve(atomic_ops_spsc_ring *ring, size_t count, size_t *reserved) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_spsc_ring_commit(atomic_ops_spsc_ring *ring, size_t count) ATTR_ALWAYSINLINE;
+static inline void * atomic_ops_spsc_ring_peek(atomic_ops_spsc_ring *ring, size_t count, size_t *available) ATTR_ALWAYSINLINE;
+static inline void atomic_ops_spsc_ring_consume(atomic_ops_spsc_ring *ring, size_t count) ATTR_ALWAYSINLINE;
+static inline bool atomic_ops_spsc_ring_try_push(atomic_ops_spsc_ring *ring, const void *elem) ATTR_ALWAYSINLINE;
+static inline bool atomic_ops_spsc_ring_try_pop(atomic_ops_spsc_ring *ring, void *elem) ATTR_ALWAYSINLINE;
+
+/*
+ * Implementations
+ */
+
+// Capacity must be a power of two
+static inline bool atomic_ops_spsc_ring_init(atomic_ops_spsc_ring *ring, size_t capacity, size_t elem_size) {
+	if (capacity == 0 || (capacity & (capacity - 1)) != 0 || elem_size == 0) {
+		return (false);
+	}
+
+	ring->buffer = malloc(capacity * elem_size);
+	if (ring->buffer == NULL) {
+		return (false);
+	}
+
+	ring->elem_size = elem_size;
+	ring->mask = capacity - 1;
+	ring->tail_cache = 0;
+	ring->head_cache = 0;
+
+	atomic_ops_uint_store(&ring->head, 0, ATOMIC_OPS_FENCE_NONE);
+	atomic_ops_uint_store(&ring->tail, 0, ATOMIC_OPS_FENCE_RELEASE);
+
+	return (true);
+}
+
+static inline void atomic_ops_spsc_ring_destroy(atomic_ops_spsc_ring *ring) {
+	free(ring->buffer);
+	ring->buffer = NULL;
+}
+
+static inline size_t atomic_ops_spsc_ring_capacity(const atomic_ops_spsc_ring *ring) {
+	return (ring->mask + 1);
+}
+
+// Producer: get space for up to count contiguous elements, NULL if the ring is full
+static inline void * atomic_ops_spsc_ring_reserve(atomic_ops_spsc_ring *ring, size_t count, size_t *reserved) {
+	uintptr_t head = atomic_ops_uint_load(&ring->head, ATOMIC_OPS_FENCE_NONE);
+	size_t space = ring->tail_cache + ring->mask + 1 - head;
+
+	if (space < count) {
+		// Acquire: the consumer must be done reading what it released
+		ring->tail_cache = atomic_ops_uint_load(&ring->tail, ATOMIC_OPS_FENCE_ACQUIRE);
+		space = ring->tail_cache + ring->mask + 1 - head;
+	}
+
+	size_t contiguous = ring->mask + 1 - (head & ring->mask);
+
+	count = (count < space) ? (count) : (space);
+	count = (count < contiguous) ? (count) : (contiguous);
+
+	*reserved = count;
+
+	return ((count == 0) ? (NULL) : (ring->buffer + ((head & ring->mask) * ring->elem_size)));
+}
+
+// Producer: publish count elements written into reserved space
+static inline void atomic_ops_spsc_ring_commit(atomic_ops_spsc_ring *ring, size_t count) {
+	uintptr_t head = atomic_ops_uint_load(&ring->head, ATOMIC_OPS_FENCE_NONE);
+
+	atomic_ops_uint_store(&ring->head, head + count, ATOMIC_OPS_FENCE_RELEASE);
+}
+
+// Consumer: get up to count contiguous elements, NULL if the ring is empty
+static inline void * atomic_ops_spsc_ring_peek(atomic_ops_spsc_ring *ring, size_t count, size_t *available) {
+	uintptr_t tail = atomic_ops_uint_load(&ring->tail, ATOMIC_OPS_FENCE_NONE);
+	size_t avail = ring->head_cache - tail;
+
+	if (avail < count) {
+		// Acquire: the elements the producer committed must be visible
+		ring->head_cache = atomic_ops_uint_load(&ring->head, ATOMIC_OPS_FENCE_ACQUIRE);
+		avail = ring->head_cache - tail;
+	}
+
+	size_t contiguous = ring->mask + 1 - (tail & ring->mask);
+
+	count = (count < avail) ? (count) : (avail);
+	count = (count < contiguous) ? (count) : (contiguous);
+
+	*available = count;
+
+	return ((count == 0) ? (NULL) : (ring->buffer + ((tail & ring->mask) * ring->elem_size)));
+}
+
+// Consumer: hand count peeked elements back to the producer
+static inline void atomic_ops_spsc_ring_consume(atomic_ops_spsc_ring *ring, size_t count) {
+	uintptr_t tail = atomic_ops_uint_load(&ring->tail, ATOMIC_OPS_FENCE_NONE);
+
+	atomic_ops_uint_store(&ring->tail, tail + count, ATOMIC_OPS_FENCE_RELEASE);
+}
+
+static inline bool atomic_ops_spsc_ring_try_push(atomic_ops_spsc_ring *ring, const void *elem) {
+	size_t reserved;
+	void *slot = atomic_ops_spsc_ring_reserve(ring, 1, &reserved);
+
+	if (slot == NULL) {
+		return (false);
+	}
+
+	memcpy(slot, elem, ring->elem_size);
+	atomic_ops_spsc_ring_commit(ring, 1);
+
+	return (true);
+}
+
+static inline bool atomic_ops_spsc_ring_try_pop(atomic_ops_spsc_ring *ring, void *elem) {
+	size_t available;
+	void *slot = atomic_ops_spsc_ring_peek(ring, 1, &available);
+
+	if (slot == NULL) {
+		return (false);
+	}
+
+	memcpy(elem, slot, ring->elem_size);
+	atomic_ops_spsc_ring_consume(ring, 1);
+
+	return (true);
+}
+
+#endif /* ATOMIC_OPS_SPSC_RING_H */
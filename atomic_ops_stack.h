@@ -0,0 +1,183 @@
+/**
+ * This file is part of the atomic_ops project.
+ *
+ * For the full copyright and license information, please view the COPYING
+ * file that was distributed with this source code.
+ *
+ * @copyright  (c) the atomic_ops project
+ * @author     Luca Longinotti <chtekk@longitekk.com>
+ * @license    BSD 2-clause
+ * @version    $Id$
+ */
+
+#ifndef ATOMIC_OPS_STACK_H
+#define ATOMIC_OPS_STACK_H 1
+
+/*
+ * Lock-free LIFO stack of intrusive nodes (Treiber), with elimination backoff.
+ * The top is a dptr: the node, and a version bumped by every push and pop, so
+ * a pop whose top was popped and pushed again meanwhile fails its CAS instead
+ * of installing a stale next pointer (ABA). Nodes are never freed by the stack,
+ * but pop reads the next pointer of a node that another thread may have just
+ * popped: nodes must stay readable memory while the stack is in use, as they
+ * do in pools recycling them.
+ * When the CAS on the top fails, there is contention, and instead of retrying
+ * it right away, the operation visits a slot of the elimination array: a push
+ * offers its node there for a while, a pop takes a node offered there. A push
+ * and a pop that meet cancel each other out without touching the top at all,
+ * so the more threads contend, the more operations complete in parallel.
+ * Each failed attempt widens the range of slots used, spreading the threads
+ * out as contention grows, and keeping them together while it's low.
+ */
+
+#include "atomic_ops.h"
+
+// Elimination slots, each on its own line
+#if !defined(ATOMIC_OPS_STACK_SLOTS)
+	#define ATOMIC_OPS_STACK_SLOTS 16
+#endif
+
+// Pause instructions an operation waits in an elimination slot for a partner
+#if !defined(ATOMIC_OPS_STACK_SPINS)
+	#define ATOMIC_OPS_STACK_SPINS 64
+#endif
+
+/*
+ * Type Definitions
+ */
+
+typedef struct atomic_ops_stack_node atomic_ops_stack_node;
+
+// To be embedded in the objects put on the stack
+struct atomic_ops_stack_node {
+	atomic_ops_stack_node *next;
+};
+
+typedef struct {
+	atomic_ops_dptr top; // lo: top node, hi: version
+	char pad0[ATOMIC_OPS_DESTRUCTIVE_SIZE - sizeof(atomic_ops_dptr)];
+	atomic_ops_ptr_padded slots[ATOMIC_OPS_STACK_SLOTS]; // Node offered by a push, NULL if none
+} atomic_ops_stack;
+
+/*
+ * Functions
+ */
+
+static inline void atomic_ops_stack_init(atomic_ops_stack *stack);
+static inline void atomic_ops_stack_push(atomic_ops_stack *stack, atomic_ops_stack_node *node);
+static inline atomic_ops_stack_node * atomic_ops_stack_pop(atomic_ops_stack *stack);
+static inline bool atomic_ops_stack_empty(const atomic_ops_stack *stack) ATTR_ALWAYSINLINE;
+
+/*
+ * Implementations
+ */
+
+static inline void atomic_ops_stack_init(atomic_ops_stack *stack) {
+	atomic_ops_dptr_val top = { 0, 0 };
+
+	for (size_t i = 0; i < ATOMIC_OPS_STACK_SLOTS; i++) {
+		atomic_ops_ptr_padded_store(&stack->slots[i], NULL, ATOMIC_OPS_FENCE_NONE);
+	}
+
+	atomic_ops_dptr_store(&stack->top, top, ATOMIC_OPS_FENCE_RELEASE);
+}
+
+// Slot for the given failed attempt, in a range widening with each one
+static inline atomic_ops_ptr_padded * atomic_ops_stack_slot(atomic_ops_stack *stack, size_t attempt) {
+	size_t range = (attempt < ATOMIC_OPS_STACK_SLOTS) ? (attempt + 1) : (ATOMIC_OPS_STACK_SLOTS);
+	uint32_t hash = (uint32_t)(atomic_ops_thread_slot() + 1) * UINT32_C(0x9E3779B1) + (uint32_t)attempt * UINT32_C(0x85EBCA77);
+
+	return (&stack->slots[(hash >> 16) % range]);
+}
+
+// Offer the node to a pop: true if one took it
+static inline bool atomic_ops_stack_eliminate_push(atomic_ops_stack *stack, atomic_ops_stack_node *node, size_t attempt) {
+	atomic_ops_ptr_padded *slot = atomic_ops_stack_slot(stack, attempt);
+
+	if (atomic_ops_ptr_padded_load(slot, ATOMIC_OPS_FENCE_NONE) != NULL
+		|| !atomic_ops_ptr_padded_cas(slot, NULL, node, ATOMIC_OPS_FENCE_RELEASE)) {
+		return (false);
+	}
+
+	for (size_t i = 0; i < ATOMIC_OPS_STACK_SPINS; i++) {
+		if (atomic_ops_ptr_padded_load(slot, ATOMIC_OPS_FENCE_NONE) != node) {
+			return (true);
+		}
+
+		atomic_ops_pause();
+	}
+
+	// Withdraw the offer, unless a pop takes it right now
+	return (!atomic_ops_ptr_padded_cas(slot, node, NULL, ATOMIC_OPS_FENCE_NONE));
+}
+
+// Take a node offered by a push, NULL if none showed up
+static inline atomic_ops_stack_node * atomic_ops_stack_eliminate_pop(atomic_ops_stack *stack, size_t attempt) {
+	atomic_ops_ptr_padded *slot = atomic_ops_stack_slot(stack, attempt);
+
+	for (size_t i = 0; i < ATOMIC_OPS_STACK_SPINS; i++) {
+		atomic_ops_stack_node *node = atomic_ops_ptr_padded_load(slot, ATOMIC_OPS_FENCE_NONE);
+
+		if (node != NULL) {
+			return (atomic_ops_ptr_padded_cas(slot, node, NULL, ATOMIC_OPS_FENCE_ACQUIRE) ? (node) : (NULL));
+		}
+
+		atomic_ops_pause();
+	}
+
+	return (NULL);
+}
+
+static inline void atomic_ops_stack_push(atomic_ops_stack *stack, atomic_ops_stack_node *node) {
+	atomic_ops_dptr_val top = atomic_ops_dptr_load(&stack->top, ATOMIC_OPS_FENCE_NONE), newtop;
+
+	for (size_t attempt = 0; ; attempt++) {
+		node->next = (atomic_ops_stack_node *)top.lo;
+
+		newtop.lo = (uintptr_t)node;
+		newtop.hi = top.hi + 1;
+
+		if (atomic_ops_dptr_cas(&stack->top, top, newtop, ATOMIC_OPS_FENCE_RELEASE)) {
+			return;
+		}
+
+		if (atomic_ops_stack_eliminate_push(stack, node, attempt)) {
+			return;
+		}
+
+		top = atomic_ops_dptr_load(&stack->top, ATOMIC_OPS_FENCE_NONE);
+	}
+}
+
+// NULL if the stack is empty
+static inline atomic_ops_stack_node * atomic_ops_stack_pop(atomic_ops_stack *stack) {
+	atomic_ops_dptr_val top = atomic_ops_dptr_load(&stack->top, ATOMIC_OPS_FENCE_ACQUIRE), newtop;
+
+	for (size_t attempt = 0; ; attempt++) {
+		if (top.lo == 0) {
+			return (NULL);
+		}
+
+		// Maybe popped and reused by now: then the version changed too, and the CAS fails
+		newtop.lo = (uintptr_t)((volatile atomic_ops_stack_node *)top.lo)->next;
+		newtop.hi = top.hi + 1;
+
+		if (atomic_ops_dptr_cas(&stack->top, top, newtop, ATOMIC_OPS_FENCE_ACQUIRE)) {
+			return ((atomic_ops_stack_node *)top.lo);
+		}
+
+		atomic_ops_stack_node *node = atomic_ops_stack_eliminate_pop(stack, attempt);
+		if (node != NULL) {
+			return (node);
+		}
+
+		top = atomic_ops_dptr_load(&stack->top, ATOMIC_OPS_FENCE_ACQUIRE);
+	}
+}
+
+// Only a hint while other threads push and pop
+static inline bool atomic_ops_stack_empty(const atomic_ops_stack *stack) {
+	return (atomic_ops_dptr_load(&stack->top, ATOMIC_OPS_FENCE_NONE).lo == 0);
+}
+
+#endif /* ATOMIC_OPS_STACK_H */
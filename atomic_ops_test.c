@@ -11,7 +11,24 @@
  */
 
 #include "atomic_ops.h"
+#include "atomic_ops_bitmap.h"
+#include "atomic_ops_combiner.h"
+#include "atomic_ops_counter.h"
+#include "atomic_ops_epoch.h"
+#include "atomic_ops_hashmap.h"
+#include "atomic_ops_hazard.h"
+#include "atomic_ops_histogram.h"
+#include "atomic_ops_list.h"
+#include "atomic_ops_lock.h"
+#include "atomic_ops_mpmc_queue.h"
+#include "atomic_ops_rwlock.h"
+#include "atomic_ops_seqlock.h"
+#include "atomic_ops_slab.h"
+#include "atomic_ops_spsc_ring.h"
+#include "atomic_ops_stack.h"
 #include <check.h>
+#include <pthread.h>
+#include <sched.h>
 
 #define TCASE_ADD(testname) \
 	TCase *tc_##testname = tcase_create(#testname); \
@@ -47,9 +64,32 @@ Suite *test_atomic_ops_dec(void);
 Suite *test_atomic_ops_fetch_and_add(void);
 Suite *test_atomic_ops_fetch_and_inc(void);
 Suite *test_atomic_ops_fetch_and_dec(void);
+Suite *test_atomic_ops_fetch_and_andorxor(void);
+Suite *test_atomic_ops_fetch_minmax(void);
 Suite *test_atomic_ops_casr(void);
 Suite *test_atomic_ops_cas(void);
 Suite *test_atomic_ops_swap(void);
+Suite *test_atomic_ops_test_and_bit(void);
+Suite *test_atomic_ops_dptr(void);
+Suite *test_atomic_ops_mpmc_queue(void);
+Suite *test_atomic_ops_spsc_ring(void);
+Suite *test_atomic_ops_hazard(void);
+Suite *test_atomic_ops_epoch(void);
+Suite *test_atomic_ops_list(void);
+Suite *test_atomic_ops_hashmap(void);
+Suite *test_atomic_ops_lock(void);
+Suite *test_atomic_ops_rwlock(void);
+Suite *test_atomic_ops_seqlock(void);
+Suite *test_atomic_ops_counter(void);
+Suite *test_atomic_ops_padded(void);
+Suite *test_atomic_ops_fixed(void);
+Suite *test_atomic_ops_bitmap(void);
+Suite *test_atomic_ops_histogram(void);
+Suite *test_atomic_ops_combiner(void);
+Suite *test_atomic_ops_stack(void);
+Suite *test_atomic_ops_backoff(void);
+Suite *test_atomic_ops_stats(void);
+Suite *test_atomic_ops_slab(void);
 
 int main(void) {
 	SRunner *sr = srunner_create(test_atomic_ops_load());
@@ -64,9 +104,32 @@ int main(void) {
 	srunner_add_suite(sr, test_atomic_ops_fetch_and_add());
 	srunner_add_suite(sr, test_atomic_ops_fetch_and_inc());
 	srunner_add_suite(sr, test_atomic_ops_fetch_and_dec());
+	srunner_add_suite(sr, test_atomic_ops_fetch_and_andorxor());
+	srunner_add_suite(sr, test_atomic_ops_fetch_minmax());
 	srunner_add_suite(sr, test_atomic_ops_casr());
 	srunner_add_suite(sr, test_atomic_ops_cas());
 	srunner_add_suite(sr, test_atomic_ops_swap());
+	srunner_add_suite(sr, test_atomic_ops_test_and_bit());
+	srunner_add_suite(sr, test_atomic_ops_dptr());
+	srunner_add_suite(sr, test_atomic_ops_mpmc_queue());
+	srunner_add_suite(sr, test_atomic_ops_spsc_ring());
+	srunner_add_suite(sr, test_atomic_ops_hazard());
+	srunner_add_suite(sr, test_atomic_ops_epoch());
+	srunner_add_suite(sr, test_atomic_ops_list());
+	srunner_add_suite(sr, test_atomic_ops_hashmap());
+	srunner_add_suite(sr, test_atomic_ops_lock());
+	srunner_add_suite(sr, test_atomic_ops_rwlock());
+	srunner_add_suite(sr, test_atomic_ops_seqlock());
+	srunner_add_suite(sr, test_atomic_ops_counter());
+	srunner_add_suite(sr, test_atomic_ops_padded());
+	srunner_add_suite(sr, test_atomic_ops_fixed());
+	srunner_add_suite(sr, test_atomic_ops_bitmap());
+	srunner_add_suite(sr, test_atomic_ops_histogram());
+	srunner_add_suite(sr, test_atomic_ops_combiner());
+	srunner_add_suite(sr, test_atomic_ops_stack());
+	srunner_add_suite(sr, test_atomic_ops_backoff());
+	srunner_add_suite(sr, test_atomic_ops_stats());
+	srunner_add_suite(sr, test_atomic_ops_slab());
 
 	srunner_run_all(sr, CK_VERBOSE);
 	int failed = srunner_ntests_failed(sr);
@@ -424,6 +487,106 @@ Suite *test_atomic_ops_fetch_and_dec(void) {
 
 /******************************************************************************/
 
+START_TEST(test_atomic_ops_fetch_and_andorxor_int) {
+	atomic_ops_int dest = ATOMIC_OPS_INT_INIT(-16);
+
+	ck_assert(atomic_ops_int_fetch_and_or(&dest, 0x0F, ATOMIC_OPS_FENCE_NONE) == -16);
+	ck_assert(atomic_ops_int_fetch_and_and(&dest, 0x3C, ATOMIC_OPS_FENCE_FULL) == -1);
+	ck_assert(atomic_ops_int_fetch_and_xor(&dest, -1, ATOMIC_OPS_FENCE_ACQUIRE) == 0x3C);
+	ck_assert(atomic_ops_int_load(&dest, ATOMIC_OPS_FENCE_FULL) == ~0x3C);
+} END_TEST
+
+START_TEST(test_atomic_ops_fetch_and_andorxor_uint) {
+	atomic_ops_uint dest = ATOMIC_OPS_UINT_INIT(0xF0);
+
+	ck_assert(atomic_ops_uint_fetch_and_or(&dest, 0x0F, ATOMIC_OPS_FENCE_RELEASE) == 0xF0);
+	ck_assert(atomic_ops_uint_fetch_and_and(&dest, 0x3C, ATOMIC_OPS_FENCE_NONE) == 0xFF);
+	ck_assert(atomic_ops_uint_fetch_and_xor(&dest, 0xFF, ATOMIC_OPS_FENCE_FULL) == 0x3C);
+	ck_assert(atomic_ops_uint_load(&dest, ATOMIC_OPS_FENCE_FULL) == 0xC3);
+} END_TEST
+
+Suite *test_atomic_ops_fetch_and_andorxor(void) {
+	Suite *s = suite_create("test_atomic_ops_fetch_and_andorxor");
+
+	TCASE_ADD(atomic_ops_fetch_and_andorxor_int);
+	TCASE_ADD(atomic_ops_fetch_and_andorxor_uint);
+
+	return (s);
+}
+
+/******************************************************************************/
+
+START_TEST(test_atomic_ops_fetch_minmax_int) {
+	atomic_ops_int dest = ATOMIC_OPS_INT_INIT(-5);
+
+	// Signed comparison
+	ck_assert(atomic_ops_int_fetch_min(&dest, 3, ATOMIC_OPS_FENCE_NONE) == -5);
+	ck_assert(atomic_ops_int_fetch_min(&dest, -9, ATOMIC_OPS_FENCE_FULL) == -5);
+	ck_assert(atomic_ops_int_fetch_max(&dest, -10, ATOMIC_OPS_FENCE_FULL) == -9);
+	ck_assert(atomic_ops_int_fetch_max(&dest, 4, ATOMIC_OPS_FENCE_ACQUIRE) == -9);
+	ck_assert(atomic_ops_int_fetch_max(&dest, 4, ATOMIC_OPS_FENCE_NONE) == 4);
+	ck_assert(atomic_ops_int_load(&dest, ATOMIC_OPS_FENCE_FULL) == 4);
+} END_TEST
+
+START_TEST(test_atomic_ops_fetch_minmax_uint) {
+	atomic_ops_uint dest = ATOMIC_OPS_UINT_INIT(5);
+
+	// Unsigned comparison
+	ck_assert(atomic_ops_uint_fetch_max(&dest, (uintptr_t)-1, ATOMIC_OPS_FENCE_RELEASE) == 5);
+	ck_assert(atomic_ops_uint_fetch_min(&dest, 7, ATOMIC_OPS_FENCE_NONE) == (uintptr_t)-1);
+	ck_assert(atomic_ops_uint_fetch_min(&dest, 9, ATOMIC_OPS_FENCE_FULL) == 7);
+	ck_assert(atomic_ops_uint_fetch_max(&dest, 7, ATOMIC_OPS_FENCE_FULL) == 7);
+	ck_assert(atomic_ops_uint_load(&dest, ATOMIC_OPS_FENCE_FULL) == 7);
+} END_TEST
+
+#define MINMAX_THREADS 4
+#define MINMAX_ITERATIONS 50000
+
+static atomic_ops_uint minmax_high = ATOMIC_OPS_UINT_INIT(0);
+static atomic_ops_int minmax_low = ATOMIC_OPS_INT_INIT(0);
+
+// High-water marks: every value any thread saw must end up below/above them
+static void *minmax_worker(void *arg) {
+	size_t id = (size_t)arg;
+
+	for (size_t i = 0; i < MINMAX_ITERATIONS; i++) {
+		uintptr_t val = (i * MINMAX_THREADS) + id + 1;
+
+		ck_assert(atomic_ops_uint_fetch_max(&minmax_high, val, ATOMIC_OPS_FENCE_NONE) != val);
+		atomic_ops_int_fetch_min(&minmax_low, -(intptr_t)val, ATOMIC_OPS_FENCE_NONE);
+		ck_assert(atomic_ops_int_load(&minmax_low, ATOMIC_OPS_FENCE_NONE) <= -(intptr_t)val);
+	}
+
+	return (NULL);
+}
+
+START_TEST(test_atomic_ops_fetch_minmax_threads) {
+	pthread_t threads[MINMAX_THREADS];
+
+	for (size_t i = 0; i < MINMAX_THREADS; i++) {
+		ck_assert(pthread_create(&threads[i], NULL, &minmax_worker, (void *)i) == 0);
+	}
+
+	for (size_t i = 0; i < MINMAX_THREADS; i++) {
+		ck_assert(pthread_join(threads[i], NULL) == 0);
+	}
+
+	ck_assert(atomic_ops_uint_load(&minmax_high, ATOMIC_OPS_FENCE_NONE) == MINMAX_THREADS * MINMAX_ITERATIONS);
+	ck_assert(atomic_ops_int_load(&minmax_low, ATOMIC_OPS_FENCE_NONE) == -(MINMAX_THREADS * MINMAX_ITERATIONS));
+} END_TEST
+
+Suite *test_atomic_ops_fetch_minmax(void) {
+	Suite *s = suite_create("test_atomic_ops_fetch_minmax");
+
+	TCASE_ADD(atomic_ops_fetch_minmax_int);
+	TCASE_ADD(atomic_ops_fetch_minmax_uint);
+	TCASE_ADD(atomic_ops_fetch_minmax_threads);
+
+	return (s);
+}
+
+/******************************************************************************/
+
 START_TEST(test_atomic_ops_casr_int) {
 } END_TEST
 
@@ -486,3 +649,2775 @@ Suite *test_atomic_ops_swap(void) {
 }
 
 /******************************************************************************/
+
+START_TEST(test_atomic_ops_test_and_bit_int) {
+	atomic_ops_int dest = ATOMIC_OPS_INT_INIT(-1);
+
+	ck_assert(atomic_ops_int_test_and_clear_bit(&dest, 0, ATOMIC_OPS_FENCE_NONE));
+	ck_assert(!atomic_ops_int_test_and_clear_bit(&dest, 0, ATOMIC_OPS_FENCE_FULL));
+	ck_assert(atomic_ops_int_load(&dest, ATOMIC_OPS_FENCE_FULL) == -2);
+
+	ck_assert(!atomic_ops_int_test_and_set_bit(&dest, 0, ATOMIC_OPS_FENCE_FULL));
+	ck_assert(atomic_ops_int_test_and_set_bit(&dest, 0, ATOMIC_OPS_FENCE_NONE));
+	ck_assert(atomic_ops_int_load(&dest, ATOMIC_OPS_FENCE_FULL) == -1);
+
+	// The sign bit too
+	ck_assert(atomic_ops_int_test_and_complement_bit(&dest, (sizeof(intptr_t) * 8) - 1, ATOMIC_OPS_FENCE_FULL));
+	ck_assert(atomic_ops_int_load(&dest, ATOMIC_OPS_FENCE_FULL) == INTPTR_MAX);
+	ck_assert(!atomic_ops_int_test_and_complement_bit(&dest, (sizeof(intptr_t) * 8) - 1, ATOMIC_OPS_FENCE_FULL));
+	ck_assert(atomic_ops_int_load(&dest, ATOMIC_OPS_FENCE_FULL) == -1);
+} END_TEST
+
+START_TEST(test_atomic_ops_test_and_bit_uint) {
+	atomic_ops_uint dest = ATOMIC_OPS_UINT_INIT(0);
+
+	ck_assert(!atomic_ops_uint_test_and_set_bit(&dest, 3, ATOMIC_OPS_FENCE_NONE));
+	ck_assert(atomic_ops_uint_test_and_set_bit(&dest, 3, ATOMIC_OPS_FENCE_FULL));
+	ck_assert(!atomic_ops_uint_test_and_set_bit(&dest, 31, ATOMIC_OPS_FENCE_ACQUIRE));
+	ck_assert(atomic_ops_uint_load(&dest, ATOMIC_OPS_FENCE_FULL) == ((((uintptr_t)1) << 31) | 0x08));
+
+	ck_assert(atomic_ops_uint_test_and_clear_bit(&dest, 3, ATOMIC_OPS_FENCE_RELEASE));
+	ck_assert(!atomic_ops_uint_test_and_clear_bit(&dest, 4, ATOMIC_OPS_FENCE_FULL));
+	ck_assert(!atomic_ops_uint_test_and_complement_bit(&dest, 0, ATOMIC_OPS_FENCE_FULL));
+	ck_assert(atomic_ops_uint_test_and_complement_bit(&dest, 31, ATOMIC_OPS_FENCE_NONE));
+	ck_assert(atomic_ops_uint_load(&dest, ATOMIC_OPS_FENCE_FULL) == 1);
+} END_TEST
+
+Suite *test_atomic_ops_test_and_bit(void) {
+	Suite *s = suite_create("test_atomic_ops_test_and_bit");
+
+	TCASE_ADD(atomic_ops_test_and_bit_int);
+	TCASE_ADD(atomic_ops_test_and_bit_uint);
+
+	return (s);
+}
+
+/******************************************************************************/
+
+START_TEST(test_atomic_ops_dptr_load_store) {
+	atomic_ops_dptr dest = ATOMIC_OPS_DPTR_INIT(10, 20);
+	atomic_ops_dptr_val val;
+
+	ck_assert(((uintptr_t)&dest % (2 * sizeof(uintptr_t))) == 0);
+
+	val = atomic_ops_dptr_load(&dest, ATOMIC_OPS_FENCE_NONE);
+
+	ck_assert(val.lo == 10 && val.hi == 20);
+
+	val.lo = UINTPTR_MAX;
+	val.hi = 0x10;
+
+	atomic_ops_dptr_store(&dest, val, ATOMIC_OPS_FENCE_FULL);
+	val = atomic_ops_dptr_load(&dest, ATOMIC_OPS_FENCE_FULL);
+
+	ck_assert(val.lo == UINTPTR_MAX && val.hi == 0x10);
+} END_TEST
+
+START_TEST(test_atomic_ops_dptr_casr) {
+	atomic_ops_dptr dest = ATOMIC_OPS_DPTR_INIT(10, 20);
+	atomic_ops_dptr_val oldval = { 10, 21 }, newval = { 30, 40 }, res;
+
+	// Only one word matching isn't enough
+	res = atomic_ops_dptr_casr(&dest, oldval, newval, ATOMIC_OPS_FENCE_NONE);
+
+	ck_assert(res.lo == 10 && res.hi == 20);
+
+	oldval.hi = 20;
+	res = atomic_ops_dptr_casr(&dest, oldval, newval, ATOMIC_OPS_FENCE_FULL);
+
+	ck_assert(res.lo == 10 && res.hi == 20);
+
+	res = atomic_ops_dptr_load(&dest, ATOMIC_OPS_FENCE_FULL);
+
+	ck_assert(res.lo == 30 && res.hi == 40);
+} END_TEST
+
+START_TEST(test_atomic_ops_dptr_cas) {
+	atomic_ops_dptr dest = ATOMIC_OPS_DPTR_INIT(10, 20);
+	atomic_ops_dptr_val oldval = { 11, 20 }, newval = { 30, 40 }, res;
+
+	ck_assert(!atomic_ops_dptr_cas(&dest, oldval, newval, ATOMIC_OPS_FENCE_NONE));
+
+	oldval.lo = 10;
+
+	ck_assert(atomic_ops_dptr_cas(&dest, oldval, newval, ATOMIC_OPS_FENCE_FULL));
+
+	res = atomic_ops_dptr_load(&dest, ATOMIC_OPS_FENCE_FULL);
+
+	ck_assert(res.lo == 30 && res.hi == 40);
+} END_TEST
+
+#define DPTR_THREADS 4
+#define DPTR_ITERATIONS 20000
+
+static atomic_ops_dptr dptr_shared = ATOMIC_OPS_DPTR_INIT(0, 0);
+static atomic_ops_uint dptr_torn = ATOMIC_OPS_UINT_INIT(0);
+
+// Both words are always incremented together, so they must always be equal
+static void *dptr_incrementer(void *arg) {
+	UNUSED_ARGUMENT(arg);
+
+	for (size_t i = 0; i < DPTR_ITERATIONS; i++) {
+		atomic_ops_dptr_val oldval = atomic_ops_dptr_load(&dptr_shared, ATOMIC_OPS_FENCE_NONE), newval;
+
+		do {
+			if (oldval.lo != oldval.hi) {
+				atomic_ops_uint_inc(&dptr_torn, ATOMIC_OPS_FENCE_NONE);
+			}
+
+			newval.lo = oldval.lo + 1;
+			newval.hi = oldval.hi + 1;
+
+			atomic_ops_dptr_val prev = atomic_ops_dptr_casr(&dptr_shared, oldval, newval, ATOMIC_OPS_FENCE_FULL);
+
+			if (prev.lo == oldval.lo && prev.hi == oldval.hi) {
+				break;
+			}
+
+			oldval = prev;
+		} while (true);
+	}
+
+	return (NULL);
+}
+
+START_TEST(test_atomic_ops_dptr_threads) {
+	pthread_t threads[DPTR_THREADS];
+
+	for (size_t i = 0; i < DPTR_THREADS; i++) {
+		ck_assert(pthread_create(&threads[i], NULL, &dptr_incrementer, NULL) == 0);
+	}
+
+	for (size_t i = 0; i < DPTR_THREADS; i++) {
+		pthread_join(threads[i], NULL);
+	}
+
+	atomic_ops_dptr_val res = atomic_ops_dptr_load(&dptr_shared, ATOMIC_OPS_FENCE_FULL);
+
+	ck_assert(atomic_ops_uint_load(&dptr_torn, ATOMIC_OPS_FENCE_FULL) == 0);
+	ck_assert(res.lo == DPTR_THREADS * DPTR_ITERATIONS && res.hi == DPTR_THREADS * DPTR_ITERATIONS);
+} END_TEST
+
+Suite *test_atomic_ops_dptr(void) {
+	Suite *s = suite_create("test_atomic_ops_dptr");
+
+	TCASE_ADD(atomic_ops_dptr_load_store);
+	TCASE_ADD(atomic_ops_dptr_casr);
+	TCASE_ADD(atomic_ops_dptr_cas);
+	TCASE_ADD(atomic_ops_dptr_threads);
+
+	return (s);
+}
+
+/******************************************************************************/
+
+START_TEST(test_atomic_ops_mpmc_queue_single) {
+	atomic_ops_mpmc_queue queue;
+	void *data = NULL;
+
+	ck_assert(!atomic_ops_mpmc_queue_init(&queue, 3));
+	ck_assert(atomic_ops_mpmc_queue_init(&queue, 4));
+	ck_assert(atomic_ops_mpmc_queue_capacity(&queue) == 4);
+
+	ck_assert(!atomic_ops_mpmc_queue_try_dequeue(&queue, &data));
+
+	for (uintptr_t i = 1; i <= 4; i++) {
+		ck_assert(atomic_ops_mpmc_queue_try_enqueue(&queue, (void *)i));
+	}
+
+	ck_assert(!atomic_ops_mpmc_queue_try_enqueue(&queue, (void *)5));
+	ck_assert(atomic_ops_mpmc_queue_size(&queue) == 4);
+
+	for (uintptr_t i = 1; i <= 4; i++) {
+		ck_assert(atomic_ops_mpmc_queue_try_dequeue(&queue, &data));
+		ck_assert(data == (void *)i);
+	}
+
+	ck_assert(!atomic_ops_mpmc_queue_try_dequeue(&queue, &data));
+
+	// Wrap around a few times with the blocking variants
+	for (uintptr_t i = 1; i <= 10; i++) {
+		atomic_ops_mpmc_queue_enqueue(&queue, (void *)i);
+		ck_assert(atomic_ops_mpmc_queue_dequeue(&queue) == (void *)i);
+	}
+
+	ck_assert(atomic_ops_mpmc_queue_size(&queue) == 0);
+
+	atomic_ops_mpmc_queue_destroy(&queue);
+} END_TEST
+
+START_TEST(test_atomic_ops_mpmc_queue_batch) {
+	atomic_ops_mpmc_queue queue;
+	void *in[6] = { (void *)1, (void *)2, (void *)3, (void *)4, (void *)5, (void *)6 };
+	void *out[6] = { NULL };
+
+	ck_assert(atomic_ops_mpmc_queue_init(&queue, 4));
+
+	ck_assert(atomic_ops_mpmc_queue_try_enqueue_batch(&queue, in, 3) == 3);
+	ck_assert(atomic_ops_mpmc_queue_try_enqueue_batch(&queue, in + 3, 3) == 1);
+	ck_assert(atomic_ops_mpmc_queue_try_enqueue_batch(&queue, in + 4, 2) == 0);
+
+	ck_assert(atomic_ops_mpmc_queue_try_dequeue_batch(&queue, out, 2) == 2);
+	ck_assert(out[0] == (void *)1 && out[1] == (void *)2);
+
+	ck_assert(atomic_ops_mpmc_queue_try_enqueue_batch(&queue, in + 4, 2) == 2);
+
+	ck_assert(atomic_ops_mpmc_queue_try_dequeue_batch(&queue, out, 6) == 4);
+	ck_assert(out[0] == (void *)3 && out[1] == (void *)4 && out[2] == (void *)5 && out[3] == (void *)6);
+	ck_assert(atomic_ops_mpmc_queue_try_dequeue_batch(&queue, out, 6) == 0);
+
+	atomic_ops_mpmc_queue_destroy(&queue);
+} END_TEST
+
+#define MPMC_QUEUE_THREADS 2
+#define MPMC_QUEUE_ITEMS 2000
+
+static atomic_ops_mpmc_queue mpmc_queue;
+static atomic_ops_uint mpmc_queue_sum = ATOMIC_OPS_UINT_INIT(0);
+
+static void *mpmc_queue_producer(void *arg) {
+	uintptr_t id = (uintptr_t)arg;
+
+	for (uintptr_t i = 1; i <= MPMC_QUEUE_ITEMS; i++) {
+		if (id % 2 == 0) {
+			atomic_ops_mpmc_queue_enqueue(&mpmc_queue, (void *)i);
+		}
+		else {
+			while (!atomic_ops_mpmc_queue_try_enqueue(&mpmc_queue, (void *)i)) {
+				sched_yield();
+			}
+		}
+	}
+
+	return (NULL);
+}
+
+static void *mpmc_queue_consumer(void *arg) {
+	uintptr_t id = (uintptr_t)arg;
+	uintptr_t sum = 0;
+
+	for (size_t i = 0; i < MPMC_QUEUE_ITEMS; i++) {
+		void *data;
+
+		if (id % 2 == 0) {
+			data = atomic_ops_mpmc_queue_dequeue(&mpmc_queue);
+		}
+		else {
+			while (!atomic_ops_mpmc_queue_try_dequeue(&mpmc_queue, &data)) {
+				sched_yield();
+			}
+		}
+
+		sum += (uintptr_t)data;
+	}
+
+	atomic_ops_uint_add(&mpmc_queue_sum, sum, ATOMIC_OPS_FENCE_FULL);
+
+	return (NULL);
+}
+
+START_TEST(test_atomic_ops_mpmc_queue_threads) {
+	pthread_t producers[MPMC_QUEUE_THREADS], consumers[MPMC_QUEUE_THREADS];
+
+	ck_assert(atomic_ops_mpmc_queue_init(&mpmc_queue, 64));
+
+	for (uintptr_t i = 0; i < MPMC_QUEUE_THREADS; i++) {
+		ck_assert(pthread_create(&producers[i], NULL, &mpmc_queue_producer, (void *)i) == 0);
+		ck_assert(pthread_create(&consumers[i], NULL, &mpmc_queue_consumer, (void *)i) == 0);
+	}
+
+	for (size_t i = 0; i < MPMC_QUEUE_THREADS; i++) {
+		pthread_join(producers[i], NULL);
+		pthread_join(consumers[i], NULL);
+	}
+
+	ck_assert(atomic_ops_uint_load(&mpmc_queue_sum, ATOMIC_OPS_FENCE_FULL)
+		== (uintptr_t)MPMC_QUEUE_THREADS * MPMC_QUEUE_ITEMS * (MPMC_QUEUE_ITEMS + 1) / 2);
+	ck_assert(atomic_ops_mpmc_queue_size(&mpmc_queue) == 0);
+
+	atomic_ops_mpmc_queue_destroy(&mpmc_queue);
+} END_TEST
+
+Suite *test_atomic_ops_mpmc_queue(void) {
+	Suite *s = suite_create("test_atomic_ops_mpmc_queue");
+
+	TCASE_ADD(atomic_ops_mpmc_queue_single);
+	TCASE_ADD(atomic_ops_mpmc_queue_batch);
+	TCASE_ADD(atomic_ops_mpmc_queue_threads);
+
+	return (s);
+}
+
+/******************************************************************************/
+
+START_TEST(test_atomic_ops_spsc_ring_single) {
+	atomic_ops_spsc_ring ring;
+	uint32_t val = 0;
+
+	ck_assert(!atomic_ops_spsc_ring_init(&ring, 6, sizeof(uint32_t)));
+	ck_assert(atomic_ops_spsc_ring_init(&ring, 4, sizeof(uint32_t)));
+	ck_assert(atomic_ops_spsc_ring_capacity(&ring) == 4);
+
+	ck_assert(!atomic_ops_spsc_ring_try_pop(&ring, &val));
+
+	for (uint32_t i = 1; i <= 4; i++) {
+		ck_assert(atomic_ops_spsc_ring_try_push(&ring, &i));
+	}
+
+	val = 5;
+	ck_assert(!atomic_ops_spsc_ring_try_push(&ring, &val));
+
+	for (uint32_t i = 1; i <= 4; i++) {
+		ck_assert(atomic_ops_spsc_ring_try_pop(&ring, &val));
+		ck_assert(val == i);
+	}
+
+	ck_assert(!atomic_ops_spsc_ring_try_pop(&ring, &val));
+
+	atomic_ops_spsc_ring_destroy(&ring);
+} END_TEST
+
+START_TEST(test_atomic_ops_spsc_ring_batch) {
+	atomic_ops_spsc_ring ring;
+	size_t n = 0;
+
+	ck_assert(atomic_ops_spsc_ring_init(&ring, 4, sizeof(uint32_t)));
+
+	uint32_t *in = atomic_ops_spsc_ring_reserve(&ring, 3, &n);
+	ck_assert(in != NULL && n == 3);
+	in[0] = 1; in[1] = 2; in[2] = 3;
+
+	// Not yet committed, so not visible
+	ck_assert(atomic_ops_spsc_ring_peek(&ring, 4, &n) == NULL && n == 0);
+
+	atomic_ops_spsc_ring_commit(&ring, 3);
+
+	uint32_t *out = atomic_ops_spsc_ring_peek(&ring, 2, &n);
+	ck_assert(out != NULL && n == 2 && out[0] == 1 && out[1] == 2);
+	atomic_ops_spsc_ring_consume(&ring, 2);
+
+	// Reservations stop at the end of the buffer
+	in = atomic_ops_spsc_ring_reserve(&ring, 4, &n);
+	ck_assert(in != NULL && n == 1);
+	in[0] = 4;
+	atomic_ops_spsc_ring_commit(&ring, 1);
+
+	in = atomic_ops_spsc_ring_reserve(&ring, 4, &n);
+	ck_assert(in != NULL && n == 2);
+	in[0] = 5; in[1] = 6;
+	atomic_ops_spsc_ring_commit(&ring, 2);
+
+	ck_assert(atomic_ops_spsc_ring_reserve(&ring, 1, &n) == NULL && n == 0);
+
+	out = atomic_ops_spsc_ring_peek(&ring, 4, &n);
+	ck_assert(out != NULL && n == 2 && out[0] == 3 && out[1] == 4);
+	atomic_ops_spsc_ring_consume(&ring, 2);
+
+	out = atomic_ops_spsc_ring_peek(&ring, 4, &n);
+	ck_assert(out != NULL && n == 2 && out[0] == 5 && out[1] == 6);
+	atomic_ops_spsc_ring_consume(&ring, 2);
+
+	atomic_ops_spsc_ring_destroy(&ring);
+} END_TEST
+
+#define SPSC_RING_ITEMS 100000
+
+static atomic_ops_spsc_ring spsc_ring;
+
+static void *spsc_ring_producer(void *arg) {
+	UNUSED_ARGUMENT(arg);
+
+	for (uintptr_t i = 0; i < SPSC_RING_ITEMS; ) {
+		size_t n;
+		uintptr_t *in = atomic_ops_spsc_ring_reserve(&spsc_ring, 7, &n);
+
+		// Full: let the consumer run, spinning would only burn our time slice on one CPU
+		if (n == 0) {
+			sched_yield();
+			continue;
+		}
+
+		for (size_t j = 0; j < n; j++) {
+			in[j] = i++;
+		}
+
+		atomic_ops_spsc_ring_commit(&spsc_ring, n);
+	}
+
+	return (NULL);
+}
+
+START_TEST(test_atomic_ops_spsc_ring_threads) {
+	pthread_t producer;
+	uintptr_t expected = 0;
+
+	ck_assert(atomic_ops_spsc_ring_init(&spsc_ring, 64, sizeof(uintptr_t)));
+	ck_assert(pthread_create(&producer, NULL, &spsc_ring_producer, NULL) == 0);
+
+	while (expected < SPSC_RING_ITEMS) {
+		uintptr_t val;
+
+		if (atomic_ops_spsc_ring_try_pop(&spsc_ring, &val)) {
+			ck_assert(val == expected);
+			expected++;
+		}
+		else {
+			sched_yield();
+		}
+	}
+
+	pthread_join(producer, NULL);
+
+	atomic_ops_spsc_ring_destroy(&spsc_ring);
+} END_TEST
+
+Suite *test_atomic_ops_spsc_ring(void) {
+	Suite *s = suite_create("test_atomic_ops_spsc_ring");
+
+	TCASE_ADD(atomic_ops_spsc_ring_single);
+	TCASE_ADD(atomic_ops_spsc_ring_batch);
+	TCASE_ADD(atomic_ops_spsc_ring_threads);
+
+	return (s);
+}
+
+/******************************************************************************/
+
+static size_t hazard_freed = 0;
+
+static void hazard_free(void *ptr) {
+	hazard_freed++;
+	free(ptr);
+}
+
+START_TEST(test_atomic_ops_hazard_single) {
+	atomic_ops_hazard_domain domain = ATOMIC_OPS_HAZARD_DOMAIN_INIT;
+	atomic_ops_hazard_record *rec = atomic_ops_hazard_acquire(&domain);
+	atomic_ops_hazard_record *other = atomic_ops_hazard_acquire(&domain);
+	uintptr_t *obj = malloc(sizeof(uintptr_t));
+	atomic_ops_ptr src = ATOMIC_OPS_PTR_INIT(obj);
+
+	ck_assert(rec != NULL && other != NULL && rec != other);
+
+	hazard_freed = 0;
+
+	ck_assert(atomic_ops_hazard_protect(other, 1, &src) == obj);
+
+	// Unlink and retire it, while 'other' still protects it
+	atomic_ops_ptr_store(&src, NULL, ATOMIC_OPS_FENCE_FULL);
+	ck_assert(atomic_ops_hazard_retire(&domain, rec, obj, &hazard_free));
+
+	ck_assert(atomic_ops_hazard_scan(&domain, rec) == 0);
+	ck_assert(hazard_freed == 0);
+
+	atomic_ops_hazard_clear(other, 1);
+
+	ck_assert(atomic_ops_hazard_scan(&domain, rec) == 1);
+	ck_assert(hazard_freed == 1);
+
+	// Released records get reused
+	atomic_ops_hazard_release(&domain, other);
+	ck_assert(atomic_ops_hazard_acquire(&domain) == other);
+
+	// Whatever is still retired goes away with the domain
+	obj = malloc(sizeof(uintptr_t));
+	atomic_ops_hazard_set(rec, 0, obj);
+	ck_assert(atomic_ops_hazard_retire(&domain, rec, obj, &hazard_free));
+	ck_assert(atomic_ops_hazard_scan(&domain, rec) == 0);
+
+	atomic_ops_hazard_domain_destroy(&domain);
+	ck_assert(hazard_freed == 2);
+} END_TEST
+
+START_TEST(test_atomic_ops_hazard_flagptr) {
+	atomic_ops_hazard_domain domain = ATOMIC_OPS_HAZARD_DOMAIN_INIT;
+	atomic_ops_hazard_record *rec = atomic_ops_hazard_acquire(&domain);
+	uintptr_t *obj = malloc(sizeof(uintptr_t));
+	atomic_ops_flagptr src = ATOMIC_OPS_FLAGPTR_INIT(obj, true);
+	bool flag = false;
+
+	ck_assert(atomic_ops_hazard_protect_flagptr(rec, 0, &src, &flag) == obj);
+	ck_assert(flag);
+	ck_assert(atomic_ops_ptr_load(&rec->slots[0], ATOMIC_OPS_FENCE_NONE) == obj);
+
+	atomic_ops_hazard_domain_destroy(&domain);
+	free(obj);
+} END_TEST
+
+#define HAZARD_THREADS 2
+#define HAZARD_ITERATIONS 20000
+#define HAZARD_ALIVE 0x600DF00D
+#define HAZARD_DEAD 0xDEADBEEF
+
+static atomic_ops_hazard_domain hazard_domain = ATOMIC_OPS_HAZARD_DOMAIN_INIT;
+static atomic_ops_ptr hazard_shared = ATOMIC_OPS_PTR_INIT(NULL);
+static atomic_ops_uint hazard_done = ATOMIC_OPS_UINT_INIT(0);
+static atomic_ops_uint hazard_bad = ATOMIC_OPS_UINT_INIT(0);
+static atomic_ops_uint hazard_dead = ATOMIC_OPS_UINT_INIT(0);
+
+// Poison before freeing, readers must never see it
+static void hazard_kill(void *ptr) {
+	atomic_ops_uint_store(ptr, HAZARD_DEAD, ATOMIC_OPS_FENCE_NONE);
+	atomic_ops_uint_inc(&hazard_dead, ATOMIC_OPS_FENCE_NONE);
+	free(ptr);
+}
+
+static void *hazard_reader(void *arg) {
+	UNUSED_ARGUMENT(arg);
+
+	atomic_ops_hazard_record *rec = atomic_ops_hazard_acquire(&hazard_domain);
+
+	while (atomic_ops_uint_load(&hazard_done, ATOMIC_OPS_FENCE_ACQUIRE) == 0) {
+		atomic_ops_uint *obj = atomic_ops_hazard_protect(rec, 0, &hazard_shared);
+
+		if (obj != NULL && atomic_ops_uint_load(obj, ATOMIC_OPS_FENCE_NONE) != HAZARD_ALIVE) {
+			atomic_ops_uint_inc(&hazard_bad, ATOMIC_OPS_FENCE_NONE);
+		}
+
+		atomic_ops_hazard_clear(rec, 0);
+	}
+
+	atomic_ops_hazard_release(&hazard_domain, rec);
+
+	return (NULL);
+}
+
+START_TEST(test_atomic_ops_hazard_threads) {
+	pthread_t threads[HAZARD_THREADS];
+	atomic_ops_hazard_record *rec = atomic_ops_hazard_acquire(&hazard_domain);
+
+	for (size_t i = 0; i < HAZARD_THREADS; i++) {
+		ck_assert(pthread_create(&threads[i], NULL, &hazard_reader, NULL) == 0);
+	}
+
+	for (size_t i = 0; i < HAZARD_ITERATIONS; i++) {
+		atomic_ops_uint *obj = malloc(sizeof(atomic_ops_uint));
+
+		atomic_ops_uint_store(obj, HAZARD_ALIVE, ATOMIC_OPS_FENCE_NONE);
+
+		void *old = atomic_ops_ptr_swap(&hazard_shared, obj, ATOMIC_OPS_FENCE_FULL);
+
+		if (old != NULL) {
+			ck_assert(atomic_ops_hazard_retire(&hazard_domain, rec, old, &hazard_kill));
+		}
+	}
+
+	atomic_ops_uint_store(&hazard_done, 1, ATOMIC_OPS_FENCE_RELEASE);
+
+	for (size_t i = 0; i < HAZARD_THREADS; i++) {
+		pthread_join(threads[i], NULL);
+	}
+
+	// Nothing protects anything anymore: all but the last one must be gone
+	atomic_ops_hazard_scan(&hazard_domain, rec);
+
+	ck_assert(atomic_ops_uint_load(&hazard_bad, ATOMIC_OPS_FENCE_FULL) == 0);
+	ck_assert(atomic_ops_uint_load(&hazard_dead, ATOMIC_OPS_FENCE_FULL) == HAZARD_ITERATIONS - 1);
+
+	free(atomic_ops_ptr_load(&hazard_shared, ATOMIC_OPS_FENCE_NONE));
+	atomic_ops_hazard_domain_destroy(&hazard_domain);
+} END_TEST
+
+#define HAZARD_GROW_RECORDS 4000
+
+static atomic_ops_hazard_domain hazard_grow_domain = ATOMIC_OPS_HAZARD_DOMAIN_INIT;
+static atomic_ops_uint hazard_grow_done = ATOMIC_OPS_UINT_INIT(0);
+static atomic_ops_uint hazard_grow_freed = ATOMIC_OPS_UINT_INIT(0);
+
+static void hazard_grow_free(void *ptr) {
+	UNUSED_ARGUMENT(ptr);
+
+	atomic_ops_uint_inc(&hazard_grow_freed, ATOMIC_OPS_FENCE_NONE);
+}
+
+// Keep pushing new records at the head of the list while scans walk it
+static void *hazard_grower(void *arg) {
+	UNUSED_ARGUMENT(arg);
+
+	for (size_t i = 0; i < HAZARD_GROW_RECORDS; i++) {
+		atomic_ops_hazard_acquire(&hazard_grow_domain);
+	}
+
+	atomic_ops_uint_store(&hazard_grow_done, 1, ATOMIC_OPS_FENCE_RELEASE);
+
+	return (NULL);
+}
+
+START_TEST(test_atomic_ops_hazard_scan_grow) {
+	pthread_t thread;
+	static uintptr_t obj;
+
+	// The oldest record, at the tail of the list, protects obj
+	atomic_ops_hazard_record *protector = atomic_ops_hazard_acquire(&hazard_grow_domain);
+	atomic_ops_hazard_record *rec = atomic_ops_hazard_acquire(&hazard_grow_domain);
+
+	atomic_ops_hazard_set(protector, 0, &obj);
+	ck_assert(atomic_ops_hazard_retire(&hazard_grow_domain, rec, &obj, &hazard_grow_free));
+
+	ck_assert(pthread_create(&thread, NULL, &hazard_grower, NULL) == 0);
+
+	while (atomic_ops_uint_load(&hazard_grow_done, ATOMIC_OPS_FENCE_ACQUIRE) == 0) {
+		ck_assert(atomic_ops_hazard_scan(&hazard_grow_domain, rec) == 0);
+	}
+
+	pthread_join(thread, NULL);
+
+	ck_assert(atomic_ops_hazard_scan(&hazard_grow_domain, rec) == 0);
+	ck_assert(atomic_ops_uint_load(&hazard_grow_freed, ATOMIC_OPS_FENCE_NONE) == 0);
+
+	atomic_ops_hazard_clear(protector, 0);
+	ck_assert(atomic_ops_hazard_scan(&hazard_grow_domain, rec) == 1);
+
+	atomic_ops_hazard_domain_destroy(&hazard_grow_domain);
+} END_TEST
+
+Suite *test_atomic_ops_hazard(void) {
+	Suite *s = suite_create("test_atomic_ops_hazard");
+
+	TCASE_ADD(atomic_ops_hazard_single);
+	TCASE_ADD(atomic_ops_hazard_flagptr);
+	TCASE_ADD(atomic_ops_hazard_threads);
+	TCASE_ADD(atomic_ops_hazard_scan_grow);
+
+	return (s);
+}
+
+/******************************************************************************/
+
+static size_t epoch_called = 0;
+
+static void epoch_callback(void *arg) {
+	epoch_called += (uintptr_t)arg;
+}
+
+START_TEST(test_atomic_ops_epoch_single) {
+	atomic_ops_epoch_domain domain;
+
+	atomic_ops_epoch_domain_init(&domain);
+
+	atomic_ops_epoch_record *rec = atomic_ops_epoch_acquire(&domain);
+	atomic_ops_epoch_record *reader = atomic_ops_epoch_acquire(&domain);
+
+	ck_assert(rec != NULL && reader != NULL && rec != reader);
+
+	epoch_called = 0;
+
+	// Nested critical sections only end with the outermost exit
+	atomic_ops_epoch_enter(&domain, reader);
+	atomic_ops_epoch_enter(&domain, reader);
+	atomic_ops_epoch_exit(&domain, reader);
+
+	ck_assert(atomic_ops_epoch_defer(&domain, rec, &epoch_callback, (void *)1));
+
+	for (size_t i = 0; i < 4; i++) {
+		ck_assert(atomic_ops_epoch_reclaim(&domain, rec) == 0);
+	}
+
+	ck_assert(epoch_called == 0);
+	ck_assert(!atomic_ops_epoch_advance(&domain));
+
+	atomic_ops_epoch_exit(&domain, reader);
+
+	ck_assert(atomic_ops_epoch_advance(&domain));
+	ck_assert(atomic_ops_epoch_reclaim(&domain, rec) == 1);
+	ck_assert(epoch_called == 1);
+
+	// Nobody is active: synchronize returns right away
+	atomic_ops_epoch_synchronize(&domain);
+
+	// Reserving makes room for the next defer, without queueing anything
+	ck_assert(atomic_ops_epoch_reserve(&domain, rec));
+	ck_assert(rec->deferred_len == 0 && rec->deferred_size > 0);
+
+	// Released records get reused
+	atomic_ops_epoch_release(&domain, reader);
+	ck_assert(atomic_ops_epoch_acquire(&domain) == reader);
+
+	// Whatever is still deferred runs when the domain goes away
+	atomic_ops_epoch_enter(&domain, reader);
+	ck_assert(atomic_ops_epoch_defer(&domain, rec, &epoch_callback, (void *)2));
+	ck_assert(atomic_ops_epoch_reclaim(&domain, rec) == 0);
+
+	atomic_ops_epoch_domain_destroy(&domain);
+	ck_assert(epoch_called == 3);
+} END_TEST
+
+START_TEST(test_atomic_ops_epoch_qsbr) {
+	atomic_ops_epoch_domain domain;
+
+	atomic_ops_epoch_domain_init(&domain);
+
+	atomic_ops_epoch_record *rec = atomic_ops_epoch_acquire(&domain);
+	atomic_ops_epoch_record *reader = atomic_ops_epoch_acquire(&domain);
+
+	epoch_called = 0;
+
+	atomic_ops_epoch_online(&domain, reader);
+
+	ck_assert(atomic_ops_epoch_defer(&domain, rec, &epoch_callback, (void *)1));
+
+	// An online thread holds back the epoch until it reports a quiescent state
+	ck_assert(atomic_ops_epoch_reclaim(&domain, rec) == 0);
+	ck_assert(!atomic_ops_epoch_advance(&domain));
+	ck_assert(atomic_ops_epoch_reclaim(&domain, rec) == 0);
+	ck_assert(epoch_called == 0);
+
+	atomic_ops_epoch_quiescent(&domain, reader);
+
+	ck_assert(atomic_ops_epoch_reclaim(&domain, rec) == 1);
+	ck_assert(epoch_called == 1);
+
+	// Offline threads don't hold anything back
+	atomic_ops_epoch_offline(&domain, reader);
+	atomic_ops_epoch_synchronize(&domain);
+
+	atomic_ops_epoch_domain_destroy(&domain);
+} END_TEST
+
+#define EPOCH_THREADS 2
+#define EPOCH_ITERATIONS 20000
+#define EPOCH_ALIVE 0x600DF00D
+#define EPOCH_DEAD 0xDEADBEEF
+
+static atomic_ops_epoch_domain epoch_domain;
+static atomic_ops_ptr epoch_shared = ATOMIC_OPS_PTR_INIT(NULL);
+static atomic_ops_uint epoch_done = ATOMIC_OPS_UINT_INIT(0);
+static atomic_ops_uint epoch_bad = ATOMIC_OPS_UINT_INIT(0);
+static atomic_ops_uint epoch_dead = ATOMIC_OPS_UINT_INIT(0);
+
+// Poison before freeing, readers must never see it
+static void epoch_kill(void *ptr) {
+	atomic_ops_uint_store(ptr, EPOCH_DEAD, ATOMIC_OPS_FENCE_NONE);
+	atomic_ops_uint_inc(&epoch_dead, ATOMIC_OPS_FENCE_NONE);
+	free(ptr);
+}
+
+// Readers either use critical sections, or stay online and report quiescent states (QSBR)
+static void *epoch_reader(void *arg) {
+	bool qsbr = (arg != NULL);
+	atomic_ops_epoch_record *rec = atomic_ops_epoch_acquire(&epoch_domain);
+
+	if (qsbr) {
+		atomic_ops_epoch_online(&epoch_domain, rec);
+	}
+
+	while (atomic_ops_uint_load(&epoch_done, ATOMIC_OPS_FENCE_ACQUIRE) == 0) {
+		if (!qsbr) {
+			atomic_ops_epoch_enter(&epoch_domain, rec);
+		}
+
+		atomic_ops_uint *obj = atomic_ops_ptr_load(&epoch_shared, ATOMIC_OPS_FENCE_ACQUIRE);
+
+		if (obj != NULL && atomic_ops_uint_load(obj, ATOMIC_OPS_FENCE_NONE) != EPOCH_ALIVE) {
+			atomic_ops_uint_inc(&epoch_bad, ATOMIC_OPS_FENCE_NONE);
+		}
+
+		if (qsbr) {
+			atomic_ops_epoch_quiescent(&epoch_domain, rec);
+		}
+		else {
+			atomic_ops_epoch_exit(&epoch_domain, rec);
+		}
+	}
+
+	atomic_ops_epoch_release(&epoch_domain, rec);
+
+	return (NULL);
+}
+
+START_TEST(test_atomic_ops_epoch_threads) {
+	pthread_t threads[EPOCH_THREADS];
+
+	atomic_ops_epoch_domain_init(&epoch_domain);
+
+	atomic_ops_epoch_record *rec = atomic_ops_epoch_acquire(&epoch_domain);
+
+	for (size_t i = 0; i < EPOCH_THREADS; i++) {
+		ck_assert(pthread_create(&threads[i], NULL, &epoch_reader, (void *)(i % 2)) == 0);
+	}
+
+	for (size_t i = 0; i < EPOCH_ITERATIONS; i++) {
+		atomic_ops_uint *obj = malloc(sizeof(atomic_ops_uint));
+
+		atomic_ops_uint_store(obj, EPOCH_ALIVE, ATOMIC_OPS_FENCE_NONE);
+
+		void *old = atomic_ops_ptr_swap(&epoch_shared, obj, ATOMIC_OPS_FENCE_FULL);
+
+		if (old != NULL) {
+			ck_assert(atomic_ops_epoch_retire(&epoch_domain, rec, old, &epoch_kill));
+		}
+	}
+
+	atomic_ops_uint_store(&epoch_done, 1, ATOMIC_OPS_FENCE_RELEASE);
+
+	for (size_t i = 0; i < EPOCH_THREADS; i++) {
+		pthread_join(threads[i], NULL);
+	}
+
+	// Nobody is active anymore: all but the last one must be gone after a grace period
+	atomic_ops_epoch_synchronize(&epoch_domain);
+	atomic_ops_epoch_reclaim(&epoch_domain, rec);
+
+	ck_assert(atomic_ops_uint_load(&epoch_bad, ATOMIC_OPS_FENCE_FULL) == 0);
+	ck_assert(atomic_ops_uint_load(&epoch_dead, ATOMIC_OPS_FENCE_FULL) == EPOCH_ITERATIONS - 1);
+
+	free(atomic_ops_ptr_load(&epoch_shared, ATOMIC_OPS_FENCE_NONE));
+	atomic_ops_epoch_domain_destroy(&epoch_domain);
+} END_TEST
+
+Suite *test_atomic_ops_epoch(void) {
+	Suite *s = suite_create("test_atomic_ops_epoch");
+
+	TCASE_ADD(atomic_ops_epoch_single);
+	TCASE_ADD(atomic_ops_epoch_qsbr);
+	TCASE_ADD(atomic_ops_epoch_threads);
+
+	return (s);
+}
+
+/******************************************************************************/
+
+static bool list_collect(uintptr_t key, void *value, void *arg) {
+	uintptr_t *keys = arg;
+
+	ck_assert((uintptr_t)value == key * 10);
+	keys[++keys[0]] = key;
+
+	return (keys[0] < 3);
+}
+
+START_TEST(test_atomic_ops_list_single) {
+	atomic_ops_epoch_domain domain;
+	atomic_ops_list list;
+	void *value = NULL;
+	uintptr_t keys[8] = { 0 };
+
+	atomic_ops_epoch_domain_init(&domain);
+	atomic_ops_list_init(&list, &domain);
+
+	atomic_ops_epoch_record *rec = atomic_ops_epoch_acquire(&domain);
+
+	ck_assert(!atomic_ops_list_contains(&list, rec, 5, NULL));
+	ck_assert(!atomic_ops_list_remove(&list, rec, 5, NULL));
+
+	ck_assert(atomic_ops_list_insert(&list, rec, 5, (void *)50));
+	ck_assert(atomic_ops_list_insert(&list, rec, 1, (void *)10));
+	ck_assert(atomic_ops_list_insert(&list, rec, 9, (void *)90));
+	ck_assert(atomic_ops_list_insert(&list, rec, 7, (void *)70));
+	ck_assert(!atomic_ops_list_insert(&list, rec, 5, (void *)55));
+
+	ck_assert(atomic_ops_list_contains(&list, rec, 5, &value));
+	ck_assert(value == (void *)50);
+	ck_assert(!atomic_ops_list_contains(&list, rec, 6, NULL));
+
+	// In key order, stopping when the callback says so
+	atomic_ops_list_iterate(&list, rec, &list_collect, keys);
+	ck_assert(keys[0] == 3 && keys[1] == 1 && keys[2] == 5 && keys[3] == 7);
+
+	ck_assert(atomic_ops_list_remove(&list, rec, 5, &value));
+	ck_assert(value == (void *)50);
+	ck_assert(!atomic_ops_list_remove(&list, rec, 5, NULL));
+	ck_assert(!atomic_ops_list_contains(&list, rec, 5, NULL));
+
+	keys[0] = 0;
+	atomic_ops_list_iterate(&list, rec, &list_collect, keys);
+	ck_assert(keys[0] == 3 && keys[1] == 1 && keys[2] == 7 && keys[3] == 9);
+
+	ck_assert(atomic_ops_list_insert(&list, rec, 5, (void *)50));
+	ck_assert(atomic_ops_list_contains(&list, rec, 5, NULL));
+
+	atomic_ops_list_destroy(&list);
+	atomic_ops_epoch_domain_destroy(&domain);
+} END_TEST
+
+#define LIST_THREADS 4
+#define LIST_KEYS 64
+#define LIST_ITERATIONS 20000
+
+static atomic_ops_epoch_domain list_domain;
+static atomic_ops_list list_shared;
+static intptr_t list_net[LIST_THREADS][LIST_KEYS];
+
+// Random inserts, removes and lookups on a small shared key range, counting what succeeded
+static void *list_worker(void *arg) {
+	uintptr_t id = (uintptr_t)arg, seed = id * 2654435761u + 1;
+	atomic_ops_epoch_record *rec = atomic_ops_epoch_acquire(&list_domain);
+
+	for (size_t i = 0; i < LIST_ITERATIONS; i++) {
+		seed ^= seed << 13;
+		seed ^= seed >> 7;
+		seed ^= seed << 17;
+
+		uintptr_t key = (seed >> 4) % LIST_KEYS;
+		void *value;
+
+		switch (seed & 3) {
+			case 0:
+				if (atomic_ops_list_insert(&list_shared, rec, key, (void *)(key + 1))) {
+					list_net[id][key]++;
+				}
+				break;
+
+			case 1:
+				if (atomic_ops_list_remove(&list_shared, rec, key, &value)) {
+					ck_assert(value == (void *)(key + 1));
+					list_net[id][key]--;
+				}
+				break;
+
+			default:
+				if (atomic_ops_list_contains(&list_shared, rec, key, &value)) {
+					ck_assert(value == (void *)(key + 1));
+				}
+				break;
+		}
+	}
+
+	atomic_ops_epoch_release(&list_domain, rec);
+
+	return (NULL);
+}
+
+static bool list_check_sorted(uintptr_t key, void *value, void *arg) {
+	uintptr_t *last = arg;
+
+	ck_assert(value == (void *)(key + 1));
+	ck_assert(*last == UINTPTR_MAX || *last < key);
+	*last = key;
+
+	return (true);
+}
+
+START_TEST(test_atomic_ops_list_threads) {
+	pthread_t threads[LIST_THREADS];
+	uintptr_t last = UINTPTR_MAX;
+
+	atomic_ops_epoch_domain_init(&list_domain);
+	atomic_ops_list_init(&list_shared, &list_domain);
+
+	for (uintptr_t i = 0; i < LIST_THREADS; i++) {
+		ck_assert(pthread_create(&threads[i], NULL, &list_worker, (void *)i) == 0);
+	}
+
+	for (size_t i = 0; i < LIST_THREADS; i++) {
+		pthread_join(threads[i], NULL);
+	}
+
+	atomic_ops_epoch_record *rec = atomic_ops_epoch_acquire(&list_domain);
+
+	// Every key is present exactly if it was inserted once more than it was removed
+	for (uintptr_t key = 0; key < LIST_KEYS; key++) {
+		intptr_t net = 0;
+
+		for (size_t i = 0; i < LIST_THREADS; i++) {
+			net += list_net[i][key];
+		}
+
+		ck_assert(net == (atomic_ops_list_contains(&list_shared, rec, key, NULL) ? (1) : (0)));
+	}
+
+	atomic_ops_list_iterate(&list_shared, rec, &list_check_sorted, &last);
+
+	atomic_ops_epoch_release(&list_domain, rec);
+	atomic_ops_list_destroy(&list_shared);
+	atomic_ops_epoch_domain_destroy(&list_domain);
+} END_TEST
+
+Suite *test_atomic_ops_list(void) {
+	Suite *s = suite_create("test_atomic_ops_list");
+
+	TCASE_ADD(atomic_ops_list_single);
+	TCASE_ADD(atomic_ops_list_threads);
+
+	return (s);
+}
+
+/******************************************************************************/
+
+START_TEST(test_atomic_ops_hashmap_single) {
+	atomic_ops_epoch_domain domain;
+	atomic_ops_hashmap map;
+	void *value = NULL;
+
+	atomic_ops_epoch_domain_init(&domain);
+
+	ck_assert(!atomic_ops_hashmap_init(&map, &domain, 3));
+	ck_assert(atomic_ops_hashmap_init(&map, &domain, 2));
+
+	atomic_ops_epoch_record *rec = atomic_ops_epoch_acquire(&domain);
+
+	ck_assert(!atomic_ops_hashmap_lookup(&map, rec, 5, NULL));
+	ck_assert(!atomic_ops_hashmap_erase(&map, rec, 5, NULL));
+
+	ck_assert(atomic_ops_hashmap_insert(&map, rec, 5, (void *)50));
+	ck_assert(!atomic_ops_hashmap_insert(&map, rec, 5, (void *)55));
+	ck_assert(atomic_ops_hashmap_lookup(&map, rec, 5, &value));
+	ck_assert(value == (void *)50);
+
+	ck_assert(atomic_ops_hashmap_erase(&map, rec, 5, &value));
+	ck_assert(value == (void *)50);
+	ck_assert(!atomic_ops_hashmap_lookup(&map, rec, 5, NULL));
+	ck_assert(atomic_ops_hashmap_size(&map) == 0);
+
+	// Grows as elements are added, everything stays reachable
+	for (uintptr_t key = 0; key < 10000; key++) {
+		ck_assert(atomic_ops_hashmap_insert(&map, rec, key, (void *)(key + 1)));
+	}
+
+	ck_assert(atomic_ops_hashmap_size(&map) == 10000);
+	ck_assert(atomic_ops_hashmap_buckets(&map) >= 10000 / ATOMIC_OPS_HASHMAP_LOAD_FACTOR / 2);
+
+	for (uintptr_t key = 0; key < 10000; key += 2) {
+		ck_assert(atomic_ops_hashmap_erase(&map, rec, key, &value));
+		ck_assert(value == (void *)(key + 1));
+	}
+
+	for (uintptr_t key = 0; key < 10000; key++) {
+		ck_assert(atomic_ops_hashmap_lookup(&map, rec, key, &value) == ((key % 2) == 1));
+		ck_assert((key % 2) == 0 || value == (void *)(key + 1));
+	}
+
+	ck_assert(atomic_ops_hashmap_size(&map) == 5000);
+
+	atomic_ops_hashmap_destroy(&map);
+	atomic_ops_epoch_domain_destroy(&domain);
+} END_TEST
+
+#define HASHMAP_THREADS 4
+#define HASHMAP_KEYS 4096
+#define HASHMAP_ITERATIONS 40000
+
+static atomic_ops_epoch_domain hashmap_domain;
+static atomic_ops_hashmap hashmap_shared;
+static intptr_t hashmap_net[HASHMAP_THREADS][HASHMAP_KEYS];
+
+// Random inserts, erases and lookups while the map keeps growing, counting what succeeded
+static void *hashmap_worker(void *arg) {
+	uintptr_t id = (uintptr_t)arg, seed = id * 2654435761u + 1;
+	atomic_ops_epoch_record *rec = atomic_ops_epoch_acquire(&hashmap_domain);
+
+	for (size_t i = 0; i < HASHMAP_ITERATIONS; i++) {
+		seed ^= seed << 13;
+		seed ^= seed >> 7;
+		seed ^= seed << 17;
+
+		uintptr_t key = (seed >> 4) % HASHMAP_KEYS;
+		void *value;
+
+		switch (seed % 3) {
+			case 0:
+				if (atomic_ops_hashmap_insert(&hashmap_shared, rec, key, (void *)(key + 1))) {
+					hashmap_net[id][key]++;
+				}
+				break;
+
+			case 1:
+				if (atomic_ops_hashmap_erase(&hashmap_shared, rec, key, &value)) {
+					ck_assert(value == (void *)(key + 1));
+					hashmap_net[id][key]--;
+				}
+				break;
+
+			default:
+				if (atomic_ops_hashmap_lookup(&hashmap_shared, rec, key, &value)) {
+					ck_assert(value == (void *)(key + 1));
+				}
+				break;
+		}
+	}
+
+	atomic_ops_epoch_release(&hashmap_domain, rec);
+
+	return (NULL);
+}
+
+START_TEST(test_atomic_ops_hashmap_threads) {
+	pthread_t threads[HASHMAP_THREADS];
+	size_t present = 0;
+
+	atomic_ops_epoch_domain_init(&hashmap_domain);
+	ck_assert(atomic_ops_hashmap_init(&hashmap_shared, &hashmap_domain, 1));
+
+	for (uintptr_t i = 0; i < HASHMAP_THREADS; i++) {
+		ck_assert(pthread_create(&threads[i], NULL, &hashmap_worker, (void *)i) == 0);
+	}
+
+	for (size_t i = 0; i < HASHMAP_THREADS; i++) {
+		pthread_join(threads[i], NULL);
+	}
+
+	atomic_ops_epoch_record *rec = atomic_ops_epoch_acquire(&hashmap_domain);
+
+	// Every key is present exactly if it was inserted once more than it was erased
+	for (uintptr_t key = 0; key < HASHMAP_KEYS; key++) {
+		intptr_t net = 0;
+
+		for (size_t i = 0; i < HASHMAP_THREADS; i++) {
+			net += hashmap_net[i][key];
+		}
+
+		ck_assert(net == (atomic_ops_hashmap_lookup(&hashmap_shared, rec, key, NULL) ? (1) : (0)));
+		present += (size_t)net;
+	}
+
+	ck_assert(atomic_ops_hashmap_size(&hashmap_shared) == present);
+	ck_assert(atomic_ops_hashmap_buckets(&hashmap_shared) > 1);
+
+	atomic_ops_epoch_release(&hashmap_domain, rec);
+	atomic_ops_hashmap_destroy(&hashmap_shared);
+	atomic_ops_epoch_domain_destroy(&hashmap_domain);
+} END_TEST
+
+Suite *test_atomic_ops_hashmap(void) {
+	Suite *s = suite_create("test_atomic_ops_hashmap");
+
+	TCASE_ADD(atomic_ops_hashmap_single);
+	TCASE_ADD(atomic_ops_hashmap_threads);
+
+	return (s);
+}
+
+/******************************************************************************/
+
+START_TEST(test_atomic_ops_lock_single) {
+	atomic_ops_ttas ttas = ATOMIC_OPS_TTAS_INIT;
+
+	ck_assert(atomic_ops_ttas_trylock(&ttas));
+	ck_assert(!atomic_ops_ttas_trylock(&ttas));
+	atomic_ops_ttas_unlock(&ttas);
+	atomic_ops_ttas_lock(&ttas);
+	ck_assert(!atomic_ops_ttas_trylock(&ttas));
+	atomic_ops_ttas_unlock(&ttas);
+
+	atomic_ops_ttas_lock_init(&ttas, 0, 0);
+	ck_assert(ttas.backoff_min == 1 && ttas.backoff_max == 1);
+
+	atomic_ops_ticket ticket = ATOMIC_OPS_TICKET_INIT;
+
+	ck_assert(atomic_ops_ticket_trylock(&ticket));
+	ck_assert(!atomic_ops_ticket_trylock(&ticket));
+	atomic_ops_ticket_unlock(&ticket);
+	atomic_ops_ticket_lock(&ticket);
+	ck_assert(!atomic_ops_ticket_trylock(&ticket));
+	atomic_ops_ticket_unlock(&ticket);
+	ck_assert(atomic_ops_uint_load(&ticket.next, ATOMIC_OPS_FENCE_NONE) == 2);
+	ck_assert(atomic_ops_uint_load(&ticket.owner, ATOMIC_OPS_FENCE_NONE) == 2);
+
+	atomic_ops_mcs mcs = ATOMIC_OPS_MCS_INIT;
+	atomic_ops_mcs_node mcs_a, mcs_b;
+
+	ck_assert(atomic_ops_mcs_trylock(&mcs, &mcs_a));
+	ck_assert(!atomic_ops_mcs_trylock(&mcs, &mcs_b));
+	atomic_ops_mcs_unlock(&mcs, &mcs_a);
+	ck_assert(atomic_ops_ptr_load(&mcs.tail, ATOMIC_OPS_FENCE_NONE) == NULL);
+	atomic_ops_mcs_lock(&mcs, &mcs_b);
+	ck_assert(!atomic_ops_mcs_trylock(&mcs, &mcs_a));
+	atomic_ops_mcs_unlock(&mcs, &mcs_b);
+
+	atomic_ops_clh clh;
+	atomic_ops_clh_node *clh_a = atomic_ops_clh_node_create(), *clh_b = atomic_ops_clh_node_create();
+
+	ck_assert(clh_a != NULL && clh_b != NULL);
+	ck_assert(atomic_ops_clh_lock_init(&clh));
+	ck_assert(atomic_ops_clh_trylock(&clh, clh_a));
+	ck_assert(!atomic_ops_clh_trylock(&clh, clh_b));
+
+	// Unlocking hands back the dummy node, ours stays in the lock
+	atomic_ops_clh_node *dummy = atomic_ops_clh_unlock(&clh, clh_a);
+
+	ck_assert(dummy != clh_a);
+	ck_assert(atomic_ops_dptr_load(&clh.tail, ATOMIC_OPS_FENCE_NONE).lo == (uintptr_t)clh_a);
+	atomic_ops_clh_lock(&clh, clh_b);
+	ck_assert(!atomic_ops_clh_trylock(&clh, dummy));
+	ck_assert(atomic_ops_clh_unlock(&clh, clh_b) == clh_a);
+
+	free(dummy);
+	free(clh_a);
+	atomic_ops_clh_lock_destroy(&clh);
+} END_TEST
+
+#define LOCK_THREADS 4
+#define LOCK_ITERATIONS 1000
+
+static atomic_ops_ttas lock_ttas = ATOMIC_OPS_TTAS_INIT;
+static atomic_ops_ticket lock_ticket = ATOMIC_OPS_TICKET_INIT;
+static atomic_ops_mcs lock_mcs = ATOMIC_OPS_MCS_INIT;
+static atomic_ops_clh lock_clh;
+
+// Plain, non-atomic counters: any overlap of critical sections loses increments
+static volatile size_t lock_counters[4];
+
+static void *lock_worker(void *arg) {
+	UNUSED_ARGUMENT(arg);
+
+	atomic_ops_mcs_node mcs;
+	atomic_ops_clh_node *clh = atomic_ops_clh_node_create();
+
+	ck_assert(clh != NULL);
+
+	for (size_t i = 0; i < LOCK_ITERATIONS; i++) {
+		atomic_ops_ttas_lock(&lock_ttas);
+		lock_counters[0] = lock_counters[0] + 1;
+		atomic_ops_ttas_unlock(&lock_ttas);
+
+		atomic_ops_ticket_lock(&lock_ticket);
+		lock_counters[1] = lock_counters[1] + 1;
+		atomic_ops_ticket_unlock(&lock_ticket);
+
+		atomic_ops_mcs_lock(&lock_mcs, &mcs);
+		lock_counters[2] = lock_counters[2] + 1;
+		atomic_ops_mcs_unlock(&lock_mcs, &mcs);
+
+		atomic_ops_clh_lock(&lock_clh, clh);
+		lock_counters[3] = lock_counters[3] + 1;
+		clh = atomic_ops_clh_unlock(&lock_clh, clh);
+	}
+
+	free(clh);
+
+	return (NULL);
+}
+
+START_TEST(test_atomic_ops_lock_threads) {
+	pthread_t threads[LOCK_THREADS];
+
+	ck_assert(atomic_ops_clh_lock_init(&lock_clh));
+
+	for (size_t i = 0; i < LOCK_THREADS; i++) {
+		ck_assert(pthread_create(&threads[i], NULL, &lock_worker, NULL) == 0);
+	}
+
+	for (size_t i = 0; i < LOCK_THREADS; i++) {
+		pthread_join(threads[i], NULL);
+	}
+
+	for (size_t i = 0; i < 4; i++) {
+		ck_assert(lock_counters[i] == LOCK_THREADS * LOCK_ITERATIONS);
+	}
+
+	atomic_ops_clh_lock_destroy(&lock_clh);
+} END_TEST
+
+static atomic_ops_clh lock_clh_mixed;
+static volatile size_t lock_clh_counter;
+static atomic_ops_uint lock_clh_inside = ATOMIC_OPS_UINT_INIT(0);
+static atomic_ops_uint lock_clh_overlaps = ATOMIC_OPS_UINT_INIT(0);
+
+// Mix lock and trylock, so trylocks race with nodes being handed over
+static void *lock_clh_worker(void *arg) {
+	UNUSED_ARGUMENT(arg);
+
+	atomic_ops_clh_node *clh = atomic_ops_clh_node_create();
+
+	ck_assert(clh != NULL);
+
+	for (size_t i = 0; i < LOCK_ITERATIONS; i++) {
+		if ((i % 3) == 0 || !atomic_ops_clh_trylock(&lock_clh_mixed, clh)) {
+			atomic_ops_clh_lock(&lock_clh_mixed, clh);
+		}
+
+		if (atomic_ops_uint_fetch_and_inc(&lock_clh_inside, ATOMIC_OPS_FENCE_NONE) != 0) {
+			atomic_ops_uint_inc(&lock_clh_overlaps, ATOMIC_OPS_FENCE_NONE);
+		}
+
+		lock_clh_counter = lock_clh_counter + 1;
+
+		atomic_ops_uint_dec(&lock_clh_inside, ATOMIC_OPS_FENCE_NONE);
+
+		clh = atomic_ops_clh_unlock(&lock_clh_mixed, clh);
+	}
+
+	free(clh);
+
+	return (NULL);
+}
+
+START_TEST(test_atomic_ops_lock_clh_trylock) {
+	pthread_t threads[LOCK_THREADS];
+
+	ck_assert(atomic_ops_clh_lock_init(&lock_clh_mixed));
+
+	for (size_t i = 0; i < LOCK_THREADS; i++) {
+		ck_assert(pthread_create(&threads[i], NULL, &lock_clh_worker, NULL) == 0);
+	}
+
+	for (size_t i = 0; i < LOCK_THREADS; i++) {
+		pthread_join(threads[i], NULL);
+	}
+
+	ck_assert(atomic_ops_uint_load(&lock_clh_overlaps, ATOMIC_OPS_FENCE_FULL) == 0);
+	ck_assert(lock_clh_counter == LOCK_THREADS * LOCK_ITERATIONS);
+
+	atomic_ops_clh_lock_destroy(&lock_clh_mixed);
+} END_TEST
+
+static atomic_ops_clh lock_clh_recycle;
+static atomic_ops_clh_node *lock_clh_recycled;
+static atomic_ops_uint lock_clh_held = ATOMIC_OPS_UINT_INIT(0);
+static atomic_ops_uint lock_clh_release = ATOMIC_OPS_UINT_INIT(0);
+
+// Cycle the node at the tail through another lock and unlock, and lock it again, holding the lock until told
+static void *lock_clh_recycler(void *arg) {
+	atomic_ops_clh_node *node = arg;
+
+	atomic_ops_clh_lock(&lock_clh_recycle, node);
+	node = atomic_ops_clh_unlock(&lock_clh_recycle, node);
+	ck_assert(node == lock_clh_recycled);
+	atomic_ops_clh_lock(&lock_clh_recycle, node);
+
+	atomic_ops_uint_store(&lock_clh_held, 1, ATOMIC_OPS_FENCE_RELEASE);
+
+	while (atomic_ops_uint_load(&lock_clh_release, ATOMIC_OPS_FENCE_ACQUIRE) == 0) {
+		sched_yield();
+	}
+
+	free(atomic_ops_clh_unlock(&lock_clh_recycle, node));
+
+	return (NULL);
+}
+
+START_TEST(test_atomic_ops_lock_clh_recycle) {
+	pthread_t thread;
+	atomic_ops_clh_node *node = atomic_ops_clh_node_create(), *other = atomic_ops_clh_node_create();
+
+	ck_assert(node != NULL && other != NULL);
+	ck_assert(atomic_ops_clh_lock_init(&lock_clh_recycle));
+
+	// Leave our node free at the tail, and keep a stale view of it
+	atomic_ops_clh_lock(&lock_clh_recycle, node);
+	lock_clh_recycled = node;
+	node = atomic_ops_clh_unlock(&lock_clh_recycle, node);
+
+	atomic_ops_dptr_val stale = atomic_ops_dptr_load(&lock_clh_recycle.tail, ATOMIC_OPS_FENCE_NONE);
+
+	ck_assert(stale.lo == (uintptr_t)lock_clh_recycled);
+	ck_assert(pthread_create(&thread, NULL, &lock_clh_recycler, other) == 0);
+
+	while (atomic_ops_uint_load(&lock_clh_held, ATOMIC_OPS_FENCE_ACQUIRE) == 0) {
+		sched_yield();
+	}
+
+	// Same node at the tail, locked now: the version tells it apart, and trylock fails right away
+	atomic_ops_dptr_val tail = atomic_ops_dptr_load(&lock_clh_recycle.tail, ATOMIC_OPS_FENCE_NONE);
+	atomic_ops_dptr_val newtail = { (uintptr_t)node, stale.hi + 1 };
+
+	ck_assert(tail.lo == stale.lo && tail.hi != stale.hi);
+	ck_assert(!atomic_ops_dptr_cas(&lock_clh_recycle.tail, stale, newtail, ATOMIC_OPS_FENCE_FULL));
+	ck_assert(!atomic_ops_clh_trylock(&lock_clh_recycle, node));
+
+	atomic_ops_uint_store(&lock_clh_release, 1, ATOMIC_OPS_FENCE_RELEASE);
+	pthread_join(thread, NULL);
+
+	ck_assert(atomic_ops_clh_trylock(&lock_clh_recycle, node));
+	free(atomic_ops_clh_unlock(&lock_clh_recycle, node));
+	atomic_ops_clh_lock_destroy(&lock_clh_recycle);
+} END_TEST
+
+Suite *test_atomic_ops_lock(void) {
+	Suite *s = suite_create("test_atomic_ops_lock");
+
+	TCASE_ADD(atomic_ops_lock_single);
+	TCASE_ADD(atomic_ops_lock_threads);
+	TCASE_ADD(atomic_ops_lock_clh_trylock);
+	TCASE_ADD(atomic_ops_lock_clh_recycle);
+
+	return (s);
+}
+
+/******************************************************************************/
+
+START_TEST(test_atomic_ops_rwlock_single) {
+	atomic_ops_rwlock lock;
+
+	for (size_t p = 0; p < 2; p++) {
+		ck_assert(atomic_ops_rwlock_init(&lock, (p == 0) ? (ATOMIC_OPS_RWLOCK_WRITER) : (ATOMIC_OPS_RWLOCK_READER)));
+
+		// Readers share the lock, even on the same slot
+		ck_assert(atomic_ops_rwlock_read_trylock(&lock));
+		atomic_ops_rwlock_read_lock(&lock);
+		ck_assert(!atomic_ops_rwlock_write_trylock(&lock));
+		ck_assert(atomic_ops_uint_load(&lock.writer, ATOMIC_OPS_FENCE_NONE) == 0);
+		atomic_ops_rwlock_read_unlock(&lock);
+		ck_assert(!atomic_ops_rwlock_write_trylock(&lock));
+		atomic_ops_rwlock_read_unlock(&lock);
+
+		// Writers exclude everyone
+		ck_assert(atomic_ops_rwlock_write_trylock(&lock));
+		ck_assert(!atomic_ops_rwlock_write_trylock(&lock));
+		ck_assert(!atomic_ops_rwlock_read_trylock(&lock));
+		atomic_ops_rwlock_write_unlock(&lock);
+
+		atomic_ops_rwlock_write_lock(&lock);
+		ck_assert(!atomic_ops_rwlock_read_trylock(&lock));
+		atomic_ops_rwlock_write_unlock(&lock);
+
+		ck_assert(atomic_ops_rwlock_read_trylock(&lock));
+		atomic_ops_rwlock_read_unlock(&lock);
+
+		for (size_t i = 0; i < ATOMIC_OPS_RWLOCK_SLOTS; i++) {
+			ck_assert(atomic_ops_uint_padded_load(&lock.slots[i], ATOMIC_OPS_FENCE_NONE) == 0);
+		}
+
+		atomic_ops_rwlock_destroy(&lock);
+	}
+
+	// Stable for a thread
+	ck_assert(atomic_ops_thread_slot() == atomic_ops_thread_slot());
+} END_TEST
+
+#define RWLOCK_THREADS 4
+#define RWLOCK_ITERATIONS 20000
+
+static atomic_ops_rwlock rwlock_shared;
+
+// Written in two halves: a reader seeing them differ overlapped a writer
+static volatile uintptr_t rwlock_data[2];
+static size_t rwlock_writes[RWLOCK_THREADS];
+
+static void *rwlock_worker(void *arg) {
+	uintptr_t id = (uintptr_t)arg;
+
+	for (size_t i = 0; i < RWLOCK_ITERATIONS; i++) {
+		if (i % 8 == id) {
+			atomic_ops_rwlock_write_lock(&rwlock_shared);
+			rwlock_data[0] = rwlock_data[0] + 1;
+			rwlock_data[1] = rwlock_data[1] + 1;
+			atomic_ops_rwlock_write_unlock(&rwlock_shared);
+
+			rwlock_writes[id]++;
+		}
+		else {
+			atomic_ops_rwlock_read_lock(&rwlock_shared);
+			ck_assert(rwlock_data[0] == rwlock_data[1]);
+			atomic_ops_rwlock_read_unlock(&rwlock_shared);
+		}
+	}
+
+	return (NULL);
+}
+
+START_TEST(test_atomic_ops_rwlock_threads) {
+	pthread_t threads[RWLOCK_THREADS];
+
+	for (size_t p = 0; p < 2; p++) {
+		size_t writes = 0;
+
+		rwlock_data[0] = 0;
+		rwlock_data[1] = 0;
+		ck_assert(atomic_ops_rwlock_init(&rwlock_shared, (p == 0) ? (ATOMIC_OPS_RWLOCK_WRITER) : (ATOMIC_OPS_RWLOCK_READER)));
+
+		for (uintptr_t i = 0; i < RWLOCK_THREADS; i++) {
+			rwlock_writes[i] = 0;
+			ck_assert(pthread_create(&threads[i], NULL, &rwlock_worker, (void *)i) == 0);
+		}
+
+		for (size_t i = 0; i < RWLOCK_THREADS; i++) {
+			pthread_join(threads[i], NULL);
+			writes += rwlock_writes[i];
+		}
+
+		ck_assert(rwlock_data[0] == writes);
+		ck_assert(rwlock_data[1] == writes);
+
+		atomic_ops_rwlock_destroy(&rwlock_shared);
+	}
+} END_TEST
+
+Suite *test_atomic_ops_rwlock(void) {
+	Suite *s = suite_create("test_atomic_ops_rwlock");
+
+	TCASE_ADD(atomic_ops_rwlock_single);
+	TCASE_ADD(atomic_ops_rwlock_threads);
+
+	return (s);
+}
+
+/******************************************************************************/
+
+typedef struct {
+	uintptr_t id;
+	uintptr_t bid;
+	uintptr_t ask;
+	uintptr_t check; // id ^ bid ^ ask
+} seqlock_quote;
+
+GEN_atomic_ops_seqlock(seqlock_quote, quote)
+
+START_TEST(test_atomic_ops_seqlock_single) {
+	atomic_ops_seqlock lock = ATOMIC_OPS_SEQLOCK_INIT;
+
+	uintptr_t seq = atomic_ops_seqlock_read_begin(&lock);
+	ck_assert(seq == 0);
+	ck_assert(!atomic_ops_seqlock_read_retry(&lock, seq));
+
+	// A write in between forces a retry, even once it's over
+	atomic_ops_seqlock_write_begin(&lock);
+	ck_assert(atomic_ops_seqlock_read_retry(&lock, seq));
+	ck_assert(atomic_ops_uint_load(&lock.seq, ATOMIC_OPS_FENCE_NONE) == 1);
+	atomic_ops_seqlock_write_end(&lock);
+	ck_assert(atomic_ops_seqlock_read_retry(&lock, seq));
+
+	seq = atomic_ops_seqlock_read_begin(&lock);
+	ck_assert(seq == 2);
+
+	atomic_ops_seqlock_write_lock(&lock);
+	ck_assert(atomic_ops_uint_load(&lock.seq, ATOMIC_OPS_FENCE_NONE) == 3);
+	atomic_ops_seqlock_write_unlock(&lock);
+	ck_assert(atomic_ops_seqlock_read_begin(&lock) == 4);
+
+	atomic_ops_seqlock_quote sl = { ATOMIC_OPS_SEQLOCK_INIT, { 0, 0, 0, 0 } };
+	seqlock_quote in = { 1, 100, 101, 1 ^ 100 ^ 101 }, out;
+
+	atomic_ops_seqlock_quote_write(&sl, &in);
+	atomic_ops_seqlock_quote_read(&sl, &out);
+	ck_assert(memcmp(&in, &out, sizeof(seqlock_quote)) == 0);
+	ck_assert(atomic_ops_uint_load(&sl.lock.seq, ATOMIC_OPS_FENCE_NONE) == 2);
+} END_TEST
+
+#define SEQLOCK_WRITERS 2
+#define SEQLOCK_READERS 2
+#define SEQLOCK_ITERATIONS 100000
+
+static atomic_ops_seqlock_quote seqlock_shared;
+
+static void *seqlock_writer(void *arg) {
+	uintptr_t id = (uintptr_t)arg;
+
+	for (uintptr_t i = 0; i < SEQLOCK_ITERATIONS; i++) {
+		seqlock_quote q = { id, i, i * 3 + id, 0 };
+
+		q.check = q.id ^ q.bid ^ q.ask;
+		atomic_ops_seqlock_quote_write(&seqlock_shared, &q);
+	}
+
+	return (NULL);
+}
+
+static void *seqlock_reader(void *arg) {
+	UNUSED_ARGUMENT(arg);
+
+	for (size_t i = 0; i < SEQLOCK_ITERATIONS; i++) {
+		seqlock_quote q;
+
+		atomic_ops_seqlock_quote_read(&seqlock_shared, &q);
+		ck_assert(q.check == (q.id ^ q.bid ^ q.ask));
+	}
+
+	return (NULL);
+}
+
+START_TEST(test_atomic_ops_seqlock_threads) {
+	pthread_t threads[SEQLOCK_WRITERS + SEQLOCK_READERS];
+
+	atomic_ops_seqlock_init(&seqlock_shared.lock);
+	memset(&seqlock_shared.data, 0, sizeof(seqlock_quote));
+
+	for (uintptr_t i = 0; i < SEQLOCK_WRITERS + SEQLOCK_READERS; i++) {
+		ck_assert(pthread_create(&threads[i], NULL, (i < SEQLOCK_WRITERS) ? (&seqlock_writer) : (&seqlock_reader), (void *)i) == 0);
+	}
+
+	for (size_t i = 0; i < SEQLOCK_WRITERS + SEQLOCK_READERS; i++) {
+		pthread_join(threads[i], NULL);
+	}
+
+	// Every write bumped the sequence twice, none was lost
+	ck_assert(atomic_ops_uint_load(&seqlock_shared.lock.seq, ATOMIC_OPS_FENCE_NONE) == 2 * SEQLOCK_WRITERS * SEQLOCK_ITERATIONS);
+	ck_assert(seqlock_shared.data.bid == SEQLOCK_ITERATIONS - 1);
+} END_TEST
+
+Suite *test_atomic_ops_seqlock(void) {
+	Suite *s = suite_create("test_atomic_ops_seqlock");
+
+	TCASE_ADD(atomic_ops_seqlock_single);
+	TCASE_ADD(atomic_ops_seqlock_threads);
+
+	return (s);
+}
+
+/******************************************************************************/
+
+START_TEST(test_atomic_ops_counter_single) {
+	atomic_ops_counter counter;
+
+	ck_assert(atomic_ops_counter_init(&counter));
+	ck_assert(atomic_ops_counter_read(&counter) == 0);
+
+	atomic_ops_counter_inc(&counter);
+	atomic_ops_counter_add(&counter, 41);
+	ck_assert(atomic_ops_counter_read(&counter) == 42);
+
+	atomic_ops_counter_add(&counter, (uintptr_t)-2);
+	ck_assert(atomic_ops_counter_read(&counter) == 40);
+
+	ck_assert(atomic_ops_counter_reset(&counter) == 40);
+	ck_assert(atomic_ops_counter_read(&counter) == 0);
+	ck_assert(atomic_ops_counter_reset(&counter) == 0);
+
+	atomic_ops_counter_destroy(&counter);
+} END_TEST
+
+#define COUNTER_THREADS 4
+#define COUNTER_ITERATIONS 100000
+
+static atomic_ops_counter counter_shared;
+static atomic_ops_uint counter_done = ATOMIC_OPS_UINT_INIT(0);
+
+static void *counter_worker(void *arg) {
+	UNUSED_ARGUMENT(arg);
+
+	for (size_t i = 0; i < COUNTER_ITERATIONS; i++) {
+		atomic_ops_counter_inc(&counter_shared);
+	}
+
+	atomic_ops_uint_inc(&counter_done, ATOMIC_OPS_FENCE_RELEASE);
+
+	return (NULL);
+}
+
+START_TEST(test_atomic_ops_counter_threads) {
+	pthread_t threads[COUNTER_THREADS];
+	uintptr_t total = 0;
+
+	ck_assert(atomic_ops_counter_init(&counter_shared));
+
+	for (size_t i = 0; i < COUNTER_THREADS; i++) {
+		ck_assert(pthread_create(&threads[i], NULL, &counter_worker, NULL) == 0);
+	}
+
+	// Resetting while updates go on must lose none of them
+	while (atomic_ops_uint_load(&counter_done, ATOMIC_OPS_FENCE_ACQUIRE) != COUNTER_THREADS) {
+		total += atomic_ops_counter_reset(&counter_shared);
+	}
+
+	for (size_t i = 0; i < COUNTER_THREADS; i++) {
+		pthread_join(threads[i], NULL);
+	}
+
+	total += atomic_ops_counter_reset(&counter_shared);
+	ck_assert(total == COUNTER_THREADS * COUNTER_ITERATIONS);
+
+	atomic_ops_counter_destroy(&counter_shared);
+} END_TEST
+
+Suite *test_atomic_ops_counter(void) {
+	Suite *s = suite_create("test_atomic_ops_counter");
+
+	TCASE_ADD(atomic_ops_counter_single);
+	TCASE_ADD(atomic_ops_counter_threads);
+
+	return (s);
+}
+
+/******************************************************************************/
+
+START_TEST(test_atomic_ops_padded_ops) {
+	atomic_ops_int_padded ia[2] = { ATOMIC_OPS_INT_PADDED_INIT(-5), ATOMIC_OPS_INT_PADDED_INIT(0) };
+	atomic_ops_uint_padded ua[2] = { ATOMIC_OPS_UINT_PADDED_INIT(5), ATOMIC_OPS_UINT_PADDED_INIT(0) };
+	atomic_ops_ptr_padded pa[2] = { ATOMIC_OPS_PTR_PADDED_INIT(NULL), ATOMIC_OPS_PTR_PADDED_INIT(NULL) };
+	int obj;
+
+	// Each one alone in its block
+	ck_assert(sizeof(atomic_ops_int_padded) == ATOMIC_OPS_DESTRUCTIVE_SIZE);
+	ck_assert(sizeof(atomic_ops_uint_padded) == ATOMIC_OPS_DESTRUCTIVE_SIZE);
+	ck_assert(sizeof(atomic_ops_ptr_padded) == ATOMIC_OPS_DESTRUCTIVE_SIZE);
+	ck_assert(((uintptr_t)&ia[0] % ATOMIC_OPS_DESTRUCTIVE_SIZE) == 0);
+	ck_assert(((uintptr_t)&ua[1] % ATOMIC_OPS_DESTRUCTIVE_SIZE) == 0);
+	ck_assert(((uintptr_t)&pa[1] - (uintptr_t)&pa[0]) == ATOMIC_OPS_DESTRUCTIVE_SIZE);
+	ck_assert(ATOMIC_OPS_DESTRUCTIVE_SIZE >= ATOMIC_OPS_CACHELINE_SIZE);
+
+	ck_assert(atomic_ops_int_padded_load(&ia[0], ATOMIC_OPS_FENCE_NONE) == -5);
+	atomic_ops_int_padded_add(&ia[0], 10, ATOMIC_OPS_FENCE_NONE);
+	atomic_ops_int_padded_dec(&ia[0], ATOMIC_OPS_FENCE_NONE);
+	ck_assert(atomic_ops_int_padded_fetch_and_inc(&ia[0], ATOMIC_OPS_FENCE_FULL) == 4);
+	ck_assert(atomic_ops_int_padded_swap(&ia[0], -1, ATOMIC_OPS_FENCE_FULL) == 5);
+	ck_assert(atomic_ops_int_padded_cas(&ia[0], -1, 7, ATOMIC_OPS_FENCE_FULL));
+	ck_assert(atomic_ops_int_padded_casr(&ia[0], -1, 8, ATOMIC_OPS_FENCE_FULL) == 7);
+	atomic_ops_int_padded_not(&ia[0], ATOMIC_OPS_FENCE_NONE);
+	ck_assert(atomic_ops_int_padded_load(&ia[0], ATOMIC_OPS_FENCE_NONE) == ~7);
+	ck_assert(atomic_ops_int_padded_load(&ia[1], ATOMIC_OPS_FENCE_NONE) == 0);
+
+	atomic_ops_uint_padded_store(&ua[0], 0xF0, ATOMIC_OPS_FENCE_RELEASE);
+	atomic_ops_uint_padded_and(&ua[0], 0x3C, ATOMIC_OPS_FENCE_NONE);
+	atomic_ops_uint_padded_or(&ua[0], 0x01, ATOMIC_OPS_FENCE_NONE);
+	atomic_ops_uint_padded_xor(&ua[0], 0x11, ATOMIC_OPS_FENCE_NONE);
+	ck_assert(atomic_ops_uint_padded_load(&ua[0], ATOMIC_OPS_FENCE_ACQUIRE) == 0x20);
+	atomic_ops_uint_padded_inc(&ua[0], ATOMIC_OPS_FENCE_NONE);
+	ck_assert(atomic_ops_uint_padded_fetch_and_add(&ua[0], 2, ATOMIC_OPS_FENCE_NONE) == 0x21);
+	ck_assert(atomic_ops_uint_padded_fetch_and_dec(&ua[0], ATOMIC_OPS_FENCE_NONE) == 0x23);
+	ck_assert(atomic_ops_uint_padded_load(&ua[1], ATOMIC_OPS_FENCE_NONE) == 0);
+
+	ck_assert(!atomic_ops_uint_padded_test_and_set_bit(&ua[0], 3, ATOMIC_OPS_FENCE_FULL));
+	ck_assert(atomic_ops_uint_padded_test_and_complement_bit(&ua[0], 3, ATOMIC_OPS_FENCE_FULL));
+	ck_assert(!atomic_ops_uint_padded_test_and_clear_bit(&ua[0], 3, ATOMIC_OPS_FENCE_FULL));
+	ck_assert(atomic_ops_int_padded_test_and_clear_bit(&ia[0], 3, ATOMIC_OPS_FENCE_FULL));
+	ck_assert(atomic_ops_int_padded_load(&ia[0], ATOMIC_OPS_FENCE_NONE) == ~15);
+
+	atomic_ops_ptr_padded_store(&pa[0], &obj, ATOMIC_OPS_FENCE_NONE);
+	ck_assert(atomic_ops_ptr_padded_load(&pa[0], ATOMIC_OPS_FENCE_NONE) == &obj);
+	ck_assert(!atomic_ops_ptr_padded_cas(&pa[0], NULL, &ia, ATOMIC_OPS_FENCE_FULL));
+	ck_assert(atomic_ops_ptr_padded_casr(&pa[0], &obj, &ua, ATOMIC_OPS_FENCE_FULL) == &obj);
+	ck_assert(atomic_ops_ptr_padded_swap(&pa[0], NULL, ATOMIC_OPS_FENCE_FULL) == &ua);
+	ck_assert(atomic_ops_ptr_padded_load(&pa[1], ATOMIC_OPS_FENCE_NONE) == NULL);
+} END_TEST
+
+Suite *test_atomic_ops_padded(void) {
+	Suite *s = suite_create("test_atomic_ops_padded");
+
+	TCASE_ADD(atomic_ops_padded_ops);
+
+	return (s);
+}
+
+/******************************************************************************/
+
+START_TEST(test_atomic_ops_fixed_unsigned) {
+	atomic_ops_u8 u8 = ATOMIC_OPS_U8_INIT(UINT8_MAX);
+	atomic_ops_u16 u16 = ATOMIC_OPS_U16_INIT(0);
+	atomic_ops_u32 u32 = ATOMIC_OPS_U32_INIT(UINT32_MAX - 1);
+
+	ck_assert(sizeof(atomic_ops_u8) == 1);
+	ck_assert(sizeof(atomic_ops_u16) == 2);
+	ck_assert(sizeof(atomic_ops_u32) == 4);
+
+	// Wraparound happens at the type's own width
+	atomic_ops_u8_inc(&u8, ATOMIC_OPS_FENCE_NONE);
+	ck_assert(atomic_ops_u8_load(&u8, ATOMIC_OPS_FENCE_NONE) == 0);
+	ck_assert(atomic_ops_u8_fetch_and_dec(&u8, ATOMIC_OPS_FENCE_FULL) == 0);
+	ck_assert(atomic_ops_u8_fetch_and_add(&u8, 2, ATOMIC_OPS_FENCE_FULL) == UINT8_MAX);
+	ck_assert(atomic_ops_u8_load(&u8, ATOMIC_OPS_FENCE_ACQUIRE) == 1);
+	atomic_ops_u8_not(&u8, ATOMIC_OPS_FENCE_NONE);
+	ck_assert(atomic_ops_u8_load(&u8, ATOMIC_OPS_FENCE_NONE) == 0xFE);
+	atomic_ops_u8_and(&u8, 0x3C, ATOMIC_OPS_FENCE_NONE);
+	atomic_ops_u8_or(&u8, 0x01, ATOMIC_OPS_FENCE_NONE);
+	atomic_ops_u8_xor(&u8, 0x11, ATOMIC_OPS_FENCE_NONE);
+	ck_assert(atomic_ops_u8_load(&u8, ATOMIC_OPS_FENCE_NONE) == 0x2C);
+	ck_assert(!atomic_ops_u8_cas(&u8, 0x2D, 0x80, ATOMIC_OPS_FENCE_FULL));
+	ck_assert(atomic_ops_u8_casr(&u8, 0x2C, 0x80, ATOMIC_OPS_FENCE_FULL) == 0x2C);
+	ck_assert(atomic_ops_u8_swap(&u8, 0xFF, ATOMIC_OPS_FENCE_FULL) == 0x80);
+
+	atomic_ops_u16_dec(&u16, ATOMIC_OPS_FENCE_NONE);
+	ck_assert(atomic_ops_u16_load(&u16, ATOMIC_OPS_FENCE_NONE) == UINT16_MAX);
+	atomic_ops_u16_add(&u16, 0x8001, ATOMIC_OPS_FENCE_NONE);
+	ck_assert(atomic_ops_u16_fetch_and_inc(&u16, ATOMIC_OPS_FENCE_NONE) == 0x8000);
+	ck_assert(atomic_ops_u16_cas(&u16, 0x8001, 0xBEEF, ATOMIC_OPS_FENCE_FULL));
+	ck_assert(atomic_ops_u16_swap(&u16, 1, ATOMIC_OPS_FENCE_FULL) == 0xBEEF);
+
+	atomic_ops_u32_add(&u32, 3, ATOMIC_OPS_FENCE_NONE);
+	ck_assert(atomic_ops_u32_load(&u32, ATOMIC_OPS_FENCE_NONE) == 1);
+	atomic_ops_u32_store(&u32, 0xDEADBEEF, ATOMIC_OPS_FENCE_RELEASE);
+	ck_assert(atomic_ops_u32_casr(&u32, 0xDEADBEEF, 0, ATOMIC_OPS_FENCE_FULL) == 0xDEADBEEF);
+	ck_assert(atomic_ops_u32_fetch_and_dec(&u32, ATOMIC_OPS_FENCE_NONE) == 0);
+	ck_assert(atomic_ops_u32_load(&u32, ATOMIC_OPS_FENCE_NONE) == UINT32_MAX);
+
+#if UINTPTR_MAX == UINT64_MAX
+	atomic_ops_u64 u64 = ATOMIC_OPS_U64_INIT(UINT32_MAX);
+
+	ck_assert(sizeof(atomic_ops_u64) == 8);
+
+	// Carries into the upper half
+	atomic_ops_u64_inc(&u64, ATOMIC_OPS_FENCE_NONE);
+	ck_assert(atomic_ops_u64_load(&u64, ATOMIC_OPS_FENCE_NONE) == UINT64_C(0x100000000));
+	ck_assert(atomic_ops_u64_swap(&u64, UINT64_MAX, ATOMIC_OPS_FENCE_FULL) == UINT64_C(0x100000000));
+	ck_assert(atomic_ops_u64_fetch_and_inc(&u64, ATOMIC_OPS_FENCE_FULL) == UINT64_MAX);
+	ck_assert(atomic_ops_u64_cas(&u64, 0, UINT64_C(1) << 63, ATOMIC_OPS_FENCE_FULL));
+	atomic_ops_u64_xor(&u64, UINT64_MAX, ATOMIC_OPS_FENCE_NONE);
+	ck_assert(atomic_ops_u64_load(&u64, ATOMIC_OPS_FENCE_NONE) == INT64_MAX);
+#endif
+} END_TEST
+
+START_TEST(test_atomic_ops_fixed_signed) {
+	atomic_ops_i8 i8 = ATOMIC_OPS_I8_INIT(INT8_MAX);
+	atomic_ops_i16 i16 = ATOMIC_OPS_I16_INIT(INT16_MIN);
+	atomic_ops_i32 i32 = ATOMIC_OPS_I32_INIT(-1);
+
+	// Signed values come back sign extended
+	atomic_ops_i8_inc(&i8, ATOMIC_OPS_FENCE_NONE);
+	ck_assert(atomic_ops_i8_load(&i8, ATOMIC_OPS_FENCE_NONE) == INT8_MIN);
+	ck_assert(atomic_ops_i8_fetch_and_add(&i8, -1, ATOMIC_OPS_FENCE_FULL) == INT8_MIN);
+	ck_assert(atomic_ops_i8_swap(&i8, -5, ATOMIC_OPS_FENCE_FULL) == INT8_MAX);
+	ck_assert(atomic_ops_i8_casr(&i8, -5, -6, ATOMIC_OPS_FENCE_FULL) == -5);
+	ck_assert(atomic_ops_i8_fetch_and_inc(&i8, ATOMIC_OPS_FENCE_NONE) == -6);
+	atomic_ops_i8_not(&i8, ATOMIC_OPS_FENCE_NONE);
+	ck_assert(atomic_ops_i8_load(&i8, ATOMIC_OPS_FENCE_NONE) == 4);
+
+	atomic_ops_i16_dec(&i16, ATOMIC_OPS_FENCE_NONE);
+	ck_assert(atomic_ops_i16_load(&i16, ATOMIC_OPS_FENCE_NONE) == INT16_MAX);
+	ck_assert(atomic_ops_i16_fetch_and_dec(&i16, ATOMIC_OPS_FENCE_NONE) == INT16_MAX);
+	atomic_ops_i16_store(&i16, -300, ATOMIC_OPS_FENCE_FULL);
+	ck_assert(atomic_ops_i16_cas(&i16, -300, -301, ATOMIC_OPS_FENCE_FULL));
+	ck_assert(atomic_ops_i16_load(&i16, ATOMIC_OPS_FENCE_NONE) == -301);
+
+	atomic_ops_i32_add(&i32, -10, ATOMIC_OPS_FENCE_NONE);
+	ck_assert(atomic_ops_i32_load(&i32, ATOMIC_OPS_FENCE_NONE) == -11);
+	atomic_ops_i32_and(&i32, ~0xFF, ATOMIC_OPS_FENCE_NONE);
+	atomic_ops_i32_or(&i32, 0x0F, ATOMIC_OPS_FENCE_NONE);
+	ck_assert(atomic_ops_i32_load(&i32, ATOMIC_OPS_FENCE_NONE) == -241);
+	ck_assert(atomic_ops_i32_casr(&i32, 0, 1, ATOMIC_OPS_FENCE_FULL) == -241);
+
+#if UINTPTR_MAX == UINT64_MAX
+	atomic_ops_i64 i64 = ATOMIC_OPS_I64_INIT(INT64_MIN);
+
+	atomic_ops_i64_dec(&i64, ATOMIC_OPS_FENCE_NONE);
+	ck_assert(atomic_ops_i64_load(&i64, ATOMIC_OPS_FENCE_NONE) == INT64_MAX);
+	ck_assert(atomic_ops_i64_fetch_and_add(&i64, INT64_MIN + 1, ATOMIC_OPS_FENCE_FULL) == INT64_MAX);
+	ck_assert(atomic_ops_i64_load(&i64, ATOMIC_OPS_FENCE_NONE) == 0);
+#endif
+} END_TEST
+
+// Operations on one element must leave its neighbours alone
+START_TEST(test_atomic_ops_fixed_neighbours) {
+	atomic_ops_u8 u8[8];
+	atomic_ops_i16 i16[4];
+
+	for (size_t i = 0; i < 8; i++) {
+		atomic_ops_u8_store(&u8[i], (uint8_t)(0xA0 + i), ATOMIC_OPS_FENCE_NONE);
+	}
+	for (size_t i = 0; i < 4; i++) {
+		atomic_ops_i16_store(&i16[i], (int16_t)(-1000 - (int)i), ATOMIC_OPS_FENCE_NONE);
+	}
+
+	atomic_ops_u8_swap(&u8[3], 0, ATOMIC_OPS_FENCE_FULL);
+	atomic_ops_u8_not(&u8[4], ATOMIC_OPS_FENCE_FULL);
+	atomic_ops_u8_add(&u8[7], 0x70, ATOMIC_OPS_FENCE_FULL);
+	ck_assert(atomic_ops_u8_cas(&u8[0], 0xA0, 0xFF, ATOMIC_OPS_FENCE_FULL));
+	ck_assert(!atomic_ops_u8_cas(&u8[1], 0xA0, 0xFF, ATOMIC_OPS_FENCE_FULL));
+
+	ck_assert(atomic_ops_u8_load(&u8[0], ATOMIC_OPS_FENCE_NONE) == 0xFF);
+	ck_assert(atomic_ops_u8_load(&u8[1], ATOMIC_OPS_FENCE_NONE) == 0xA1);
+	ck_assert(atomic_ops_u8_load(&u8[2], ATOMIC_OPS_FENCE_NONE) == 0xA2);
+	ck_assert(atomic_ops_u8_load(&u8[3], ATOMIC_OPS_FENCE_NONE) == 0);
+	ck_assert(atomic_ops_u8_load(&u8[4], ATOMIC_OPS_FENCE_NONE) == 0x5B);
+	ck_assert(atomic_ops_u8_load(&u8[5], ATOMIC_OPS_FENCE_NONE) == 0xA5);
+	ck_assert(atomic_ops_u8_load(&u8[6], ATOMIC_OPS_FENCE_NONE) == 0xA6);
+	ck_assert(atomic_ops_u8_load(&u8[7], ATOMIC_OPS_FENCE_NONE) == 0x17);
+
+	atomic_ops_i16_inc(&i16[1], ATOMIC_OPS_FENCE_FULL);
+	ck_assert(atomic_ops_i16_swap(&i16[2], 7, ATOMIC_OPS_FENCE_FULL) == -1002);
+
+	ck_assert(atomic_ops_i16_load(&i16[0], ATOMIC_OPS_FENCE_NONE) == -1000);
+	ck_assert(atomic_ops_i16_load(&i16[1], ATOMIC_OPS_FENCE_NONE) == -1000);
+	ck_assert(atomic_ops_i16_load(&i16[2], ATOMIC_OPS_FENCE_NONE) == 7);
+	ck_assert(atomic_ops_i16_load(&i16[3], ATOMIC_OPS_FENCE_NONE) == -1003);
+} END_TEST
+
+#define FIXED_THREADS 4
+#define FIXED_ITERATIONS 100000
+
+// All threads hammer bytes of the same word, each its own
+static atomic_ops_u8 fixed_bytes[FIXED_THREADS] ATTR_ALIGNED(sizeof(uint32_t));
+
+static void *fixed_incrementer(void *arg) {
+	size_t i = (size_t)arg;
+
+	for (size_t n = 0; n < FIXED_ITERATIONS; n++) {
+		if ((n % 2) == 0) {
+			atomic_ops_u8_inc(&fixed_bytes[i], ATOMIC_OPS_FENCE_NONE);
+		}
+		else {
+			uint8_t val;
+
+			do {
+				val = atomic_ops_u8_load(&fixed_bytes[i], ATOMIC_OPS_FENCE_NONE);
+			} while (!atomic_ops_u8_cas(&fixed_bytes[i], val, (uint8_t)(val + 1), ATOMIC_OPS_FENCE_NONE));
+		}
+	}
+
+	return (NULL);
+}
+
+START_TEST(test_atomic_ops_fixed_threads) {
+	pthread_t threads[FIXED_THREADS];
+
+	for (size_t i = 0; i < FIXED_THREADS; i++) {
+		atomic_ops_u8_store(&fixed_bytes[i], (uint8_t)i, ATOMIC_OPS_FENCE_NONE);
+	}
+
+	for (size_t i = 0; i < FIXED_THREADS; i++) {
+		ck_assert(pthread_create(&threads[i], NULL, &fixed_incrementer, (void *)i) == 0);
+	}
+
+	for (size_t i = 0; i < FIXED_THREADS; i++) {
+		ck_assert(pthread_join(threads[i], NULL) == 0);
+	}
+
+	// No lost update on any byte, in spite of sharing the word
+	for (size_t i = 0; i < FIXED_THREADS; i++) {
+		ck_assert(atomic_ops_u8_load(&fixed_bytes[i], ATOMIC_OPS_FENCE_NONE) == (uint8_t)(i + FIXED_ITERATIONS));
+	}
+} END_TEST
+
+Suite *test_atomic_ops_fixed(void) {
+	Suite *s = suite_create("test_atomic_ops_fixed");
+
+	TCASE_ADD(atomic_ops_fixed_unsigned);
+	TCASE_ADD(atomic_ops_fixed_signed);
+	TCASE_ADD(atomic_ops_fixed_neighbours);
+	TCASE_ADD(atomic_ops_fixed_threads);
+
+	return (s);
+}
+
+/******************************************************************************/
+
+START_TEST(test_atomic_ops_bitmap_single) {
+	atomic_ops_bitmap bitmap;
+	size_t id;
+
+	ck_assert(!atomic_ops_bitmap_init(&bitmap, 0));
+	ck_assert(atomic_ops_bitmap_init(&bitmap, 130));
+
+	// Lowest first, and never past the end
+	for (size_t i = 0; i < 130; i++) {
+		ck_assert(atomic_ops_bitmap_alloc(&bitmap, &id));
+		ck_assert(id == i);
+		ck_assert(atomic_ops_bitmap_test(&bitmap, id));
+	}
+
+	ck_assert(!atomic_ops_bitmap_alloc(&bitmap, &id));
+	ck_assert(!atomic_ops_bitmap_alloc_near(&bitmap, 129, &id));
+
+	atomic_ops_bitmap_free(&bitmap, 64);
+	ck_assert(!atomic_ops_bitmap_test(&bitmap, 64));
+	ck_assert(atomic_ops_bitmap_alloc(&bitmap, &id));
+	ck_assert(id == 64);
+
+	// Near: at or after the hint, wrapping around
+	atomic_ops_bitmap_free(&bitmap, 5);
+	atomic_ops_bitmap_free(&bitmap, 100);
+	ck_assert(atomic_ops_bitmap_alloc_near(&bitmap, 50, &id));
+	ck_assert(id == 100);
+	ck_assert(atomic_ops_bitmap_alloc_near(&bitmap, 101, &id));
+	ck_assert(id == 5);
+
+	atomic_ops_bitmap_free(&bitmap, 129);
+	ck_assert(atomic_ops_bitmap_alloc_near(&bitmap, 1000, &id));
+	ck_assert(id == 129);
+	ck_assert(!atomic_ops_bitmap_alloc(&bitmap, &id));
+
+	atomic_ops_bitmap_destroy(&bitmap);
+} END_TEST
+
+// More map words than one summary word covers: full words must be skipped, and found again once freed
+START_TEST(test_atomic_ops_bitmap_large) {
+	atomic_ops_bitmap bitmap;
+	size_t bits = (ATOMIC_OPS_BITMAP_WORD_BITS * ATOMIC_OPS_BITMAP_WORD_BITS * 3) + 7;
+	size_t id;
+
+	ck_assert(atomic_ops_bitmap_init(&bitmap, bits));
+
+	for (size_t i = 0; i < bits; i++) {
+		ck_assert(atomic_ops_bitmap_alloc(&bitmap, &id));
+		ck_assert(id == i);
+	}
+
+	ck_assert(!atomic_ops_bitmap_alloc(&bitmap, &id));
+
+	atomic_ops_bitmap_free(&bitmap, bits - 1);
+	atomic_ops_bitmap_free(&bitmap, bits / 2);
+	ck_assert(atomic_ops_bitmap_alloc(&bitmap, &id));
+	ck_assert(id == bits / 2);
+	ck_assert(atomic_ops_bitmap_alloc_near(&bitmap, 3, &id));
+	ck_assert(id == bits - 1);
+	ck_assert(!atomic_ops_bitmap_alloc_near(&bitmap, 3, &id));
+
+	atomic_ops_bitmap_destroy(&bitmap);
+} END_TEST
+
+#define BITMAP_THREADS 4
+#define BITMAP_IDS 160
+#define BITMAP_HELD 40
+#define BITMAP_ITERATIONS 20000
+
+static atomic_ops_bitmap bitmap_shared;
+static atomic_ops_uint bitmap_owners[BITMAP_IDS];
+
+// Every allocated ID must belong to us alone until we free it
+static void *bitmap_worker(void *arg) {
+	uintptr_t me = (uintptr_t)arg + 1;
+	size_t held[BITMAP_HELD];
+	size_t count = 0;
+
+	for (size_t i = 0; i < BITMAP_ITERATIONS; i++) {
+		size_t id;
+
+		if (count < BITMAP_HELD && (i % 3) != 2) {
+			bool ok = ((i % 2) == 0) ? (atomic_ops_bitmap_alloc(&bitmap_shared, &id)) : (atomic_ops_bitmap_alloc_near(&bitmap_shared, i % BITMAP_IDS, &id));
+
+			// There are exactly enough IDs for all the threads to hold their maximum
+			ck_assert(ok);
+			ck_assert(id < BITMAP_IDS);
+			ck_assert(atomic_ops_uint_cas(&bitmap_owners[id], 0, me, ATOMIC_OPS_FENCE_NONE));
+
+			held[count++] = id;
+		}
+		else if (count > 0) {
+			id = held[--count];
+
+			ck_assert(atomic_ops_uint_cas(&bitmap_owners[id], me, 0, ATOMIC_OPS_FENCE_NONE));
+			atomic_ops_bitmap_free(&bitmap_shared, id);
+		}
+	}
+
+	while (count > 0) {
+		size_t id = held[--count];
+
+		ck_assert(atomic_ops_uint_cas(&bitmap_owners[id], me, 0, ATOMIC_OPS_FENCE_NONE));
+		atomic_ops_bitmap_free(&bitmap_shared, id);
+	}
+
+	return (NULL);
+}
+
+START_TEST(test_atomic_ops_bitmap_threads) {
+	pthread_t threads[BITMAP_THREADS];
+	size_t id;
+
+	ck_assert(BITMAP_THREADS * BITMAP_HELD == BITMAP_IDS);
+	ck_assert(atomic_ops_bitmap_init(&bitmap_shared, BITMAP_IDS));
+
+	for (size_t i = 0; i < BITMAP_IDS; i++) {
+		atomic_ops_uint_store(&bitmap_owners[i], 0, ATOMIC_OPS_FENCE_NONE);
+	}
+
+	for (size_t i = 0; i < BITMAP_THREADS; i++) {
+		ck_assert(pthread_create(&threads[i], NULL, &bitmap_worker, (void *)i) == 0);
+	}
+
+	for (size_t i = 0; i < BITMAP_THREADS; i++) {
+		ck_assert(pthread_join(threads[i], NULL) == 0);
+	}
+
+	// All freed: every ID can be had again, no summary bit left behind
+	for (size_t i = 0; i < BITMAP_IDS; i++) {
+		ck_assert(atomic_ops_bitmap_alloc(&bitmap_shared, &id));
+		ck_assert(id == i);
+	}
+
+	ck_assert(!atomic_ops_bitmap_alloc(&bitmap_shared, &id));
+
+	atomic_ops_bitmap_destroy(&bitmap_shared);
+} END_TEST
+
+Suite *test_atomic_ops_bitmap(void) {
+	Suite *s = suite_create("test_atomic_ops_bitmap");
+
+	TCASE_ADD(atomic_ops_bitmap_single);
+	TCASE_ADD(atomic_ops_bitmap_large);
+	TCASE_ADD(atomic_ops_bitmap_threads);
+
+	return (s);
+}
+
+/******************************************************************************/
+
+START_TEST(test_atomic_ops_histogram_dense) {
+	atomic_ops_histogram hist;
+	atomic_ops_histogram_local local;
+	uintptr_t out[100];
+
+	ck_assert(!atomic_ops_histogram_init(&hist, 0));
+	ck_assert(atomic_ops_histogram_init(&hist, 100));
+	ck_assert(atomic_ops_histogram_local_init(&local, &hist));
+	ck_assert(local.dense != NULL);
+
+	atomic_ops_histogram_inc(&local, 0);
+	atomic_ops_histogram_inc(&local, 99);
+	atomic_ops_histogram_add(&local, 50, 41);
+	atomic_ops_histogram_inc(&local, 50);
+
+	// Buffered until flushed
+	ck_assert(atomic_ops_histogram_read(&hist, 50) == 0);
+
+	atomic_ops_histogram_flush(&local);
+	atomic_ops_histogram_snapshot(&hist, out);
+
+	for (size_t i = 0; i < 100; i++) {
+		ck_assert(out[i] == ((i == 50) ? (42) : ((i == 0 || i == 99) ? (1) : (0))));
+	}
+
+	atomic_ops_histogram_add(&local, 50, (uintptr_t)-2);
+	atomic_ops_histogram_flush(&local);
+	ck_assert(atomic_ops_histogram_read(&hist, 50) == 40);
+
+	atomic_ops_histogram_reset(&hist, out);
+	ck_assert(out[50] == 40);
+	ck_assert(atomic_ops_histogram_read(&hist, 50) == 0);
+
+	// Flushed every ATOMIC_OPS_HISTOGRAM_FLUSH samples, the rest on destroy
+	for (size_t i = 0; i < ATOMIC_OPS_HISTOGRAM_FLUSH + 1; i++) {
+		atomic_ops_histogram_inc(&local, i % 100);
+	}
+
+	ck_assert(atomic_ops_histogram_read(&hist, 0) == ATOMIC_OPS_HISTOGRAM_FLUSH / 100 + ((ATOMIC_OPS_HISTOGRAM_FLUSH % 100) != 0));
+
+	atomic_ops_histogram_local_destroy(&local);
+	atomic_ops_histogram_reset(&hist, out);
+
+	uintptr_t total = 0;
+
+	for (size_t i = 0; i < 100; i++) {
+		total += out[i];
+	}
+
+	ck_assert(total == ATOMIC_OPS_HISTOGRAM_FLUSH + 1);
+
+	atomic_ops_histogram_destroy(&hist);
+} END_TEST
+
+#define HISTOGRAM_SPARSE_SIZE (ATOMIC_OPS_HISTOGRAM_DENSE * 16)
+
+START_TEST(test_atomic_ops_histogram_sparse) {
+	atomic_ops_histogram hist;
+	atomic_ops_histogram_local local;
+
+	ck_assert(atomic_ops_histogram_init(&hist, HISTOGRAM_SPARSE_SIZE));
+	ck_assert(atomic_ops_histogram_local_init(&local, &hist));
+	ck_assert(local.dense == NULL);
+
+	// More distinct buckets than the table holds: it flushes when full, and nothing gets lost
+	for (size_t round = 0; round < 3; round++) {
+		for (size_t i = 0; i < ATOMIC_OPS_HISTOGRAM_BUFFER * 2; i++) {
+			atomic_ops_histogram_add(&local, (i * 997) % HISTOGRAM_SPARSE_SIZE, i + 1);
+		}
+	}
+
+	atomic_ops_histogram_flush(&local);
+
+	for (size_t i = 0; i < ATOMIC_OPS_HISTOGRAM_BUFFER * 2; i++) {
+		ck_assert(atomic_ops_histogram_read(&hist, (i * 997) % HISTOGRAM_SPARSE_SIZE) == (i + 1) * 3);
+	}
+
+	atomic_ops_histogram_inc(&local, HISTOGRAM_SPARSE_SIZE - 1);
+	atomic_ops_histogram_local_destroy(&local);
+	ck_assert(atomic_ops_histogram_read(&hist, HISTOGRAM_SPARSE_SIZE - 1) == 1);
+
+	atomic_ops_histogram_destroy(&hist);
+} END_TEST
+
+#define HISTOGRAM_THREADS 4
+#define HISTOGRAM_ITERATIONS 100000
+#define HISTOGRAM_SIZE 256
+
+static atomic_ops_histogram histogram_shared;
+static atomic_ops_uint histogram_done = ATOMIC_OPS_UINT_INIT(0);
+
+// Samples come in pairs, mirrored around the middle: flushes happen between pairs only
+static void *histogram_worker(void *arg) {
+	atomic_ops_histogram_local local;
+	size_t id = (size_t)arg;
+
+	ck_assert(atomic_ops_histogram_local_init(&local, &histogram_shared));
+
+	for (size_t i = 0; i < HISTOGRAM_ITERATIONS; i++) {
+		size_t bucket = (i * 7 + id) % (HISTOGRAM_SIZE / 2);
+
+		atomic_ops_histogram_inc(&local, bucket);
+		atomic_ops_histogram_inc(&local, HISTOGRAM_SIZE - 1 - bucket);
+
+		if ((i % 1000) == 999) {
+			atomic_ops_histogram_flush(&local);
+		}
+	}
+
+	atomic_ops_histogram_local_destroy(&local);
+	atomic_ops_uint_inc(&histogram_done, ATOMIC_OPS_FENCE_RELEASE);
+
+	return (NULL);
+}
+
+START_TEST(test_atomic_ops_histogram_threads) {
+	pthread_t threads[HISTOGRAM_THREADS];
+	uintptr_t out[HISTOGRAM_SIZE];
+	uintptr_t lo, hi;
+
+	ck_assert((ATOMIC_OPS_HISTOGRAM_FLUSH % 2) == 0);
+	ck_assert(atomic_ops_histogram_init(&histogram_shared, HISTOGRAM_SIZE));
+
+	for (size_t i = 0; i < HISTOGRAM_THREADS; i++) {
+		ck_assert(pthread_create(&threads[i], NULL, &histogram_worker, (void *)i) == 0);
+	}
+
+	// Snapshots never see half a flush: both halves always hold the same number of samples
+	do {
+		atomic_ops_histogram_snapshot(&histogram_shared, out);
+		lo = 0;
+		hi = 0;
+
+		for (size_t i = 0; i < HISTOGRAM_SIZE / 2; i++) {
+			lo += out[i];
+			hi += out[HISTOGRAM_SIZE - 1 - i];
+		}
+
+		ck_assert(lo == hi);
+	} while (atomic_ops_uint_load(&histogram_done, ATOMIC_OPS_FENCE_ACQUIRE) != HISTOGRAM_THREADS);
+
+	for (size_t i = 0; i < HISTOGRAM_THREADS; i++) {
+		pthread_join(threads[i], NULL);
+	}
+
+	atomic_ops_histogram_snapshot(&histogram_shared, out);
+	lo = 0;
+
+	for (size_t i = 0; i < HISTOGRAM_SIZE / 2; i++) {
+		ck_assert(out[i] == out[HISTOGRAM_SIZE - 1 - i]);
+		lo += out[i];
+	}
+
+	ck_assert(lo == HISTOGRAM_THREADS * HISTOGRAM_ITERATIONS);
+
+	atomic_ops_histogram_destroy(&histogram_shared);
+} END_TEST
+
+Suite *test_atomic_ops_histogram(void) {
+	Suite *s = suite_create("test_atomic_ops_histogram");
+
+	TCASE_ADD(atomic_ops_histogram_dense);
+	TCASE_ADD(atomic_ops_histogram_sparse);
+	TCASE_ADD(atomic_ops_histogram_threads);
+
+	return (s);
+}
+
+/******************************************************************************/
+
+START_TEST(test_atomic_ops_combiner_counter_single) {
+	atomic_ops_combiner_counter counter;
+	atomic_ops_combiner_record *rec;
+
+	atomic_ops_combiner_counter_init(&counter, 10);
+
+	rec = atomic_ops_combiner_acquire(&counter.combiner);
+	ck_assert(rec != NULL);
+
+	ck_assert(atomic_ops_combiner_counter_fetch_and_add(&counter, rec, 5) == 10);
+	ck_assert(atomic_ops_combiner_counter_fetch_and_add(&counter, rec, (uintptr_t)-1) == 15);
+	ck_assert(atomic_ops_combiner_counter_read(&counter, rec) == 14);
+
+	// Released records get reused
+	atomic_ops_combiner_release(&counter.combiner, rec);
+	ck_assert(atomic_ops_combiner_acquire(&counter.combiner) == rec);
+	ck_assert(atomic_ops_combiner_acquire(&counter.combiner) != rec);
+
+	atomic_ops_combiner_counter_destroy(&counter);
+} END_TEST
+
+START_TEST(test_atomic_ops_combiner_pq_single) {
+	atomic_ops_combiner_pq pq;
+	atomic_ops_combiner_record *rec;
+	uintptr_t key;
+	void *value;
+
+	atomic_ops_combiner_pq_init(&pq);
+
+	rec = atomic_ops_combiner_acquire(&pq.combiner);
+	ck_assert(rec != NULL);
+
+	ck_assert(!atomic_ops_combiner_pq_pop(&pq, rec, &key, &value));
+
+	// Enough to grow the heap a few times, in scrambled order
+	for (uintptr_t i = 0; i < 1000; i++) {
+		uintptr_t k = (i * 617) % 1000;
+
+		ck_assert(atomic_ops_combiner_pq_push(&pq, rec, k, (void *)(k + 1)));
+	}
+
+	for (uintptr_t i = 0; i < 1000; i++) {
+		ck_assert(atomic_ops_combiner_pq_pop(&pq, rec, &key, &value));
+		ck_assert(key == i);
+		ck_assert(value == (void *)(i + 1));
+	}
+
+	ck_assert(!atomic_ops_combiner_pq_pop(&pq, rec, &key, &value));
+
+	atomic_ops_combiner_release(&pq.combiner, rec);
+	atomic_ops_combiner_pq_destroy(&pq);
+} END_TEST
+
+#define COMBINER_THREADS 4
+#define COMBINER_ITERATIONS 20000
+
+static atomic_ops_combiner_counter combiner_counter;
+static atomic_ops_combiner_pq combiner_pq;
+static atomic_ops_uint combiner_sum = ATOMIC_OPS_UINT_INIT(0);
+static atomic_ops_uint combiner_popped[COMBINER_THREADS * COMBINER_ITERATIONS];
+
+// Every thread pushes its own keys, and pops as many of anyone's
+static void *combiner_worker(void *arg) {
+	atomic_ops_combiner_record *counter_rec = atomic_ops_combiner_acquire(&combiner_counter.combiner);
+	atomic_ops_combiner_record *pq_rec = atomic_ops_combiner_acquire(&combiner_pq.combiner);
+	size_t id = (size_t)arg;
+	uintptr_t sum = 0, key;
+	void *value;
+
+	ck_assert(counter_rec != NULL && pq_rec != NULL);
+
+	for (size_t i = 0; i < COMBINER_ITERATIONS; i++) {
+		sum += atomic_ops_combiner_counter_fetch_and_add(&combiner_counter, counter_rec, 1);
+
+		key = i * COMBINER_THREADS + id;
+		ck_assert(atomic_ops_combiner_pq_push(&combiner_pq, pq_rec, key, (void *)(key + 1)));
+
+		ck_assert(atomic_ops_combiner_pq_pop(&combiner_pq, pq_rec, &key, &value));
+		ck_assert(value == (void *)(key + 1));
+		ck_assert(atomic_ops_uint_fetch_and_inc(&combiner_popped[key], ATOMIC_OPS_FENCE_NONE) == 0);
+	}
+
+	atomic_ops_uint_add(&combiner_sum, sum, ATOMIC_OPS_FENCE_NONE);
+
+	atomic_ops_combiner_release(&combiner_counter.combiner, counter_rec);
+	atomic_ops_combiner_release(&combiner_pq.combiner, pq_rec);
+
+	return (NULL);
+}
+
+START_TEST(test_atomic_ops_combiner_threads) {
+	pthread_t threads[COMBINER_THREADS];
+	uintptr_t n = COMBINER_THREADS * COMBINER_ITERATIONS;
+
+	atomic_ops_combiner_counter_init(&combiner_counter, 0);
+	atomic_ops_combiner_pq_init(&combiner_pq);
+
+	for (size_t i = 0; i < n; i++) {
+		atomic_ops_uint_store(&combiner_popped[i], 0, ATOMIC_OPS_FENCE_NONE);
+	}
+
+	for (size_t i = 0; i < COMBINER_THREADS; i++) {
+		ck_assert(pthread_create(&threads[i], NULL, &combiner_worker, (void *)i) == 0);
+	}
+
+	for (size_t i = 0; i < COMBINER_THREADS; i++) {
+		ck_assert(pthread_join(threads[i], NULL) == 0);
+	}
+
+	// Every fetch_and_add returned a different value: together, all of 0 .. n-1
+	ck_assert(atomic_ops_uint_load(&combiner_sum, ATOMIC_OPS_FENCE_NONE) == n * (n - 1) / 2);
+	ck_assert(combiner_counter.value == n);
+
+	// Every key popped exactly once
+	ck_assert(combiner_pq.len == 0);
+
+	for (size_t i = 0; i < n; i++) {
+		ck_assert(atomic_ops_uint_load(&combiner_popped[i], ATOMIC_OPS_FENCE_NONE) == 1);
+	}
+
+	atomic_ops_combiner_counter_destroy(&combiner_counter);
+	atomic_ops_combiner_pq_destroy(&combiner_pq);
+} END_TEST
+
+Suite *test_atomic_ops_combiner(void) {
+	Suite *s = suite_create("test_atomic_ops_combiner");
+
+	TCASE_ADD(atomic_ops_combiner_counter_single);
+	TCASE_ADD(atomic_ops_combiner_pq_single);
+	TCASE_ADD(atomic_ops_combiner_threads);
+
+	return (s);
+}
+
+/******************************************************************************/
+
+START_TEST(test_atomic_ops_stack_single) {
+	atomic_ops_stack stack;
+	atomic_ops_stack_node nodes[3];
+
+	atomic_ops_stack_init(&stack);
+	ck_assert(atomic_ops_stack_empty(&stack));
+	ck_assert(atomic_ops_stack_pop(&stack) == NULL);
+
+	for (size_t i = 0; i < 3; i++) {
+		atomic_ops_stack_push(&stack, &nodes[i]);
+	}
+
+	ck_assert(!atomic_ops_stack_empty(&stack));
+
+	// LIFO
+	ck_assert(atomic_ops_stack_pop(&stack) == &nodes[2]);
+	ck_assert(atomic_ops_stack_pop(&stack) == &nodes[1]);
+
+	// Same top node again, but not the same top: the version tells them apart
+	atomic_ops_dptr_val before = atomic_ops_dptr_load(&stack.top, ATOMIC_OPS_FENCE_NONE);
+	atomic_ops_stack_push(&stack, &nodes[1]);
+	ck_assert(atomic_ops_stack_pop(&stack) == &nodes[1]);
+	atomic_ops_dptr_val after = atomic_ops_dptr_load(&stack.top, ATOMIC_OPS_FENCE_NONE);
+	ck_assert(after.lo == before.lo);
+	ck_assert(after.hi == before.hi + 2);
+
+	ck_assert(atomic_ops_stack_pop(&stack) == &nodes[0]);
+	ck_assert(atomic_ops_stack_pop(&stack) == NULL);
+	ck_assert(atomic_ops_stack_empty(&stack));
+
+	// Elimination: the first attempt always uses slot 0; an offer nobody takes is withdrawn
+	ck_assert(!atomic_ops_stack_eliminate_push(&stack, &nodes[0], 0));
+	ck_assert(atomic_ops_ptr_padded_load(&stack.slots[0], ATOMIC_OPS_FENCE_NONE) == NULL);
+	ck_assert(atomic_ops_stack_eliminate_pop(&stack, 0) == NULL);
+
+	atomic_ops_ptr_padded_store(&stack.slots[0], &nodes[0], ATOMIC_OPS_FENCE_NONE);
+	ck_assert(atomic_ops_stack_eliminate_pop(&stack, 0) == &nodes[0]);
+	ck_assert(atomic_ops_ptr_padded_load(&stack.slots[0], ATOMIC_OPS_FENCE_NONE) == NULL);
+} END_TEST
+
+#define STACK_THREADS 4
+#define STACK_ITERATIONS 100000
+#define STACK_NODES 8 // Per thread, at the start
+
+typedef struct {
+	atomic_ops_stack_node node; // First: node pointers are element pointers
+	atomic_ops_uint on_stack;
+} stack_elem;
+
+static atomic_ops_stack stack_shared;
+static stack_elem stack_elems[STACK_THREADS * STACK_NODES];
+
+// Push one held node, pop one: a node popped twice, or lost, shows up in on_stack
+static void *stack_worker(void *arg) {
+	stack_elem *held[STACK_THREADS * STACK_NODES];
+	size_t id = (size_t)arg, count = 0;
+
+	for (size_t i = 0; i < STACK_NODES; i++) {
+		held[count++] = &stack_elems[id * STACK_NODES + i];
+	}
+
+	for (size_t i = 0; i < STACK_ITERATIONS; i++) {
+		if (count > 0) {
+			stack_elem *e = held[--count];
+
+			ck_assert(atomic_ops_uint_cas(&e->on_stack, 0, 1, ATOMIC_OPS_FENCE_NONE));
+			atomic_ops_stack_push(&stack_shared, &e->node);
+		}
+
+		stack_elem *e = (stack_elem *)atomic_ops_stack_pop(&stack_shared);
+
+		if (e != NULL) {
+			ck_assert(atomic_ops_uint_cas(&e->on_stack, 1, 0, ATOMIC_OPS_FENCE_NONE));
+			held[count++] = e;
+		}
+	}
+
+	while (count > 0) {
+		stack_elem *e = held[--count];
+
+		ck_assert(atomic_ops_uint_cas(&e->on_stack, 0, 1, ATOMIC_OPS_FENCE_NONE));
+		atomic_ops_stack_push(&stack_shared, &e->node);
+	}
+
+	return (NULL);
+}
+
+START_TEST(test_atomic_ops_stack_threads) {
+	pthread_t threads[STACK_THREADS];
+	stack_elem *e;
+	size_t count = 0;
+
+	atomic_ops_stack_init(&stack_shared);
+
+	for (size_t i = 0; i < STACK_THREADS * STACK_NODES; i++) {
+		atomic_ops_uint_store(&stack_elems[i].on_stack, 0, ATOMIC_OPS_FENCE_NONE);
+	}
+
+	for (size_t i = 0; i < STACK_THREADS; i++) {
+		ck_assert(pthread_create(&threads[i], NULL, &stack_worker, (void *)i) == 0);
+	}
+
+	for (size_t i = 0; i < STACK_THREADS; i++) {
+		ck_assert(pthread_join(threads[i], NULL) == 0);
+	}
+
+	// All nodes back on the stack, each exactly once
+	while ((e = (stack_elem *)atomic_ops_stack_pop(&stack_shared)) != NULL) {
+		ck_assert(atomic_ops_uint_cas(&e->on_stack, 1, 0, ATOMIC_OPS_FENCE_NONE));
+		count++;
+	}
+
+	ck_assert(count == STACK_THREADS * STACK_NODES);
+
+	for (size_t i = 0; i < ATOMIC_OPS_STACK_SLOTS; i++) {
+		ck_assert(atomic_ops_ptr_padded_load(&stack_shared.slots[i], ATOMIC_OPS_FENCE_NONE) == NULL);
+	}
+} END_TEST
+
+Suite *test_atomic_ops_stack(void) {
+	Suite *s = suite_create("test_atomic_ops_stack");
+
+	TCASE_ADD(atomic_ops_stack_single);
+	TCASE_ADD(atomic_ops_stack_threads);
+
+	return (s);
+}
+
+/******************************************************************************/
+
+START_TEST(test_atomic_ops_backoff_limit) {
+	atomic_ops_emu_backoff none = ATOMIC_OPS_EMU_BACKOFF_INIT, expo = ATOMIC_OPS_EMU_BACKOFF_INIT, randomized = ATOMIC_OPS_EMU_BACKOFF_INIT;
+
+	atomic_ops_emu_backoff_policy(&none, ATOMIC_OPS_EMU_BACKOFF_NONE);
+	ck_assert(none.limit == 0);
+
+	// Doubles from one pause after the first failure, then stays at the maximum, even if not a power of two
+	for (uint32_t i = 1; expo.limit < ATOMIC_OPS_EMU_BACKOFF_MAX; i *= 2) {
+		ck_assert(expo.limit == ((i == 1) ? (0) : (i)));
+		ck_assert(randomized.limit == expo.limit);
+
+		atomic_ops_emu_backoff_policy(&expo, ATOMIC_OPS_EMU_BACKOFF_EXP);
+		atomic_ops_emu_backoff_policy(&randomized, ATOMIC_OPS_EMU_BACKOFF_RAND);
+	}
+
+	ck_assert(expo.limit == ATOMIC_OPS_EMU_BACKOFF_MAX);
+
+	atomic_ops_emu_backoff_policy(&expo, ATOMIC_OPS_EMU_BACKOFF_EXP);
+	atomic_ops_emu_backoff_policy(&randomized, ATOMIC_OPS_EMU_BACKOFF_RAND);
+
+	ck_assert(expo.limit == ATOMIC_OPS_EMU_BACKOFF_MAX);
+	ck_assert(randomized.limit == ATOMIC_OPS_EMU_BACKOFF_MAX);
+} END_TEST
+
+Suite *test_atomic_ops_backoff(void) {
+	Suite *s = suite_create("test_atomic_ops_backoff");
+
+	TCASE_ADD(atomic_ops_backoff_limit);
+
+	return (s);
+}
+
+/******************************************************************************/
+
+#if defined(ATOMIC_OPS_STATS)
+START_TEST(test_atomic_ops_stats_counts) {
+	atomic_ops_stats_count before[ATOMIC_OPS_STATS_OPS], after[ATOMIC_OPS_STATS_OPS];
+	atomic_ops_uint atomic = ATOMIC_OPS_UINT_INIT(0);
+
+	atomic_ops_stats_merge(before);
+
+	ck_assert(atomic_ops_uint_cas(&atomic, 0, 1, ATOMIC_OPS_FENCE_FULL));
+	ck_assert(!atomic_ops_uint_cas(&atomic, 0, 2, ATOMIC_OPS_FENCE_FULL));
+	ck_assert(atomic_ops_uint_casr(&atomic, 0, 2, ATOMIC_OPS_FENCE_ACQUIRE) == 1);
+	atomic_ops_fence(ATOMIC_OPS_FENCE_RELEASE);
+
+	atomic_ops_stats_merge(after);
+
+	ck_assert(after[ATOMIC_OPS_STATS_OP_CAS].calls - before[ATOMIC_OPS_STATS_OP_CAS].calls == 2);
+	ck_assert(after[ATOMIC_OPS_STATS_OP_CAS].failures - before[ATOMIC_OPS_STATS_OP_CAS].failures == 1);
+	ck_assert(after[ATOMIC_OPS_STATS_OP_CAS].fences[3] - before[ATOMIC_OPS_STATS_OP_CAS].fences[3] == 2);
+	ck_assert(after[ATOMIC_OPS_STATS_OP_CASR].calls - before[ATOMIC_OPS_STATS_OP_CASR].calls == 1);
+	ck_assert(after[ATOMIC_OPS_STATS_OP_CASR].failures - before[ATOMIC_OPS_STATS_OP_CASR].failures == 1);
+	ck_assert(after[ATOMIC_OPS_STATS_OP_CASR].fences[1] - before[ATOMIC_OPS_STATS_OP_CASR].fences[1] == 1);
+	ck_assert(after[ATOMIC_OPS_STATS_OP_FENCE].fences[2] - before[ATOMIC_OPS_STATS_OP_FENCE].fences[2] == 1);
+
+#if defined(ATOMIC_OPS_STATS_SITES)
+	atomic_ops_stats_site_count sites[64];
+	uintptr_t untracked;
+	unsigned int line = __LINE__ + 3;
+
+	for (size_t i = 0; i < 5; i++) {
+		atomic_ops_uint_inc(&atomic, ATOMIC_OPS_FENCE_NONE);
+	}
+
+	size_t count = atomic_ops_stats_merge_sites(sites, 64, &untracked);
+	size_t found = 0;
+
+	for (size_t i = 0; i < count; i++) {
+		if (sites[i].line == line && strcmp(sites[i].file, __FILE__) == 0) {
+			ck_assert(sites[i].op == ATOMIC_OPS_STATS_OP_INC);
+			ck_assert(sites[i].count.calls == 5);
+			found++;
+		}
+	}
+
+	ck_assert(found == 1);
+#endif
+} END_TEST
+
+START_TEST(test_atomic_ops_stats_nested) {
+	atomic_ops_stats_count before[ATOMIC_OPS_STATS_OPS], after[ATOMIC_OPS_STATS_OPS];
+	atomic_ops_uint atomic = ATOMIC_OPS_UINT_INIT(0);
+	atomic_ops_uint other = ATOMIC_OPS_UINT_INIT(5);
+
+	atomic_ops_stats_merge(before);
+
+	// The inner load is counted first, the failure goes to the outer CAS
+	ck_assert(!atomic_ops_uint_cas(&atomic, atomic_ops_uint_load(&other, ATOMIC_OPS_FENCE_NONE), 9, ATOMIC_OPS_FENCE_FULL));
+	ck_assert(atomic_ops_uint_casr(&atomic, atomic_ops_uint_load(&other, ATOMIC_OPS_FENCE_NONE), 9, ATOMIC_OPS_FENCE_FULL) == 0);
+
+	atomic_ops_stats_merge(after);
+
+	ck_assert(after[ATOMIC_OPS_STATS_OP_LOAD].calls - before[ATOMIC_OPS_STATS_OP_LOAD].calls == 2);
+	ck_assert(after[ATOMIC_OPS_STATS_OP_LOAD].failures - before[ATOMIC_OPS_STATS_OP_LOAD].failures == 0);
+	ck_assert(after[ATOMIC_OPS_STATS_OP_CAS].calls - before[ATOMIC_OPS_STATS_OP_CAS].calls == 1);
+	ck_assert(after[ATOMIC_OPS_STATS_OP_CAS].failures - before[ATOMIC_OPS_STATS_OP_CAS].failures == 1);
+	ck_assert(after[ATOMIC_OPS_STATS_OP_CASR].calls - before[ATOMIC_OPS_STATS_OP_CASR].calls == 1);
+	ck_assert(after[ATOMIC_OPS_STATS_OP_CASR].failures - before[ATOMIC_OPS_STATS_OP_CASR].failures == 1);
+} END_TEST
+#endif
+
+Suite *test_atomic_ops_stats(void) {
+	Suite *s = suite_create("test_atomic_ops_stats");
+
+#if defined(ATOMIC_OPS_STATS)
+	TCASE_ADD(atomic_ops_stats_counts);
+	TCASE_ADD(atomic_ops_stats_nested);
+#endif
+
+	return (s);
+}
+
+/******************************************************************************/
+
+START_TEST(test_atomic_ops_slab_single) {
+	atomic_ops_slab_pool pool;
+	atomic_ops_slab_cache cache, other;
+	void *objs[3 * 4096];
+
+	ck_assert(!atomic_ops_slab_pool_init(&pool, 0));
+	ck_assert(!atomic_ops_slab_pool_init(&pool, ATOMIC_OPS_SLAB_BYTES));
+	ck_assert(atomic_ops_slab_pool_init(&pool, 24));
+	ck_assert(pool.size == 32);
+	ck_assert(pool.count * 3 <= sizeof(objs) / sizeof(objs[0]));
+
+	atomic_ops_slab_cache_init(&cache, &pool);
+	atomic_ops_slab_cache_init(&other, &pool);
+
+	// Three slabs' worth, all distinct and aligned
+	for (size_t i = 0; i < pool.count * 3; i++) {
+		objs[i] = atomic_ops_slab_alloc(&cache);
+		ck_assert(objs[i] != NULL);
+		ck_assert(((uintptr_t)objs[i] % ATOMIC_OPS_SLAB_ALIGN) == 0);
+		memset(objs[i], 0xA5, pool.size);
+	}
+
+	for (size_t i = 1; i < pool.count * 3; i++) {
+		ck_assert(objs[i] != objs[i - 1]);
+	}
+
+	// Freed locally: allocated again right away, last freed first
+	atomic_ops_slab_free(&cache, objs[5]);
+	ck_assert(atomic_ops_slab_alloc(&cache) == objs[5]);
+
+	// Freed through another cache: remote, reclaimed once the free list runs dry
+	ck_assert(atomic_ops_slab_alloc(&cache) != NULL);
+	atomic_ops_slab_free_bulk(&other, objs, 3);
+	ck_assert(atomic_ops_ptr_load(&atomic_ops_slab_of(objs[0])->remote, ATOMIC_OPS_FENCE_NONE) != NULL);
+
+	while (cache.free != NULL) {
+		ck_assert(atomic_ops_slab_alloc(&cache) != NULL);
+	}
+
+	ck_assert(atomic_ops_slab_alloc_bulk(&cache, objs + 3 * 4096 - 3, 3) == 3);
+	ck_assert(atomic_ops_ptr_load(&atomic_ops_slab_of(objs[0])->remote, ATOMIC_OPS_FENCE_NONE) == NULL);
+	ck_assert(other.slabs == NULL);
+
+	// Slabs of a destroyed cache get adopted, with what was freed into them meanwhile
+	atomic_ops_slab_cache_destroy(&cache);
+	ck_assert(!atomic_ops_stack_empty(&pool.orphans));
+
+	atomic_ops_slab_free(&other, objs[10]);
+	ck_assert(atomic_ops_slab_alloc(&other) == objs[10]);
+	ck_assert(other.slabs == atomic_ops_slab_of(objs[10]));
+
+	atomic_ops_slab_cache_destroy(&other);
+	atomic_ops_slab_pool_destroy(&pool);
+} END_TEST
+
+#define SLAB_ITEMS 200000
+
+static atomic_ops_slab_pool slab_pool;
+static atomic_ops_spsc_ring slab_ring;
+
+// Producer: allocates objects and stamps them with their sequence number
+static void *slab_producer(void *arg) {
+	atomic_ops_slab_cache cache;
+
+	UNUSED_ARGUMENT(arg);
+
+	atomic_ops_slab_cache_init(&cache, &slab_pool);
+
+	for (uintptr_t i = 0; i < SLAB_ITEMS; i++) {
+		uintptr_t *obj = atomic_ops_slab_alloc(&cache);
+
+		ck_assert(obj != NULL);
+		obj[0] = i;
+		obj[1] = ~i;
+
+		while (!atomic_ops_spsc_ring_try_push(&slab_ring, &obj)) {
+			sched_yield();
+		}
+	}
+
+	atomic_ops_slab_cache_destroy(&cache);
+
+	return (NULL);
+}
+
+// Consumer: checks the stamps, overwriting them so an object handed out twice shows up, and frees the objects remotely
+static void *slab_consumer(void *arg) {
+	atomic_ops_slab_cache cache;
+	uintptr_t *batch[16];
+	size_t count = 0;
+
+	UNUSED_ARGUMENT(arg);
+
+	atomic_ops_slab_cache_init(&cache, &slab_pool);
+
+	for (uintptr_t i = 0; i < SLAB_ITEMS; i++) {
+		uintptr_t *obj;
+
+		while (!atomic_ops_spsc_ring_try_pop(&slab_ring, &obj)) {
+			sched_yield();
+		}
+
+		ck_assert(obj[0] == i);
+		ck_assert(obj[1] == ~i);
+		obj[0] = obj[1] = 0;
+
+		if ((i & 1) == 0) {
+			atomic_ops_slab_free(&cache, obj);
+		}
+		else {
+			batch[count++] = obj;
+
+			if (count == 16) {
+				atomic_ops_slab_free_bulk(&cache, (void **)batch, count);
+				count = 0;
+			}
+		}
+	}
+
+	atomic_ops_slab_free_bulk(&cache, (void **)batch, count);
+	atomic_ops_slab_cache_destroy(&cache);
+
+	return (NULL);
+}
+
+START_TEST(test_atomic_ops_slab_threads) {
+	pthread_t producer, consumer;
+
+	ck_assert(atomic_ops_slab_pool_init(&slab_pool, 2 * sizeof(uintptr_t)));
+	ck_assert(atomic_ops_spsc_ring_init(&slab_ring, 256, sizeof(void *)));
+
+	ck_assert(pthread_create(&producer, NULL, &slab_producer, NULL) == 0);
+	ck_assert(pthread_create(&consumer, NULL, &slab_consumer, NULL) == 0);
+
+	ck_assert(pthread_join(producer, NULL) == 0);
+	ck_assert(pthread_join(consumer, NULL) == 0);
+
+	// Objects kept being recycled: at most the ring's worth in flight, plus a slab per cache
+	size_t slabs = 0;
+
+	for (atomic_ops_slab *slab = atomic_ops_ptr_load(&slab_pool.slabs, ATOMIC_OPS_FENCE_ACQUIRE); slab != NULL; slab = slab->all) {
+		slabs++;
+	}
+
+	ck_assert(slabs <= 2 + ((256 + slab_pool.count - 1) / slab_pool.count));
+
+	atomic_ops_spsc_ring_destroy(&slab_ring);
+	atomic_ops_slab_pool_destroy(&slab_pool);
+} END_TEST
+
+Suite *test_atomic_ops_slab(void) {
+	Suite *s = suite_create("test_atomic_ops_slab");
+
+	TCASE_ADD(atomic_ops_slab_single);
+	TCASE_ADD(atomic_ops_slab_threads);
+
+	return (s);
+}
+
+/******************************************************************************/